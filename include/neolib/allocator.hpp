@@ -38,15 +38,120 @@
 #include "neolib.hpp"
 #include <memory>
 #include <type_traits>
+#include <atomic>
+#include <string>
+#include <typeinfo>
 #include <boost/pool/pool_alloc.hpp>
 #include <neolib/memory.hpp>
+#include <neolib/allocator_stats.hpp>
 
 namespace neolib
 {
+	// per-thread cached pool: allocation and deallocation are a free list pop/push without any global lock
+	template <typename T, std::size_t ChunkSize = 16 * 1024>
+	using thread_safe_fast_pool_allocator = pool_allocator<T, ChunkSize, false, 0, true>;
+	// boost::fast_pool_allocator with allocation statistics; single threaded like the pool underneath. The 
+	// boost pool doesn't expose its chunks so reserved memory isn't reported.
 	template <typename T>
-	using thread_safe_fast_pool_allocator = boost::fast_pool_allocator<T, boost::default_user_allocator_new_delete>;
-	template <typename T>
-	using fast_pool_allocator = boost::fast_pool_allocator<T, boost::default_user_allocator_new_delete, boost::details::pool::null_mutex>;
+	class fast_pool_allocator : public boost::fast_pool_allocator<T, boost::default_user_allocator_new_delete, boost::details::pool::null_mutex>
+	{
+	private:
+		typedef boost::fast_pool_allocator<T, boost::default_user_allocator_new_delete, boost::details::pool::null_mutex> base_type;
+	public:
+		using typename base_type::pointer;
+		using typename base_type::size_type;
+	private:
+		class counters
+		{
+		public:
+			counters() : iObjects{ 0 }, iAllocations{ 0 }, iDeallocations{ 0 }, iPeakObjects{ 0 }
+			{
+				allocator_registry::instance().add(name(), [this]() { return stats(); });
+			}
+		public:
+			// leaked, like the boost pool's own singleton, so blocks can be freed during static destruction
+			static counters& instance()
+			{
+				static counters* sInstance = new counters{};
+				return *sInstance;
+			}
+		public:
+			void allocated(size_type aCount)
+			{
+				detail::bump_counter(iAllocations);
+				detail::bump_counter<std::uint64_t>(iObjects, aCount);
+				if (iObjects.load(std::memory_order_relaxed) > iPeakObjects.load(std::memory_order_relaxed))
+					iPeakObjects.store(iObjects.load(std::memory_order_relaxed), std::memory_order_relaxed);
+			}
+			void deallocated(size_type aCount)
+			{
+				detail::bump_counter(iDeallocations);
+				detail::bump_counter<std::uint64_t>(iObjects, 0 - static_cast<std::uint64_t>(aCount));
+			}
+			allocator_stats stats() const
+			{
+				allocator_stats result;
+				result.iAllocations = iAllocations.load(std::memory_order_relaxed);
+				result.iDeallocations = iDeallocations.load(std::memory_order_relaxed);
+				result.iLiveObjects = static_cast<std::size_t>(iObjects.load(std::memory_order_relaxed));
+				result.iBytesInUse = result.iLiveObjects * sizeof(T);
+				result.iHighWaterMark = static_cast<std::size_t>(iPeakObjects.load(std::memory_order_relaxed)) * sizeof(T);
+				return result;
+			}
+		private:
+			static std::string name()
+			{
+				return std::string{ "neolib::fast_pool_allocator<" } + typeid(T).name() + ">";
+			}
+		private:
+			std::atomic<std::uint64_t> iObjects;
+			std::atomic<std::uint64_t> iAllocations;
+			std::atomic<std::uint64_t> iDeallocations;
+			std::atomic<std::uint64_t> iPeakObjects;
+		};
+	public:
+		template <typename U>
+		struct rebind
+		{
+			typedef fast_pool_allocator<U> other;
+		};
+	public:
+		fast_pool_allocator()
+		{
+		}
+		template <typename U>
+		fast_pool_allocator(const fast_pool_allocator<U>&)
+		{
+		}
+	public:
+		static pointer allocate(size_type aCount)
+		{
+			pointer result = base_type::allocate(aCount);
+			counters::instance().allocated(aCount);
+			return result;
+		}
+		static pointer allocate(size_type aCount, const void*)
+		{
+			return allocate(aCount);
+		}
+		static pointer allocate()
+		{
+			return allocate(1);
+		}
+		static void deallocate(pointer aObject, size_type aCount)
+		{
+			base_type::deallocate(aObject, aCount);
+			counters::instance().deallocated(aCount);
+		}
+		static void deallocate(pointer aObject)
+		{
+			deallocate(aObject, 1);
+		}
+		static allocator_stats stats()
+		{
+			return counters::instance().stats();
+		}
+	};
 
 	// WARNING: Omega allocator doesn't free chunks and doesn't call element destructors on deallocation; use only when pathological performance is required.
 	template <typename T, std::size_t ChunkSize = 1 * 1024 * 1024>
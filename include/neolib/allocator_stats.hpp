@@ -0,0 +1,120 @@
+// allocator_stats.hpp
+/*
+ *  Copyright (c) 2018 Leigh Johnston.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *     * Neither the name of Leigh Johnston nor the names of any
+ *       other contributors to this software may be used to endorse or
+ *       promote products derived from this software without specific prior
+ *       written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ *  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include "neolib.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <functional>
+#include <ostream>
+
+namespace neolib
+{
+	struct allocator_stats
+	{
+		std::size_t iLiveObjects = 0;
+		std::size_t iChunksReserved = 0;
+		std::size_t iBytesInUse = 0;
+		std::size_t iBytesReserved = 0;
+		std::size_t iHighWaterMark = 0; // bytes
+		std::uint64_t iAllocations = 0;
+		std::uint64_t iDeallocations = 0;
+		std::uint64_t iCrossThreadDeallocations = 0;
+		// per second since the previous read through allocator_registry (zero on a first read or a direct read)
+		double iAllocationRate = 0.0;
+		double iDeallocationRate = 0.0;
+	};
+
+	namespace detail
+	{
+		// For counters with a single writer: other threads may read them at any time without the writer paying 
+		// for a locked read-modify-write.
+		template <typename T>
+		inline void bump_counter(std::atomic<T>& aCounter, T aDelta = 1)
+		{
+			aCounter.store(aCounter.load(std::memory_order_relaxed) + aDelta, std::memory_order_relaxed);
+		}
+
+		template <typename T>
+		inline void raise_to(std::atomic<T>& aMaximum, T aValue)
+		{
+			T maximum = aMaximum.load(std::memory_order_relaxed);
+			while (maximum < aValue && !aMaximum.compare_exchange_weak(maximum, aValue, std::memory_order_relaxed))
+				;
+		}
+	}
+
+	// Process wide registry of allocator statistics sources. Pooled allocators register themselves when their
+	// pool is created; the registry is leaked so that pools can still deregister during static destruction.
+	class allocator_registry
+	{
+	public:
+		typedef std::function<allocator_stats()> stats_source;
+		typedef std::vector<std::pair<std::string, allocator_stats>> snapshot_type;
+	private:
+		struct entry
+		{
+			stats_source iSource;
+			std::chrono::steady_clock::time_point iLastRead;
+			std::uint64_t iLastAllocations;
+			std::uint64_t iLastDeallocations;
+		};
+		typedef std::map<std::string, entry> entry_list;
+		// construction
+	private:
+		allocator_registry();
+	public:
+		static allocator_registry& instance();
+		// operations
+	public:
+		// replaces any existing source of the same name
+		void add(const std::string& aName, stats_source aSource);
+		void remove(const std::string& aName);
+		snapshot_type snapshot();
+		std::string to_json();
+		void dump(std::ostream& aStream);
+		// attributes
+	private:
+		std::mutex iMutex;
+		entry_list iEntries;
+	};
+}
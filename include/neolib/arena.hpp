@@ -0,0 +1,200 @@
+// arena.hpp
+/*
+ *  Copyright (c) 2018 Leigh Johnston.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *     * Neither the name of Leigh Johnston nor the names of any
+ *       other contributors to this software may be used to endorse or
+ *       promote products derived from this software without specific prior
+ *       written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ *  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include "neolib.hpp"
+#include <cstddef>
+#include <new>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <limits>
+#include <utility>
+
+namespace neolib
+{
+	// Region allocator. Requests up to MaxSmallSize are rounded up to a power of two size class and recycled 
+	// through per-class free lists; larger requests are bump allocated (and only reclaimed by release_all()) 
+	// or, if very large, given their own block. Everything is carved from PageSize aligned pages so a block 
+	// can always find its arena. An arena allocates on the thread that created it only; blocks may be freed 
+	// on any thread. release_all() frees every block at once: whatever was allocated must be dead by then.
+	class arena
+	{
+		friend class scoped_arena;
+		// constants
+	public:
+		static constexpr std::size_t MinSize = 16;
+		static constexpr std::size_t MaxSmallSize = 4096;
+		static constexpr std::size_t SizeClassCount = 9;
+		static constexpr std::size_t PageSize = 64 * 1024;
+		static constexpr std::size_t MaxBumpSize = PageSize / 4;
+		// types
+	private:
+		struct free_block
+		{
+			free_block* iNext;
+		};
+		struct page_header;
+		struct large_block_header;
+		// construction
+	public:
+		arena();
+		~arena();
+		arena(const arena&) = delete;
+		arena& operator=(const arena&) = delete;
+		// operations
+	public:
+		void* allocate(std::size_t aSize);
+		static void deallocate(void* aBlock, std::size_t aSize);
+		void release_all();
+		std::size_t bytes_reserved() const;
+		std::size_t live_allocations() const;
+	public:
+		// innermost scoped_arena of the calling thread or, failing that, the thread's default arena
+		static arena& current();
+		// implementation
+	private:
+		static std::size_t size_class(std::size_t aSize)
+		{
+			std::size_t sizeClass = 0;
+			for (std::size_t classSize = MinSize; classSize < aSize; classSize <<= 1)
+				++sizeClass;
+			return sizeClass;
+		}
+		static page_header& page_of(void* aBlock);
+		bool owned_by_this_thread() const;
+		void* allocate_small(std::size_t aSizeClass);
+		void* allocate_bump(std::size_t aSize);
+		void* allocate_large(std::size_t aSize);
+		void deallocate_small(void* aBlock, std::size_t aSizeClass);
+		void deallocate_large(large_block_header* aBlock);
+		void free_remote_large_blocks();
+		void new_page();
+		// attributes
+	private:
+		std::thread::id iThread;
+		free_block* iFree[SizeClassCount];
+		std::atomic<free_block*> iRemoteFree[SizeClassCount];
+		page_header* iPages;
+		char* iCursor;
+		char* iLimit;
+		large_block_header* iLargeBlocks;
+		std::atomic<large_block_header*> iRemoteLargeBlocks;
+		std::size_t iBytesReserved;
+		std::size_t iAllocations;
+		std::size_t iDeallocations;
+		std::atomic<std::size_t> iRemoteDeallocations;
+	};
+
+	// Makes an arena (its own, or one supplied) current for the calling thread for the lifetime of the scope;
+	// the arena's memory is released in one go when an owned arena goes out of scope.
+	class scoped_arena
+	{
+		// construction
+	public:
+		scoped_arena();
+		explicit scoped_arena(arena& aArena);
+		~scoped_arena();
+		scoped_arena(const scoped_arena&) = delete;
+		scoped_arena& operator=(const scoped_arena&) = delete;
+		// operations
+	public:
+		arena& get() const;
+		void release_all();
+		// attributes
+	private:
+		std::unique_ptr<arena> iOwnedArena;
+		arena& iArena;
+		arena* iPrevious;
+	};
+
+	// Stateless allocator over arena::current(); suitable for the Alloc parameter of basic_json, basic_xml,
+	// segmented_array, vecarray and the standard containers.
+	template <typename T>
+	class arena_allocator
+	{
+	public:
+		typedef T value_type;
+		typedef T* pointer;
+		typedef T& reference;
+		typedef const T* const_pointer;
+		typedef const T& const_reference;
+		typedef std::size_t size_type;
+		typedef std::ptrdiff_t difference_type;
+	public:
+		arena_allocator()
+		{
+		}
+		template <typename U>
+		arena_allocator(const arena_allocator<U>&)
+		{
+		}
+	public:
+		pointer allocate(size_type aCount = 1)
+		{
+			static_assert(alignof(T) <= alignof(std::max_align_t), "neolib::arena_allocator: over-aligned types not supported");
+			if (aCount > max_size())
+				throw std::bad_alloc();
+			return static_cast<pointer>(arena::current().allocate(sizeof(T) * aCount));
+		}
+		void deallocate(pointer aObject, size_type aCount = 1)
+		{
+			arena::deallocate(aObject, sizeof(T) * aCount);
+		}
+		template <typename... Args>
+		void construct(pointer aObject, Args&&... aArguments)
+		{
+			new (aObject) T(std::forward<Args>(aArguments)...);
+		}
+		void destroy(pointer aObject)
+		{
+			aObject->~T();
+		}
+		size_type max_size() const
+		{
+			return std::numeric_limits<size_type>::max() / sizeof(T);
+		}
+		template <typename U>
+		struct rebind
+		{
+			typedef arena_allocator<U> other;
+		};
+		template <typename U>
+		bool operator==(const arena_allocator<U>&) const { return true; }
+		template <typename U>
+		bool operator!=(const arena_allocator<U>&) const { return false; }
+	};
+}
@@ -0,0 +1,607 @@
+// array_btree.hpp
+/*
+ *  Copyright (c) 2018 Leigh Johnston.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *     * Neither the name of Leigh Johnston nor the names of any
+ *       other contributors to this software may be used to endorse or
+ *       promote products derived from this software without specific prior
+ *       written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ *  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include "neolib.hpp"
+#include <memory>
+#include <vector>
+
+namespace neolib
+{
+	/* Drop-in alternative to array_tree: a B+-tree whose leaves are the caller's nodes and whose inner nodes
+	   keep a subtree element count per child. The counts of an inner node occupy exactly one cache line so an
+	   index lookup touches two lines (counts, then the chosen child pointer) per level. */
+	template <typename Alloc>
+	class array_btree
+	{
+	public:
+		typedef std::size_t size_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef Alloc allocator_type;
+	public:
+		static constexpr size_type InnerNodeCapacity = 64 / sizeof(size_type);
+	private:
+		class inner_node;
+		class node_base
+		{
+			friend array_btree;
+
+		protected:
+			node_base() :
+				iParent{ nullptr }
+			{
+			}
+
+		private:
+			inner_node* iParent;
+		};
+		class alignas(64) inner_node : public node_base
+		{
+			friend array_btree;
+
+		public:
+			inner_node(size_type aHeight) :
+				iHeight{ aHeight }, iCount{ 0 }, iCounts{}, iChildren{}
+			{
+			}
+
+		private:
+			size_type index_of(const node_base* aChild) const
+			{
+				size_type index = 0;
+				while (iChildren[index] != aChild)
+					++index;
+				return index;
+			}
+
+		private:
+			size_type iHeight;
+			size_type iCount;
+			alignas(64) size_type iCounts[InnerNodeCapacity];
+			node_base* iChildren[InnerNodeCapacity];
+		};
+	protected:
+		class node : public node_base
+		{
+			friend array_btree;
+
+		public:
+			node(bool aNil = false) :
+				iNil{ aNil }, iPrevious{ nullptr }, iNext{ nullptr }, iSize{ 0 }
+			{
+			}
+			node(const node& aOther) :
+				iNil{ aOther.iNil }, iPrevious{ nullptr }, iNext{ nullptr }, iSize{ 0 }
+			{
+			}
+
+		public:
+			bool is_nil() const
+			{
+				return iNil;
+			}
+			node* previous() const
+			{
+				return iPrevious;
+			}
+			void set_previous(node* aPrevious)
+			{
+				iPrevious = aPrevious;
+			}
+			node* next() const
+			{
+				return iNext;
+			}
+			void set_next(node* aNext)
+			{
+				iNext = aNext;
+			}
+			size_type size() const
+			{
+				return iSize;
+			}
+			void set_size(size_type aSize)
+			{
+				if (!is_nil())
+				{
+					difference_type difference = aSize - iSize;
+					if (difference != 0)
+					{
+						iSize = aSize;
+						array_btree::adjust_size(this, difference);
+					}
+				}
+			}
+
+		private:
+			bool iNil;
+			node* iPrevious;
+			node* iNext;
+			size_type iSize;
+		};
+	private:
+		typedef typename allocator_type:: template rebind<inner_node>::other inner_node_allocator_type;
+
+	public:
+		array_btree(const Alloc& aAllocator = Alloc()) :
+			iAllocator(aAllocator),
+			iRoot(nullptr),
+			iFront(nullptr),
+			iBack(nullptr),
+			iNil(true)
+		{
+		}
+		~array_btree()
+		{
+			free_inner_node(iRoot);
+		}
+
+	public:
+		node* nil_node() const
+		{
+			return const_cast<node*>(&iNil);
+		}
+		node* front_node() const
+		{
+			return iFront;
+		}
+		void set_front_node(node* aFront)
+		{
+			iFront = aFront;
+		}
+		node* back_node() const
+		{
+			return iBack;
+		}
+		void set_back_node(node* aBack)
+		{
+			iBack = aBack;
+		}
+		node* find_node(size_type aPosition, size_type& aNodeIndex) const
+		{
+			aNodeIndex = 0;
+			const inner_node* x = iRoot;
+			while (x != nullptr)
+			{
+				size_type child = 0;
+				for (; child < x->iCount && aPosition >= x->iCounts[child]; ++child)
+				{
+					aPosition -= x->iCounts[child];
+					aNodeIndex += x->iCounts[child];
+				}
+				if (child == x->iCount)
+					break;
+				if (x->iHeight == 1)
+					return static_cast<node*>(x->iChildren[child]);
+				x = static_cast<const inner_node*>(x->iChildren[child]);
+			}
+			return nil_node();
+		}
+		void insert_node(node* aNode, size_type aPosition)
+		{
+			inner_node* parent = nullptr;
+			size_type index = 0;
+			if (iRoot == nullptr)
+				parent = iRoot = allocate_inner_node(1);
+			else if (aNode->previous() != nullptr && aNode->previous()->iParent != nullptr)
+			{
+				parent = aNode->previous()->iParent;
+				index = parent->index_of(aNode->previous()) + 1;
+			}
+			else if (aNode->next() != nullptr && aNode->next()->iParent != nullptr)
+			{
+				parent = aNode->next()->iParent;
+				index = parent->index_of(aNode->next());
+			}
+			else
+			{
+				/* neither neighbour is in the tree yet so fall back to locating the leaf by position */
+				parent = iRoot;
+				for (;;)
+				{
+					index = 0;
+					while (index + 1 < parent->iCount && aPosition > parent->iCounts[index])
+						aPosition -= parent->iCounts[index++];
+					if (parent->iHeight == 1)
+						break;
+					parent = static_cast<inner_node*>(parent->iChildren[index]);
+				}
+				if (parent->iCount != 0 && aPosition != 0)
+					++index;
+			}
+			parent = insert_child(parent, index, aNode, aNode->size());
+			adjust_size(parent, aNode->size());
+		}
+		void delete_node(node* aNode)
+		{
+			inner_node* parent = aNode->iParent;
+			if (parent == nullptr)
+				return;
+			adjust_size(aNode, -static_cast<difference_type>(aNode->size()));
+			remove_child(parent, parent->index_of(aNode));
+			rebalance(parent);
+		}
+		// Builds the tree bottom-up over an already linked chain of leaves (the tree must be empty).
+		void build(node* aFront, node* aBack)
+		{
+			std::vector<std::pair<node_base*, size_type>> level;
+			for (node* x = aFront; x != nullptr; x = (x != aBack ? x->next() : nullptr))
+				level.emplace_back(x, x->size());
+			iFront = aFront;
+			iBack = aBack;
+			for (size_type height = 1; !level.empty(); ++height)
+			{
+				const size_type groups = (level.size() + InnerNodeCapacity - 1) / InnerNodeCapacity;
+				std::vector<std::pair<node_base*, size_type>> nextLevel;
+				nextLevel.reserve(groups);
+				auto child = level.begin();
+				for (size_type group = 0; group < groups; ++group)
+				{
+					/* spread the children evenly so that no node is left underfull */
+					const size_type children = level.size() / groups + (group < level.size() % groups ? 1 : 0);
+					inner_node* newNode = allocate_inner_node(height);
+					size_type total = 0;
+					for (size_type i = 0; i < children; ++i, ++child)
+					{
+						insert_child(newNode, i, child->first, child->second);
+						total += child->second;
+					}
+					nextLevel.emplace_back(newNode, total);
+				}
+				if (nextLevel.size() == 1)
+				{
+					iRoot = static_cast<inner_node*>(nextLevel[0].first);
+					break;
+				}
+				level.swap(nextLevel);
+			}
+		}
+		// Appends all of aOther's leaves in O(log n).
+		void join(array_btree& aOther)
+		{
+			if (aOther.iFront == nullptr)
+				return;
+			if (iBack != nullptr)
+			{
+				iBack->set_next(aOther.iFront);
+				aOther.iFront->set_previous(iBack);
+			}
+			else
+				iFront = aOther.iFront;
+			iBack = aOther.iBack;
+			inner_node* left = iRoot;
+			inner_node* right = aOther.iRoot;
+			iRoot = nullptr;
+			aOther.iRoot = nullptr;
+			aOther.iFront = nullptr;
+			aOther.iBack = nullptr;
+			iRoot = join_subtrees(left, right);
+		}
+		// Moves aFirst and every leaf after it into aOther (which must be empty) in O(log n).
+		void split(node* aFirst, array_btree& aOther)
+		{
+			if (aFirst == nullptr)
+				return;
+			node* const last = aFirst->previous();
+			aOther.iFront = aFirst;
+			aOther.iBack = iBack;
+			aFirst->set_previous(nullptr);
+			if (last != nullptr)
+				last->set_next(nullptr);
+			else
+				iFront = nullptr;
+			iBack = last;
+			/* walk up from the leaf cutting each node on the path in two; the halves are detached subtrees that are
+			   joined onto the results from the level below, which costs O(1) amortised per level */
+			iRoot = nullptr;
+			inner_node* left = nullptr;
+			inner_node* right = nullptr;
+			inner_node* x = aFirst->iParent;
+			size_type index = x->index_of(aFirst);
+			for (bool leafLevel = true; x != nullptr; leafLevel = false)
+			{
+				inner_node* const parent = x->iParent;
+				const size_type parentIndex = (parent != nullptr ? parent->index_of(x) : 0);
+				inner_node* rightPart = allocate_inner_node(x->iHeight);
+				for (size_type child = (leafLevel ? index : index + 1); child < x->iCount; ++child)
+					insert_child(rightPart, rightPart->iCount, x->iChildren[child], x->iCounts[child]);
+				x->iCount = index;
+				x->iParent = nullptr;
+				left = join_subtrees(x, left);
+				right = join_subtrees(right, rightPart);
+				x = parent;
+				index = parentIndex;
+			}
+			iRoot = left;
+			aOther.iRoot = right;
+		}
+		void swap(array_btree& aOther)
+		{
+			std::swap(iAllocator, aOther.iAllocator);
+			std::swap(iRoot, aOther.iRoot);
+			std::swap(iFront, aOther.iFront);
+			std::swap(iBack, aOther.iBack);
+		}
+
+	private:
+		static void adjust_size(node_base* aChild, difference_type aDifference)
+		{
+			for (inner_node* parent = aChild->iParent; parent != nullptr; aChild = parent, parent = parent->iParent)
+				parent->iCounts[parent->index_of(aChild)] += aDifference;
+		}
+		inner_node* allocate_inner_node(size_type aHeight)
+		{
+			inner_node* newNode = std::allocator_traits<inner_node_allocator_type>::allocate(iAllocator, 1);
+			try
+			{
+				std::allocator_traits<inner_node_allocator_type>::construct(iAllocator, newNode, aHeight);
+			}
+			catch (...)
+			{
+				std::allocator_traits<inner_node_allocator_type>::deallocate(iAllocator, newNode, 1);
+				throw;
+			}
+			return newNode;
+		}
+		void free_inner_node(inner_node* aNode)
+		{
+			if (aNode == nullptr)
+				return;
+			if (aNode->iHeight > 1)
+				for (size_type child = 0; child < aNode->iCount; ++child)
+					free_inner_node(static_cast<inner_node*>(aNode->iChildren[child]));
+			std::allocator_traits<inner_node_allocator_type>::destroy(iAllocator, aNode);
+			std::allocator_traits<inner_node_allocator_type>::deallocate(iAllocator, aNode, 1);
+		}
+		// Inserts a child without touching ancestor counts; returns the node the child ended up in (the parent may split).
+		inner_node* insert_child(inner_node* aParent, size_type aIndex, node_base* aChild, size_type aChildSize)
+		{
+			if (aParent->iCount == InnerNodeCapacity)
+			{
+				inner_node* sibling = split(aParent, aIndex);
+				if (aIndex >= aParent->iCount)
+				{
+					aIndex -= aParent->iCount;
+					aParent = sibling;
+				}
+			}
+			for (size_type child = aParent->iCount; child > aIndex; --child)
+			{
+				aParent->iCounts[child] = aParent->iCounts[child - 1];
+				aParent->iChildren[child] = aParent->iChildren[child - 1];
+			}
+			aParent->iCounts[aIndex] = aChildSize;
+			aParent->iChildren[aIndex] = aChild;
+			aChild->iParent = aParent;
+			++aParent->iCount;
+			return aParent;
+		}
+		void remove_child(inner_node* aParent, size_type aIndex)
+		{
+			aParent->iChildren[aIndex]->iParent = nullptr;
+			--aParent->iCount;
+			for (size_type child = aIndex; child < aParent->iCount; ++child)
+			{
+				aParent->iCounts[child] = aParent->iCounts[child + 1];
+				aParent->iChildren[child] = aParent->iChildren[child + 1];
+			}
+		}
+		// Moves the upper half of a full node into a new right sibling; when the pending insertion is an append nothing
+		// is moved so that sequential growth leaves full nodes behind it. The sibling joins the parent empty and counts
+		// then follow the moved children so that a split further up always sees consistent counts.
+		inner_node* split(inner_node* aNode, size_type aInsertIndex)
+		{
+			if (aNode->iParent == nullptr)
+			{
+				inner_node* root = allocate_inner_node(aNode->iHeight + 1);
+				if (iRoot == aNode)
+					iRoot = root;
+				insert_child(root, 0, aNode, sum(aNode, 0, aNode->iCount));
+			}
+			inner_node* sibling = allocate_inner_node(aNode->iHeight);
+			insert_child(aNode->iParent, aNode->iParent->index_of(aNode) + 1, sibling, 0);
+			const size_type keep = (aInsertIndex == InnerNodeCapacity ? InnerNodeCapacity : InnerNodeCapacity / 2);
+			size_type moved = 0;
+			for (size_type child = keep; child < aNode->iCount; ++child)
+			{
+				sibling->iCounts[sibling->iCount] = aNode->iCounts[child];
+				sibling->iChildren[sibling->iCount] = aNode->iChildren[child];
+				sibling->iChildren[sibling->iCount++]->iParent = sibling;
+				moved += aNode->iCounts[child];
+			}
+			aNode->iCount = keep;
+			adjust_size(aNode, -static_cast<difference_type>(moved));
+			adjust_size(sibling, moved);
+			return sibling;
+		}
+		void rebalance(inner_node* aNode)
+		{
+			if (aNode->iParent == nullptr)
+			{
+				if (aNode->iCount == 0)
+				{
+					if (iRoot == aNode)
+						iRoot = nullptr;
+					free_inner_node(aNode);
+				}
+				else if (aNode->iCount == 1 && aNode->iHeight > 1)
+				{
+					inner_node* root = static_cast<inner_node*>(aNode->iChildren[0]);
+					root->iParent = nullptr;
+					if (iRoot == aNode)
+						iRoot = root;
+					aNode->iCount = 0;
+					free_inner_node(aNode);
+					rebalance(root);
+				}
+				return;
+			}
+			if (aNode->iCount >= InnerNodeCapacity / 2)
+				return;
+			inner_node* parent = aNode->iParent;
+			if (parent->iCount == 1)
+			{
+				/* an only child (left behind by an append split) has nothing to merge with */
+				if (aNode->iCount == 0)
+				{
+					remove_child(parent, 0);
+					free_inner_node(aNode);
+					rebalance(parent);
+				}
+				return;
+			}
+			const size_type index = parent->index_of(aNode);
+			const size_type leftIndex = index > 0 ? index - 1 : index;
+			inner_node* left = static_cast<inner_node*>(parent->iChildren[leftIndex]);
+			inner_node* right = static_cast<inner_node*>(parent->iChildren[leftIndex + 1]);
+			if (left->iCount + right->iCount <= InnerNodeCapacity)
+			{
+				while (right->iCount != 0)
+				{
+					const size_type count = right->iCounts[0];
+					node_base* child = right->iChildren[0];
+					remove_child(right, 0);
+					insert_child(left, left->iCount, child, count);
+				}
+				parent->iCounts[leftIndex] += parent->iCounts[leftIndex + 1];
+				remove_child(parent, leftIndex + 1);
+				free_inner_node(right);
+				rebalance(parent);
+			}
+			else if (left == aNode)
+			{
+				const size_type count = right->iCounts[0];
+				node_base* child = right->iChildren[0];
+				remove_child(right, 0);
+				insert_child(left, left->iCount, child, count);
+				parent->iCounts[leftIndex] += count;
+				parent->iCounts[leftIndex + 1] -= count;
+			}
+			else
+			{
+				const size_type count = left->iCounts[left->iCount - 1];
+				node_base* child = left->iChildren[left->iCount - 1];
+				remove_child(left, left->iCount - 1);
+				insert_child(right, 0, child, count);
+				parent->iCounts[leftIndex] -= count;
+				parent->iCounts[leftIndex + 1] += count;
+			}
+		}
+		// Joins two detached subtrees (either may be null or empty) such that all of aLeft's leaves precede aRight's;
+		// the shorter tree is hung off the facing spine of the taller one.
+		inner_node* join_subtrees(inner_node* aLeft, inner_node* aRight)
+		{
+			if (aLeft != nullptr && aLeft->iCount == 0)
+			{
+				free_inner_node(aLeft);
+				aLeft = nullptr;
+			}
+			if (aRight != nullptr && aRight->iCount == 0)
+			{
+				free_inner_node(aRight);
+				aRight = nullptr;
+			}
+			if (aLeft == nullptr || aRight == nullptr)
+				return normalized(aLeft != nullptr ? aLeft : aRight);
+			node_base* const anchor = front_leaf(aLeft);
+			if (aLeft->iHeight == aRight->iHeight)
+			{
+				inner_node* root = allocate_inner_node(aLeft->iHeight + 1);
+				insert_child(root, 0, aLeft, sum(aLeft, 0, aLeft->iCount));
+				insert_child(root, 1, aRight, sum(aRight, 0, aRight->iCount));
+				rebalance(aLeft->iCount < aRight->iCount ? aLeft : aRight);
+			}
+			else if (aLeft->iHeight > aRight->iHeight)
+			{
+				inner_node* x = aLeft;
+				while (x->iHeight > aRight->iHeight + 1)
+					x = static_cast<inner_node*>(x->iChildren[x->iCount - 1]);
+				const size_type total = sum(aRight, 0, aRight->iCount);
+				adjust_size(insert_child(x, x->iCount, aRight, total), total);
+				rebalance(aRight);
+			}
+			else
+			{
+				inner_node* x = aRight;
+				while (x->iHeight > aLeft->iHeight + 1)
+					x = static_cast<inner_node*>(x->iChildren[0]);
+				const size_type total = sum(aLeft, 0, aLeft->iCount);
+				adjust_size(insert_child(x, 0, aLeft, total), total);
+				rebalance(aLeft);
+			}
+			return normalized(root_of(anchor));
+		}
+		inner_node* normalized(inner_node* aRoot)
+		{
+			while (aRoot != nullptr && aRoot->iCount == 1 && aRoot->iHeight > 1)
+			{
+				inner_node* child = static_cast<inner_node*>(aRoot->iChildren[0]);
+				child->iParent = nullptr;
+				aRoot->iCount = 0;
+				free_inner_node(aRoot);
+				aRoot = child;
+			}
+			return aRoot;
+		}
+		static node_base* front_leaf(inner_node* aNode)
+		{
+			while (aNode->iHeight > 1)
+				aNode = static_cast<inner_node*>(aNode->iChildren[0]);
+			return aNode->iChildren[0];
+		}
+		static inner_node* root_of(node_base* aNode)
+		{
+			inner_node* root = aNode->iParent;
+			while (root->iParent != nullptr)
+				root = root->iParent;
+			return root;
+		}
+		static size_type sum(const inner_node* aNode, size_type aFirst, size_type aLast)
+		{
+			size_type result = 0;
+			for (size_type child = aFirst; child < aLast; ++child)
+				result += aNode->iCounts[child];
+			return result;
+		}
+
+	private:
+		inner_node_allocator_type iAllocator;
+		inner_node* iRoot;
+		node* iFront;
+		node* iBack;
+		node iNil;
+	};
+}
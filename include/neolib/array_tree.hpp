@@ -37,6 +37,7 @@
 #pragma once
 
 #include "neolib.hpp"
+#include <vector>
 
 namespace neolib
 {
@@ -196,6 +197,8 @@ namespace neolib
 		};
 	private:
 		typedef typename allocator_type:: template rebind<node>::other node_allocator_type;
+	private:
+		static constexpr size_type RebuildFactor = 32; // moving a node costs roughly this many nodes' worth of rebuild
 
 	public:
 		array_tree(const Alloc& aAllocator = Alloc()) :
@@ -369,6 +372,105 @@ namespace neolib
 			if (performDeleteFixup)
 				delete_fixup(x);
 		}
+		// Builds a balanced tree over an already linked chain of nodes (the tree must be empty).
+		void build(node* aFront, node* aBack)
+		{
+			std::vector<node*> nodes;
+			for (node* x = aFront; x != nullptr; x = (x != aBack ? x->next() : nullptr))
+				nodes.push_back(x);
+			set_front_node(aFront);
+			set_back_node(aBack);
+			size_type maxDepth = 0;
+			while ((size_type{ 2 } << maxDepth) - 1 < nodes.size())
+				++maxDepth;
+			set_root_node(build(nodes.data(), nodes.data() + nodes.size(), nil_node(), 0, maxDepth));
+		}
+		// Appends all of aOther's nodes. A red-black tree cannot be joined in O(log n) here as every tree has its own
+		// nil sentinel so the cheaper of moving the k nodes one at a time (O(k log n)) or rebuilding (O(n)) is chosen.
+		void join(array_tree& aOther)
+		{
+			if (aOther.front_node() == nullptr)
+				return;
+			if (front_node() == nullptr)
+			{
+				swap(aOther);
+				return;
+			}
+			const size_type moving = count_nodes(aOther.front_node(), static_cast<size_type>(-1));
+			if (count_nodes(front_node(), moving * RebuildFactor) < moving * RebuildFactor)
+			{
+				node* const front = front_node();
+				node* const middleBack = back_node();
+				node* const middleFront = aOther.front_node();
+				node* const back = aOther.back_node();
+				release();
+				aOther.release();
+				middleBack->set_next(middleFront);
+				middleFront->set_previous(middleBack);
+				build(front, back);
+				return;
+			}
+			while (aOther.front_node() != nullptr)
+			{
+				node* x = aOther.front_node();
+				aOther.set_front_node(x->next());
+				aOther.detach(x);
+				x->set_previous(back_node());
+				x->set_next(nullptr);
+				back_node()->set_next(x);
+				set_back_node(x);
+				insert_node(x, size(root_node()));
+			}
+			aOther.set_back_node(nullptr);
+		}
+		// Moves aFirst and every node after it into aOther (which must be empty); as with join() the smaller side is
+		// moved node by node unless rebuilding both trees is cheaper.
+		void split(node* aFirst, array_tree& aOther)
+		{
+			if (aFirst == nullptr)
+				return;
+			node* const front = front_node();
+			node* const last = aFirst->previous();
+			node* const back = back_node();
+			size_type smaller = 0;
+			node* x = front;
+			node* y = aFirst;
+			for (; x != aFirst && y != nullptr; x = x->next(), y = y->next())
+				++smaller;
+			const bool leftSmaller = (x == aFirst);
+			const size_type limit = smaller * RebuildFactor;
+			const bool rebuild = (leftSmaller ? count_nodes(y, limit) : count_nodes(x, limit, aFirst)) < limit;
+			if (rebuild)
+				release();
+			else if (leftSmaller)
+			{
+				for (node* z = front; z != aFirst; z = z->next())
+					detach(z);
+				set_front_node(aFirst);
+				swap(aOther);
+			}
+			else
+			{
+				for (node* z = aFirst; z != nullptr; z = z->next())
+					detach(z);
+			}
+			aFirst->set_previous(nullptr);
+			if (last != nullptr)
+				last->set_next(nullptr);
+			if (rebuild || !leftSmaller)
+			{
+				set_front_node(nullptr);
+				set_back_node(nullptr);
+				aOther.build(aFirst, back);
+			}
+			if (last != nullptr && (rebuild || leftSmaller))
+				build(front, last);
+			else if (last != nullptr)
+			{
+				set_front_node(front);
+				set_back_node(last);
+			}
+		}
 		void swap(array_tree& aOther)
 		{
 			std::swap(iAllocator, aOther.iAllocator);
@@ -379,6 +481,51 @@ namespace neolib
 		}
 
 	private:
+		static size_type count_nodes(node* aFrom, size_type aLimit, node* aStop = nullptr)
+		{
+			size_type count = 0;
+			for (; aFrom != aStop && count < aLimit; aFrom = aFrom->next())
+				++count;
+			return count;
+		}
+		// Empties the tree leaving each node (still linked) holding only its own size, ready for build().
+		void release()
+		{
+			std::vector<size_type> ownSizes;
+			for (node* x = front_node(); x != nullptr; x = x->next())
+				ownSizes.push_back(size(x) - size_left(x) - size_right(x));
+			auto ownSize = ownSizes.begin();
+			for (node* x = front_node(); x != nullptr; x = x->next())
+				x->iSize = *ownSize++;
+			set_root_node(nil_node());
+			set_front_node(nullptr);
+			set_back_node(nullptr);
+		}
+		node* build(node** aFirst, node** aLast, node* aParent, size_type aDepth, size_type aMaxDepth)
+		{
+			if (aFirst == aLast)
+				return nil_node();
+			node** middle = aFirst + (aLast - aFirst) / 2;
+			node* x = *middle;
+			/* every path has the same number of black nodes if only the (possibly incomplete) deepest level is red */
+			x->iColor = (aDepth == aMaxDepth && aDepth != 0 ? node::RED : node::BLACK);
+			x->set_parent(aParent);
+			x->set_left(build(aFirst, middle, x, aDepth + 1, aMaxDepth));
+			x->set_right(build(middle + 1, aLast, x, aDepth + 1, aMaxDepth));
+			x->iSize += x->left()->size() + x->right()->size();
+			return x;
+		}
+		// Removes a node from the tree only (list links are untouched) leaving it ready for insertion elsewhere.
+		void detach(node* aNode)
+		{
+			size_type ownSize = size(aNode) - size_left(aNode) - size_right(aNode);
+			delete_node(aNode);
+			aNode->iColor = node::RED;
+			aNode->set_parent(nullptr);
+			aNode->set_left(nullptr);
+			aNode->set_right(nullptr);
+			aNode->iSize = ownSize;
+		}
 		void insert_fixup(node* aNode)
 		{
 			node* z = aNode;
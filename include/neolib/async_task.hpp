@@ -39,6 +39,7 @@
 #include <boost/asio.hpp>
 #include "i_thread.hpp"
 #include "task.hpp"
+#include "resumer.hpp"
 #include "message_queue.hpp"
 
 namespace neolib
@@ -74,6 +75,29 @@ namespace neolib
 		// types
 	private:
 		typedef std::unique_ptr<neolib::message_queue> message_queue_pointer;
+	public:
+		class schedule_awaiter
+		{
+		public:
+			schedule_awaiter(async_task& aTask) : iTask{ aTask }
+			{
+			}
+		public:
+			bool await_ready() const
+			{
+				return false;
+			}
+			template <typename Handle>
+			void await_suspend(Handle aHandle)
+			{
+				iTask.resume(resumer{ aHandle });
+			}
+			void await_resume() const
+			{
+			}
+		private:
+			async_task& iTask;
+		};
 		// exceptions
 	public:
 		struct no_message_queue : std::logic_error { no_message_queue() : std::logic_error("neolib::async_task::no_message_queue") {} };
@@ -95,6 +119,10 @@ namespace neolib
 		bool pump_messages();
 		bool halted() const;
 		void halt();
+		schedule_awaiter schedule();
+		void resume(const resumer& aResumer);
+	public:
+		static async_task* current();
 		// implementation
 	public:
 		void run() override;
@@ -0,0 +1,451 @@
+// coroutine.hpp
+/*
+ *  Copyright (c) 2018 Leigh Johnston.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *     * Neither the name of Leigh Johnston nor the names of any
+ *       other contributors to this software may be used to endorse or
+ *       promote products derived from this software without specific prior
+ *       written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ *  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include "neolib.hpp"
+#include <cstddef>
+#include <exception>
+#include <optional>
+#include <mutex>
+#include <condition_variable>
+#include <type_traits>
+#include <utility>
+#include <boost/asio.hpp>
+#if __has_include(<coroutine>) && defined(__cpp_impl_coroutine)
+#include <coroutine>
+#define NEOLIB_SYMMETRIC_TRANSFER
+#elif __has_include(<experimental/coroutine>)
+#include <experimental/coroutine>
+#else
+#error neolib: coroutine support required
+#endif
+#include "task.hpp"
+#include "async_task.hpp"
+#include "thread_pool.hpp"
+
+namespace neolib
+{
+	namespace coro
+	{
+		#ifdef NEOLIB_SYMMETRIC_TRANSFER
+		using std::coroutine_handle;
+		using std::suspend_always;
+		using std::noop_coroutine;
+		#else
+		using std::experimental::coroutine_handle;
+		using std::experimental::suspend_always;
+		#endif
+	}
+
+	template <typename T = void>
+	class co_task;
+
+	namespace detail
+	{
+		// Coroutine frames come from the task block slabs, as do the handlers of the awaiters that suspend them.
+		class co_task_promise_base
+		{
+		public:
+			class final_awaiter
+			{
+			public:
+				bool await_ready() const noexcept
+				{
+					return false;
+				}
+				#ifdef NEOLIB_SYMMETRIC_TRANSFER
+				template <typename Promise>
+				coro::coroutine_handle<> await_suspend(coro::coroutine_handle<Promise> aHandle) noexcept
+				{
+					co_task_promise_base& promise = aHandle.promise();
+					if (promise.iDetached)
+					{
+						aHandle.destroy();
+						return coro::noop_coroutine();
+					}
+					if (promise.iContinuation)
+						return promise.iContinuation;
+					return coro::noop_coroutine();
+				}
+				#else
+				template <typename Promise>
+				void await_suspend(coro::coroutine_handle<Promise> aHandle) noexcept
+				{
+					co_task_promise_base& promise = aHandle.promise();
+					if (promise.iDetached)
+						aHandle.destroy();
+					else if (promise.iContinuation)
+						promise.iContinuation.resume();
+				}
+				#endif
+				void await_resume() const noexcept
+				{
+				}
+			};
+		public:
+			co_task_promise_base() : iDetached{ false }
+			{
+			}
+		public:
+			static void* operator new(std::size_t aSize)
+			{
+				return allocate_task_block(aSize);
+			}
+			static void operator delete(void* aFrame, std::size_t aSize)
+			{
+				deallocate_task_block(aFrame, aSize);
+			}
+		public:
+			coro::suspend_always initial_suspend() const noexcept
+			{
+				return {};
+			}
+			final_awaiter final_suspend() const noexcept
+			{
+				return {};
+			}
+			void unhandled_exception()
+			{
+				// as with std::thread nothing is left to observe the exception of a detached coroutine
+				if (iDetached)
+					std::terminate();
+				iException = std::current_exception();
+			}
+			void set_continuation(coro::coroutine_handle<> aContinuation)
+			{
+				iContinuation = aContinuation;
+			}
+			void detach()
+			{
+				iDetached = true;
+			}
+			void rethrow_if_failed() const
+			{
+				if (iException)
+					std::rethrow_exception(iException);
+			}
+		private:
+			coro::coroutine_handle<> iContinuation;
+			std::exception_ptr iException;
+			bool iDetached;
+		};
+
+		template <typename T>
+		class co_task_promise : public co_task_promise_base
+		{
+		public:
+			co_task<T> get_return_object();
+			template <typename U>
+			void return_value(U&& aValue)
+			{
+				iValue.emplace(std::forward<U>(aValue));
+			}
+			T result()
+			{
+				rethrow_if_failed();
+				return std::move(*iValue);
+			}
+		private:
+			std::optional<T> iValue;
+		};
+
+		template <>
+		class co_task_promise<void> : public co_task_promise_base
+		{
+		public:
+			co_task<void> get_return_object();
+			void return_void()
+			{
+			}
+			void result()
+			{
+				rethrow_if_failed();
+			}
+		};
+	}
+
+	// Lazily started coroutine: runs when awaited (resuming its awaiter on completion) or when detached.
+	// A coroutine that is suspended must not have its co_task destroyed.
+	template <typename T>
+	class co_task
+	{
+		// types
+	public:
+		typedef T value_type;
+		typedef detail::co_task_promise<T> promise_type;
+	private:
+		typedef coro::coroutine_handle<promise_type> handle_type;
+	public:
+		class awaiter
+		{
+		public:
+			awaiter(handle_type aHandle) : iHandle{ aHandle }
+			{
+			}
+		public:
+			bool await_ready() const
+			{
+				return !iHandle || iHandle.done();
+			}
+			#ifdef NEOLIB_SYMMETRIC_TRANSFER
+			handle_type await_suspend(coro::coroutine_handle<> aContinuation)
+			{
+				iHandle.promise().set_continuation(aContinuation);
+				return iHandle;
+			}
+			#else
+			void await_suspend(coro::coroutine_handle<> aContinuation)
+			{
+				iHandle.promise().set_continuation(aContinuation);
+				iHandle.resume();
+			}
+			#endif
+			T await_resume()
+			{
+				if (!iHandle)
+					throw invalid();
+				return iHandle.promise().result();
+			}
+		private:
+			handle_type iHandle;
+		};
+		// exceptions
+	public:
+		struct invalid : std::logic_error { invalid() : std::logic_error("neolib::co_task::invalid") {} };
+		// construction
+	public:
+		co_task() : iHandle{}
+		{
+		}
+		explicit co_task(handle_type aHandle) : iHandle{ aHandle }
+		{
+		}
+		co_task(co_task&& aOther) : iHandle{ std::exchange(aOther.iHandle, handle_type{}) }
+		{
+		}
+		~co_task()
+		{
+			if (iHandle)
+				iHandle.destroy();
+		}
+		co_task(const co_task&) = delete;
+		co_task& operator=(const co_task&) = delete;
+		co_task& operator=(co_task&& aOther)
+		{
+			if (&aOther != this)
+			{
+				if (iHandle)
+					iHandle.destroy();
+				iHandle = std::exchange(aOther.iHandle, handle_type{});
+			}
+			return *this;
+		}
+		// operations
+	public:
+		bool valid() const
+		{
+			return static_cast<bool>(iHandle);
+		}
+		bool done() const
+		{
+			return iHandle && iHandle.done();
+		}
+		// start the coroutine on the calling thread; its frame is freed when it completes
+		void detach()
+		{
+			if (!iHandle)
+				throw invalid();
+			handle_type handle = std::exchange(iHandle, handle_type{});
+			handle.promise().detach();
+			handle.resume();
+		}
+		awaiter operator co_await() const
+		{
+			return awaiter{ iHandle };
+		}
+		// attributes
+	private:
+		handle_type iHandle;
+	};
+
+	namespace detail
+	{
+		template <typename T>
+		inline co_task<T> co_task_promise<T>::get_return_object()
+		{
+			return co_task<T>{ coro::coroutine_handle<co_task_promise<T>>::from_promise(*this) };
+		}
+
+		inline co_task<void> co_task_promise<void>::get_return_object()
+		{
+			return co_task<void>{ coro::coroutine_handle<co_task_promise<void>>::from_promise(*this) };
+		}
+
+		class sync_wait_event
+		{
+		public:
+			sync_wait_event() : iSet{ false }
+			{
+			}
+		public:
+			void set()
+			{
+				std::lock_guard<std::mutex> lk(iMutex);
+				iSet = true;
+				iConditionVariable.notify_all();
+			}
+			void wait()
+			{
+				std::unique_lock<std::mutex> lk(iMutex);
+				iConditionVariable.wait(lk, [this] { return iSet; });
+			}
+		private:
+			std::mutex iMutex;
+			std::condition_variable iConditionVariable;
+			bool iSet;
+		};
+
+		// aTask is only referenced from the coroutine frame, which some compilers report as an unused parameter
+		template <typename T>
+		inline co_task<void> sync_wait_on([[maybe_unused]] co_task<T>& aTask, std::optional<T>& aResult, std::exception_ptr& aException, sync_wait_event& aDone)
+		{
+			try
+			{
+				aResult.emplace(co_await aTask);
+			}
+			catch (...)
+			{
+				aException = std::current_exception();
+			}
+			aDone.set();
+		}
+
+		inline co_task<void> sync_wait_on([[maybe_unused]] co_task<void>& aTask, std::exception_ptr& aException, sync_wait_event& aDone)
+		{
+			try
+			{
+				co_await aTask;
+			}
+			catch (...)
+			{
+				aException = std::current_exception();
+			}
+			aDone.set();
+		}
+	}
+
+	// Block the calling thread until aTask completes; aTask must not need the calling thread (or, if it
+	// is an async_task's thread, that task's event loop) to make progress.
+	template <typename T>
+	inline T sync_wait(co_task<T> aTask)
+	{
+		std::exception_ptr exception;
+		detail::sync_wait_event done;
+		if constexpr (std::is_void_v<T>)
+		{
+			detail::sync_wait_on(aTask, exception, done).detach();
+			done.wait();
+			if (exception)
+				std::rethrow_exception(exception);
+		}
+		else
+		{
+			std::optional<T> result;
+			detail::sync_wait_on(aTask, result, exception, done).detach();
+			done.wait();
+			if (exception)
+				std::rethrow_exception(exception);
+			return std::move(*result);
+		}
+	}
+
+	// co_await timer_for(ms) suspends for the given period and resumes from the io task's event loop; the 
+	// timer lives in the awaiting coroutine's frame so no timer object or handler proxy is allocated per wait.
+	class timer_awaiter
+	{
+		friend class detail::completion_handler<timer_awaiter>;
+	public:
+		struct no_async_task : std::logic_error { no_async_task() : std::logic_error("neolib::timer_awaiter::no_async_task") {} };
+	public:
+		timer_awaiter(async_task& aIoTask, uint32_t aDuration_ms) :
+			iTimerObject{ aIoTask.timer_io_service().native_object() }, iDuration_ms{ aDuration_ms }
+		{
+		}
+		timer_awaiter(const timer_awaiter&) = delete;
+	public:
+		bool await_ready() const
+		{
+			return false;
+		}
+		template <typename Handle>
+		void await_suspend(Handle aHandle)
+		{
+			iResumer = resumer{ aHandle };
+			iTimerObject.expires_from_now(boost::posix_time::milliseconds(iDuration_ms));
+			iTimerObject.async_wait(detail::completion_handler<timer_awaiter>{ *this });
+		}
+		void await_resume() const
+		{
+			if (iError)
+				throw boost::system::system_error(iError);
+		}
+	private:
+		void complete(const boost::system::error_code& aError)
+		{
+			iError = aError;
+			iResumer();
+		}
+	private:
+		boost::asio::deadline_timer iTimerObject;
+		uint32_t iDuration_ms;
+		boost::system::error_code iError;
+		resumer iResumer;
+	};
+
+	inline timer_awaiter timer_for(async_task& aIoTask, uint32_t aDuration_ms)
+	{
+		return timer_awaiter{ aIoTask, aDuration_ms };
+	}
+
+	// uses the async task whose event loop is running on the calling thread
+	inline timer_awaiter timer_for(uint32_t aDuration_ms)
+	{
+		async_task* ioTask = async_task::current();
+		if (ioTask == nullptr)
+			throw timer_awaiter::no_async_task();
+		return timer_awaiter{ *ioTask, aDuration_ms };
+	}
+}
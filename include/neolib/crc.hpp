@@ -36,8 +36,93 @@
 #pragma once
 
 #include "neolib.hpp"
+#include <cstdint>
 
 namespace neolib
 {
-	uint32_t crc32(const uint8_t *aData, uint32_t aDataLength);
+	class thread_pool;
+
+	// Reflected generator polynomials.
+	enum class crc_polynomial : uint32_t
+	{
+		Crc32 = 0xEDB88320u,	// zlib, zip, gzip, PNG
+		Crc32c = 0x82F63B78u	// Castagnoli: iSCSI, SCTP, ext4; has a dedicated SSE4.2 instruction
+	};
+
+	// Continues aCrc (zero to start) over aData. The fastest implementation the CPU supports is selected at run
+	// time: PCLMULQDQ folding for CRC-32, the SSE4.2 crc32 instruction for CRC-32C, otherwise slice-by-16 tables.
+	uint32_t crc(crc_polynomial aPolynomial, uint32_t aCrc, const void* aData, uint64_t aLength);
+	// The CRC of the concatenation of two buffers given their CRCs and the length of the second.
+	uint32_t crc_combine(crc_polynomial aPolynomial, uint32_t aCrc1, uint32_t aCrc2, uint64_t aLength2);
+	// Computes the CRC of a large buffer in blocks on aThreadPool and combines the results.
+	uint32_t parallel_crc(thread_pool& aThreadPool, crc_polynomial aPolynomial, const void* aData, uint64_t aLength);
+
+	inline uint32_t crc32(uint32_t aCrc, const void* aData, uint64_t aLength)
+	{
+		return crc(crc_polynomial::Crc32, aCrc, aData, aLength);
+	}
+
+	inline uint32_t crc32(const uint8_t* aData, uint64_t aDataLength)
+	{
+		return crc32(0u, aData, aDataLength);
+	}
+
+	inline uint32_t crc32c(uint32_t aCrc, const void* aData, uint64_t aLength)
+	{
+		return crc(crc_polynomial::Crc32c, aCrc, aData, aLength);
+	}
+
+	inline uint32_t crc32_combine(uint32_t aCrc1, uint32_t aCrc2, uint64_t aLength2)
+	{
+		return crc_combine(crc_polynomial::Crc32, aCrc1, aCrc2, aLength2);
+	}
+
+	inline uint32_t crc32c_combine(uint32_t aCrc1, uint32_t aCrc2, uint64_t aLength2)
+	{
+		return crc_combine(crc_polynomial::Crc32c, aCrc1, aCrc2, aLength2);
+	}
+
+	template <crc_polynomial Polynomial>
+	class basic_crc
+	{
+	public:
+		static constexpr crc_polynomial polynomial = Polynomial;
+	public:
+		explicit basic_crc(uint32_t aValue = 0) : iValue{ aValue }, iLength{ 0 }
+		{
+		}
+	public:
+		basic_crc& update(const void* aData, uint64_t aLength)
+		{
+			iValue = crc(Polynomial, iValue, aData, aLength);
+			iLength += aLength;
+			return *this;
+		}
+		// Appends the data summarised by aOther, e.g. a block checksummed on another thread.
+		basic_crc& append(const basic_crc& aOther)
+		{
+			iValue = crc_combine(Polynomial, iValue, aOther.iValue, aOther.iLength);
+			iLength += aOther.iLength;
+			return *this;
+		}
+		void reset()
+		{
+			iValue = 0;
+			iLength = 0;
+		}
+		uint32_t value() const
+		{
+			return iValue;
+		}
+		uint64_t length() const
+		{
+			return iLength;
+		}
+	private:
+		uint32_t iValue;
+		uint64_t iLength;
+	};
+
+	typedef basic_crc<crc_polynomial::Crc32> crc32_engine;
+	typedef basic_crc<crc_polynomial::Crc32c> crc32c_engine;
 }
@@ -22,9 +22,15 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "neolib.hpp"
 #include <vector>
 #include <list>
-#include <unordered_map>
 #include <optional>
 #include <mutex>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include <tuple>
+#include <functional>
 #include "any.hpp"
 #include "allocator.hpp"
 #include "mutex.hpp"
@@ -32,9 +38,17 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "async_task.hpp"
 #include "timer.hpp"
 #include "raii.hpp"
+#include "mpsc_queue.hpp"
+#include "flat_hash_map.hpp"
 
 namespace neolib
 {
+	enum class event_dispatch_mode
+	{
+		Locking,
+		Snapshot
+	};
+
 	class event_system
 	{
 	public:
@@ -54,6 +68,15 @@ namespace neolib
 		{
 			instance().iMultiThreaded = true;
 		}
+		// dispatch mode of events created from now on
+		static event_dispatch_mode default_dispatch_mode()
+		{
+			return instance().iDefaultDispatchMode;
+		}
+		static void set_default_dispatch_mode(event_dispatch_mode aDispatchMode)
+		{
+			instance().iDefaultDispatchMode = aDispatchMode;
+		}
 	private:
 		static event_system& instance()
 		{
@@ -62,6 +85,7 @@ namespace neolib
 		}
 	private:
 		bool iMultiThreaded = true;
+		std::atomic<event_dispatch_mode> iDefaultDispatchMode{ event_dispatch_mode::Locking };
 	};
 
 	typedef multi_threaded_lifetime event_lifetime;
@@ -156,6 +180,8 @@ namespace neolib
 		event_handle& operator~()
 		{
 			iHandler->iThreadId = std::nullopt;
+			if (!iEvent.expired())
+				(**iEvent.lock()).handler_changed();
 			return *this;
 		}
 	public:
@@ -187,6 +213,11 @@ namespace neolib
 		typename handler_list::iterator iHandler;
 	};
 
+	// Delivers asynchronous event triggers on the queue's task and callbacks enqueued to specific threads. Each 
+	// target thread has its own lock-free MPSC queue; an empty queue that receives an event wakes its consumer 
+	// (a condition variable, or for a task other than the queue's own a publish posted to that task) which then 
+	// delivers everything queued as one batch. Triggers queued by add() are also registered by event (under a 
+	// mutex) so that has() and remove() can find them without consuming the queue.
 	class async_event_queue
 	{
 	private:
@@ -203,24 +234,63 @@ namespace neolib
 			async_event_queue* aliased;
 			std::weak_ptr<async_event_queue> counted;
 		};
-		typedef std::unordered_multimap<
-			const void*,
-			std::pair<callback, event_lifetime::destroyed_flag>,
-			std::hash<const void*>,
-			std::equal_to<const void*>,
-			thread_safe_fast_pool_allocator<std::pair<const void* const, std::pair<callback, event_lifetime::destroyed_flag>>>> event_list;
-		typedef std::vector<callback> callback_list;
-		typedef std::unordered_map<
-			const void*,
-			callback_list,
-			std::hash<const void*>,
-			std::equal_to<const void*>,
-			thread_safe_fast_pool_allocator<std::pair<const void* const, callback_list>>> event_callback_list;
-		typedef std::map<
-			std::thread::id,
-			event_callback_list,
-			std::less<std::thread::id>,
-			thread_safe_fast_pool_allocator<std::pair<const std::thread::id, event_callback_list>>> threaded_callbacks;
+		// a trigger queued by add(); delivery and remove() race to claim it
+		struct pending_event
+		{
+			const void* iEvent;
+			callback iCallback;
+			event_lifetime::destroyed_flag iDestroyedFlag;
+			pending_event* iPrevious = nullptr;
+			pending_event* iNext = nullptr;
+			bool iClaimed = false;
+			pending_event(const void* aEvent, callback aCallback, const event_lifetime::destroyed_flag& aDestroyedFlag) :
+				iEvent{ aEvent }, iCallback{ std::move(aCallback) }, iDestroyedFlag{ aDestroyedFlag }
+			{
+			}
+		};
+		struct pending_list
+		{
+			pending_event* first = nullptr;
+			pending_event* last = nullptr;
+		};
+		typedef flat_hash_map<const void*, pending_list> pending_map;
+		struct queued_event
+		{
+			const void* iEvent = nullptr;
+			const void* iHandler = nullptr; // callbacks with the same event and (non-null) handler can be coalesced
+			callback iCallback;
+			std::unique_ptr<pending_event> iPending;
+		};
+		typedef mpsc_queue<queued_event> event_list;
+		class delivery_queue
+		{
+		public:
+			delivery_queue();
+		public:
+			void push(queued_event&& aEvent);
+			bool pop(queued_event& aEvent);
+			bool empty() const;
+			void set_poster(std::function<void()> aPoster);
+			// consumer: waits until there is something to deliver, aDeadline is reached or wake() is called
+			bool wait(std::optional<std::chrono::steady_clock::time_point> aDeadline = {});
+			void wake();
+			void begin_delivery();
+			std::vector<queued_event>& batch();
+		private:
+			event_list iEvents;
+			std::function<void()> iPoster;
+			std::atomic<bool> iWakePending;
+			std::atomic<std::size_t> iWaiters;
+			std::mutex iMutex;
+			std::condition_variable iCondition;
+			std::vector<queued_event> iBatch;
+		};
+		struct thread_queue
+		{
+			std::thread::id threadId;
+			delivery_queue queue;
+			thread_queue* next;
+		};
 	public:
 		async_event_queue();
 		async_event_queue(neolib::async_task& aTask);
@@ -242,11 +312,17 @@ namespace neolib
 		{
 			return has(static_cast<const void*>(&aEvent));
 		}
+		// delivers the callbacks enqueued to the calling thread
 		bool exec();
-		void enqueue_to_thread(const void* aEvent, std::thread::id aThreadId, callback aCallback);
+		// blocks the calling thread until callbacks have been enqueued to it or aTimeout elapses
+		bool wait(std::chrono::milliseconds aTimeout);
+		void enqueue_to_thread(const void* aEvent, std::thread::id aThreadId, callback aCallback, const void* aHandler = nullptr);
 		void unqueue(const void* aEvent);
 		void terminate();
 		void persist(std::shared_ptr<async_event_queue> aPtr, uint32_t aDuration_ms = 1000u);
+		// when set, only the last of several triggers of the same event in one batch is delivered to each handler
+		bool coalescing() const;
+		void set_coalescing(bool aCoalescing);
 	private:
 		async_event_queue(std::shared_ptr<async_task> aTask);
 		static std::recursive_mutex& instance_mutex();
@@ -254,19 +330,219 @@ namespace neolib
 		void add(const void* aEvent, callback aCallback, event_lifetime::destroyed_flag aDestroyedFlag);
 		void remove(const void* aEvent);
 		bool has(const void* aEvent) const;
-		void publish_events();
+		void link(pending_event& aPending);
+		void unlink(pending_event& aPending);
+		bool publish_events();
+		bool deliver(delivery_queue& aQueue);
+		thread_queue* find_thread_queue(std::thread::id aThreadId) const;
+		thread_queue& thread_queue_for(std::thread::id aThreadId);
+		void run_local_thread(local_thread& aThread);
+		void release_expired_cache();
 	private:
 		std::shared_ptr<async_task> iTask;
-		neolib::callback_timer iTimer;
-		mutable event_mutex iEventsMutex;
-		event_list iEvents;
-		event_mutex iThreadedCallbacksMutex;
-		std::atomic<bool> iHaveThreadedCallbacks;
-		threaded_callbacks iThreadedCallbacks;
+		delivery_queue iEvents;
+		std::atomic<thread_queue*> iThreadQueues;
+		std::atomic<bool> iCoalescing;
 		std::atomic<bool> iTerminated;
+		std::atomic<bool> iStopping;
+		mutable std::mutex iPendingMutex;
+		pending_map iPending;
+		std::mutex iCacheMutex;
 		std::pair<std::shared_ptr<async_event_queue>, std::chrono::time_point<std::chrono::steady_clock>> iCache;
 	};
 
+	namespace detail
+	{
+		struct event_dispatch_context
+		{
+			const void* iEvent;
+			bool iAccepted;
+			event_dispatch_context* iOuter;
+		};
+
+		// innermost snapshot trigger running on the calling thread (for accept() and ignore())
+		inline event_dispatch_context*& current_event_dispatch_context()
+		{
+			thread_local event_dispatch_context* tContext = nullptr;
+			return tContext;
+		}
+
+		// Read-copy-update handler list for event_dispatch_mode::Snapshot. Triggers take a reference on the 
+		// dispatcher and call through the current snapshot without locking, allocating or copying handlers;
+		// subscription changes publish a new snapshot (under the event's mutex) and retire the old one which 
+		// is freed once no trigger that could have seen it is still running. The event holds a reference too 
+		// so a trigger whose handler destroys the event can still finish safely. A trigger finds the dispatcher 
+		// through an atomic pointer, so between loading that pointer and taking its reference it holds a pin 
+		// (see acquire()); unpublish() waits for the pins to drain before dropping the event's reference.
+		template <typename HandlerListItem, typename HandlerCallback>
+		class event_dispatcher
+		{
+		public:
+			struct entry
+			{
+				HandlerCallback iCallback;
+				std::optional<std::thread::id> iThreadId;
+				const HandlerListItem* iItem;
+				std::atomic<bool> iActive;
+			};
+			class snapshot
+			{
+			public:
+				snapshot(std::size_t aSize) : iSize{ aSize }, iEntries{ aSize != 0 ? new entry[aSize] : nullptr }
+				{
+				}
+			public:
+				entry* begin() const
+				{
+					return iEntries.get();
+				}
+				entry* end() const
+				{
+					return iEntries.get() + iSize;
+				}
+			private:
+				std::size_t iSize;
+				std::unique_ptr<entry[]> iEntries;
+			};
+			class reader
+			{
+			public:
+				// adopts the reference taken by acquire()
+				reader(event_dispatcher& aDispatcher) :
+					iDispatcher{ aDispatcher }, iSnapshot{ aDispatcher.iCurrent.load() }
+				{
+				}
+				~reader()
+				{
+					iDispatcher.release_reader();
+				}
+				reader(const reader&) = delete;
+				reader& operator=(const reader&) = delete;
+			public:
+				const snapshot& current() const
+				{
+					return *iSnapshot;
+				}
+				bool orphaned() const
+				{
+					return iDispatcher.iOrphaned.load(std::memory_order_relaxed);
+				}
+			private:
+				event_dispatcher& iDispatcher;
+				const snapshot* iSnapshot;
+			};
+		public:
+			event_dispatcher() : 
+				iReferences{ 1 }, iOrphaned{ false }, iCurrent{ new snapshot{ 0 } }, iHaveRetired{ false }
+			{
+			}
+			~event_dispatcher()
+			{
+				delete iCurrent.load();
+				for (auto s : iRetired)
+					delete s;
+			}
+			event_dispatcher(const event_dispatcher&) = delete;
+			event_dispatcher& operator=(const event_dispatcher&) = delete;
+		public:
+			// the dispatcher published in aDispatcher, if any, with a reference taken for a reader
+			static event_dispatcher* acquire(const std::atomic<event_dispatcher*>& aDispatcher, std::atomic<std::size_t>& aPins)
+			{
+				aPins.fetch_add(1);
+				auto dispatcher = aDispatcher.load();
+				if (dispatcher != nullptr)
+					dispatcher->iReferences.fetch_add(1);
+				aPins.fetch_sub(1);
+				return dispatcher;
+			}
+			// called with the event's mutex held
+			static void unpublish(std::atomic<event_dispatcher*>& aDispatcher, const std::atomic<std::size_t>& aPins)
+			{
+				auto dispatcher = aDispatcher.exchange(nullptr);
+				if (dispatcher == nullptr)
+					return;
+				// an acquire() that loaded the pointer before the exchange has pinned it and not yet referenced it
+				while (aPins.load() != 0)
+					std::this_thread::yield();
+				dispatcher->orphan();
+			}
+		public:
+			// called with the event's mutex held
+			template <typename HandlerList>
+			void publish(const HandlerList& aHandlers)
+			{
+				std::unique_ptr<snapshot> newSnapshot = std::make_unique<snapshot>(aHandlers.size());
+				entry* e = newSnapshot->begin();
+				for (auto const& handler : aHandlers)
+				{
+					e->iCallback = handler.iHandlerCallback;
+					e->iThreadId = handler.iThreadId;
+					e->iItem = &handler;
+					e->iActive.store(true, std::memory_order_relaxed);
+					++e;
+				}
+				retire(iCurrent.exchange(newSnapshot.release()));
+			}
+			// stops triggers already running from calling a handler that has been unsubscribed
+			void deactivate(const HandlerListItem& aItem)
+			{
+				std::lock_guard<std::mutex> lg{ iRetiredMutex };
+				deactivate(*iCurrent.load(), aItem);
+				for (auto s : iRetired)
+					deactivate(*s, aItem);
+			}
+			// called by the owning event when it goes away
+			void orphan()
+			{
+				iOrphaned.store(true);
+				if (iReferences.fetch_sub(1) == 1)
+					delete this;
+			}
+		private:
+			static void deactivate(snapshot& aSnapshot, const HandlerListItem& aItem)
+			{
+				for (auto& e : aSnapshot)
+					if (e.iItem == &aItem)
+						e.iActive.store(false, std::memory_order_relaxed);
+			}
+			void retire(snapshot* aSnapshot)
+			{
+				std::lock_guard<std::mutex> lg{ iRetiredMutex };
+				iRetired.push_back(aSnapshot);
+				iHaveRetired.store(true, std::memory_order_relaxed);
+				if (iReferences.load() == 1)
+					reclaim();
+			}
+			void release_reader()
+			{
+				// the last trigger out frees what was retired while it ran; the reference count is checked 
+				// with the retired list locked so nothing it didn't account for can be retired meanwhile
+				if (iHaveRetired.load(std::memory_order_relaxed) && iRetiredMutex.try_lock())
+				{
+					std::lock_guard<std::mutex> lg{ iRetiredMutex, std::adopt_lock };
+					if (iReferences.load() == 2 && !iOrphaned.load())
+						reclaim();
+				}
+				if (iReferences.fetch_sub(1) == 1)
+					delete this;
+			}
+			void reclaim()
+			{
+				for (auto s : iRetired)
+					delete s;
+				iRetired.clear();
+				iHaveRetired.store(false, std::memory_order_relaxed);
+			}
+		private:
+			std::atomic<std::size_t> iReferences;
+			std::atomic<bool> iOrphaned;
+			std::atomic<snapshot*> iCurrent;
+			std::mutex iRetiredMutex;
+			std::vector<snapshot*> iRetired;
+			std::atomic<bool> iHaveRetired;
+		};
+	}
+
 	enum class event_trigger_type
 	{
 		Default,
@@ -281,6 +557,7 @@ namespace neolib
 	{
 		friend class sink;
 		friend class async_event_queue;
+		friend class event_handle<Arguments...>;
 	private:
 		typedef event<Arguments...> self_type;
 		typedef event_handle<Arguments...> handle;
@@ -292,12 +569,7 @@ namespace neolib
 		typedef typename handle::sink_reference_count sink_reference_count;
 		typedef typename handle::handler_list_item handler_list_item;
 		typedef typename handle::handler_list handler_list;
-		typedef std::unordered_map<
-			unique_id_type, 
-			typename handler_list::iterator,
-			std::hash<unique_id_type>, 
-			std::equal_to<unique_id_type>, 
-			thread_safe_fast_pool_allocator<std::pair<const unique_id_type, typename handler_list::iterator>>> unique_id_map;
+		typedef flat_hash_map<unique_id_type, typename handler_list::iterator> unique_id_map;
 		class copyable_atomic_bool : public std::atomic<bool>
 		{
 		public:
@@ -311,8 +583,11 @@ namespace neolib
 		typedef std::vector<notification> notification_list;
 		typedef std::shared_ptr<notification_list> notification_list_ptr;
 		typedef std::vector<notification_list_ptr> notification_list_pool;
+		typedef detail::event_dispatcher<handler_list_item, handler_callback> dispatcher;
 		struct state : event_lifetime
 		{
+			std::atomic<dispatcher*> snapshotDispatcher{ nullptr };
+			mutable std::atomic<std::size_t> snapshotPins{ 0 };
 			instance_ptr instancePtr;
 			std::shared_ptr<async_event_queue> asyncEventQueue;
 			handler_list handlers;
@@ -356,11 +631,36 @@ namespace neolib
 		{
 			instance_data().triggerType = aTriggerType;
 		}
+		event_dispatch_mode dispatch_mode() const
+		{
+			return instance_data().snapshotDispatcher.load(std::memory_order_acquire) != nullptr ? event_dispatch_mode::Snapshot : event_dispatch_mode::Locking;
+		}
+		void set_dispatch_mode(event_dispatch_mode aDispatchMode)
+		{
+			destroyable_mutex_lock_guard<event_mutex> guard{ iMutex };
+			auto& instanceData = instance_data();
+			if ((instanceData.snapshotDispatcher.load() != nullptr) == (aDispatchMode == event_dispatch_mode::Snapshot))
+				return;
+			if (aDispatchMode == event_dispatch_mode::Snapshot)
+			{
+				auto newDispatcher = new dispatcher{};
+				newDispatcher->publish(instanceData.handlers);
+				instanceData.snapshotDispatcher.store(newDispatcher, std::memory_order_release);
+			}
+			else
+				dispatcher::unpublish(instanceData.snapshotDispatcher, instanceData.snapshotPins);
+		}
 		template<class... Ts>
 		bool trigger(Ts&&... aArguments) const
 		{
 			if (!has_instance_data()) // no instance date means no subscribers so no point triggering.
 				return true;
+			if (trigger_type() != event_trigger_type::Asynchronous && trigger_type() != event_trigger_type::AsynchronousDontQueue)
+			{
+				auto snapshotDispatcher = acquire_snapshot_dispatcher();
+				if (snapshotDispatcher != nullptr)
+					return snapshot_trigger(*snapshotDispatcher, std::forward<Ts>(aArguments)...);
+			}
 			destroyable_mutex_lock_guard<event_mutex> guard{ iMutex };
 			switch (trigger_type())
 			{
@@ -380,6 +680,9 @@ namespace neolib
 		{
 			if (!has_instance_data()) // no instance date means no subscribers so no point triggering.
 				return true;
+			auto snapshotDispatcher = acquire_snapshot_dispatcher();
+			if (snapshotDispatcher != nullptr)
+				return snapshot_trigger(*snapshotDispatcher, std::forward<Ts>(aArguments)...);
 			scoped_atomic_flag saf{ iInSync };
 			destroyable_mutex_lock_guard<event_mutex> guard{ iMutex };
 			destroyed_flag destroyed{ *this };
@@ -436,7 +739,7 @@ namespace neolib
 				if (iterHandler->iThreadId == std::nullopt || *iterHandler->iThreadId == std::this_thread::get_id())
 					context.notifications->emplace_back(true, iterHandler->iHandlerCallback, iterHandler);
 				else
-					enqueue_to_thread(*iterHandler, std::forward<Ts>(aArguments)...);
+					enqueue_to_thread(&*iterHandler, iterHandler->iHandlerCallback, *iterHandler->iThreadId, std::forward<Ts>(aArguments)...);
 			guard.unlock();
 			for (auto& notification : *context.notifications)
 			{
@@ -456,15 +759,20 @@ namespace neolib
 			if (!has_instance_data()) // no instance means no subscribers so no point triggering.
 				return;
 			destroyable_mutex_lock_guard<event_mutex> guard{ iMutex };
-			instance_data().asyncEventQueue->add(*this, [this, &aArguments...]() { sync_trigger(std::forward<Ts>(aArguments)...); });
+			std::tuple<std::decay_t<Ts>...> arguments{ std::forward<Ts>(aArguments)... };
+			instance_data().asyncEventQueue->add(*this, [this, arguments]() { std::apply([this](auto const&... aArguments) { sync_trigger(aArguments...); }, arguments); });
 		}
 		void accept() const
 		{
+			if (set_snapshot_accepted(true))
+				return;
 			destroyable_mutex_lock_guard<event_mutex> guard{ iMutex };
 			instance_data().contexts.back()->accepted = true;
 		}
 		void ignore() const
 		{
+			if (set_snapshot_accepted(false))
+				return;
 			destroyable_mutex_lock_guard<event_mutex> guard{ iMutex };
 			instance_data().contexts.back()->accepted = false;
 		}
@@ -474,12 +782,17 @@ namespace neolib
 			destroyable_mutex_lock_guard<event_mutex> guard{ iMutex };
 			auto& instanceData = instance_data();
 			if (aUniqueId == nullptr)
-				return handle{ instanceData.instancePtr, instanceData.handlers.insert(instanceData.handlers.end(), handler_list_item{ std::this_thread::get_id(), aUniqueId, aHandlerCallback }) };
+			{
+				auto newHandler = instanceData.handlers.insert(instanceData.handlers.end(), handler_list_item{ std::this_thread::get_id(), aUniqueId, aHandlerCallback });
+				publish_handlers();
+				return handle{ instanceData.instancePtr, newHandler };
+			}
 			auto existing = instanceData.uniqueIdMap.find(aUniqueId);
 			if (existing == instanceData.uniqueIdMap.end())
 				existing = instanceData.uniqueIdMap.insert(std::make_pair(aUniqueId, instanceData.handlers.insert(instanceData.handlers.end(), handler_list_item{ std::this_thread::get_id(), aUniqueId, aHandlerCallback }))).first;
 			else
 				existing->second->iHandlerCallback = aHandlerCallback;
+			publish_handlers();
 			return handle{ instanceData.instancePtr, existing->second };
 		}
 		handle operator()(const handler_callback& aHandlerCallback, const void* aUniqueId = nullptr) const
@@ -522,7 +835,11 @@ namespace neolib
 				if (existing != instanceData.uniqueIdMap.end())
 					instanceData.uniqueIdMap.erase(existing);
 			}
+			auto snapshotDispatcher = instanceData.snapshotDispatcher.load();
+			if (snapshotDispatcher != nullptr)
+				snapshotDispatcher->deactivate(*aHandle.handler());
 			instanceData.handlers.erase(aHandle.handler());
+			publish_handlers();
 		}
 		void unsubscribe(const void* aUniqueId) const
 		{
@@ -543,12 +860,80 @@ namespace neolib
 			return unsubscribe(static_cast<const void*>(&aUniqueIdObject));
 		}
 	private:
+		dispatcher* acquire_snapshot_dispatcher() const
+		{
+			auto& instanceData = instance_data();
+			return dispatcher::acquire(instanceData.snapshotDispatcher, instanceData.snapshotPins);
+		}
+		// aDispatcher was referenced by acquire_snapshot_dispatcher()
+		template<class... Ts>
+		bool snapshot_trigger(dispatcher& aDispatcher, Ts&&... aArguments) const
+		{
+			typename dispatcher::reader reader{ aDispatcher };
+			scoped_atomic_flag saf{ iInSync };
+			auto const& handlers = reader.current();
+			auto const thisThread = std::this_thread::get_id();
+			bool haveLocalHandlers = false;
+			for (auto const& handler : handlers)
+				if (handler.iThreadId == std::nullopt || *handler.iThreadId == thisThread)
+					haveLocalHandlers = true;
+				else if (handler.iActive.load(std::memory_order_relaxed))
+					enqueue_to_thread(handler.iItem, handler.iCallback, *handler.iThreadId, std::forward<Ts>(aArguments)...);
+			if (!haveLocalHandlers)
+				return true;
+			struct scoped_context : detail::event_dispatch_context
+			{
+				scoped_context(const void* aEvent) : 
+					detail::event_dispatch_context{ aEvent, false, detail::current_event_dispatch_context() }
+				{
+					detail::current_event_dispatch_context() = this;
+				}
+				~scoped_context()
+				{
+					detail::current_event_dispatch_context() = iOuter;
+				}
+			} context{ this };
+			for (auto const& handler : handlers)
+			{
+				if (!handler.iActive.load(std::memory_order_relaxed) || (handler.iThreadId != std::nullopt && *handler.iThreadId != thisThread))
+					continue;
+				handler.iCallback(std::forward<Ts>(aArguments)...);
+				if (reader.orphaned())
+					return false;
+				if (context.iAccepted)
+					return false;
+			}
+			return true;
+		}
+		bool set_snapshot_accepted(bool aAccepted) const
+		{
+			for (auto context = detail::current_event_dispatch_context(); context != nullptr; context = context->iOuter)
+				if (context->iEvent == this)
+				{
+					context->iAccepted = aAccepted;
+					return true;
+				}
+			return false;
+		}
+		// called with the mutex held whenever the handler list changes
+		void publish_handlers() const
+		{
+			auto& instanceData = instance_data();
+			auto snapshotDispatcher = instanceData.snapshotDispatcher.load();
+			if (snapshotDispatcher != nullptr)
+				snapshotDispatcher->publish(instanceData.handlers);
+		}
+		void handler_changed() const
+		{
+			destroyable_mutex_lock_guard<event_mutex> guard{ iMutex };
+			publish_handlers();
+		}
 		template<class... Ts>
-		void enqueue_to_thread(const handler_list_item& aItem, Ts&&... aArguments) const
+		void enqueue_to_thread(const handler_list_item* aHandler, const handler_callback& aCallback, std::thread::id aThreadId, Ts&&... aArguments) const
 		{
-			auto callback = aItem.iHandlerCallback;
-			std::tuple<Ts...> arguments{ std::forward<Ts>(aArguments)... };
-			instance_data().asyncEventQueue->enqueue_to_thread(this, *aItem.iThreadId, [callback, arguments](){ std::apply(callback, arguments); });
+			auto callback = aCallback;
+			std::tuple<std::decay_t<Ts>...> arguments{ std::forward<Ts>(aArguments)... };
+			instance_data().asyncEventQueue->enqueue_to_thread(this, aThreadId, [callback, arguments](){ std::apply(callback, arguments); }, aHandler);
 		}
 		void unqueue() const
 		{
@@ -572,6 +957,7 @@ namespace neolib
 				}
 			} destroyer{ iInstanceData };
 			iInstanceData = nullptr;
+			dispatcher::unpublish(instanceData.snapshotDispatcher, instanceData.snapshotPins);
 			auto queue = instanceData.asyncEventQueue;
 			if (queue.use_count() == 2)
 				queue->persist(queue); // keeps event queue around (cached) for a second 
@@ -593,6 +979,8 @@ namespace neolib
 					allocator().construct(newInstance);
 					newInstance->instancePtr = std::make_shared<ptr>(this);
 					newInstance->asyncEventQueue = async_event_queue::instance();
+					if (event_system::default_dispatch_mode() == event_dispatch_mode::Snapshot)
+						newInstance->snapshotDispatcher = new dispatcher{};
 				}
 				catch (...)
 				{
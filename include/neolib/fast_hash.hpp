@@ -36,18 +36,59 @@
 #pragma once
 
 #include "neolib.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NEOLIB_FAST_HASH_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#define NEOLIB_FAST_HASH_AVX2
+#include <immintrin.h>
+#endif
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
 
 namespace neolib
 {
-	namespace detail
+	enum class hash_algorithm
 	{
-		template <typename T>
-		inline T fast_hash(const void* aInput, std::size_t aLength);
+		Fnv1a,		// byte at a time; produces the same values as earlier versions of fast_hash
+		Wyhash,		// word at a time for short input, eight lane striped accumulation for long input
+		Default = Wyhash
+	};
+
+	struct hash128
+	{
+		uint64_t low;
+		uint64_t high;
+	};
+
+	inline bool operator==(const hash128& lhs, const hash128& rhs)
+	{
+		return lhs.low == rhs.low && lhs.high == rhs.high;
+	}
 
+	inline bool operator!=(const hash128& lhs, const hash128& rhs)
+	{
+		return !(lhs == rhs);
+	}
+
+	namespace detail
+	{
 		// https://en.wikipedia.org/wiki/Fowler%E2%80%93Noll%E2%80%93Vo_hash_function
 
+		template <typename T>
+		inline T fnv1a(const void* aInput, std::size_t aLength);
+
 		template <>
-		inline uint32_t fast_hash<uint32_t>(const void* aInput, std::size_t aLength)
+		inline uint32_t fnv1a<uint32_t>(const void* aInput, std::size_t aLength)
 		{
 			uint32_t hash = 2166136261u;
 			const uint8_t* octet = static_cast<const uint8_t*>(aInput);
@@ -61,7 +102,7 @@ namespace neolib
 		}
 
 		template <>
-		inline uint64_t fast_hash<uint64_t>(const void* aInput, std::size_t aLength)
+		inline uint64_t fnv1a<uint64_t>(const void* aInput, std::size_t aLength)
 		{
 			uint64_t hash = 14695981039346656037ull;
 			const uint8_t* octet = static_cast<const uint8_t*>(aInput);
@@ -73,16 +114,403 @@ namespace neolib
 			}
 			return hash;
 		}
+
+		/* Inputs of up to ShortLimit bytes are hashed as by wyhash (https://github.com/wangyi-fudan/wyhash): eight
+		   bytes at a time folded through 64x64->128 bit multiplies. Longer inputs are split into 64 byte stripes
+		   accumulated into eight independent 64 bit lanes in the manner of XXH3, which vectorizes with SSE2 and AVX2;
+		   every 16 stripes the lanes are scrambled and the lanes are folded together at the end. */
+		namespace wyhash
+		{
+			constexpr std::size_t ShortLimit = 256;
+			constexpr std::size_t StripeSize = 64;
+			constexpr std::size_t StripesPerBlock = 16;
+			constexpr std::size_t Lanes = 8;
+			constexpr std::size_t LastStripeSecret = 17;
+			constexpr std::size_t ScrambleSecret = 24;
+
+			constexpr uint64_t P0 = 0xA0761D6478BD642Full;
+			constexpr uint64_t P1 = 0xE7037ED1A0B428DBull;
+			constexpr uint64_t P2 = 0x8EBC6AF09C88C6E3ull;
+			constexpr uint64_t P3 = 0x589965CC75374CC3ull;
+			constexpr uint32_t ScramblePrime = 0x9E3779B1u;
+
+			// splitmix64 sequence seeded with zero
+			alignas(32) constexpr uint64_t Secret[32] =
+			{
+				0xE220A8397B1DCDAFull, 0x6E789E6AA1B965F4ull, 0x06C45D188009454Full, 0xF88BB8A8724C81ECull,
+				0x1B39896A51A8749Bull, 0x53CB9F0C747EA2EAull, 0x2C829ABE1F4532E1ull, 0xC584133AC916AB3Cull,
+				0x3EE5789041C98AC3ull, 0xF3B8488C368CB0A6ull, 0x657EECDD3CB13D09ull, 0xC2D326E0055BDEF6ull,
+				0x8621A03FE0BBDB7Bull, 0x8E1F7555983AA92Full, 0xB54E0F1600CC4D19ull, 0x84BB3F97971D80ABull,
+				0x7D29825C75521255ull, 0xC3CF17102B7F7F86ull, 0x3466E9A083914F64ull, 0xD81A8D2B5A4485ACull,
+				0xDB01602B100B9ED7ull, 0xA9038A921825F10Dull, 0xEDF5F1D90DCA2F6Aull, 0x54496AD67BD2634Cull,
+				0xDD7C01D4F5407269ull, 0x935E82F1DB4C4F7Bull, 0x69B82EBC92233300ull, 0x40D29EB57DE1D510ull,
+				0xA2F09DABB45C6316ull, 0xEE521D7A0F4D3872ull, 0xF16952EE72F3454Full, 0x377D35DEA8E40225ull
+			};
+
+			inline uint64_t read64(const uint8_t* aInput)
+			{
+				uint64_t result;
+				std::memcpy(&result, aInput, sizeof(result));
+				return result;
+			}
+
+			inline uint64_t read32(const uint8_t* aInput)
+			{
+				uint32_t result;
+				std::memcpy(&result, aInput, sizeof(result));
+				return result;
+			}
+
+			inline uint64_t read_small(const uint8_t* aInput, std::size_t aLength)
+			{
+				return (static_cast<uint64_t>(aInput[0]) << 16) | (static_cast<uint64_t>(aInput[aLength >> 1]) << 8) | aInput[aLength - 1];
+			}
+
+			// aA, aB := low and high halves of aA * aB
+			inline void multiply(uint64_t& aA, uint64_t& aB)
+			{
+#if defined(__SIZEOF_INT128__)
+				__uint128_t const product = static_cast<__uint128_t>(aA) * aB;
+				aA = static_cast<uint64_t>(product);
+				aB = static_cast<uint64_t>(product >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+				aA = _umul128(aA, aB, &aB);
+#else
+				uint64_t const ha = aA >> 32, hb = aB >> 32, la = static_cast<uint32_t>(aA), lb = static_cast<uint32_t>(aB);
+				uint64_t const rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb, t = rl + (rm0 << 32);
+				uint64_t carry = t < rl ? 1 : 0;
+				uint64_t const low = t + (rm1 << 32);
+				carry += low < t ? 1 : 0;
+				aA = low;
+				aB = rh + (rm0 >> 32) + (rm1 >> 32) + carry;
+#endif
+			}
+
+			inline uint64_t mix(uint64_t aA, uint64_t aB)
+			{
+				multiply(aA, aB);
+				return aA ^ aB;
+			}
+
+			inline uint64_t avalanche(uint64_t aHash)
+			{
+				aHash ^= aHash >> 37;
+				aHash *= 0x165667919E3779F9ull;
+				return aHash ^ (aHash >> 32);
+			}
+
+			inline hash128 hash_short(const uint8_t* aInput, std::size_t aLength, uint64_t aSeed)
+			{
+				uint64_t seed = aSeed ^ mix(aSeed ^ P0, P1);
+				uint64_t a;
+				uint64_t b;
+				if (aLength <= 16)
+				{
+					if (aLength >= 4)
+					{
+						std::size_t const offset = (aLength >> 3) << 2;
+						a = (read32(aInput) << 32) | read32(aInput + offset);
+						b = (read32(aInput + aLength - 4) << 32) | read32(aInput + aLength - 4 - offset);
+					}
+					else if (aLength > 0)
+					{
+						a = read_small(aInput, aLength);
+						b = 0;
+					}
+					else
+						a = b = 0;
+				}
+				else
+				{
+					const uint8_t* input = aInput;
+					std::size_t remaining = aLength;
+					if (remaining > 48)
+					{
+						uint64_t seed1 = seed;
+						uint64_t seed2 = seed;
+						do
+						{
+							seed = mix(read64(input) ^ P1, read64(input + 8) ^ seed);
+							seed1 = mix(read64(input + 16) ^ P2, read64(input + 24) ^ seed1);
+							seed2 = mix(read64(input + 32) ^ P3, read64(input + 40) ^ seed2);
+							input += 48;
+							remaining -= 48;
+						} while (remaining > 48);
+						seed ^= seed1 ^ seed2;
+					}
+					while (remaining > 16)
+					{
+						seed = mix(read64(input) ^ P1, read64(input + 8) ^ seed);
+						input += 16;
+						remaining -= 16;
+					}
+					a = read64(input + remaining - 16);
+					b = read64(input + remaining - 8);
+				}
+				a ^= P1;
+				b ^= seed;
+				multiply(a, b);
+				return hash128{ mix(a ^ P0 ^ aLength, b ^ P1), mix(a ^ P2 ^ aLength, b ^ P3) };
+			}
+
+			inline void init_lanes(uint64_t* aLanes, uint64_t aSeed)
+			{
+				for (std::size_t lane = 0; lane < Lanes; ++lane)
+					aLanes[lane] = Secret[lane + 8] ^ aSeed;
+			}
+
+			// Each lane adds the product of the two 32 bit halves of (input ^ secret) and the neighbouring lane's input.
+			inline void accumulate_stripe(uint64_t* aLanes, const uint8_t* aInput, const uint64_t* aSecret)
+			{
+#if defined(NEOLIB_FAST_HASH_AVX2)
+				for (std::size_t lane = 0; lane < Lanes; lane += 4)
+				{
+					__m256i const data = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(aInput + lane * 8));
+					__m256i const key = _mm256_xor_si256(data, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(aSecret + lane)));
+					__m256i const product = _mm256_mul_epu32(key, _mm256_shuffle_epi32(key, 0x31));
+					__m256i const swapped = _mm256_shuffle_epi32(data, 0x4E);
+					__m256i* const lanes = reinterpret_cast<__m256i*>(aLanes + lane);
+					_mm256_storeu_si256(lanes, _mm256_add_epi64(_mm256_loadu_si256(lanes), _mm256_add_epi64(product, swapped)));
+				}
+#elif defined(NEOLIB_FAST_HASH_SSE2)
+				for (std::size_t lane = 0; lane < Lanes; lane += 2)
+				{
+					__m128i const data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aInput + lane * 8));
+					__m128i const key = _mm_xor_si128(data, _mm_loadu_si128(reinterpret_cast<const __m128i*>(aSecret + lane)));
+					__m128i const product = _mm_mul_epu32(key, _mm_shuffle_epi32(key, 0x31));
+					__m128i const swapped = _mm_shuffle_epi32(data, 0x4E);
+					__m128i* const lanes = reinterpret_cast<__m128i*>(aLanes + lane);
+					_mm_storeu_si128(lanes, _mm_add_epi64(_mm_loadu_si128(lanes), _mm_add_epi64(product, swapped)));
+				}
+#else
+				for (std::size_t lane = 0; lane < Lanes; ++lane)
+				{
+					uint64_t const data = read64(aInput + lane * 8);
+					uint64_t const key = data ^ aSecret[lane];
+					aLanes[lane ^ 1] += data;
+					aLanes[lane] += (key & 0xFFFFFFFFull) * (key >> 32);
+				}
+#endif
+			}
+
+			inline void scramble_lanes(uint64_t* aLanes)
+			{
+				for (std::size_t lane = 0; lane < Lanes; ++lane)
+				{
+					uint64_t value = aLanes[lane];
+					value ^= value >> 47;
+					value ^= Secret[ScrambleSecret + lane];
+					aLanes[lane] = value * ScramblePrime;
+				}
+			}
+
+			// aStripe counts the stripes accumulated so far and selects the secret for the next one.
+			inline void accumulate_stripes(uint64_t* aLanes, const uint8_t* aInput, std::size_t aStripeCount, std::size_t& aStripe)
+			{
+				for (std::size_t i = 0; i < aStripeCount; ++i, aInput += StripeSize)
+				{
+					accumulate_stripe(aLanes, aInput, Secret + aStripe % StripesPerBlock);
+					if (++aStripe % StripesPerBlock == 0)
+						scramble_lanes(aLanes);
+				}
+			}
+
+			inline uint64_t merge_lanes(const uint64_t* aLanes, const uint64_t* aSecret, uint64_t aStart)
+			{
+				uint64_t result = aStart;
+				for (std::size_t lane = 0; lane < Lanes; lane += 2)
+					result += mix(aLanes[lane] ^ aSecret[lane], aLanes[lane + 1] ^ aSecret[lane + 1]);
+				return avalanche(result);
+			}
+
+			// aLastStripe is the final StripeSize bytes of the input, which overlap the last accumulated stripe.
+			inline hash128 finish_long(const uint64_t* aLanes, const uint8_t* aLastStripe, std::size_t aLength)
+			{
+				uint64_t lanes[Lanes];
+				std::memcpy(lanes, aLanes, sizeof(lanes));
+				accumulate_stripe(lanes, aLastStripe, Secret + LastStripeSecret);
+				uint64_t const length = static_cast<uint64_t>(aLength);
+				return hash128{ merge_lanes(lanes, Secret + 3, length * P0), merge_lanes(lanes, Secret + 21, ~(length * P2)) };
+			}
+
+			inline hash128 hash(const void* aInput, std::size_t aLength, uint64_t aSeed)
+			{
+				const uint8_t* input = static_cast<const uint8_t*>(aInput);
+				if (aLength <= ShortLimit)
+					return hash_short(input, aLength, aSeed);
+				uint64_t lanes[Lanes];
+				init_lanes(lanes, aSeed);
+				std::size_t stripe = 0;
+				accumulate_stripes(lanes, input, (aLength - 1) / StripeSize, stripe);
+				return finish_long(lanes, input + aLength - StripeSize, aLength);
+			}
+		}
+
+		typedef std::conditional<sizeof(std::size_t) == sizeof(uint64_t), uint64_t, uint32_t>::type hash_word;
+
+		// Spreads the entropy of a word across all of its bits so that open addressing tables can use any subset of the
+		// bits of an identity-like hash.
+		inline std::size_t hash_mix(hash_word aValue)
+		{
+			if (sizeof(hash_word) == sizeof(uint64_t))
+				return static_cast<std::size_t>(wyhash::mix(static_cast<uint64_t>(aValue) ^ wyhash::P0, wyhash::P1));
+			uint32_t const product = static_cast<uint32_t>(aValue) * 0x9E3779B9u;
+			return static_cast<std::size_t>(product ^ (product >> 16));
+		}
 	}
 
-	template <typename T>
+	template <typename T, hash_algorithm Algorithm = hash_algorithm::Default>
 	inline T fast_hash(const void* aInput, std::size_t aLength)
 	{
-		return detail::fast_hash<T>(aInput, aLength);
+		static_assert(std::is_unsigned<T>::value && sizeof(T) <= sizeof(uint64_t), "neolib::fast_hash: unsupported hash type");
+		if constexpr (Algorithm == hash_algorithm::Fnv1a)
+			return static_cast<T>(detail::fnv1a<typename std::conditional<sizeof(T) <= sizeof(uint32_t), uint32_t, uint64_t>::type>(aInput, aLength));
+		else
+			return static_cast<T>(detail::wyhash::hash(aInput, aLength, 0).low);
 	}
 
 	inline uint32_t fast_hash(const void* aInput, std::size_t aLength)
 	{
 		return fast_hash<uint32_t>(aInput, aLength);
 	}
+
+	inline uint64_t fast_hash64(const void* aInput, std::size_t aLength, uint64_t aSeed = 0)
+	{
+		return detail::wyhash::hash(aInput, aLength, aSeed).low;
+	}
+
+	inline hash128 fast_hash128(const void* aInput, std::size_t aLength, uint64_t aSeed = 0)
+	{
+		return detail::wyhash::hash(aInput, aLength, aSeed);
+	}
+
+	/* Incremental form of fast_hash64/fast_hash128: feeding the same bytes in any number of update() calls gives
+	   the same digest as hashing them in one go. */
+	class fast_hasher
+	{
+	private:
+		static constexpr std::size_t BufferSize = detail::wyhash::ShortLimit;
+		static constexpr std::size_t StripeSize = detail::wyhash::StripeSize;
+	public:
+		explicit fast_hasher(uint64_t aSeed = 0)
+		{
+			reset(aSeed);
+		}
+	public:
+		void reset(uint64_t aSeed = 0)
+		{
+			iSeed = aSeed;
+			detail::wyhash::init_lanes(iLanes, aSeed);
+			iStripe = 0;
+			iLength = 0;
+			iBuffered = 0;
+		}
+		fast_hasher& update(const void* aInput, std::size_t aLength)
+		{
+			const uint8_t* input = static_cast<const uint8_t*>(aInput);
+			iLength += aLength;
+			if (iBuffered + aLength <= BufferSize)
+			{
+				std::memcpy(iBuffer + iBuffered, input, aLength);
+				iBuffered += aLength;
+				return *this;
+			}
+			// only stripes known not to be the last are accumulated; the last BufferSize bytes or fewer wait for digest
+			if (iBuffered != 0)
+			{
+				std::size_t const fill = BufferSize - iBuffered;
+				std::memcpy(iBuffer + iBuffered, input, fill);
+				input += fill;
+				aLength -= fill;
+				detail::wyhash::accumulate_stripes(iLanes, iBuffer, BufferSize / StripeSize, iStripe);
+				iBuffered = 0;
+			}
+			if (aLength > BufferSize)
+			{
+				std::size_t const stripes = (aLength - 1) / StripeSize;
+				detail::wyhash::accumulate_stripes(iLanes, input, stripes, iStripe);
+				input += stripes * StripeSize;
+				aLength -= stripes * StripeSize;
+				// keep the last accumulated stripe as the final stripe may overlap it
+				std::memcpy(iBuffer + BufferSize - StripeSize, input - StripeSize, StripeSize);
+			}
+			std::memcpy(iBuffer, input, aLength);
+			iBuffered = aLength;
+			return *this;
+		}
+		template <typename CharT, typename Traits>
+		fast_hasher& update(std::basic_string_view<CharT, Traits> aInput)
+		{
+			return update(aInput.data(), aInput.size() * sizeof(CharT));
+		}
+		uint64_t digest64() const
+		{
+			return digest128().low;
+		}
+		hash128 digest128() const
+		{
+			if (iLength <= BufferSize)
+				return detail::wyhash::hash_short(iBuffer, iBuffered, iSeed);
+			uint64_t lanes[detail::wyhash::Lanes];
+			std::memcpy(lanes, iLanes, sizeof(lanes));
+			std::size_t stripe = iStripe;
+			detail::wyhash::accumulate_stripes(lanes, iBuffer, (iBuffered - 1) / StripeSize, stripe);
+			if (iBuffered >= StripeSize)
+				return detail::wyhash::finish_long(lanes, iBuffer + iBuffered - StripeSize, iLength);
+			uint8_t lastStripe[StripeSize];
+			std::memcpy(lastStripe, iBuffer + BufferSize - (StripeSize - iBuffered), StripeSize - iBuffered);
+			std::memcpy(lastStripe + StripeSize - iBuffered, iBuffer, iBuffered);
+			return detail::wyhash::finish_long(lanes, lastStripe, iLength);
+		}
+	private:
+		uint64_t iSeed;
+		uint64_t iLanes[detail::wyhash::Lanes];
+		std::size_t iStripe;
+		uint64_t iLength;
+		std::size_t iBuffered;
+		uint8_t iBuffer[BufferSize];
+	};
+
+	/* Hash functor for neolib's hash containers: integers, enumerations and pointers are mixed rather than passed
+	   through unchanged and strings are hashed with fast_hash; anything else uses std::hash and is mixed. */
+	template <typename Key, typename = void>
+	struct hash
+	{
+		std::size_t operator()(const Key& aKey) const noexcept(noexcept(std::hash<Key>{}(aKey)))
+		{
+			return detail::hash_mix(static_cast<detail::hash_word>(std::hash<Key>{}(aKey)));
+		}
+	};
+
+	template <typename Key>
+	struct hash<Key, typename std::enable_if<std::is_integral<Key>::value || std::is_enum<Key>::value>::type>
+	{
+		std::size_t operator()(Key aKey) const noexcept
+		{
+			return detail::hash_mix(static_cast<detail::hash_word>(aKey));
+		}
+	};
+
+	template <typename T>
+	struct hash<T*>
+	{
+		std::size_t operator()(T* aKey) const noexcept
+		{
+			return detail::hash_mix(static_cast<detail::hash_word>(reinterpret_cast<std::uintptr_t>(aKey)));
+		}
+	};
+
+	template <typename CharT, typename Traits>
+	struct hash<std::basic_string_view<CharT, Traits>>
+	{
+		std::size_t operator()(std::basic_string_view<CharT, Traits> aKey) const noexcept
+		{
+			return static_cast<std::size_t>(fast_hash<detail::hash_word>(aKey.data(), aKey.size() * sizeof(CharT)));
+		}
+	};
+
+	template <typename CharT, typename Traits, typename Alloc>
+	struct hash<std::basic_string<CharT, Traits, Alloc>> : hash<std::basic_string_view<CharT, Traits>>
+	{
+	};
 }
@@ -0,0 +1,821 @@
+// flat_hash_map.hpp
+/*
+ *  Copyright (c) 2018 Leigh Johnston.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *     * Neither the name of Leigh Johnston nor the names of any
+ *       other contributors to this software may be used to endorse or
+ *       promote products derived from this software without specific prior
+ *       written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ *  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include "neolib.hpp"
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <utility>
+#include <tuple>
+#include <iterator>
+#include <algorithm>
+#include <functional>
+#include <initializer_list>
+#include <stdexcept>
+#include <type_traits>
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NEOLIB_FLAT_HASH_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#include "fast_hash.hpp"
+#include "vecarray.hpp"
+
+namespace neolib
+{
+	namespace detail
+	{
+		namespace flat_hash
+		{
+			/* One control byte per slot: a full slot holds the low seven bits of its key's hash (so the sign bit is
+			   clear), an empty or deleted slot has the sign bit set. */
+			typedef int8_t control_byte;
+			constexpr control_byte Empty = -128;
+			constexpr control_byte Deleted = -2;
+			constexpr std::size_t GroupWidth = 16;
+
+			inline uint32_t trailing_zeros(uint32_t aMask)
+			{
+#if defined(_MSC_VER)
+				unsigned long index;
+				_BitScanForward(&index, aMask);
+				return index;
+#elif defined(__GNUC__)
+				return __builtin_ctz(aMask);
+#else
+				uint32_t index = 0;
+				for (; (aMask & 1u) == 0u; aMask >>= 1)
+					++index;
+				return index;
+#endif
+			}
+
+			inline uint32_t leading_zeros(uint32_t aMask)
+			{
+				uint32_t count = 0;
+				for (uint32_t bit = 1u << (GroupWidth - 1); bit != 0u && (aMask & bit) == 0u; bit >>= 1)
+					++count;
+				return count;
+			}
+
+			// GroupWidth consecutive control bytes; each match yields a bitmask with bit i set for matching byte i.
+			class group
+			{
+			public:
+				explicit group(const control_byte* aControl) :
+#ifdef NEOLIB_FLAT_HASH_SSE2
+					iControl{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(aControl)) }
+#else
+					iControl{ aControl }
+#endif
+				{
+				}
+			public:
+#ifdef NEOLIB_FLAT_HASH_SSE2
+				uint32_t match(control_byte aHash) const
+				{
+					return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(aHash), iControl)));
+				}
+				uint32_t match_empty_or_deleted() const
+				{
+					return static_cast<uint32_t>(_mm_movemask_epi8(iControl));
+				}
+#else
+				uint32_t match(control_byte aHash) const
+				{
+					uint32_t result = 0;
+					for (std::size_t i = 0; i < GroupWidth; ++i)
+						if (iControl[i] == aHash)
+							result |= (1u << i);
+					return result;
+				}
+				uint32_t match_empty_or_deleted() const
+				{
+					uint32_t result = 0;
+					for (std::size_t i = 0; i < GroupWidth; ++i)
+						if (iControl[i] < 0)
+							result |= (1u << i);
+					return result;
+				}
+#endif
+				uint32_t match_empty() const
+				{
+					return match(Empty);
+				}
+			private:
+#ifdef NEOLIB_FLAT_HASH_SSE2
+				__m128i iControl;
+#else
+				const control_byte* iControl;
+#endif
+			};
+
+			template <typename Value>
+			struct identity
+			{
+				const Value& operator()(const Value& aValue) const { return aValue; }
+			};
+
+			template <typename Value>
+			struct select_first
+			{
+				const typename Value::first_type& operator()(const Value& aValue) const { return aValue.first; }
+			};
+		}
+
+		/* Open addressing hash table in the SwissTable style. Values are stored inline in one slot array with a
+		   parallel array of control bytes; a lookup compares a whole group of control bytes against seven bits of
+		   the hash at once and only touches slots whose control byte matches. The capacity is a power of two and at
+		   most 7/8 of the slots are ever non-empty so every probe sequence meets an empty slot. The first GroupWidth
+		   control bytes are mirrored after the last so that a group can be loaded at any slot index. */
+		template <typename Value, typename Key, typename KeyOf, typename Hash, typename KeyEqual, typename Alloc>
+		class flat_hash_table
+		{
+		public:
+			typedef Key key_type;
+			typedef Value value_type;
+			typedef std::size_t size_type;
+			typedef std::ptrdiff_t difference_type;
+			typedef Hash hasher;
+			typedef KeyEqual key_equal;
+			typedef Alloc allocator_type;
+			typedef value_type& reference;
+			typedef const value_type& const_reference;
+			typedef value_type* pointer;
+			typedef const value_type* const_pointer;
+		private:
+			typedef flat_hash::control_byte control_byte;
+			typedef typename allocator_type:: template rebind<value_type>::other slot_allocator_type;
+			typedef typename allocator_type:: template rebind<control_byte>::other control_allocator_type;
+			typedef typename allocator_type:: template rebind<std::size_t>::other hash_allocator_type;
+			static constexpr size_type GroupWidth = flat_hash::GroupWidth;
+			static constexpr size_type npos = static_cast<size_type>(-1);
+		public:
+			template <typename ValueType>
+			class basic_iterator : public std::iterator<std::forward_iterator_tag, typename std::remove_const<ValueType>::type, std::ptrdiff_t, ValueType*, ValueType&>
+			{
+				friend class flat_hash_table;
+				template <typename>
+				friend class basic_iterator;
+			public:
+				basic_iterator() :
+					iControl{ nullptr }, iControlEnd{ nullptr }, iSlot{ nullptr }
+				{
+				}
+				template <typename OtherValueType, typename = typename std::enable_if<std::is_convertible<OtherValueType*, ValueType*>::value>::type>
+				basic_iterator(const basic_iterator<OtherValueType>& aOther) :
+					iControl{ aOther.iControl }, iControlEnd{ aOther.iControlEnd }, iSlot{ aOther.iSlot }
+				{
+				}
+			private:
+				basic_iterator(const control_byte* aControl, const control_byte* aControlEnd, ValueType* aSlot) :
+					iControl{ aControl }, iControlEnd{ aControlEnd }, iSlot{ aSlot }
+				{
+				}
+			public:
+				basic_iterator& operator++()
+				{
+					++iControl;
+					++iSlot;
+					skip_free();
+					return *this;
+				}
+				basic_iterator operator++(int) { basic_iterator ret(*this); operator++(); return ret; }
+				ValueType& operator*() const { return *iSlot; }
+				ValueType* operator->() const { return iSlot; }
+				bool operator==(const basic_iterator& aOther) const { return iControl == aOther.iControl; }
+				bool operator!=(const basic_iterator& aOther) const { return iControl != aOther.iControl; }
+			private:
+				void skip_free()
+				{
+					while (iControl != iControlEnd && *iControl < 0)
+					{
+						++iControl;
+						++iSlot;
+					}
+				}
+			private:
+				const control_byte* iControl;
+				const control_byte* iControlEnd;
+				ValueType* iSlot;
+			};
+			typedef basic_iterator<value_type> iterator;
+			typedef basic_iterator<const value_type> const_iterator;
+
+		public:
+			flat_hash_table(size_type aBucketCount = 0, const hasher& aHash = hasher{}, const key_equal& aKeyEqual = key_equal{}, const allocator_type& aAllocator = allocator_type{}) :
+				iHash{ aHash }, iKeyEqual{ aKeyEqual }, iSlotAllocator{ aAllocator }, iControlAllocator{ aAllocator }, iSlots{ nullptr }, iControl{ nullptr }, iCapacity{ 0 }, iSize{ 0 }, iGrowthLeft{ 0 }
+			{
+				reserve(aBucketCount);
+			}
+			flat_hash_table(const flat_hash_table& aOther) :
+				iHash{ aOther.iHash }, iKeyEqual{ aOther.iKeyEqual }, iSlotAllocator{ aOther.iSlotAllocator }, iControlAllocator{ aOther.iControlAllocator }, iSlots{ nullptr }, iControl{ nullptr }, iCapacity{ 0 }, iSize{ 0 }, iGrowthLeft{ 0 }
+			{
+				reserve(aOther.size());
+				for (const auto& value : aOther)
+				{
+					std::size_t const hash = hash_of(KeyOf{}(value));
+					size_type const index = find_free(hash);
+					construct(iSlots + index, value);
+					commit_insert(index, hash);
+				}
+			}
+			flat_hash_table(flat_hash_table&& aOther) :
+				iHash{ aOther.iHash }, iKeyEqual{ aOther.iKeyEqual }, iSlotAllocator{ aOther.iSlotAllocator }, iControlAllocator{ aOther.iControlAllocator }, iSlots{ aOther.iSlots }, iControl{ aOther.iControl }, iCapacity{ aOther.iCapacity }, iSize{ aOther.iSize }, iGrowthLeft{ aOther.iGrowthLeft }
+			{
+				aOther.iSlots = nullptr;
+				aOther.iControl = nullptr;
+				aOther.iCapacity = 0;
+				aOther.iSize = 0;
+				aOther.iGrowthLeft = 0;
+			}
+			~flat_hash_table()
+			{
+				destroy_all();
+				deallocate(iSlots, iControl, iCapacity);
+			}
+			flat_hash_table& operator=(const flat_hash_table& aOther)
+			{
+				flat_hash_table newContents{ aOther };
+				newContents.swap(*this);
+				return *this;
+			}
+			flat_hash_table& operator=(flat_hash_table&& aOther)
+			{
+				flat_hash_table newContents{ std::move(aOther) };
+				newContents.swap(*this);
+				return *this;
+			}
+
+		public:
+			allocator_type get_allocator() const
+			{
+				return allocator_type{ iSlotAllocator };
+			}
+			hasher hash_function() const
+			{
+				return iHash;
+			}
+			key_equal key_eq() const
+			{
+				return iKeyEqual;
+			}
+			iterator begin()
+			{
+				iterator result{ iControl, iControl + iCapacity, iSlots };
+				result.skip_free();
+				return result;
+			}
+			const_iterator begin() const
+			{
+				const_iterator result{ iControl, iControl + iCapacity, iSlots };
+				result.skip_free();
+				return result;
+			}
+			const_iterator cbegin() const
+			{
+				return begin();
+			}
+			iterator end()
+			{
+				return iterator{ iControl + iCapacity, iControl + iCapacity, iSlots + iCapacity };
+			}
+			const_iterator end() const
+			{
+				return const_iterator{ iControl + iCapacity, iControl + iCapacity, iSlots + iCapacity };
+			}
+			const_iterator cend() const
+			{
+				return end();
+			}
+			bool empty() const
+			{
+				return iSize == 0;
+			}
+			size_type size() const
+			{
+				return iSize;
+			}
+			size_type max_size() const
+			{
+				return std::allocator_traits<slot_allocator_type>::max_size(iSlotAllocator);
+			}
+			size_type bucket_count() const
+			{
+				return iCapacity;
+			}
+			float load_factor() const
+			{
+				return iCapacity != 0 ? static_cast<float>(iSize) / static_cast<float>(iCapacity) : 0.0f;
+			}
+			float max_load_factor() const
+			{
+				return 7.0f / 8.0f;
+			}
+			void max_load_factor(float)
+			{
+				// fixed at 7/8; accepted for interface compatibility with std::unordered_map
+			}
+			void reserve(size_type aCount)
+			{
+				if (aCount > growth_limit(iCapacity))
+					rehash(aCount);
+			}
+			void rehash(size_type aCount)
+			{
+				if (aCount == 0 && iCapacity == 0)
+					return;
+				size_type newCapacity = GroupWidth;
+				while (growth_limit(newCapacity) < std::max(aCount, iSize))
+					newCapacity *= 2;
+				resize(newCapacity);
+			}
+			void clear()
+			{
+				destroy_all();
+				if (iCapacity != 0)
+				{
+					std::memset(iControl, flat_hash::Empty, iCapacity + GroupWidth);
+					iGrowthLeft = growth_limit(iCapacity);
+				}
+				iSize = 0;
+			}
+			void swap(flat_hash_table& aOther)
+			{
+				std::swap(iHash, aOther.iHash);
+				std::swap(iKeyEqual, aOther.iKeyEqual);
+				std::swap(iSlotAllocator, aOther.iSlotAllocator);
+				std::swap(iControlAllocator, aOther.iControlAllocator);
+				std::swap(iSlots, aOther.iSlots);
+				std::swap(iControl, aOther.iControl);
+				std::swap(iCapacity, aOther.iCapacity);
+				std::swap(iSize, aOther.iSize);
+				std::swap(iGrowthLeft, aOther.iGrowthLeft);
+			}
+
+		public:
+			iterator find(const key_type& aKey)
+			{
+				return iterator_at(find_index(aKey, hash_of(aKey)));
+			}
+			const_iterator find(const key_type& aKey) const
+			{
+				return const_cast<flat_hash_table&>(*this).find(aKey);
+			}
+			size_type count(const key_type& aKey) const
+			{
+				return find_index(aKey, hash_of(aKey)) != npos ? 1 : 0;
+			}
+			bool contains(const key_type& aKey) const
+			{
+				return count(aKey) != 0;
+			}
+			std::pair<iterator, bool> insert(const value_type& aValue)
+			{
+				return emplace_key(KeyOf{}(aValue), [&](value_type* aSlot) { construct(aSlot, aValue); });
+			}
+			std::pair<iterator, bool> insert(value_type&& aValue)
+			{
+				return emplace_key(KeyOf{}(aValue), [&](value_type* aSlot) { construct(aSlot, std::move(aValue)); });
+			}
+			template <typename InputIterator>
+			void insert(InputIterator aFirst, InputIterator aLast)
+			{
+				for (; aFirst != aLast; ++aFirst)
+					insert(*aFirst);
+			}
+			template <typename... Args>
+			std::pair<iterator, bool> emplace(Args&&... aArguments)
+			{
+				value_type value(std::forward<Args>(aArguments)...);
+				return insert(std::move(value));
+			}
+			// Constructs the value with aConstruct(slot) only if aKey is not already present.
+			template <typename Construct>
+			std::pair<iterator, bool> emplace_key(const key_type& aKey, Construct aConstruct)
+			{
+				std::size_t const hash = hash_of(aKey);
+				size_type index = find_index(aKey, hash);
+				if (index != npos)
+					return std::make_pair(iterator_at(index), false);
+				index = prepare_insert(hash);
+				aConstruct(iSlots + index);
+				commit_insert(index, hash);
+				return std::make_pair(iterator_at(index), true);
+			}
+			iterator erase(const_iterator aPosition)
+			{
+				iterator next{ aPosition.iControl, aPosition.iControlEnd, const_cast<value_type*>(aPosition.iSlot) };
+				erase_index(static_cast<size_type>(aPosition.iSlot - iSlots));
+				++next;
+				return next;
+			}
+			iterator erase(iterator aPosition)
+			{
+				return erase(const_iterator{ aPosition });
+			}
+			iterator erase(const_iterator aFirst, const_iterator aLast)
+			{
+				while (aFirst != aLast)
+					aFirst = erase(aFirst);
+				return iterator{ aLast.iControl, aLast.iControlEnd, const_cast<value_type*>(aLast.iSlot) };
+			}
+			size_type erase(const key_type& aKey)
+			{
+				size_type const index = find_index(aKey, hash_of(aKey));
+				if (index == npos)
+					return 0;
+				erase_index(index);
+				return 1;
+			}
+			bool operator==(const flat_hash_table& aOther) const
+			{
+				if (size() != aOther.size())
+					return false;
+				for (const auto& value : *this)
+				{
+					auto existing = aOther.find(KeyOf{}(value));
+					if (existing == aOther.end() || !(*existing == value))
+						return false;
+				}
+				return true;
+			}
+			bool operator!=(const flat_hash_table& aOther) const
+			{
+				return !operator==(aOther);
+			}
+
+		private:
+			static size_type growth_limit(size_type aCapacity)
+			{
+				return aCapacity - aCapacity / 8;
+			}
+			std::size_t hash_of(const key_type& aKey) const
+			{
+				return iHash(aKey);
+			}
+			static control_byte h2(std::size_t aHash)
+			{
+				return static_cast<control_byte>(aHash & 0x7F);
+			}
+			static std::size_t h1(std::size_t aHash)
+			{
+				return aHash >> 7;
+			}
+			iterator iterator_at(size_type aIndex)
+			{
+				if (aIndex == npos)
+					return end();
+				return iterator{ iControl + aIndex, iControl + iCapacity, iSlots + aIndex };
+			}
+			size_type find_index(const key_type& aKey, std::size_t aHash) const
+			{
+				if (iCapacity == 0)
+					return npos;
+				size_type const mask = iCapacity - 1;
+				control_byte const tag = h2(aHash);
+				size_type position = h1(aHash) & mask;
+				for (size_type step = GroupWidth;; step += GroupWidth)
+				{
+					flat_hash::group const candidates{ iControl + position };
+					for (uint32_t match = candidates.match(tag); match != 0; match &= match - 1)
+					{
+						size_type const index = (position + flat_hash::trailing_zeros(match)) & mask;
+						if (iKeyEqual(KeyOf{}(iSlots[index]), aKey))
+							return index;
+					}
+					if (candidates.match_empty() != 0)
+						return npos;
+					position = (position + step) & mask;
+				}
+			}
+			size_type find_free(std::size_t aHash) const
+			{
+				size_type const mask = iCapacity - 1;
+				size_type position = h1(aHash) & mask;
+				for (size_type step = GroupWidth;; step += GroupWidth)
+				{
+					uint32_t const free = flat_hash::group{ iControl + position }.match_empty_or_deleted();
+					if (free != 0)
+						return (position + flat_hash::trailing_zeros(free)) & mask;
+					position = (position + step) & mask;
+				}
+			}
+			size_type prepare_insert(std::size_t aHash)
+			{
+				if (iCapacity == 0)
+					resize(GroupWidth);
+				size_type index = find_free(aHash);
+				if (iGrowthLeft == 0 && iControl[index] == flat_hash::Empty)
+				{
+					// out of empty slots: grow if mostly live, otherwise just clear out the tombstones
+					resize(iSize + 1 > growth_limit(iCapacity) / 2 ? iCapacity * 2 : iCapacity);
+					index = find_free(aHash);
+				}
+				return index;
+			}
+			void commit_insert(size_type aIndex, std::size_t aHash)
+			{
+				if (iControl[aIndex] == flat_hash::Empty)
+					--iGrowthLeft;
+				set_control(aIndex, h2(aHash));
+				++iSize;
+			}
+			void erase_index(size_type aIndex)
+			{
+				destroy(iSlots + aIndex);
+				--iSize;
+				// a slot can go back to empty if no probe window could ever have stepped over it when full
+				size_type const before = (aIndex - GroupWidth) & (iCapacity - 1);
+				uint32_t const emptyAfter = flat_hash::group{ iControl + aIndex }.match_empty();
+				uint32_t const emptyBefore = flat_hash::group{ iControl + before }.match_empty();
+				if (emptyAfter != 0 && emptyBefore != 0 && flat_hash::trailing_zeros(emptyAfter) + flat_hash::leading_zeros(emptyBefore) < GroupWidth)
+				{
+					set_control(aIndex, flat_hash::Empty);
+					++iGrowthLeft;
+				}
+				else
+					set_control(aIndex, flat_hash::Deleted);
+			}
+			void set_control(size_type aIndex, control_byte aControl)
+			{
+				iControl[aIndex] = aControl;
+				if (aIndex < GroupWidth)
+					iControl[iCapacity + aIndex] = aControl;
+			}
+			void resize(size_type aNewCapacity)
+			{
+				value_type* const oldSlots = iSlots;
+				control_byte* const oldControl = iControl;
+				size_type const oldCapacity = iCapacity;
+				iSlots = std::allocator_traits<slot_allocator_type>::allocate(iSlotAllocator, aNewCapacity);
+				try
+				{
+					iControl = std::allocator_traits<control_allocator_type>::allocate(iControlAllocator, aNewCapacity + GroupWidth);
+				}
+				catch (...)
+				{
+					std::allocator_traits<slot_allocator_type>::deallocate(iSlotAllocator, iSlots, aNewCapacity);
+					iSlots = oldSlots;
+					throw;
+				}
+				std::memset(iControl, flat_hash::Empty, aNewCapacity + GroupWidth);
+				iCapacity = aNewCapacity;
+				// once a value has been moved out of the old table a throwing hasher could no longer put the old table
+				// back, so in that case every key is hashed before anything moves
+				constexpr bool hashFirst = relocates_by_move() && !std::is_nothrow_invocable<const hasher&, const key_type&>::value;
+				hash_allocator_type hashAllocator{ iSlotAllocator };
+				std::size_t* hashes = nullptr;
+				size_type moved = 0;
+				try
+				{
+					if constexpr (hashFirst)
+					{
+						hashes = std::allocator_traits<hash_allocator_type>::allocate(hashAllocator, oldCapacity);
+						for (size_type i = 0; i < oldCapacity; ++i)
+							if (oldControl[i] >= 0)
+								hashes[i] = hash_of(KeyOf{}(oldSlots[i]));
+					}
+					for (size_type i = 0; i < oldCapacity; ++i)
+						if (oldControl[i] >= 0)
+						{
+							std::size_t const hash = hashFirst ? hashes[i] : hash_of(KeyOf{}(oldSlots[i]));
+							size_type const index = find_free(hash);
+							relocate(iSlots + index, oldSlots + i);
+							set_control(index, h2(hash));
+							++moved;
+						}
+				}
+				catch (...)
+				{
+					// nothing has left the old table: either values are copied or the throw came before the first move
+					if (hashes != nullptr)
+						std::allocator_traits<hash_allocator_type>::deallocate(hashAllocator, hashes, oldCapacity);
+					for (size_type i = 0; i < iCapacity; ++i)
+						if (iControl[i] >= 0)
+							destroy(iSlots + i);
+					deallocate(iSlots, iControl, iCapacity);
+					iSlots = oldSlots;
+					iControl = oldControl;
+					iCapacity = oldCapacity;
+					throw;
+				}
+				if (hashes != nullptr)
+					std::allocator_traits<hash_allocator_type>::deallocate(hashAllocator, hashes, oldCapacity);
+				iGrowthLeft = growth_limit(iCapacity) - moved;
+				if (!relocates_by_move())
+					for (size_type i = 0; i < oldCapacity; ++i)
+						if (oldControl[i] >= 0)
+							destroy(oldSlots + i);
+				deallocate(oldSlots, oldControl, oldCapacity);
+			}
+			static constexpr bool relocates_by_move()
+			{
+				return is_trivially_relocatable<value_type>::value || std::is_nothrow_move_constructible<value_type>::value;
+			}
+			// Moves a value to a new slot and ends the source's lifetime; if moving might throw the value is copied
+			// instead and the sources are destroyed only once the whole table has been copied.
+			void relocate(value_type* aDestination, value_type* aSource)
+			{
+				if constexpr (is_trivially_relocatable<value_type>::value)
+					std::memcpy(static_cast<void*>(aDestination), static_cast<const void*>(aSource), sizeof(value_type));
+				else if constexpr (std::is_nothrow_move_constructible<value_type>::value)
+				{
+					construct(aDestination, std::move(*aSource));
+					destroy(aSource);
+				}
+				else
+					construct(aDestination, static_cast<const value_type&>(*aSource));
+			}
+		protected:
+			template <typename... Args>
+			void construct(value_type* aSlot, Args&&... aArguments)
+			{
+				std::allocator_traits<slot_allocator_type>::construct(iSlotAllocator, aSlot, std::forward<Args>(aArguments)...);
+			}
+		private:
+			void destroy(value_type* aSlot)
+			{
+				std::allocator_traits<slot_allocator_type>::destroy(iSlotAllocator, aSlot);
+			}
+			void destroy_all()
+			{
+				if (!std::is_trivially_destructible<value_type>::value)
+					for (size_type i = 0; i < iCapacity; ++i)
+						if (iControl[i] >= 0)
+							destroy(iSlots + i);
+			}
+			void deallocate(value_type* aSlots, control_byte* aControl, size_type aCapacity)
+			{
+				if (aCapacity == 0)
+					return;
+				std::allocator_traits<slot_allocator_type>::deallocate(iSlotAllocator, aSlots, aCapacity);
+				std::allocator_traits<control_allocator_type>::deallocate(iControlAllocator, aControl, aCapacity + GroupWidth);
+			}
+
+		private:
+			hasher iHash;
+			key_equal iKeyEqual;
+			slot_allocator_type iSlotAllocator;
+			control_allocator_type iControlAllocator;
+			value_type* iSlots;
+			control_byte* iControl;
+			size_type iCapacity;
+			size_type iSize;
+			size_type iGrowthLeft;
+		};
+	}
+
+	template <typename Key, typename T, typename Hash = hash<Key>, typename KeyEqual = std::equal_to<Key>, typename Alloc = std::allocator<std::pair<const Key, T>>>
+	class flat_hash_map : public detail::flat_hash_table<std::pair<const Key, T>, Key, detail::flat_hash::select_first<std::pair<const Key, T>>, Hash, KeyEqual, Alloc>
+	{
+		typedef detail::flat_hash_table<std::pair<const Key, T>, Key, detail::flat_hash::select_first<std::pair<const Key, T>>, Hash, KeyEqual, Alloc> base_type;
+	public:
+		typedef T mapped_type;
+		using typename base_type::key_type;
+		using typename base_type::value_type;
+		using typename base_type::size_type;
+		using typename base_type::hasher;
+		using typename base_type::key_equal;
+		using typename base_type::allocator_type;
+		using typename base_type::iterator;
+		using typename base_type::const_iterator;
+	public:
+		struct key_not_found : std::out_of_range { key_not_found() : std::out_of_range("neolib::flat_hash_map::key_not_found") {} };
+	public:
+		explicit flat_hash_map(size_type aBucketCount = 0, const hasher& aHash = hasher{}, const key_equal& aKeyEqual = key_equal{}, const allocator_type& aAllocator = allocator_type{}) :
+			base_type{ aBucketCount, aHash, aKeyEqual, aAllocator }
+		{
+		}
+		template <typename InputIterator>
+		flat_hash_map(InputIterator aFirst, InputIterator aLast, size_type aBucketCount = 0, const hasher& aHash = hasher{}, const key_equal& aKeyEqual = key_equal{}, const allocator_type& aAllocator = allocator_type{}) :
+			base_type{ aBucketCount, aHash, aKeyEqual, aAllocator }
+		{
+			base_type::insert(aFirst, aLast);
+		}
+		flat_hash_map(std::initializer_list<value_type> aValues, size_type aBucketCount = 0, const hasher& aHash = hasher{}, const key_equal& aKeyEqual = key_equal{}, const allocator_type& aAllocator = allocator_type{}) :
+			base_type{ aBucketCount, aHash, aKeyEqual, aAllocator }
+		{
+			base_type::insert(aValues.begin(), aValues.end());
+		}
+	public:
+		using base_type::insert;
+		void insert(std::initializer_list<value_type> aValues)
+		{
+			base_type::insert(aValues.begin(), aValues.end());
+		}
+		template <typename... Args>
+		std::pair<iterator, bool> try_emplace(const key_type& aKey, Args&&... aArguments)
+		{
+			return base_type::emplace_key(aKey, [&](value_type* aSlot)
+			{
+				base_type::construct(aSlot, std::piecewise_construct, std::forward_as_tuple(aKey), std::forward_as_tuple(std::forward<Args>(aArguments)...));
+			});
+		}
+		template <typename... Args>
+		std::pair<iterator, bool> try_emplace(key_type&& aKey, Args&&... aArguments)
+		{
+			return base_type::emplace_key(aKey, [&](value_type* aSlot)
+			{
+				base_type::construct(aSlot, std::piecewise_construct, std::forward_as_tuple(std::move(aKey)), std::forward_as_tuple(std::forward<Args>(aArguments)...));
+			});
+		}
+		template <typename M>
+		std::pair<iterator, bool> insert_or_assign(const key_type& aKey, M&& aMapped)
+		{
+			auto result = try_emplace(aKey, std::forward<M>(aMapped));
+			if (!result.second)
+				result.first->second = std::forward<M>(aMapped);
+			return result;
+		}
+		mapped_type& operator[](const key_type& aKey)
+		{
+			return try_emplace(aKey).first->second;
+		}
+		mapped_type& operator[](key_type&& aKey)
+		{
+			return try_emplace(std::move(aKey)).first->second;
+		}
+		mapped_type& at(const key_type& aKey)
+		{
+			auto existing = base_type::find(aKey);
+			if (existing == base_type::end())
+				throw key_not_found();
+			return existing->second;
+		}
+		const mapped_type& at(const key_type& aKey) const
+		{
+			return const_cast<flat_hash_map&>(*this).at(aKey);
+		}
+	};
+
+	template <typename Key, typename Hash = hash<Key>, typename KeyEqual = std::equal_to<Key>, typename Alloc = std::allocator<Key>>
+	class flat_hash_set : public detail::flat_hash_table<Key, Key, detail::flat_hash::identity<Key>, Hash, KeyEqual, Alloc>
+	{
+		typedef detail::flat_hash_table<Key, Key, detail::flat_hash::identity<Key>, Hash, KeyEqual, Alloc> base_type;
+	public:
+		using typename base_type::value_type;
+		using typename base_type::size_type;
+		using typename base_type::hasher;
+		using typename base_type::key_equal;
+		using typename base_type::allocator_type;
+	public:
+		explicit flat_hash_set(size_type aBucketCount = 0, const hasher& aHash = hasher{}, const key_equal& aKeyEqual = key_equal{}, const allocator_type& aAllocator = allocator_type{}) :
+			base_type{ aBucketCount, aHash, aKeyEqual, aAllocator }
+		{
+		}
+		template <typename InputIterator>
+		flat_hash_set(InputIterator aFirst, InputIterator aLast, size_type aBucketCount = 0, const hasher& aHash = hasher{}, const key_equal& aKeyEqual = key_equal{}, const allocator_type& aAllocator = allocator_type{}) :
+			base_type{ aBucketCount, aHash, aKeyEqual, aAllocator }
+		{
+			base_type::insert(aFirst, aLast);
+		}
+		flat_hash_set(std::initializer_list<value_type> aValues, size_type aBucketCount = 0, const hasher& aHash = hasher{}, const key_equal& aKeyEqual = key_equal{}, const allocator_type& aAllocator = allocator_type{}) :
+			base_type{ aBucketCount, aHash, aKeyEqual, aAllocator }
+		{
+			base_type::insert(aValues.begin(), aValues.end());
+		}
+	public:
+		using base_type::insert;
+		void insert(std::initializer_list<value_type> aValues)
+		{
+			base_type::insert(aValues.begin(), aValues.end());
+		}
+	};
+}
@@ -45,6 +45,7 @@
 #include "optional.hpp"
 #include "packet_stream.hpp"
 #include "string_packet.hpp"
+#include "resumer.hpp"
 
 namespace neolib
 {
@@ -85,6 +86,58 @@ namespace neolib
 		typedef std::map<ci_string, std::string> headers_t;
 		typedef std::vector<char> body_t;
 		enum type_e { Get, Post };
+		// co_await http.request(url) resumes (on the io task) once the request has completed or failed
+		class request_awaiter : private i_http_observer
+		{
+		public:
+			request_awaiter(http& aParent) : iParent(aParent), iObserving(false)
+			{
+			}
+			request_awaiter(const request_awaiter&) = delete;
+			~request_awaiter()
+			{
+				if (iObserving)
+					iParent.remove_observer(*this);
+			}
+		public:
+			bool await_ready() const
+			{
+				return iParent.finished();
+			}
+			template <typename Handle>
+			void await_suspend(Handle aHandle)
+			{
+				iResumer = resumer{ aHandle };
+				iParent.add_observer(*this);
+				iObserving = true;
+			}
+			http& await_resume() const
+			{
+				return iParent;
+			}
+		private:
+			void http_request_started(http&) override
+			{
+			}
+			void http_request_completed(http&) override
+			{
+				finished();
+			}
+			void http_request_failure(http&) override
+			{
+				finished();
+			}
+			void finished()
+			{
+				iParent.remove_observer(*this);
+				iObserving = false;
+				iParent.iIoTask.resume(iResumer);
+			}
+		private:
+			http& iParent;
+			bool iObserving;
+			resumer iResumer;
+		};
 		
 		// construction
 	public:
@@ -96,8 +149,9 @@ namespace neolib
 
 		// operations
 	public:
-		void request(const std::string& aUrl, type_e aType = Get, const headers_t& aRequestHeaders = headers_t(), const variant<body_t, std::string>& aRequestBody = std::string());
-		void request(const std::string& aHost, const std::string& aResource, type_e aType = Get, unsigned short aPort = 80, bool aSecure = false, const headers_t& aRequestHeaders = headers_t(), const variant<body_t, std::string>& aRequestBody = std::string());
+		request_awaiter request(const std::string& aUrl, type_e aType = Get, const headers_t& aRequestHeaders = headers_t(), const variant<body_t, std::string>& aRequestBody = std::string());
+		request_awaiter request(const std::string& aHost, const std::string& aResource, type_e aType = Get, unsigned short aPort = 80, bool aSecure = false, const headers_t& aRequestHeaders = headers_t(), const variant<body_t, std::string>& aRequestBody = std::string());
+		bool finished() const { return iState == Finished; }
 		bool ok() const { return iOk; }
 		unsigned int status_code() const { return iStatusCode; }
 		unsigned long body_length() const { return iBodyLength ? *iBodyLength : iBody.size(); }
@@ -110,6 +164,7 @@ namespace neolib
 		// implementation
 	private:
 		void init();
+		request_awaiter failed_request();
 		void add_response_header(const std::string& aHeaderLine);
 		bool decode();
 		bool decode_chunked();
@@ -39,6 +39,7 @@
 #include <string>
 #include <iostream>
 #include "i_sequence_container.hpp"
+#include "fast_hash.hpp"
 
 namespace neolib
 {
@@ -90,3 +91,16 @@ namespace neolib
 		return std::strcmp(lhs.c_str(), rhs.c_str()) < 0;
 	}
 }
+
+namespace std
+{
+	template <> struct hash<neolib::i_string>
+	{
+		typedef neolib::i_string argument_type;
+		typedef std::size_t result_type;
+		result_type operator()(argument_type const& aString) const
+		{
+			return neolib::fast_hash<std::size_t>(aString.c_str(), aString.size());
+		}
+	};
+}
@@ -37,6 +37,8 @@
 #pragma once
 
 #include "neolib.hpp"
+#include <algorithm>
+#include <functional>
 
 namespace neolib
 {
@@ -363,6 +365,21 @@ namespace neolib
 			aNodeForeignIndex = foreignIndex;
 			return x;
 		}
+		/* Answers a batch of lookups, sorted ascending by aPred, in one descent that partitions the keys between
+		   subtrees; aVisitor(key, node, nodeIndex, nodeForeignIndex) is called for each key in order (node is nil if
+		   the key lies beyond the end). */
+		template <typename KeyIterator, typename Visitor, typename Pred = std::less<foreign_index_type>>
+		void find_nodes_by_foreign_index(KeyIterator aFirst, KeyIterator aLast, Visitor aVisitor, Pred aPred = Pred{}) const
+		{
+			find_nodes_by_foreign_index(root_node(), 0, foreign_index_type{}, aFirst, aLast, aVisitor, aPred);
+		}
+		/* As find_nodes_by_foreign_index but for container positions sorted ascending; aVisitor(position, node,
+		   nodeForeignIndex) is called for each position in order. */
+		template <typename PositionIterator, typename Visitor>
+		void find_nodes(PositionIterator aFirst, PositionIterator aLast, Visitor aVisitor) const
+		{
+			find_nodes(root_node(), 0, foreign_index_type{}, aFirst, aLast, aVisitor);
+		}
 		void insert_node(node* aNode, size_type aPosition)
 		{
 			node* z = aNode;
@@ -467,6 +484,14 @@ namespace neolib
 			std::swap(iNil, aOther.iNil);
 		}
 
+		/* Recomputes every subtree foreign index from aCentreForeignIndex(node); lets a large batch of updates
+		   change nodes without repairing their ancestors one at a time. */
+		template <typename CentreForeignIndex>
+		void repair_foreign_indices(CentreForeignIndex aCentreForeignIndex)
+		{
+			repair_foreign_indices(root_node(), aCentreForeignIndex);
+		}
+
 	private:
 		void insert_fixup(node* aNode)
 		{
@@ -580,6 +605,58 @@ namespace neolib
 			y->iForeignIndex -= previousForeignIndex;
 			y->iForeignIndex += y->left()->foreign_index();
 		}
+		template <typename KeyIterator, typename Visitor, typename Pred>
+		void find_nodes_by_foreign_index(node* aNode, size_type aIndex, foreign_index_type aForeignIndex, KeyIterator aFirst, KeyIterator aLast, Visitor& aVisitor, Pred& aPred) const
+		{
+			if (aFirst == aLast)
+				return;
+			if (aNode == nil_node())
+			{
+				for (; aFirst != aLast; ++aFirst)
+					aVisitor(*aFirst, aNode, aIndex, aForeignIndex);
+				return;
+			}
+			const foreign_index_type centreStart = aForeignIndex + foreign_index_left(aNode);
+			const foreign_index_type centreEnd = centreStart + aNode->centre_foreign_index();
+			KeyIterator centreFirst = std::partition_point(aFirst, aLast, [&](const foreign_index_type& aKey) { return aPred(aKey, centreStart); });
+			KeyIterator centreLast = std::partition_point(centreFirst, aLast, [&](const foreign_index_type& aKey) { return aPred(aKey, centreEnd); });
+			find_nodes_by_foreign_index(aNode->left(), aIndex, aForeignIndex, aFirst, centreFirst, aVisitor, aPred);
+			for (; centreFirst != centreLast; ++centreFirst)
+				aVisitor(*centreFirst, aNode, aIndex + size_left(aNode), centreStart);
+			find_nodes_by_foreign_index(aNode->right(), aIndex + size(aNode) - size_right(aNode), centreEnd, centreLast, aLast, aVisitor, aPred);
+		}
+		template <typename PositionIterator, typename Visitor>
+		void find_nodes(node* aNode, size_type aIndex, foreign_index_type aForeignIndex, PositionIterator aFirst, PositionIterator aLast, Visitor& aVisitor) const
+		{
+			if (aFirst == aLast)
+				return;
+			if (aNode == nil_node())
+			{
+				for (; aFirst != aLast; ++aFirst)
+					aVisitor(*aFirst, aNode, aForeignIndex);
+				return;
+			}
+			const size_type centreStart = aIndex + size_left(aNode);
+			const size_type centreEnd = centreStart + aNode->centre_size();
+			PositionIterator centreFirst = std::partition_point(aFirst, aLast, [&](size_type aPosition) { return aPosition < centreStart; });
+			PositionIterator centreLast = std::partition_point(centreFirst, aLast, [&](size_type aPosition) { return aPosition < centreEnd; });
+			const foreign_index_type centreForeignIndex = aForeignIndex + foreign_index_left(aNode);
+			find_nodes(aNode->left(), aIndex, aForeignIndex, aFirst, centreFirst, aVisitor);
+			for (; centreFirst != centreLast; ++centreFirst)
+				aVisitor(*centreFirst, aNode, centreForeignIndex);
+			find_nodes(aNode->right(), centreEnd, centreForeignIndex + aNode->centre_foreign_index(), centreLast, aLast, aVisitor);
+		}
+		template <typename CentreForeignIndex>
+		foreign_index_type repair_foreign_indices(node* aNode, CentreForeignIndex& aCentreForeignIndex)
+		{
+			if (aNode == nil_node())
+				return foreign_index_type{};
+			/* do not use set_foreign_index() as we don't want to propagate to ancestors */
+			aNode->iForeignIndex = repair_foreign_indices(aNode->left(), aCentreForeignIndex);
+			aNode->iForeignIndex += aCentreForeignIndex(*aNode);
+			aNode->iForeignIndex += repair_foreign_indices(aNode->right(), aCentreForeignIndex);
+			return aNode->iForeignIndex;
+		}
 		node* tree_minimum(node* aNode)
 		{
 			node* x = aNode;
@@ -38,9 +38,13 @@
 
 #include "neolib.hpp"
 #include <memory>
+#include <algorithm>
 #include <iterator>
 #include <type_traits>
+#include <vector>
+#include <functional>
 #include "index_array_tree.hpp"
+#include "span.hpp"
 
 namespace neolib
 {
@@ -86,12 +90,133 @@ namespace neolib
 			{
 				return iSkip;
 			}
+			foreign_index_type centre_foreign_index() const
+			{
+				return iSkip.first + iValue.second + iSkip.second;
+			}
+			// The foreign index and skips are const within their pairs so an update rebuilds both pairs in place. The
+			// copies that can throw are made before either pair is destroyed; rebuilding from them can't throw.
+			void reset(const foreign_index_type& aForeignIndex, const skip_type& aSkip)
+			{
+				static_assert(std::is_nothrow_move_constructible<value_type>::value && std::is_nothrow_move_constructible<skip_type>::value,
+					"neolib::indexitor: element and foreign index types must be nothrow move constructible");
+				foreign_index_type foreignIndex{ aForeignIndex };
+				skip_type skip{ aSkip };
+				value_type value{ std::move(iValue.first), std::move(foreignIndex) };
+				iValue.~value_type();
+				new (&iValue) value_type{ std::move(value) };
+				iSkip.~skip_type();
+				new (&iSkip) skip_type{ std::move(skip) };
+			}
 
 		private:
 			value_type iValue;
 			skip_type iSkip;
 		};
 		typedef typename allocator_type:: template rebind<node>::other node_allocator_type;
+		/* A static B+tree over the foreign index at which each node starts: level 0 holds every start, each level
+		   above holds the first key of each block of the level below and a block fills a cache line, so a lookup
+		   scans one contiguous block per level instead of chasing red-black tree pointers. */
+		class foreign_index_layout
+		{
+		public:
+			static constexpr size_type npos = static_cast<size_type>(-1);
+			static constexpr size_type BlockKeys = 64 / sizeof(foreign_index_type) > 4 ? 64 / sizeof(foreign_index_type) : 4;
+
+		public:
+			bool valid() const
+			{
+				return !iStarts.empty();
+			}
+			void clear()
+			{
+				iNodes.clear();
+				iStarts.clear();
+				iLevels.clear();
+			}
+			void build(node* aFront, size_type aSize)
+			{
+				clear();
+				try
+				{
+					iNodes.reserve(aSize);
+					iStarts.reserve(aSize + 1);
+					foreign_index_type start{};
+					for (node* n = aFront; n != nullptr; n = static_cast<node*>(n->next()))
+					{
+						iNodes.push_back(n);
+						iStarts.push_back(start);
+						start += n->centre_foreign_index();
+					}
+					iStarts.push_back(start);
+					for (const std::vector<foreign_index_type>* below = &iStarts; keys(*below) > BlockKeys; below = &iLevels.back())
+					{
+						std::vector<foreign_index_type> level;
+						level.reserve((keys(*below) + BlockKeys - 1) / BlockKeys);
+						for (size_type i = 0; i < keys(*below); i += BlockKeys)
+							level.push_back((*below)[i]);
+						iLevels.push_back(std::move(level));
+					}
+				}
+				catch (...)
+				{
+					clear();
+					throw;
+				}
+			}
+			node* node_at(size_type aIndex) const
+			{
+				return iNodes[aIndex];
+			}
+			// foreign index at which the node at aIndex starts; start(size()) is the total
+			const foreign_index_type& start(size_type aIndex) const
+			{
+				return iStarts[aIndex];
+			}
+			// index of the last node starting at or before aForeignIndex, npos if there is none
+			template <typename Pred>
+			size_type find(const foreign_index_type& aForeignIndex, Pred& aPred) const
+			{
+				if (iNodes.empty() || aPred(aForeignIndex, iStarts[0]))
+					return npos;
+				size_type i = 0;
+				for (auto level = iLevels.rbegin(); level != iLevels.rend(); ++level)
+					i = find_in_block(*level, i * BlockKeys, aForeignIndex, aPred);
+				return find_in_block(iStarts, i * BlockKeys, aForeignIndex, aPred);
+			}
+			// as find for a foreign index at or after the start of the node at aIndex; sorted keys usually land close by
+			template <typename Pred>
+			size_type find_from(size_type aIndex, const foreign_index_type& aForeignIndex, Pred& aPred) const
+			{
+				const size_type last = std::min(aIndex + BlockKeys, iNodes.size());
+				while (aIndex + 1 < last && !aPred(aForeignIndex, iStarts[aIndex + 1]))
+					++aIndex;
+				if (aIndex + 1 == iNodes.size() || aPred(aForeignIndex, iStarts[aIndex + 1]))
+					return aIndex;
+				return find(aForeignIndex, aPred);
+			}
+
+		private:
+			size_type keys(const std::vector<foreign_index_type>& aLevel) const
+			{
+				// the total at the end of iStarts is not a node start
+				return &aLevel == &iStarts ? iNodes.size() : aLevel.size();
+			}
+			template <typename Pred>
+			size_type find_in_block(const std::vector<foreign_index_type>& aLevel, size_type aFirst, const foreign_index_type& aForeignIndex, Pred& aPred) const
+			{
+				const size_type last = std::min(aFirst + BlockKeys, keys(aLevel));
+				size_type i = aFirst;
+				while (i + 1 < last && !aPred(aForeignIndex, aLevel[i + 1]))
+					++i;
+				return i;
+			}
+
+		private:
+			std::vector<node*> iNodes;
+			std::vector<foreign_index_type> iStarts;
+			std::vector<std::vector<foreign_index_type>> iLevels;
+		};
 	public:
 		class iterator : public std::iterator<std::random_access_iterator_tag, value_type, difference_type, pointer, reference>
 		{
@@ -288,22 +413,22 @@ namespace neolib
 
 	public:
 		indexitor(const Alloc& aAllocator = Alloc()) :
-			iAllocator(aAllocator), iSize(0)
+			iAllocator(aAllocator), iSize(0), iForeignIndexLookups(0)
 		{
 		}
 		indexitor(const size_type aCount, const value_type& aValue, const Alloc& aAllocator = Alloc()) :
-			iAllocator(aAllocator), iSize(0)
+			iAllocator(aAllocator), iSize(0), iForeignIndexLookups(0)
 		{
 			insert(begin(), aCount, aValue);
 		}
 		template <typename InputIterator>
 		indexitor(InputIterator aFirst, InputIterator aLast, const Alloc& aAllocator = Alloc()) :
-			iAllocator(aAllocator), iSize(0)
+			iAllocator(aAllocator), iSize(0), iForeignIndexLookups(0)
 		{
 			insert(begin(), aFirst, aLast);
 		}
 		indexitor(const indexitor& aOther, const Alloc& aAllocator = Alloc()) :
-			iAllocator(aAllocator), iSize(0)
+			iAllocator(aAllocator), iSize(0), iForeignIndexLookups(0)
 		{
 			insert(begin(), aOther.begin(), aOther.end());
 		}
@@ -465,6 +590,7 @@ namespace neolib
 		{
 			if (aFirst == aLast)
 				return iterator{*this, aFirst.container_position()};
+			invalidate_foreign_index_layout();
 			auto pos = aFirst.container_position();
 			for (node* n = aFirst.iNode; n != aLast.iNode;)
 			{
@@ -488,24 +614,65 @@ namespace neolib
 			base::swap(aOther);
 			std::swap(iAllocator, aOther.iAllocator);
 			std::swap(iSize, aOther.iSize);
+			std::swap(iForeignIndexLayout, aOther.iForeignIndexLayout);
+			std::swap(iForeignIndexLookups, aOther.iForeignIndexLookups);
 		}
 
+	public:
+		struct foreign_index_update
+		{
+			foreign_index_update(const_iterator aPosition, const foreign_index_type& aForeignIndex, const skip_type& aSkip = skip_type{}) :
+				position{ aPosition }, foreignIndex{ aForeignIndex }, skip{ aSkip }
+			{
+			}
+			const_iterator position;
+			foreign_index_type foreignIndex;
+			skip_type skip;
+		};
 	public:
 		void update_foreign_index(const_iterator aPosition, const foreign_index_type& aForeignIndex, const skip_type& aSkip = skip_type{})
 		{
-			value_type currentValue = *aPosition;
-			insert(erase(aPosition), value_type{ currentValue.first, aForeignIndex }, aSkip);
+			invalidate_foreign_index_layout();
+			node& target = *aPosition.iNode;
+			target.reset(aForeignIndex, aSkip);
+			target.set_foreign_index(target.left_foreign_index() + target.centre_foreign_index() + target.right_foreign_index());
+		}
+		/* Applies a batch of updates; past the point where repairing each update's ancestors would cost more than
+		   a single pass over the tree the prefix sums are repaired once, after all the nodes have changed. */
+		void update_foreign_indices(span<const foreign_index_update> aUpdates)
+		{
+			if (aUpdates.size() * tree_depth() < size())
+			{
+				for (const auto& update : aUpdates)
+					update_foreign_index(update.position, update.foreignIndex, update.skip);
+				return;
+			}
+			invalidate_foreign_index_layout();
+			auto const repair = [this]()
+			{
+				base::repair_foreign_indices([](const typename base::node& aNode) { return static_cast<const node&>(aNode).centre_foreign_index(); });
+			};
+			try
+			{
+				for (const auto& update : aUpdates)
+					update.position.iNode->reset(update.foreignIndex, update.skip);
+			}
+			catch (...)
+			{
+				// the nodes already reset keep their new indices; the sums must agree with them
+				repair();
+				throw;
+			}
+			repair();
 		}
 		template <typename Pred = std::less<foreign_index_type>>
 		std::pair<const_iterator, foreign_index_type> find_by_foreign_index(foreign_index_type aForeignIndex, Pred aPred = Pred{}) const
 		{
 			size_type nodeIndex{};
 			foreign_index_type nodeForeignIndex{};
-			auto n = base::find_node_by_foreign_index(aForeignIndex, nodeIndex, nodeForeignIndex, aPred);
-			if (!n->is_nil() &&
-				!aPred(aForeignIndex - nodeForeignIndex, static_cast<node*>(n)->skip().first) &&
-				aPred(aForeignIndex - nodeForeignIndex, static_cast<node*>(n)->foreign_index() - static_cast<node*>(n)->skip().second))
-				return std::make_pair(const_iterator{*this, static_cast<node*>(n)}, nodeForeignIndex + static_cast<node*>(n)->skip().first);
+			auto n = do_find_by_foreign_index(aForeignIndex, nodeIndex, nodeForeignIndex, aPred);
+			if (n != nullptr)
+				return std::make_pair(const_iterator{*this, n, nodeIndex}, nodeForeignIndex + n->skip().first);
 			else
 				return std::make_pair(end(), foreign_index(end()));
 		}
@@ -514,20 +681,71 @@ namespace neolib
 		{
 			size_type nodeIndex{};
 			foreign_index_type nodeForeignIndex{};
-			auto n = base::find_node_by_foreign_index(aForeignIndex, nodeIndex, nodeForeignIndex, aPred);
-			if (!n->is_nil() && 
-				!aPred(aForeignIndex - nodeForeignIndex, static_cast<node*>(n)->skip().first) &&
-				aPred(aForeignIndex - nodeForeignIndex, static_cast<node*>(n)->foreign_index() - static_cast<node*>(n)->skip().second))
-				return std::make_pair(iterator{*this, static_cast<node*>(n)}, nodeForeignIndex + static_cast<node*>(n)->skip().first);
+			auto n = do_find_by_foreign_index(aForeignIndex, nodeIndex, nodeForeignIndex, aPred);
+			if (n != nullptr)
+				return std::make_pair(iterator{*this, n, nodeIndex}, nodeForeignIndex + n->skip().first);
 			else
 				return std::make_pair(end(), foreign_index(end()));
 		}
+		/* Batched find_by_foreign_index: aForeignIndices must be sorted ascending by aPred; all of them are resolved in
+		   one traversal of the tree and the results are in the same order. */
+		template <typename Pred = std::less<foreign_index_type>>
+		std::vector<std::pair<const_iterator, foreign_index_type>> find_by_foreign_index(span<const foreign_index_type> aForeignIndices, Pred aPred = Pred{}) const
+		{
+			std::vector<std::pair<const_iterator, foreign_index_type>> result;
+			result.reserve(aForeignIndices.size());
+			if (auto layout = foreign_index_layout_for(aForeignIndices.size()))
+			{
+				// the keys are sorted so each search starts from the node found for the previous key
+				size_type i = foreign_index_layout::npos;
+				for (const auto& foreignIndex : aForeignIndices)
+				{
+					i = (i == foreign_index_layout::npos ? layout->find(foreignIndex, aPred) : layout->find_from(i, foreignIndex, aPred));
+					if (i != foreign_index_layout::npos && aPred(foreignIndex, layout->start(i + 1)) &&
+						within_skips(*layout->node_at(i), foreignIndex, layout->start(i), aPred))
+						result.emplace_back(const_iterator{ *this, layout->node_at(i), i }, layout->start(i) + layout->node_at(i)->skip().first);
+					else
+						result.emplace_back(end(), layout->start(size()));
+				}
+				return result;
+			}
+			base::find_nodes_by_foreign_index(aForeignIndices.begin(), aForeignIndices.end(), 
+				[&](const foreign_index_type& aForeignIndex, typename base::node* aNode, size_type aNodeIndex, const foreign_index_type& aNodeForeignIndex)
+			{
+				node* n = static_cast<node*>(aNode);
+				if (!n->is_nil() && within_skips(*n, aForeignIndex, aNodeForeignIndex, aPred))
+					result.emplace_back(const_iterator{ *this, n, aNodeIndex }, aNodeForeignIndex + n->skip().first);
+				else
+					result.emplace_back(end(), foreign_index(end()));
+			}, aPred);
+			return result;
+		}
 		foreign_index_type foreign_index(const_iterator aPosition) const
 		{
+			if (auto layout = foreign_index_layout_for(1))
+				return aPosition.iNode != nullptr ? layout->start(aPosition.container_position()) + aPosition.iNode->skip().first : layout->start(size());
 			if (aPosition.iNode != nullptr)
 				return do_foreign_index(aPosition.iNode) + aPosition.iNode->skip().first;
 			else
-				return empty() ? foreign_index_type{} : do_foreign_index(static_cast<const node*>(base::back_node())) + base::back_node()->foreign_index();
+				return empty() ? foreign_index_type{} : do_foreign_index(static_cast<const node*>(base::back_node())) + base::back_node()->centre_foreign_index();
+		}
+		// Batched foreign_index for container positions sorted ascending, resolved in one traversal of the tree.
+		std::vector<foreign_index_type> foreign_index(span<const size_type> aPositions) const
+		{
+			std::vector<foreign_index_type> result;
+			result.reserve(aPositions.size());
+			if (auto layout = foreign_index_layout_for(aPositions.size()))
+			{
+				for (auto position : aPositions)
+					result.push_back(position < size() ? layout->start(position) + layout->node_at(position)->skip().first : layout->start(size()));
+				return result;
+			}
+			base::find_nodes(aPositions.begin(), aPositions.end(), 
+				[&](size_type, typename base::node* aNode, const foreign_index_type& aNodeForeignIndex)
+			{
+				result.push_back(!aNode->is_nil() ? aNodeForeignIndex + static_cast<node*>(aNode)->skip().first : aNodeForeignIndex);
+			});
+			return result;
 		}
 		foreign_index_type skip_before(const_iterator aPosition) const
 		{
@@ -548,6 +766,7 @@ namespace neolib
 		template <class InputIterator>
 		iterator do_insert(const_iterator aPosition, InputIterator aFirst, InputIterator aLast)
 		{
+			invalidate_foreign_index_layout();
 			node* before = aPosition.iNode;
 			size_type pos = aPosition.container_position();
 			auto nextPos = pos;
@@ -561,6 +780,7 @@ namespace neolib
 		template <class InputIterator, class SkipIterator>
 		iterator do_insert(const_iterator aPosition, InputIterator aFirst, InputIterator aLast, SkipIterator aSkipFirst, SkipIterator aSkipLast)
 		{
+			invalidate_foreign_index_layout();
 			node* before = aPosition.iNode;
 			size_type pos = aPosition.container_position();
 			auto nextPos = pos;
@@ -571,6 +791,62 @@ namespace neolib
 			}
 			return iterator{ *this, pos };
 		}
+		// depth of the red-black tree at its most unbalanced: the cost of one descent
+		size_type tree_depth() const
+		{
+			size_type depth = 1;
+			for (size_type n = size(); n > 1; n /= 2)
+				depth += 2;
+			return depth;
+		}
+		/* The layout is built once the tree descents made since the last change to the container have cost as much
+		   as building it would; a const lookup can build it so concurrent lookups need external synchronisation. */
+		const foreign_index_layout* foreign_index_layout_for(size_type aLookups) const
+		{
+			if (!iForeignIndexLayout.valid())
+			{
+				iForeignIndexLookups += aLookups;
+				if (empty() || iForeignIndexLookups * tree_depth() < size())
+					return nullptr;
+				iForeignIndexLayout.build(static_cast<node*>(base::front_node()), size());
+			}
+			return &iForeignIndexLayout;
+		}
+		void invalidate_foreign_index_layout()
+		{
+			iForeignIndexLayout.clear();
+			iForeignIndexLookups = 0;
+		}
+		template <typename Pred>
+		static bool within_skips(const node& aNode, const foreign_index_type& aForeignIndex, const foreign_index_type& aNodeForeignIndex, Pred& aPred)
+		{
+			return !aPred(aForeignIndex - aNodeForeignIndex, aNode.skip().first) &&
+				aPred(aForeignIndex - aNodeForeignIndex, aNode.centre_foreign_index() - aNode.skip().second);
+		}
+		template <typename Pred>
+		node* do_find_by_foreign_index(const foreign_index_type& aForeignIndex, size_type& aNodeIndex, foreign_index_type& aNodeForeignIndex, Pred& aPred) const
+		{
+			node* result = nullptr;
+			if (auto layout = foreign_index_layout_for(1))
+			{
+				auto const i = layout->find(aForeignIndex, aPred);
+				if (i != foreign_index_layout::npos && aPred(aForeignIndex, layout->start(i + 1)))
+				{
+					result = layout->node_at(i);
+					aNodeIndex = i;
+					aNodeForeignIndex = layout->start(i);
+				}
+			}
+			else
+			{
+				auto n = base::find_node_by_foreign_index(aForeignIndex, aNodeIndex, aNodeForeignIndex, aPred);
+				if (!n->is_nil())
+					result = static_cast<node*>(n);
+			}
+			if (result != nullptr && !within_skips(*result, aForeignIndex, aNodeForeignIndex, aPred))
+				result = nullptr;
+			return result;
+		}
 		size_type do_index(const node* aNode) const
 		{
 			if (aNode != base::root_node())
@@ -662,5 +938,7 @@ namespace neolib
 	private:
 		node_allocator_type iAllocator;
 		size_type iSize;
+		mutable foreign_index_layout iForeignIndexLayout;
+		mutable size_type iForeignIndexLookups;
 	};
 }
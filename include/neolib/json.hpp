@@ -39,6 +39,7 @@
 
 #include "neolib.hpp"
 #include <cstddef>
+#include <limits>
 #include <list>
 #include <string>
 #include <unordered_map>
@@ -50,6 +51,8 @@
 #include <memory>
 #include <exception>
 #include <optional>
+#include <new>
+#include <algorithm>
 #include <neolib/allocator.hpp>
 #include <neolib/variant.hpp>
 #include <neolib/quick_string.hpp>
@@ -63,6 +66,20 @@ namespace neolib
 		Relaxed
 	};
 
+	enum class json_parse_mode
+	{
+		Scalar,				// per-character state machine; the only mode for json_syntax::Relaxed, json_syntax::StandardNoKeywords and wide characters
+		StructuralIndex,	// SIMD structural index then a pass over the index to build the tree
+		Default = StructuralIndex
+	};
+
+	enum class json_object_index
+	{
+		Lazy,				// an object's key dictionary is built the first time it is searched
+		Eager,				// built as each object is parsed so that the first lookup costs no more than any other
+		Default = Lazy
+	};
+
 	enum class json_encoding
 	{
 		Utf8,
@@ -82,6 +99,8 @@ namespace neolib
 
 		template <typename CharT>
 		struct default_encoding	{ static const json_encoding DEFAULT_ENCODING = default_encoding_helper<sizeof(CharT)>::DEFAULT_ENCODING; };
+
+		struct document_mapping;
 	}
 
 	enum class json_type
@@ -132,22 +151,257 @@ namespace neolib
 		}
 	}
 
+	template <json_syntax Syntax = json_syntax::Standard, typename Alloc = std::allocator<json_type>, typename CharT = char, typename Traits = std::char_traits<CharT>, typename CharAlloc = std::allocator<CharT>>
+	class basic_json_value;
+
 	namespace json_detail
 	{
+		// Bump allocator for the nodes and indexes of one document. Blocks are obtained from Alloc and are
+		// returned all at once by release(). Nodes are never freed individually; the indexes (which are dropped
+		// and rebuilt as a document is edited) are rounded up to a power of two size class and recycled through
+		// per-class free lists so that rebuilding one reuses the memory of the one it replaces. Not thread safe:
+		// const lookups build indexes so a document must not be read concurrently without synchronization.
+		template <typename Alloc>
+		class document_arena
+		{
+		public:
+			typedef Alloc allocator_type;
+		public:
+			static constexpr std::size_t InitialBlockSize = 4 * 1024;
+			static constexpr std::size_t MaxBlockSize = 1024 * 1024;
+		private:
+			typedef std::max_align_t unit;
+			typedef typename std::allocator_traits<allocator_type>::template rebind_alloc<unit> block_allocator;
+			struct block
+			{
+				block* previous;
+				std::size_t units;
+			};
+			static constexpr std::size_t HeaderUnits = (sizeof(block) + sizeof(unit) - 1) / sizeof(unit);
+			struct free_block
+			{
+				free_block* next;
+			};
+			static constexpr std::size_t SizeClassCount = std::numeric_limits<std::size_t>::digits;
+		public:
+			document_arena() :
+				iBlocks{ nullptr },
+				iCursor{ nullptr },
+				iLimit{ nullptr },
+				iNextBlockSize{ InitialBlockSize },
+				iBytesReserved{ 0 },
+				iTrivial{ true },
+				iDiscarding{ false },
+				iFree{}
+			{
+			}
+			~document_arena()
+			{
+				release();
+			}
+			document_arena(const document_arena&) = delete;
+			document_arena& operator=(const document_arena&) = delete;
+		public:
+			void* allocate(std::size_t aSize)
+			{
+				std::size_t const units = (aSize + sizeof(unit) - 1) / sizeof(unit);
+				if (static_cast<std::size_t>(iLimit - iCursor) < units)
+					new_block(units);
+				void* const result = iCursor;
+				iCursor += units;
+				return result;
+			}
+			void* allocate_recyclable(std::size_t aSize)
+			{
+				std::size_t const sizeClass = size_class(aSize);
+				if (iFree[sizeClass] != nullptr)
+				{
+					free_block* const result = iFree[sizeClass];
+					iFree[sizeClass] = result->next;
+					return result;
+				}
+				return allocate(sizeof(unit) << sizeClass);
+			}
+			void recycle(void* aObject, std::size_t aSize)
+			{
+				std::size_t const sizeClass = size_class(aSize);
+				iFree[sizeClass] = new (aObject) free_block{ iFree[sizeClass] };
+			}
+			// a tree is trivial whilst nothing in it owns memory from outside the arena (strings that are views of
+			// the document text own nothing) so it can be freed without running its destructors
+			bool trivial() const
+			{
+				return iTrivial;
+			}
+			void set_non_trivial()
+			{
+				iTrivial = false;
+			}
+			// true whilst a trivial tree is being released; nodes then skip destroying their children
+			bool discarding() const
+			{
+				return iDiscarding;
+			}
+			template <typename DestroyTree>
+			void release(DestroyTree&& aDestroyTree)
+			{
+				iDiscarding = iTrivial;
+				aDestroyTree();
+				iDiscarding = false;
+				release();
+			}
+			void release()
+			{
+				while (iBlocks != nullptr)
+				{
+					block* const previous = iBlocks->previous;
+					std::size_t const units = iBlocks->units;
+					iAllocator.deallocate(reinterpret_cast<unit*>(iBlocks), units);
+					iBlocks = previous;
+				}
+				iCursor = nullptr;
+				iLimit = nullptr;
+				iNextBlockSize = InitialBlockSize;
+				iBytesReserved = 0;
+				iTrivial = true;
+				std::fill(std::begin(iFree), std::end(iFree), nullptr);
+			}
+			std::size_t bytes_reserved() const
+			{
+				return iBytesReserved;
+			}
+		private:
+			static std::size_t size_class(std::size_t aSize)
+			{
+				std::size_t sizeClass = 0;
+				for (std::size_t classUnits = 1; classUnits * sizeof(unit) < aSize; classUnits <<= 1)
+					++sizeClass;
+				return sizeClass;
+			}
+			void new_block(std::size_t aUnits)
+			{
+				std::size_t const units = std::max(aUnits + HeaderUnits, iNextBlockSize / sizeof(unit));
+				if (iNextBlockSize < MaxBlockSize)
+					iNextBlockSize *= 2;
+				unit* const memory = iAllocator.allocate(units);
+				iBlocks = new (memory) block{ iBlocks, units };
+				iCursor = memory + HeaderUnits;
+				iLimit = memory + units;
+				iBytesReserved += units * sizeof(unit);
+			}
+		private:
+			block_allocator iAllocator;
+			block* iBlocks;
+			unit* iCursor;
+			unit* iLimit;
+			std::size_t iNextBlockSize;
+			std::size_t iBytesReserved;
+			bool iTrivial;
+			bool iDiscarding;
+			free_block* iFree[SizeClassCount];
+		};
+
+		// allocates from a document's arena or, for a value that is not part of a document, from Alloc
+		template <typename T, typename Arena>
+		class document_allocator
+		{
+			template <typename, typename>
+			friend class document_allocator;
+		public:
+			typedef T value_type;
+		private:
+			typedef typename std::allocator_traits<typename Arena::allocator_type>::template rebind_alloc<T> fallback_allocator;
+		public:
+			document_allocator(Arena* aArena = nullptr) :
+				iArena{ aArena }
+			{
+			}
+			template <typename U>
+			document_allocator(const document_allocator<U, Arena>& aOther) :
+				iArena{ aOther.iArena }
+			{
+			}
+		public:
+			T* allocate(std::size_t aCount)
+			{
+				if (iArena != nullptr)
+					return static_cast<T*>(iArena->allocate_recyclable(sizeof(T) * aCount));
+				return fallback_allocator{}.allocate(aCount);
+			}
+			void deallocate(T* aObject, std::size_t aCount)
+			{
+				if (iArena != nullptr)
+					iArena->recycle(aObject, sizeof(T) * aCount);
+				else
+					fallback_allocator{}.deallocate(aObject, aCount);
+			}
+		public:
+			template <typename U>
+			struct rebind
+			{
+				typedef document_allocator<U, Arena> other;
+			};
+			template <typename U>
+			bool operator==(const document_allocator<U, Arena>& aOther) const
+			{
+				return iArena == aOther.iArena;
+			}
+			template <typename U>
+			bool operator!=(const document_allocator<U, Arena>& aOther) const
+			{
+				return iArena != aOther.iArena;
+			}
+		private:
+			Arena* iArena;
+		};
+
+		template <typename T, typename Arena>
+		struct document_deleter
+		{
+			Arena* arena;
+			void operator()(T* aObject) const
+			{
+				document_allocator<T, Arena> allocator{ arena };
+				aObject->~T();
+				allocator.deallocate(aObject, 1);
+			}
+		};
+
+		template <typename T, typename Arena>
+		using document_unique_ptr = std::unique_ptr<T, document_deleter<T, Arena>>;
+
+		template <typename T, typename Arena, typename... Args>
+		inline document_unique_ptr<T, Arena> make_document_unique(Arena* aArena, Args&&... aArguments)
+		{
+			document_allocator<T, Arena> allocator{ aArena };
+			T* const memory = allocator.allocate(1);
+			try
+			{
+				return document_unique_ptr<T, Arena>{ new (memory) T(std::forward<Args>(aArguments)...), document_deleter<T, Arena>{ aArena } };
+			}
+			catch (...)
+			{
+				allocator.deallocate(memory, 1);
+				throw;
+			}
+		}
+
 		template <typename T>
 		class basic_json_node
 		{
-			template <json_syntax Syntax, typename Alloc , typename CharT, typename Traits, typename CharAlloc>
-			friend class basic_json_value;
+			template <json_syntax Syntax, typename Alloc, typename CharT, typename Traits, typename CharAlloc>
+			friend class neolib::basic_json_value;
 		private:
 			typedef basic_json_node<T> self_type;
 		public:
 			typedef T json_value;
 			typedef typename json_value::value_type value_type;
+			typedef typename json_value::arena_type arena_type;
 		private:
 			typedef typename json_value::value_allocator value_allocator;
 		public:
 			basic_json_node() : 
+				iArena{ nullptr },
 				iParent{ nullptr },
 				iPrevious{ nullptr }, 
 				iNext{ nullptr },
@@ -156,6 +410,7 @@ namespace neolib
 			{
 			}
 			basic_json_node(json_value& aParent) :
+				iArena{ aParent.iNode.iArena },
 				iParent{ &aParent },
 				iPrevious{ nullptr },
 				iNext{ nullptr },
@@ -165,8 +420,8 @@ namespace neolib
 			}
 			~basic_json_node()
 			{
-				while (iLastChild != nullptr)
-					destruct_child(iLastChild);
+				if (iArena == nullptr || !iArena->discarding())
+					clear();
 			}
 		public:
 			json_value* buy_child(json_value& aParent, const value_type& aValue)
@@ -177,7 +432,20 @@ namespace neolib
 			{
 				return construct_child(allocate_child(), aParent, std::move(aValue));
 			}
+			void clear()
+			{
+				while (iLastChild != nullptr)
+					destruct_child(iLastChild);
+			}
 		public:
+			arena_type* arena() const
+			{
+				return iArena;
+			}
+			void set_arena(arena_type& aArena)
+			{
+				iArena = &aArena;
+			}
 			bool has_parent() const
 			{
 				return iParent != nullptr;
@@ -238,16 +506,27 @@ namespace neolib
 		private:
 			json_value* allocate_child()
 			{
+				if (iArena != nullptr)
+					return static_cast<json_value*>(iArena->allocate(sizeof(json_value)));
 				return allocator().allocate(1);
 			}
 			void deallocate_child(json_value* aAddress)
 			{
-				allocator().deallocate(aAddress, 1);
+				if (iArena == nullptr)
+					allocator().deallocate(aAddress, 1);
 			}
 			template <typename... Args>
 			json_value* construct_child(json_value* aAddress, json_value& aParent, Args&&... aArguments)
 			{
-				allocator().construct(aAddress, aParent, std::forward<Args>(aArguments)...);
+				try
+				{
+					new (aAddress) json_value(aParent, std::forward<Args>(aArguments)...);
+				}
+				catch (...)
+				{
+					deallocate_child(aAddress);
+					throw;
+				}
 				json_value& child = *aAddress;
 				if (iLastChild == nullptr)
 				{
@@ -277,11 +556,13 @@ namespace neolib
 				deallocate_child(aAddress);
 			}
 		private:
+			// only for values that are not part of a document
 			static value_allocator& allocator()
 			{
 				static value_allocator sAllocator;
 				return sAllocator;
 			}
+			arena_type* iArena;
 			json_value* iParent;
 			json_value* iPrevious;
 			json_value* iNext;
@@ -303,9 +584,19 @@ namespace neolib
 		typedef T json_value;
 		typedef typename json_value::value_type value_type;
 		typedef typename json_value::json_string json_string;
+		typedef typename json_string::string_view_type key_type;
 	private:
-		typedef typename json_value::value_allocator allocator_type;
-		typedef std::unordered_multimap<json_string, json_value*, std::hash<json_string>, std::equal_to<json_string>, typename allocator_type:: template rebind<std::pair<const json_string, json_value*>>::other> dictionary_type;
+		typedef typename json_value::arena_type arena_type;
+		// keys view the members' names (which usually view the document text) so building the dictionary copies no strings
+		struct key_hash
+		{
+			std::size_t operator()(const key_type& aKey) const noexcept
+			{
+				return fast_hash<std::size_t>(aKey.data(), aKey.size() * sizeof(typename key_type::value_type));
+			}
+		};
+		typedef json_detail::document_allocator<std::pair<const key_type, json_value*>, arena_type> allocator_type;
+		typedef std::unordered_multimap<key_type, json_value*, key_hash, std::equal_to<key_type>, allocator_type> dictionary_type;
 	public:
 		basic_json_object() :
 			iOwner{ nullptr }
@@ -316,14 +607,24 @@ namespace neolib
 		{
 		}
 	public:
-		json_value& operator[](const json_string& aKey)
+		const json_value* find(const key_type& aKey) const
 		{
 			auto iter = cache().find(aKey);
 			if (iter != cache().end())
-				return *iter->second;
+				return iter->second;
+			return nullptr;
+		}
+		json_value* find(const key_type& aKey)
+		{
+			return const_cast<json_value*>(const_cast<const self_type*>(this)->find(aKey));
+		}
+		json_value& operator[](const json_string& aKey)
+		{
+			auto existing = find(key_type{ aKey.data(), aKey.size() });
+			if (existing != nullptr)
+				return *existing;
 			auto& newChild = owner().emplace_back(value_type{});
 			newChild.set_name(aKey.as_string());
-			cache().emplace(newChild.name(), &newChild);
 			return newChild;
 		}
 	private:
@@ -336,22 +637,52 @@ namespace neolib
 			iOwner = &aOwner;
 		}
 	private:
+		static key_type key(const json_value& aMember)
+		{
+			auto const& name = aMember.name();
+			return key_type{ name.data(), name.size() };
+		}
+		// built on first lookup unless json_object_index::Eager was requested when the document was parsed; a const
+		// lookup may therefore write to the document so concurrent readers need external synchronization
 		const dictionary_type& cache() const
 		{
 			if (iLazyDictionary != nullptr)
 				return *iLazyDictionary;
-			iLazyDictionary = std::make_unique<dictionary_type>(); // todo: use allocator_type
+			auto const arena = owner().iNode.arena();
+			iLazyDictionary = json_detail::make_document_unique<dictionary_type>(arena, allocator_type{ arena });
+			iLazyDictionary->reserve(owner().size());
 			for (auto i = owner().begin(); i != owner().end(); ++i)
-				iLazyDictionary->emplace(i.value().name(), &i.value());
+				iLazyDictionary->emplace(key(i.value()), &i.value());
 			return *iLazyDictionary;
 		}
 		dictionary_type& cache()
 		{
 			return const_cast<dictionary_type&>(const_cast<const self_type*>(this)->cache());
 		}
+		void member_added(json_value& aMember)
+		{
+			if (iLazyDictionary != nullptr)
+				iLazyDictionary->emplace(key(aMember), &aMember);
+		}
+		void member_removed(const json_value& aMember)
+		{
+			if (iLazyDictionary == nullptr)
+				return;
+			auto const members = iLazyDictionary->equal_range(key(aMember));
+			for (auto i = members.first; i != members.second; ++i)
+				if (i->second == &aMember)
+				{
+					iLazyDictionary->erase(i);
+					break;
+				}
+		}
+		void invalidate_cache()
+		{
+			iLazyDictionary = nullptr;
+		}
 	private:
 		json_value* iOwner;
-		mutable std::unique_ptr<dictionary_type> iLazyDictionary;
+		mutable json_detail::document_unique_ptr<dictionary_type, arena_type> iLazyDictionary;
 	};
 
 	template <typename T>
@@ -367,16 +698,20 @@ namespace neolib
 		typedef T json_value;
 		typedef typename json_value::value_type value_type;
 		typedef typename json_value::json_string json_string;
+	public:
+		// arrays with at least this many elements are indexed as they are parsed rather than on first access
+		static constexpr std::size_t ParseIndexThreshold = 64;
 	private:
-		typedef typename json_value::value_allocator allocator_type;
-		typedef std::vector<json_value*> array_type;
+		typedef typename json_value::arena_type arena_type;
+		typedef json_detail::document_allocator<json_value*, arena_type> allocator_type;
+		typedef std::vector<json_value*, allocator_type> array_type;
 	public:
 		basic_json_array() :
 			iOwner{ nullptr }
 		{
 		}
 		basic_json_array(json_value& aOwner) :
-			iOwner{ aOwner }
+			iOwner{ &aOwner }
 		{
 		}
 	public:
@@ -388,22 +723,57 @@ namespace neolib
 		{
 			iOwner = &aOwner;
 		}
+	public:
+		bool empty() const
+		{
+			return !owner().has_children();
+		}
+		std::size_t size() const
+		{
+			return cache().size();
+		}
+		const json_value& operator[](std::size_t aIndex) const
+		{
+			return *cache()[aIndex];
+		}
+		json_value& operator[](std::size_t aIndex)
+		{
+			return *cache()[aIndex];
+		}
 	private:
 		const array_type& cache() const
 		{
 			if (iLazyArray != nullptr)
 				return *iLazyArray;
-			iLazyArray = std::make_unique<array_type>(); // todo: use allocator_type
-			// todo: populate array using owner
+			auto const arena = owner().iNode.arena();
+			iLazyArray = json_detail::make_document_unique<array_type>(arena, allocator_type{ arena });
+			// counted first so the vector is not regrown through every size class
+			iLazyArray->reserve(owner().size());
+			for (auto i = owner().begin(); i != owner().end(); ++i)
+				iLazyArray->push_back(&i.value());
 			return *iLazyArray;
 		}
 		array_type& cache()
 		{
 			return const_cast<array_type&>(const_cast<const self_type*>(this)->cache());
 		}
+		void element_added(json_value& aElement)
+		{
+			if (iLazyArray != nullptr)
+				iLazyArray->push_back(&aElement);
+		}
+		void element_removed()
+		{
+			if (iLazyArray != nullptr)
+				iLazyArray->pop_back();
+		}
+		void invalidate_cache()
+		{
+			iLazyArray = nullptr;
+		}
 	private:
 		json_value* iOwner;
-		mutable std::unique_ptr<array_type> iLazyArray;
+		mutable json_detail::document_unique_ptr<array_type, arena_type> iLazyArray;
 	};
 
 	template <typename T>
@@ -429,12 +799,16 @@ namespace neolib
 	template <json_syntax Syntax = json_syntax::Standard, typename Alloc = std::allocator<json_type>, typename CharT = char, typename Traits = std::char_traits<CharT>, typename CharAlloc = std::allocator<CharT>>
 	class basic_json;
 		
-	template <json_syntax Syntax = json_syntax::Standard, typename Alloc = std::allocator<json_type>, typename CharT = char, typename Traits = std::char_traits<CharT>, typename CharAlloc = std::allocator<CharT>>
+	template <json_syntax Syntax, typename Alloc, typename CharT, typename Traits, typename CharAlloc>
 	class basic_json_value
 	{
 		friend class basic_json<Syntax, Alloc, CharT, Traits, CharAlloc>;
 		template <typename T>
 		friend class json_detail::basic_json_node;
+		template <typename T>
+		friend class basic_json_object;
+		template <typename T>
+		friend class basic_json_array;
 	public:
 		struct no_name : std::logic_error { no_name() : std::logic_error("neolib::basic_json_value::no_name") {} };
 	public:
@@ -449,6 +823,7 @@ namespace neolib
 		typedef self_type node_value_type;
 	public:
 		typedef typename allocator_type::template rebind<self_type>::other value_allocator;
+		typedef json_detail::document_arena<allocator_type> arena_type;
 	public:
 		typedef const self_type* const_pointer;
 		typedef self_type* pointer;
@@ -488,10 +863,12 @@ namespace neolib
 		basic_json_value(reference aParent, const value_type& aValue) :
 			iNode{ aParent }, iValue {	aValue }
 		{
+			check_trivial();
 		}
 		basic_json_value(reference aParent, value_type&& aValue) :
 			iNode{ aParent }, iValue{ std::move(aValue) }
 		{
+			check_trivial();
 		}
 	public:
 		basic_json_value(const basic_json_value&) = delete;
@@ -505,6 +882,8 @@ namespace neolib
 		template <typename T>
 		T& as()
 		{
+			if constexpr (std::is_same_v<T, json_string> || std::is_same_v<T, json_keyword>)
+				set_non_trivial();
 			return static_variant_cast<T&>(iValue);
 		}
 		const value_type& operator*() const
@@ -513,18 +892,21 @@ namespace neolib
 		}
 		value_type& operator*()
 		{
+			set_non_trivial();
 			return iValue;
 		}
 		reference operator=(const value_type& aValue)
 		{
 			iValue = aValue;
 			update_owner();
+			check_trivial();
 			return *this;
 		}
 		reference operator=(value_type&& aValue)
 		{
 			iValue = std::move(aValue);
 			update_owner();
+			check_trivial();
 			return *this;
 		}
 	public:
@@ -561,11 +943,17 @@ namespace neolib
 		}
 		void set_name(const json_string& aName)
 		{
+			renaming();
 			iName = aName;
+			renamed();
+			check_trivial();
 		}
 		void set_name(const json_keyword& aName)
 		{
+			renaming();
 			iName = aName;
+			renamed();
+			check_trivial();
 		}
 	public:
 		bool has_parent() const
@@ -666,6 +1054,7 @@ namespace neolib
 		template <typename Visitor>
 		void visit(Visitor&& aVisitor)
 		{
+			set_non_trivial();
 			std::visit([&aVisitor](auto&& arg)
 			{
 				if constexpr(!std::is_same_v<typename std::remove_cv<typename std::remove_reference<decltype(arg)>::type>::type, none_t>)
@@ -691,21 +1080,28 @@ namespace neolib
 		}
 		void clear()
 		{
-			iNode.~node_type();
-			new(&iNode) node_type();
+			invalidate_cache();
+			iNode.clear();
 		}
 		template <typename... Args>
 		reference emplace_back(Args&&... aArguments)
 		{
-			return *buy_child(std::forward<Args>(aArguments)...);
+			auto& child = *buy_child(std::forward<Args>(aArguments)...);
+			if (type() == json_type::Array)
+				std::get<json_array>(iValue).element_added(child);
+			return child;
 		}
 		template <typename T>
 		void push_back(T&& aValue)
 		{
-			buy_child(std::forward<T>(aValue));
+			emplace_back(std::forward<T>(aValue));
 		}
 		void pop_back()
 		{
+			if (type() == json_type::Array)
+				std::get<json_array>(iValue).element_removed();
+			else if (type() == json_type::Object && last_child()->has_name())
+				std::get<json_object>(iValue).member_removed(*last_child());
 			iNode.destruct_child(last_child());
 		}
 	private:
@@ -721,6 +1117,62 @@ namespace neolib
 			else if (type() == json_type::Array)
 				std::get<json_array>(iValue).set_owner(*this);
 		}
+		void invalidate_cache()
+		{
+			if (type() == json_type::Object)
+				std::get<json_object>(iValue).invalidate_cache();
+			else if (type() == json_type::Array)
+				std::get<json_array>(iValue).invalidate_cache();
+		}
+		// the parent's dictionary views this value's name so its entry is taken out before a rename and put back after
+		void renaming()
+		{
+			if (has_name() && has_parent() && parent().type() == json_type::Object)
+				std::get<json_object>(parent().iValue).member_removed(*this);
+		}
+		void renamed()
+		{
+			if (has_parent() && parent().type() == json_type::Object)
+				std::get<json_object>(parent().iValue).member_added(*this);
+		}
+		void set_arena(arena_type& aArena)
+		{
+			iNode.set_arena(aArena);
+			check_trivial();
+		}
+		void set_non_trivial()
+		{
+			if (iNode.arena() != nullptr)
+				iNode.arena()->set_non_trivial();
+		}
+		// strings copied into the value rather than viewing the document own memory outside the arena
+		void check_trivial()
+		{
+			if (iNode.arena() == nullptr || !iNode.arena()->trivial())
+				return;
+			bool const nameIsView = std::visit([](auto&& arg)
+			{
+				typedef std::decay_t<decltype(arg)> alternative_type;
+				if constexpr (std::is_same_v<alternative_type, json_string>)
+					return arg.is_view();
+				else if constexpr (std::is_same_v<alternative_type, json_keyword>)
+					return arg.text.is_view();
+				else
+					return true;
+			}, iName);
+			bool const valueIsView = std::visit([](auto&& arg)
+			{
+				typedef std::decay_t<decltype(arg)> alternative_type;
+				if constexpr (std::is_same_v<alternative_type, json_string>)
+					return arg.is_view();
+				else if constexpr (std::is_same_v<alternative_type, json_keyword>)
+					return arg.text.is_view();
+				else
+					return true;
+			}, iValue);
+			if (!nameIsView || !valueIsView)
+				set_non_trivial();
+		}
 	private:
 		node_type iNode;
 		name_t iName;
@@ -766,6 +1218,7 @@ namespace neolib
 		class iterator;
 	private:
 		typedef std::basic_string<CharT, Traits, CharAlloc> string_type;
+		typedef typename json_value::arena_type arena_type;
 		struct element
 		{
 			enum type_e
@@ -781,6 +1234,7 @@ namespace neolib
 			type_e auxType;
 			character_type* start;
 			character_type* auxStart;
+			bool unescaped;	// escapes have been rewritten in place so the text ends at the output position, not the input
 			typename json_value::name_t name;
 		};
 	public:
@@ -788,16 +1242,22 @@ namespace neolib
 		basic_json(const std::string& aPath, bool aValidateUtf = false);
 		template <typename Elem, typename ElemTraits>
 		basic_json(std::basic_istream<Elem, ElemTraits>& aInput, bool aValidateUtf = false);
+		~basic_json();
 	public:
 		void clear();
 		bool read(const std::string& aPath, bool aValidateUtf = false);
 		template <typename Elem, typename ElemTraits>
 		bool read(std::basic_istream<Elem, ElemTraits>& aInput, bool aValidateUtf = false);
+		bool map(const std::string& aPath, bool aValidateUtf = false);
 		bool write(const std::string& aPath, const string_type& aIndent = string_type(2, character_type{' '}));
 		template <typename Elem, typename ElemTraits>
 		bool write(std::basic_ostream<Elem, ElemTraits>& aOutput, const string_type& aIndent = string_type(2, character_type{' '}));
 	public:
 		json_encoding encoding() const;
+		json_parse_mode parse_mode() const;
+		void set_parse_mode(json_parse_mode aParseMode);
+		json_object_index object_index() const;
+		void set_object_index(json_object_index aObjectIndex);
 		const json_string& document() const;
 		const string_type& error_text() const;
 	public:
@@ -819,17 +1279,27 @@ namespace neolib
 	private:
 		template <typename Elem, typename ElemTraits>
 		bool do_read(std::basic_istream<Elem, ElemTraits>& aInput, bool aValidateUtf = false);
+		bool do_map(const std::string& aPath);
+		character_type* document_text();
 		bool do_parse();
+		bool do_parse_indexed();
+		void clear_tree();
+		void end_composite();
 		json_type context() const;
 		template <typename T>
 		json_value* buy_value(element& aCurrentElement, T&& aValue);
 		void create_parse_error(const character_type* aDocumentPos, const string_type& aExtraInfo = {});
 	private:
 		json_encoding iEncoding;
+		json_parse_mode iParseMode;
+		json_object_index iObjectIndex;
+		std::unique_ptr<json_detail::document_mapping> iDocumentMapping;
 		json_string iDocumentText;
 		string_type iErrorText;
+		mutable arena_type iArena;
 		mutable optional_json_value iRoot;
 		std::vector<json_value*> iCompositeValueStack;
+		std::vector<uint32_t> iStructuralIndex;
 		std::optional<char16_t> iUtf16HighSurrogate;
 	};
 
@@ -43,8 +43,23 @@
 #include <fstream>
 #include <iomanip>
 #include <type_traits>
+#include <cstring>
+#include <limits>
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NEOLIB_JSON_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#define NEOLIB_JSON_AVX2
+#include <immintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 #include <boost/lexical_cast.hpp>
 #include <boost/functional/hash.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
 #include <neolib/string_numeric.hpp>
 #include <neolib/string_utf.hpp>
 #include <neolib/type_traits.hpp>
@@ -364,7 +379,7 @@ namespace neolib
 			// state::Escaping
 			std::array<state, TOKEN_COUNT>
 			{{//TXXX  TOBJ  TCLO  TARR  TCLA  TCOL  TCOM  TQOT  TCHA  TESC  TESU  TECH  TPLU  TMIN  TDIG  THEX  TEHX  TDEC  TEXP  TAST  TFWD  TSYM  TSPA  TWSP  TZZZ
-				SXXX, SXXX, SXXX, SXXX, SXXX, SXXX, SXXX, SXXX, SXXX, SXXX, SEUN, SESD, SXXX, SXXX, SXXX, SXXX, SESD, SXXX, SXXX, SXXX, SXXX, SXXX, SXXX, SXXX, SXXX
+				SXXX, SXXX, SXXX, SXXX, SXXX, SXXX, SXXX, SESD, SXXX, SESD, SEUN, SESD, SXXX, SXXX, SXXX, SXXX, SESD, SXXX, SXXX, SXXX, SESD, SXXX, SXXX, SXXX, SXXX
 			}},
 			// state::Escaped
 			std::array<state, TOKEN_COUNT>
@@ -428,13 +443,13 @@ namespace neolib
 			if constexpr (Syntax == json_syntax::Standard)
 			{
 				auto stateIndex = static_cast<std::size_t>(aCurrentState);
-				auto token = sStandardTokenTable[static_cast<std::size_t>(aToken)];
+				auto token = sStandardTokenTable[static_cast<uint8_t>(aToken)];
 				return sStateTables[stateIndex][static_cast<std::size_t>(token)];
 			}
 			else
 			{
 				auto stateIndex = static_cast<std::size_t>(aCurrentState);
-				auto token = sRelaxedTokenTable[static_cast<std::size_t>(aToken)];
+				auto token = sRelaxedTokenTable[static_cast<uint8_t>(aToken)];
 				return sStateTables[stateIndex][static_cast<std::size_t>(token)];
 			}
 		}
@@ -447,6 +462,323 @@ namespace neolib
 				return std::hash<typename String::value_type>{}(aString[0]);
 			}
 		};
+
+		// a private (copy-on-write) mapping so the parser can unescape strings in place without touching the file
+		struct document_mapping
+		{
+			boost::interprocess::file_mapping file;
+			boost::interprocess::mapped_region region;
+			document_mapping(const std::string& aPath) :
+				file{ aPath.c_str(), boost::interprocess::read_only },
+				region{ file, boost::interprocess::copy_on_write }
+			{
+			}
+		};
+
+		/* Stage one of json_parse_mode::StructuralIndex: classify the document 64 bytes at a time into bitmasks and
+		   record the offset of every structural character ({}[],:) outside a string, every unescaped quote and the
+		   first character of every number or keyword. The extent of each string is found with a prefix XOR of the
+		   unescaped quote mask so nothing inside a string is indexed and the opening and closing quotes of a string
+		   are always adjacent entries in the index. */
+		namespace structural
+		{
+			constexpr std::size_t BlockSize = 64;
+
+			enum character_class : uint8_t
+			{
+				Quote		= 0x01,
+				Backslash	= 0x02,
+				Structural	= 0x04,
+				Whitespace	= 0x08,
+				Control		= 0x10
+			};
+
+			constexpr std::array<uint8_t, 256> make_character_classes()
+			{
+				std::array<uint8_t, 256> classes = {};
+				for (std::size_t ch = 0; ch < 0x20; ++ch)
+					classes[ch] = Control;
+				classes['"'] = Quote;
+				classes['\\'] = Backslash;
+				classes['{'] = Structural;
+				classes['}'] = Structural;
+				classes['['] = Structural;
+				classes[']'] = Structural;
+				classes[','] = Structural;
+				classes[':'] = Structural;
+				classes[' '] = Whitespace;
+				classes['\t'] = Whitespace | Control;
+				classes['\n'] = Whitespace | Control;
+				classes['\r'] = Whitespace | Control;
+				return classes;
+			}
+
+			constexpr std::array<uint8_t, 256> sCharacterClasses = make_character_classes();
+
+			struct block
+			{
+				uint64_t quote;
+				uint64_t backslash;
+				uint64_t structural;
+				uint64_t whitespace;
+				uint64_t control;
+			};
+
+			inline uint32_t trailing_zeros(uint64_t aMask)
+			{
+#if defined(_MSC_VER) && defined(_M_X64)
+				unsigned long index;
+				_BitScanForward64(&index, aMask);
+				return index;
+#elif defined(_MSC_VER)
+				unsigned long index;
+				if (_BitScanForward(&index, static_cast<uint32_t>(aMask)))
+					return index;
+				_BitScanForward(&index, static_cast<uint32_t>(aMask >> 32));
+				return index + 32;
+#elif defined(__GNUC__)
+				return __builtin_ctzll(aMask);
+#else
+				uint32_t index = 0;
+				for (; (aMask & 1u) == 0u; aMask >>= 1)
+					++index;
+				return index;
+#endif
+			}
+
+#if defined(NEOLIB_JSON_AVX2)
+			inline void classify(const uint8_t* aInput, block& aBlock)
+			{
+				__m256i const lowerCaseBit = _mm256_set1_epi8(0x20);
+				__m256i const openBrace = _mm256_set1_epi8('{');
+				__m256i const closeBrace = _mm256_set1_epi8('}');
+				__m256i const comma = _mm256_set1_epi8(',');
+				__m256i const colon = _mm256_set1_epi8(':');
+				__m256i const quote = _mm256_set1_epi8('"');
+				__m256i const backslash = _mm256_set1_epi8('\\');
+				__m256i const space = _mm256_set1_epi8(' ');
+				__m256i const tab = _mm256_set1_epi8('\t');
+				__m256i const lineFeed = _mm256_set1_epi8('\n');
+				__m256i const carriageReturn = _mm256_set1_epi8('\r');
+				__m256i const lastControl = _mm256_set1_epi8(0x1F);
+				aBlock = block{};
+				for (uint32_t lane = 0; lane < BlockSize; lane += 32)
+				{
+					__m256i const input = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(aInput + lane));
+					// '[' and ']' differ from '{' and '}' only in bit 5
+					__m256i const folded = _mm256_or_si256(input, lowerCaseBit);
+					__m256i const structural = _mm256_or_si256(
+						_mm256_or_si256(_mm256_cmpeq_epi8(folded, openBrace), _mm256_cmpeq_epi8(folded, closeBrace)),
+						_mm256_or_si256(_mm256_cmpeq_epi8(input, comma), _mm256_cmpeq_epi8(input, colon)));
+					__m256i const whitespace = _mm256_or_si256(
+						_mm256_or_si256(_mm256_cmpeq_epi8(input, space), _mm256_cmpeq_epi8(input, tab)),
+						_mm256_or_si256(_mm256_cmpeq_epi8(input, lineFeed), _mm256_cmpeq_epi8(input, carriageReturn)));
+					__m256i const control = _mm256_cmpeq_epi8(_mm256_max_epu8(input, lastControl), lastControl);
+					aBlock.quote |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(input, quote)))) << lane;
+					aBlock.backslash |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(input, backslash)))) << lane;
+					aBlock.structural |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(structural))) << lane;
+					aBlock.whitespace |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(whitespace))) << lane;
+					aBlock.control |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(control))) << lane;
+				}
+			}
+#elif defined(NEOLIB_JSON_SSE2)
+			inline void classify(const uint8_t* aInput, block& aBlock)
+			{
+				__m128i const lowerCaseBit = _mm_set1_epi8(0x20);
+				__m128i const openBrace = _mm_set1_epi8('{');
+				__m128i const closeBrace = _mm_set1_epi8('}');
+				__m128i const comma = _mm_set1_epi8(',');
+				__m128i const colon = _mm_set1_epi8(':');
+				__m128i const quote = _mm_set1_epi8('"');
+				__m128i const backslash = _mm_set1_epi8('\\');
+				__m128i const space = _mm_set1_epi8(' ');
+				__m128i const tab = _mm_set1_epi8('\t');
+				__m128i const lineFeed = _mm_set1_epi8('\n');
+				__m128i const carriageReturn = _mm_set1_epi8('\r');
+				__m128i const lastControl = _mm_set1_epi8(0x1F);
+				aBlock = block{};
+				for (uint32_t lane = 0; lane < BlockSize; lane += 16)
+				{
+					__m128i const input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aInput + lane));
+					// '[' and ']' differ from '{' and '}' only in bit 5
+					__m128i const folded = _mm_or_si128(input, lowerCaseBit);
+					__m128i const structural = _mm_or_si128(
+						_mm_or_si128(_mm_cmpeq_epi8(folded, openBrace), _mm_cmpeq_epi8(folded, closeBrace)),
+						_mm_or_si128(_mm_cmpeq_epi8(input, comma), _mm_cmpeq_epi8(input, colon)));
+					__m128i const whitespace = _mm_or_si128(
+						_mm_or_si128(_mm_cmpeq_epi8(input, space), _mm_cmpeq_epi8(input, tab)),
+						_mm_or_si128(_mm_cmpeq_epi8(input, lineFeed), _mm_cmpeq_epi8(input, carriageReturn)));
+					__m128i const control = _mm_cmpeq_epi8(_mm_max_epu8(input, lastControl), lastControl);
+					aBlock.quote |= static_cast<uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(input, quote))) << lane;
+					aBlock.backslash |= static_cast<uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(input, backslash))) << lane;
+					aBlock.structural |= static_cast<uint64_t>(_mm_movemask_epi8(structural)) << lane;
+					aBlock.whitespace |= static_cast<uint64_t>(_mm_movemask_epi8(whitespace)) << lane;
+					aBlock.control |= static_cast<uint64_t>(_mm_movemask_epi8(control)) << lane;
+				}
+			}
+#else
+			inline void classify(const uint8_t* aInput, block& aBlock)
+			{
+				aBlock = block{};
+				for (uint32_t i = 0; i < BlockSize; ++i)
+				{
+					uint64_t const bit = 1ull << i;
+					uint8_t const characterClass = sCharacterClasses[aInput[i]];
+					if (characterClass & Quote)
+						aBlock.quote |= bit;
+					if (characterClass & Backslash)
+						aBlock.backslash |= bit;
+					if (characterClass & Structural)
+						aBlock.structural |= bit;
+					if (characterClass & Whitespace)
+						aBlock.whitespace |= bit;
+					if (characterClass & Control)
+						aBlock.control |= bit;
+				}
+			}
+#endif
+
+			// bit i of the result is the XOR of bits 0..i of the argument
+			inline uint64_t prefix_xor(uint64_t aMask)
+			{
+				aMask ^= aMask << 1;
+				aMask ^= aMask << 2;
+				aMask ^= aMask << 4;
+				aMask ^= aMask << 8;
+				aMask ^= aMask << 16;
+				aMask ^= aMask << 32;
+				return aMask;
+			}
+
+			// Characters preceded by an odd length run of backslashes; the carry is whether the first character of the next block is escaped.
+			inline uint64_t escaped_characters(uint64_t aBackslash, uint64_t& aPreviousEscaped)
+			{
+				uint64_t const EvenBits = 0x5555555555555555ull;
+				aBackslash &= ~aPreviousEscaped;
+				uint64_t const followsEscape = (aBackslash << 1) | aPreviousEscaped;
+				uint64_t const oddSequenceStarts = aBackslash & ~EvenBits & ~followsEscape;
+				uint64_t const sequencesStartingOnEvenBits = oddSequenceStarts + aBackslash;
+				aPreviousEscaped = sequencesStartingOnEvenBits < oddSequenceStarts ? 1u : 0u;
+				uint64_t const invertMask = sequencesStartingOnEvenBits << 1;
+				return (EvenBits ^ invertMask) & followsEscape;
+			}
+
+			/* Builds the index for the first aLength characters of aDocument (offsets must fit in 32 bits). Returns
+			   false with aErrorOffset set if a string contains a control character or is not terminated. */
+			inline bool build_index(const char* aDocument, std::size_t aLength, std::vector<uint32_t>& aIndex, std::size_t& aErrorOffset)
+			{
+				if (aIndex.size() < aLength / 4 + BlockSize)
+					aIndex.resize(aLength / 4 + BlockSize);
+				std::size_t count = 0;
+				uint64_t previousEscaped = 0;
+				uint64_t previousInString = 0;
+				uint64_t previousScalar = 0;
+				uint8_t tail[BlockSize];
+				for (std::size_t offset = 0; offset < aLength; offset += BlockSize)
+				{
+					const uint8_t* input = reinterpret_cast<const uint8_t*>(aDocument) + offset;
+					if (aLength - offset < BlockSize)
+					{
+						std::memset(tail, ' ', BlockSize);
+						std::memcpy(tail, input, aLength - offset);
+						input = tail;
+					}
+					block characters;
+					classify(input, characters);
+					uint64_t const quotes = characters.quote & ~escaped_characters(characters.backslash, previousEscaped);
+					// includes the opening quote but not the closing quote
+					uint64_t const inString = prefix_xor(quotes) ^ previousInString;
+					previousInString = static_cast<uint64_t>(static_cast<int64_t>(inString) >> 63);
+					if ((characters.control & inString) != 0)
+					{
+						aErrorOffset = offset + trailing_zeros(characters.control & inString);
+						return false;
+					}
+					uint64_t const scalar = ~(characters.structural | characters.whitespace | quotes | inString);
+					uint64_t const scalarStart = scalar & ~((scalar << 1) | previousScalar);
+					previousScalar = scalar >> 63;
+					uint64_t structurals = (characters.structural & ~inString) | quotes | scalarStart;
+					if (count + BlockSize > aIndex.size())
+						aIndex.resize(aIndex.size() * 2);
+					uint32_t* output = aIndex.data() + count;
+					uint32_t const base = static_cast<uint32_t>(offset);
+					while (structurals != 0)
+					{
+						*output++ = base + trailing_zeros(structurals);
+						structurals &= structurals - 1;
+					}
+					count = output - aIndex.data();
+				}
+				aIndex.resize(count);
+				if (previousInString != 0)
+				{
+					aErrorOffset = aLength;
+					return false;
+				}
+				return true;
+			}
+
+			inline bool is_digit(char aCharacter)
+			{
+				return static_cast<unsigned char>(aCharacter - '0') < 10u;
+			}
+
+			inline bool is_whitespace(char aCharacter)
+			{
+				return (sCharacterClasses[static_cast<uint8_t>(aCharacter)] & Whitespace) != 0;
+			}
+
+			inline bool ends_number(char aCharacter)
+			{
+				return is_whitespace(aCharacter) || aCharacter == ',' || aCharacter == '}' || aCharacter == ']';
+			}
+
+			inline bool starts_keyword(char aCharacter)
+			{
+				switch (sStandardTokenTable[static_cast<uint8_t>(aCharacter)])
+				{
+				case token::Character:
+				case token::EscapingUnicode:
+				case token::Escaped:
+				case token::HexDigit:
+				case token::EscapedOrHexDigit:
+				case token::Exponent:
+					return true;
+				default:
+					return false;
+				}
+			}
+
+			inline bool continues_keyword(char aCharacter)
+			{
+				return starts_keyword(aCharacter) || is_digit(aCharacter);
+			}
+
+			inline bool ends_keyword(char aCharacter)
+			{
+				return ends_number(aCharacter) || aCharacter == ':';
+			}
+
+			inline bool parse_hex4(const char* aInput, char16_t& aResult)
+			{
+				aResult = 0;
+				for (std::size_t i = 0; i < 4; ++i)
+				{
+					char const ch = aInput[i];
+					uint32_t digit;
+					if (ch >= '0' && ch <= '9')
+						digit = ch - '0';
+					else if (ch >= 'a' && ch <= 'f')
+						digit = ch - 'a' + 10;
+					else if (ch >= 'A' && ch <= 'F')
+						digit = ch - 'A' + 10;
+					else
+						return false;
+					aResult = static_cast<char16_t>((aResult << 4) | digit);
+				}
+				return true;
+			}
+		}
 	}
 
 	namespace json_detail
@@ -878,12 +1210,12 @@ namespace neolib
 	};
 
 	template <json_syntax Syntax, typename Alloc, typename CharT, typename Traits, typename CharAlloc>
-	inline basic_json<Syntax, Alloc, CharT, Traits, CharAlloc>::basic_json() : iEncoding{ json_detail::default_encoding<CharT>::DEFAULT_ENCODING }
+	inline basic_json<Syntax, Alloc, CharT, Traits, CharAlloc>::basic_json() : iEncoding{ json_detail::default_encoding<CharT>::DEFAULT_ENCODING }, iParseMode{ json_parse_mode::Default }, iObjectIndex{ json_object_index::Default }
 	{
 	}
 
 	template <json_syntax Syntax, typename Alloc, typename CharT, typename Traits, typename CharAlloc>
-	inline basic_json<Syntax, Alloc, CharT, Traits, CharAlloc>::basic_json(const std::string& aPath, bool aValidateUtf) : iEncoding{ json_detail::default_encoding<CharT>::DEFAULT_ENCODING }
+	inline basic_json<Syntax, Alloc, CharT, Traits, CharAlloc>::basic_json(const std::string& aPath, bool aValidateUtf) : iEncoding{ json_detail::default_encoding<CharT>::DEFAULT_ENCODING }, iParseMode{ json_parse_mode::Default }, iObjectIndex{ json_object_index::Default }
 	{
 		if (!read(aPath, aValidateUtf))
 			throw json_error(error_text());
@@ -891,16 +1223,25 @@ namespace neolib
 
 	template <json_syntax Syntax, typename Alloc, typename CharT, typename Traits, typename CharAlloc>
 	template <typename Elem, typename ElemTraits>
-	inline basic_json<Syntax, Alloc, CharT, Traits, CharAlloc>::basic_json(std::basic_istream<Elem, ElemTraits>& aInput, bool aValidateUtf) : iEncoding{ json_detail::default_encoding<CharT>::DEFAULT_ENCODING }
+	inline basic_json<Syntax, Alloc, CharT, Traits, CharAlloc>::basic_json(std::basic_istream<Elem, ElemTraits>& aInput, bool aValidateUtf) : iEncoding{ json_detail::default_encoding<CharT>::DEFAULT_ENCODING }, iParseMode{ json_parse_mode::Default }, iObjectIndex{ json_object_index::Default }
 	{
 		if (!read(aInput, aValidateUtf))
 			throw json_error(error_text());
 	}
 
+	template <json_syntax Syntax, typename Alloc, typename CharT, typename Traits, typename CharAlloc>
+	inline basic_json<Syntax, Alloc, CharT, Traits, CharAlloc>::~basic_json()
+	{
+		clear_tree();
+	}
+
 	template <json_syntax Syntax, typename Alloc, typename CharT, typename Traits, typename CharAlloc>
 	inline void basic_json<Syntax, Alloc, CharT, Traits, CharAlloc>::clear()
 	{
-		document().clear();
+		clear_tree();
+		// assigned rather than cleared so that a view over a mapped file is not first copied
+		document() = json_string{};
+		iDocumentMapping.reset();
 		iUtf16HighSurrogate = std::nullopt;
 	}
 		
@@ -938,6 +1279,30 @@ namespace neolib
 		return ok;
 	}
 
+	template <json_syntax Syntax, typename Alloc, typename CharT, typename Traits, typename CharAlloc>
+	inline bool basic_json<Syntax, Alloc, CharT, Traits, CharAlloc>::map(const std::string& aPath, bool aValidateUtf)
+	{
+		if constexpr (sizeof(character_type) != 1)
+			return read(aPath, aValidateUtf);
+		else
+		{
+			// a file that cannot be mapped, or leaves no room after its last byte for the terminator, is read instead
+			if (!do_map(aPath))
+				return read(aPath, aValidateUtf);
+			bool ok = true;
+			if (aValidateUtf && !neolib::check_utf8(document().as_view()))
+			{
+				iErrorText = "invalid utf-8";
+				ok = false;
+			}
+			if (ok)
+				ok = do_parse();
+			if (!ok)
+				iErrorText = "failed to parse JSON file '" + aPath + "', " + iErrorText;
+			return ok;
+		}
+	}
+
 	template <json_syntax Syntax, typename Alloc, typename CharT, typename Traits, typename CharAlloc>
 	template <typename Elem, typename ElemTraits>
 	inline bool basic_json<Syntax, Alloc, CharT, Traits, CharAlloc>::do_read(std::basic_istream<Elem, ElemTraits>& aInput, bool aValidateUtf)
@@ -998,14 +1363,55 @@ namespace neolib
 		return true;
 	}
 
+	template <json_syntax Syntax, typename Alloc, typename CharT, typename Traits, typename CharAlloc>
+	inline bool basic_json<Syntax, Alloc, CharT, Traits, CharAlloc>::do_map(const std::string& aPath)
+	{
+		clear();
+
+		std::unique_ptr<json_detail::document_mapping> mapping;
+		try
+		{
+			mapping = std::make_unique<json_detail::document_mapping>(aPath);
+		}
+		catch (const boost::interprocess::interprocess_exception&)
+		{
+			return false;
+		}
+
+		auto const text = static_cast<character_type*>(mapping->region.get_address());
+		std::size_t size = mapping->region.get_size();
+		if (size == 0)
+			return false;
+
+		// the terminating newline and null go in the zero filled remainder of the last page; writing there only touches the private copy
+		bool const needNewline = json_detail::next_state<syntax>(json_detail::state::Value, text[size - 1]) != json_detail::state::Ignore;
+		std::size_t const pageSize = boost::interprocess::mapped_region::get_page_size();
+		std::size_t const slack = (pageSize - size % pageSize) % pageSize;
+		if (slack < (needNewline ? 2u : 1u))
+			return false;
+		if (needNewline)
+			text[size++] = character_type{ '\n' };
+		text[size++] = character_type{ '\0' };
+
+		document() = json_string{ text, text + size };
+		iDocumentMapping = std::move(mapping);
+		return true;
+	}
+
 	template <json_syntax Syntax, typename Alloc, typename CharT, typename Traits, typename CharAlloc>
 	inline bool basic_json<Syntax, Alloc, CharT, Traits, CharAlloc>::do_parse()
 	{
+		if constexpr (syntax == json_syntax::Standard && sizeof(character_type) == 1)
+		{
+			if (iParseMode == json_parse_mode::StructuralIndex && document().size() <= std::numeric_limits<uint32_t>::max())
+				return do_parse_indexed();
+		}
+
 		json_detail::state currentState = json_detail::state::Value;
 		json_detail::state nextState;
 		element currentElement = {};
 
-		auto nextInputCh = &*document().begin();
+		auto nextInputCh = document_text();
 		auto nextOutputCh = nextInputCh;
 
 		// Main parse loop
@@ -1029,7 +1435,7 @@ namespace neolib
 					create_parse_error(nextInputCh);
 					return false;
 				case json_detail::state::EndOfParse:
-					if (nextInputCh != &iDocumentText.back())
+					if (nextInputCh != document_text() + document().size() - 1)
 					{
 						create_parse_error(nextInputCh);
 						return false;
@@ -1043,7 +1449,7 @@ namespace neolib
 						case json_detail::state::String:
 						case json_detail::state::Keyword:
 						case json_detail::state::Name:
-							if (currentElement.start != nextOutputCh)
+							if (currentElement.unescaped)
 								*nextOutputCh++ = *nextInputCh;
 							// fall through
 						default:
@@ -1070,20 +1476,20 @@ namespace neolib
 						break;
 					case element::String:
 						{
-							json_string newString{ currentElement.start, currentElement.start == nextOutputCh ? nextInputCh - 1 : nextOutputCh };
+							json_string newString{ currentElement.start, currentElement.unescaped ? nextOutputCh : nextInputCh - 1 };
 							buy_value(currentElement, newString);
 						}
 						break;
 					case element::Name:
 						if (context() == json_type::Object && currentElement.name == none)
 						{
-							json_string newString{ currentElement.start, currentElement.start == nextOutputCh ? nextInputCh - 1 : nextOutputCh };
+							json_string newString{ currentElement.start, currentElement.unescaped ? nextOutputCh : nextInputCh - 1 };
 							currentElement.name = newString;
 						}
 						break;
 					case element::Number:
 						{
-							json_string newNumber{ currentElement.start, currentElement.start == nextOutputCh ? nextInputCh : nextOutputCh };
+							json_string newNumber{ currentElement.start, currentElement.unescaped ? nextOutputCh : nextInputCh };
 							if (currentState == json_detail::state::NumberInt)
 							{
 								std::visit([this, &currentElement](auto&& arg)
@@ -1103,7 +1509,7 @@ namespace neolib
 								{ "false", json_detail::keyword::False },
 								{ "null",  json_detail::keyword::Null },
 							};
-							auto keywordText = json_string{ currentElement.start, currentElement.start == nextOutputCh ? nextInputCh : nextOutputCh };
+							auto keywordText = json_string{ currentElement.start, currentElement.unescaped ? nextOutputCh : nextInputCh };
 							auto keyword = sJsonKeywords.find(keywordText);
 							if (keyword != sJsonKeywords.end())
 							{
@@ -1142,9 +1548,18 @@ namespace neolib
 							}
 						}
 						break;
+					default:
+						break;
 					}
 					if (nextState == json_detail::state::Close)
-						iCompositeValueStack.pop_back();
+					{
+						if (iCompositeValueStack.empty() || (*nextInputCh == '}') != (context() == json_type::Object))
+						{
+							create_parse_error(nextInputCh);
+							return false;
+						}
+						end_composite();
+					}
 					switch (context())
 					{
 					case json_type::Object:
@@ -1199,14 +1614,17 @@ namespace neolib
 					}
 					currentElement.type = element::Unknown;
 					currentElement.start = nullptr;
+					currentElement.unescaped = false;
 					break;
 				case json_detail::state::String:
 					currentElement.type = element::String;
 					currentElement.start = (nextOutputCh = nextInputCh + 1);
+					currentElement.unescaped = false;
 					break;
 				case json_detail::state::Name:
 					currentElement.type = element::Name;
 					currentElement.start = (nextOutputCh = nextInputCh + 1);
+					currentElement.unescaped = false;
 					break;
 				case json_detail::state::EndName:
 					if (currentElement.name == none)
@@ -1214,7 +1632,7 @@ namespace neolib
 						json_string newName
 						{
 							currentElement.start,
-							currentElement.start == nextOutputCh ? nextInputCh : nextOutputCh
+							currentElement.unescaped ? nextOutputCh : nextInputCh
 						};
 						currentElement.name = newName;
 					}
@@ -1222,12 +1640,14 @@ namespace neolib
 				case json_detail::state::NumberIntNeedDigit:
 					currentElement.type = element::Number;
 					currentElement.start = nextInputCh;
+					currentElement.unescaped = false;
 					break;
 				case json_detail::state::NumberInt:
 					if (currentElement.type != element::Number)
 					{
 						currentElement.type = element::Number;
 						currentElement.start = nextInputCh;
+						currentElement.unescaped = false;
 					}
 					break;
 				case json_detail::state::Array:
@@ -1252,6 +1672,7 @@ namespace neolib
 				case json_detail::state::Keyword:
 					currentElement.type = element::Keyword;
 					currentElement.start = (nextOutputCh = nextInputCh);
+					currentElement.unescaped = false;
 					break;
 				case json_detail::state::StringEnd:
 					if constexpr (syntax == json_syntax::Relaxed)
@@ -1267,8 +1688,12 @@ namespace neolib
 					}
 					break;
 				case json_detail::state::Escaped:
-					if (nextOutputCh == currentElement.start)
+					if (!currentElement.unescaped)
+					{
+						// from the first escape on the text is rewritten in place, starting over its backslash
+						currentElement.unescaped = true;
 						nextOutputCh = (currentState != json_detail::state::EscapingUnicode ? nextInputCh - 1 : nextInputCh - 2);
+					}
 					if (currentState == json_detail::state::Escaping)
 					{
 						switch (*(nextInputCh))
@@ -1298,7 +1723,7 @@ namespace neolib
 							(*nextOutputCh++) = '\t';
 							break;
 						}
-						nextState = json_detail::state::String;
+						nextState = (currentElement.type == element::Name ? json_detail::state::Name : json_detail::state::String);
 #ifdef DEBUG_JSON
 						changedState = true;
 #endif
@@ -1319,8 +1744,7 @@ namespace neolib
 							{
 								iUtf16HighSurrogate = u16ch;
 								currentElement.auxType = element::Unknown;
-								currentElement.type = element::String;
-								nextState = json_detail::state::String;
+								nextState = (currentElement.type == element::Name ? json_detail::state::Name : json_detail::state::String);
 								break;
 							}
 							else if (utf16::is_low_surrogate(u16ch) && iUtf16HighSurrogate != std::nullopt)
@@ -1370,7 +1794,7 @@ namespace neolib
 								}
 							}
 							currentElement.auxType = element::Unknown;
-							nextState = json_detail::state::String;
+							nextState = (currentElement.type == element::Name ? json_detail::state::Name : json_detail::state::String);
 						}
 						else
 						{
@@ -1381,6 +1805,8 @@ namespace neolib
 #endif
 					}
 					break;
+				default:
+					break;
 				}
 #ifdef DEBUG_JSON
 				if (changedState)
@@ -1399,6 +1825,358 @@ namespace neolib
 		return true;
 	}
 
+	template <json_syntax Syntax, typename Alloc, typename CharT, typename Traits, typename CharAlloc>
+	inline bool basic_json<Syntax, Alloc, CharT, Traits, CharAlloc>::do_parse_indexed()
+	{
+		using namespace json_detail::structural;
+
+		character_type* const documentStart = document_text();
+		std::size_t const documentLength = document().size() - 1; // excluding the terminating null
+		character_type* const documentEnd = documentStart + documentLength;
+
+		std::size_t errorOffset = 0;
+		if (!build_index(documentStart, documentLength, iStructuralIndex, errorOffset))
+		{
+			create_parse_error(documentStart + errorOffset);
+			return false;
+		}
+
+		iCompositeValueStack.clear();
+		element currentElement = {};
+		auto next = iStructuralIndex.cbegin();
+		auto const end = iStructuralIndex.cend();
+		character_type* pos = documentStart;
+		character_type* errorPos = documentStart;
+		auto fail = [this](const character_type* aPos, const string_type& aExtraInfo = {})
+		{
+			create_parse_error(aPos, aExtraInfo);
+			return false;
+		};
+
+		// Strings are unescaped in place, as the scalar parser does.
+		auto take_string = [&](character_type* aOpeningQuote, character_type* aClosingQuote) -> std::optional<json_string>
+		{
+			character_type* const start = aOpeningQuote + 1;
+			auto input = static_cast<character_type*>(std::memchr(start, '\\', aClosingQuote - start));
+			if (input == nullptr)
+				return json_string{ start, aClosingQuote };
+			auto output = input;
+			while (input != aClosingQuote)
+			{
+				if (*input != '\\')
+				{
+					*output++ = *input++;
+					continue;
+				}
+				switch (input[1])
+				{
+				case '\"':
+				case '\\':
+				case '/':
+					*output++ = input[1];
+					break;
+				case 'b':
+					*output++ = '\b';
+					break;
+				case 'f':
+					*output++ = '\f';
+					break;
+				case 'n':
+					*output++ = '\n';
+					break;
+				case 'r':
+					*output++ = '\r';
+					break;
+				case 't':
+					*output++ = '\t';
+					break;
+				case 'u':
+					{
+						char16_t u16ch;
+						if (!parse_hex4(input + 2, u16ch))
+						{
+							errorPos = input + 1;
+							return {};
+						}
+						input += 6;
+						if (utf16::is_high_surrogate(u16ch))
+						{
+							// an unpaired high surrogate is dropped, as the scalar parser does
+							char16_t low;
+							if (aClosingQuote - input >= 6 && input[0] == '\\' && input[1] == 'u' && parse_hex4(input + 2, low) && utf16::is_low_surrogate(low))
+							{
+								char16_t surrogatePair[] = { u16ch, low };
+								auto utf8 = utf16_to_utf8(std::u16string(&surrogatePair[0], 2));
+								output = std::copy(utf8.begin(), utf8.end(), output);
+								input += 6;
+							}
+						}
+						else if (utf16::is_low_surrogate(u16ch))
+						{
+							auto utf8 = utf16_to_utf8(std::u16string(1, u16ch));
+							output = std::copy(utf8.begin(), utf8.end(), output);
+						}
+						else if (u16ch < 0x80)
+							*output++ = static_cast<character_type>(u16ch);
+						else if (u16ch < 0x800)
+						{
+							*output++ = static_cast<character_type>(0xC0 | (u16ch >> 6));
+							*output++ = static_cast<character_type>(0x80 | (u16ch & 0x3F));
+						}
+						else
+						{
+							*output++ = static_cast<character_type>(0xE0 | (u16ch >> 12));
+							*output++ = static_cast<character_type>(0x80 | ((u16ch >> 6) & 0x3F));
+							*output++ = static_cast<character_type>(0x80 | (u16ch & 0x3F));
+						}
+					}
+					continue;
+				default:
+					errorPos = input + 1;
+					return {};
+				}
+				input += 2;
+			}
+			return json_string{ start, output };
+		};
+
+		auto take_number = [&](character_type* aStart) -> bool
+		{
+			auto input = aStart;
+			bool const negative = (*input == '-');
+			if (negative)
+				++input;
+			auto const digitsStart = input;
+			uint64_t mantissa = 0;
+			for (; is_digit(*input); ++input)
+				mantissa = mantissa * 10u + static_cast<uint64_t>(*input - '0');
+			std::size_t const digits = input - digitsStart;
+			bool integral = true;
+			if (digits == 0)
+			{
+				errorPos = input;
+				return false;
+			}
+			if (*input == '.')
+			{
+				integral = false;
+				if (!is_digit(*++input))
+				{
+					errorPos = input;
+					return false;
+				}
+				while (is_digit(*input))
+					++input;
+			}
+			if (*input == 'e' || *input == 'E')
+			{
+				integral = false;
+				if (*++input == '+' || *input == '-')
+					++input;
+				if (!is_digit(*input))
+				{
+					errorPos = input;
+					return false;
+				}
+				while (is_digit(*input))
+					++input;
+			}
+			if (!ends_number(*input))
+			{
+				errorPos = input;
+				return false;
+			}
+			std::basic_string_view<character_type, character_traits_type> const text{ aStart, static_cast<std::size_t>(input - aStart) };
+			if (!integral)
+				buy_value(currentElement, neolib::string_to_double(text));
+			// up to 19 digits cannot overflow the mantissa; the types chosen are those string_to_number would choose
+			else if (digits <= 19 && !negative && mantissa <= static_cast<uint64_t>(std::numeric_limits<json_int>::max()))
+				buy_value(currentElement, static_cast<json_int>(mantissa));
+			else if (digits <= 19 && !negative && mantissa <= std::numeric_limits<json_uint>::max())
+				buy_value(currentElement, static_cast<json_uint>(mantissa));
+			else if (digits <= 19 && !negative && mantissa <= static_cast<uint64_t>(std::numeric_limits<json_int64>::max()))
+				buy_value(currentElement, static_cast<json_int64>(mantissa));
+			else if (digits <= 19 && !negative)
+				buy_value(currentElement, static_cast<json_uint64>(mantissa));
+			else if (digits <= 19 && mantissa <= static_cast<uint64_t>(std::numeric_limits<json_int>::max()) + 1u)
+				buy_value(currentElement, static_cast<json_int>(static_cast<json_int64>(~mantissa + 1u)));
+			else if (digits <= 19 && mantissa <= static_cast<uint64_t>(std::numeric_limits<json_int64>::max()) + 1u)
+				buy_value(currentElement, static_cast<json_int64>(~mantissa + 1u));
+			else
+			{
+				std::visit([this, &currentElement](auto&& arg)
+				{
+					buy_value(currentElement, std::forward<decltype(arg)>(arg));
+				}, string_to_number(text));
+			}
+			return true;
+		};
+
+		auto take_keyword = [&](character_type* aStart) -> character_type*
+		{
+			auto input = aStart;
+			if (!starts_keyword(*input))
+			{
+				errorPos = input;
+				return nullptr;
+			}
+			while (continues_keyword(*++input))
+				;
+			if (!ends_keyword(*input))
+			{
+				errorPos = input;
+				return nullptr;
+			}
+			return input;
+		};
+
+		auto is_keyword = [](const character_type* aStart, const character_type* aEnd, const char* aKeyword)
+		{
+			std::size_t const length = std::strlen(aKeyword);
+			return static_cast<std::size_t>(aEnd - aStart) == length && std::memcmp(aStart, aKeyword, length) == 0;
+		};
+
+		enum class expect
+		{
+			Value,
+			Name,
+			Separator
+		} expecting = expect::Value;
+
+		try
+		{
+			// a document that is all whitespace has no root, as with the scalar parser
+			if (next == end)
+				return true;
+			for (;;)
+			{
+				switch (expecting)
+				{
+				case expect::Value:
+					if (next == end)
+						return fail(documentEnd);
+					pos = documentStart + *next++;
+					switch (*pos)
+					{
+					case '{':
+						iCompositeValueStack.push_back(buy_value(currentElement, json_object{}));
+						if (next != end && documentStart[*next] == '}')
+						{
+							++next;
+							iCompositeValueStack.pop_back();
+							expecting = expect::Separator;
+						}
+						else
+							expecting = expect::Name;
+						break;
+					case '[':
+						iCompositeValueStack.push_back(buy_value(currentElement, json_array{}));
+						if (next != end && documentStart[*next] == ']')
+						{
+							++next;
+							iCompositeValueStack.pop_back();
+							expecting = expect::Separator;
+						}
+						break;
+					case '\"':
+						{
+							auto newString = take_string(pos, documentStart + *next++);
+							if (newString == std::nullopt)
+								return fail(errorPos);
+							buy_value(currentElement, *newString);
+							expecting = expect::Separator;
+						}
+						break;
+					case '-':
+					case '0': case '1': case '2': case '3': case '4':
+					case '5': case '6': case '7': case '8': case '9':
+						if (!take_number(pos))
+							return fail(errorPos);
+						expecting = expect::Separator;
+						break;
+					default:
+						{
+							auto keywordEnd = take_keyword(pos);
+							if (keywordEnd == nullptr)
+								return fail(errorPos);
+							if (is_keyword(pos, keywordEnd, "true"))
+								buy_value(currentElement, json_bool{ true });
+							else if (is_keyword(pos, keywordEnd, "false"))
+								buy_value(currentElement, json_bool{ false });
+							else if (is_keyword(pos, keywordEnd, "null"))
+								buy_value(currentElement, json_null{});
+							else
+								buy_value(currentElement, json_keyword{ json_string{ pos, keywordEnd } });
+							expecting = expect::Separator;
+						}
+						break;
+					}
+					break;
+				case expect::Name:
+					if (next == end)
+						return fail(documentEnd);
+					pos = documentStart + *next++;
+					if (*pos == '\"')
+					{
+						auto newName = take_string(pos, documentStart + *next++);
+						if (newName == std::nullopt)
+							return fail(errorPos);
+						currentElement.name = *newName;
+					}
+					else
+					{
+						auto keywordEnd = take_keyword(pos);
+						if (keywordEnd == nullptr)
+							return fail(errorPos);
+						if (is_keyword(pos, keywordEnd, "true") || is_keyword(pos, keywordEnd, "false") || is_keyword(pos, keywordEnd, "null"))
+							return fail(keywordEnd, "bad object field name");
+						currentElement.name = json_keyword{ json_string{ pos, keywordEnd } };
+					}
+					if (next == end)
+						return fail(documentEnd);
+					if (documentStart[*next] != ':')
+						return fail(documentStart + *next);
+					++next;
+					expecting = expect::Value;
+					break;
+				case expect::Separator:
+					if (iCompositeValueStack.empty())
+					{
+						if (next != end)
+							return fail(documentStart + *next);
+						return true;
+					}
+					if (next == end)
+						return fail(documentEnd);
+					pos = documentStart + *next++;
+					switch (*pos)
+					{
+					case ',':
+						expecting = (context() == json_type::Object ? expect::Name : expect::Value);
+						break;
+					case '}':
+						if (context() != json_type::Object)
+							return fail(pos);
+						end_composite();
+						break;
+					case ']':
+						if (context() != json_type::Array)
+							return fail(pos);
+						end_composite();
+						break;
+					default:
+						return fail(pos);
+					}
+					break;
+				}
+			}
+		}
+		catch (std::exception& e)
+		{
+			return fail(pos, e.what());
+		}
+	}
+
 	template <json_syntax Syntax, typename Alloc, typename CharT, typename Traits, typename CharAlloc>
 	inline bool basic_json<Syntax, Alloc, CharT, Traits, CharAlloc>::write(const std::string& aPath, const string_type& aIndent)
 	{
@@ -1513,6 +2291,8 @@ namespace neolib
 			case json_type::Keyword:
 				aOutput << static_variant_cast<json_keyword>(*i).text;
 				break;
+			default:
+				break;
 			}
 			
 			if (!i.value().is_composite() || i.value().is_empty_composite())
@@ -1559,6 +2339,30 @@ namespace neolib
 		return iEncoding;
 	}
 
+	template <json_syntax Syntax, typename Alloc, typename CharT, typename Traits, typename CharAlloc>
+	inline json_parse_mode basic_json<Syntax, Alloc, CharT, Traits, CharAlloc>::parse_mode() const
+	{
+		return iParseMode;
+	}
+
+	template <json_syntax Syntax, typename Alloc, typename CharT, typename Traits, typename CharAlloc>
+	inline void basic_json<Syntax, Alloc, CharT, Traits, CharAlloc>::set_parse_mode(json_parse_mode aParseMode)
+	{
+		iParseMode = aParseMode;
+	}
+
+	template <json_syntax Syntax, typename Alloc, typename CharT, typename Traits, typename CharAlloc>
+	inline json_object_index basic_json<Syntax, Alloc, CharT, Traits, CharAlloc>::object_index() const
+	{
+		return iObjectIndex;
+	}
+
+	template <json_syntax Syntax, typename Alloc, typename CharT, typename Traits, typename CharAlloc>
+	inline void basic_json<Syntax, Alloc, CharT, Traits, CharAlloc>::set_object_index(json_object_index aObjectIndex)
+	{
+		iObjectIndex = aObjectIndex;
+	}
+
 	template <json_syntax Syntax, typename Alloc, typename CharT, typename Traits, typename CharAlloc>
 	inline const typename basic_json<Syntax, Alloc, CharT, Traits, CharAlloc>::json_string& basic_json<Syntax, Alloc, CharT, Traits, CharAlloc>::document() const
 	{
@@ -1581,7 +2385,10 @@ namespace neolib
 	inline const typename basic_json<Syntax, Alloc, CharT, Traits, CharAlloc>::json_value& basic_json<Syntax, Alloc, CharT, Traits, CharAlloc>::root() const
 	{
 		if (iRoot == std::nullopt)
+		{
 			iRoot.emplace();
+			iRoot->set_arena(iArena);
+		}
 		return *iRoot;
 	}
 
@@ -1653,6 +2460,40 @@ namespace neolib
 		return iDocumentText;
 	}
 
+	template <json_syntax Syntax, typename Alloc, typename CharT, typename Traits, typename CharAlloc>
+	inline typename basic_json<Syntax, Alloc, CharT, Traits, CharAlloc>::character_type* basic_json<Syntax, Alloc, CharT, Traits, CharAlloc>::document_text()
+	{
+		// the view of a mapped document is writable (copy-on-write); going through as_view() avoids quick_string copying it
+		return const_cast<character_type*>(document().as_view().data());
+	}
+
+	template <json_syntax Syntax, typename Alloc, typename CharT, typename Traits, typename CharAlloc>
+	inline void basic_json<Syntax, Alloc, CharT, Traits, CharAlloc>::clear_tree()
+	{
+		iCompositeValueStack.clear();
+		// every node is in the arena; unless something in the tree owns memory of its own no destructors need run
+		iArena.release([this]() { iRoot = std::nullopt; });
+	}
+
+	template <json_syntax Syntax, typename Alloc, typename CharT, typename Traits, typename CharAlloc>
+	inline void basic_json<Syntax, Alloc, CharT, Traits, CharAlloc>::end_composite()
+	{
+		json_value& composite = *iCompositeValueStack.back();
+		iCompositeValueStack.pop_back();
+		// the children have just been written so walking them again now is cheap compared to a cold first access
+		if (composite.type() == json_type::Array)
+		{
+			auto& array = composite.template as<json_array>();
+			std::size_t elements = 0;
+			for (auto child = composite.first_child(); child != nullptr && elements < json_array::ParseIndexThreshold; child = child->next_sibling())
+				++elements;
+			if (elements == json_array::ParseIndexThreshold)
+				array.cache();
+		}
+		else if (iObjectIndex == json_object_index::Eager)
+			composite.template as<json_object>().cache();
+	}
+
 	template <json_syntax Syntax, typename Alloc, typename CharT, typename Traits, typename CharAlloc>
 	inline json_type basic_json<Syntax, Alloc, CharT, Traits, CharAlloc>::context() const
 	{
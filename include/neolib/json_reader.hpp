@@ -0,0 +1,774 @@
+// json_reader.hpp
+/*
+ *  NoFussJSON v1.0
+ *
+ *  Copyright (c) 2018 Leigh Johnston.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *     * Neither the name of Leigh Johnston nor the names of any
+ *       other contributors to this software may be used to endorse or
+ *       promote products derived from this software without specific prior
+ *       written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ *  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include "neolib.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <array>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <istream>
+#include <optional>
+#include <stdexcept>
+#include <neolib/variant.hpp>
+#include <neolib/json.hpp>
+
+namespace neolib
+{
+	enum class json_event
+	{
+		NeedInput,		// the current chunk has been consumed; feed() another or call end_input()
+		StartObject,
+		EndObject,
+		StartArray,
+		EndArray,
+		Value,
+		EndRecord,		// a top level value is complete (one line of a JSON Lines stream)
+		EndOfInput,
+		Error
+	};
+
+	enum class json_stream_format
+	{
+		Document,		// exactly one top level value
+		Lines			// any number of top level values separated by whitespace (JSON Lines)
+	};
+
+	/* Incremental pull parser driven by the same state machine as basic_json's scalar parser. Input is consumed
+	   either from a std::istream through a fixed size buffer or from chunks supplied with feed(); nothing is
+	   retained other than the text of the token being parsed, the current member name and one json_type per
+	   level of nesting so memory use does not depend on the size of the input. UTF-8 only. */
+	template <json_syntax Syntax = json_syntax::Standard>
+	class basic_json_reader
+	{
+	public:
+		struct input_pending : std::logic_error { input_pending() : std::logic_error("neolib::basic_json_reader::input_pending") {} };
+		struct stream_reader : std::logic_error { stream_reader() : std::logic_error("neolib::basic_json_reader::stream_reader") {} };
+	public:
+		static constexpr json_syntax syntax = Syntax;
+		static constexpr std::size_t DefaultBufferSize = 64 * 1024;
+		typedef basic_json_reader<Syntax> self_type;
+		typedef char character_type;
+		typedef std::string string_type;
+		typedef std::string_view string_view_type;
+		typedef double json_double;
+		typedef int64_t json_int64;
+		typedef uint64_t json_uint64;
+		typedef int32_t json_int;
+		typedef uint32_t json_uint;
+		typedef string_view_type json_string;
+		typedef bool json_bool;
+		struct json_null {};
+		struct json_keyword { string_view_type text; };
+		// alternatives are in json_type order
+		typedef variant<json_double, json_int64, json_uint64, json_int, json_uint, json_string, json_bool, json_null, json_keyword> value_type;
+	private:
+		enum class element
+		{
+			Unknown,
+			String,
+			Number,
+			Keyword,
+			Name
+		};
+		struct pending_event
+		{
+			json_event event;
+			json_type type;
+			bool hasName;
+			std::size_t depth;
+		};
+	public:
+		basic_json_reader(json_stream_format aFormat = json_stream_format::Document) :
+			basic_json_reader{ nullptr, aFormat, 0 }
+		{
+		}
+		basic_json_reader(std::istream& aInput, json_stream_format aFormat = json_stream_format::Document, std::size_t aBufferSize = DefaultBufferSize) :
+			basic_json_reader{ &aInput, aFormat, aBufferSize }
+		{
+		}
+	private:
+		basic_json_reader(std::istream* aInput, json_stream_format aFormat, std::size_t aBufferSize) :
+			iInput{ aInput },
+			iFormat{ aFormat },
+			iBuffer(aBufferSize != 0 ? aBufferSize : 1),
+			iNext{ nullptr },
+			iEnd{ nullptr },
+			iInputEnded{ false },
+			iFinished{ false },
+			iState{ json_detail::state::Value },
+			iElement{ element::Unknown },
+			iQuote{ '\"' },
+			iEscapeReturn{ json_detail::state::String },
+			iUnicode{ 0u },
+			iUnicodeDigits{ 0u },
+			iHaveName{ false },
+			iNameIsKeyword{ false },
+			iPendingHead{ 0u },
+			iPendingCount{ 0u },
+			iEvent{ json_event::NeedInput },
+			iType{ json_type::Unknown },
+			iEventHasName{ false },
+			iDepth{ 0u },
+			iRecords{ 0u },
+			iLine{ 1u },
+			iColumn{ 1u }
+		{
+			if (iInput == nullptr)
+				iBuffer.clear();
+		}
+	public:
+		// the chunk must remain valid until next_event() returns json_event::NeedInput
+		void feed(const character_type* aData, std::size_t aLength)
+		{
+			if (iInput != nullptr)
+				throw stream_reader();
+			if (iNext != iEnd)
+				throw input_pending();
+			iNext = aData;
+			iEnd = aData + aLength;
+		}
+		void end_input()
+		{
+			iInputEnded = true;
+		}
+		json_event next_event()
+		{
+			if (iEvent == json_event::Error || iEvent == json_event::EndOfInput)
+				return iEvent;
+			while (iPendingCount == 0)
+			{
+				if (iNext == iEnd)
+				{
+					if (iInput != nullptr && !iInputEnded)
+					{
+						refill();
+						continue;
+					}
+					if (!iInputEnded)
+						return iEvent = json_event::NeedInput;
+					if (iFinished)
+						return iEvent = json_event::EndOfInput;
+					iFinished = true;
+					// as basic_json::read() a trailing newline terminates a top level number or keyword
+					if (!consume(character_type{ '\n' }) || !finish())
+						return iEvent = json_event::Error;
+					continue;
+				}
+				if (is_token_state(iState))
+				{
+					// characters that leave the state unchanged are appended to the token in one go
+					auto run = iNext;
+					while (run != iEnd && *run != '\n' && json_detail::next_state<syntax>(iState, *run) == iState)
+						++run;
+					if (run != iNext)
+					{
+						iToken.append(iNext, run);
+						iColumn += static_cast<uint64_t>(run - iNext);
+						iNext = run;
+						continue;
+					}
+				}
+				if (!consume(*iNext))
+					return iEvent = json_event::Error;
+				if (*iNext++ == '\n')
+				{
+					++iLine;
+					iColumn = 1u;
+				}
+				else
+					++iColumn;
+			}
+			auto const& pending = iPending[iPendingHead];
+			iPendingHead = (iPendingHead + 1u) % iPending.size();
+			--iPendingCount;
+			iType = pending.type;
+			iEventHasName = pending.hasName;
+			iDepth = pending.depth;
+			return iEvent = pending.event;
+		}
+		// after json_event::StartObject or json_event::StartArray consume events up to and including the matching end event
+		json_event skip()
+		{
+			if (iSkipTo == std::nullopt)
+			{
+				if (iEvent != json_event::StartObject && iEvent != json_event::StartArray)
+					return iEvent;
+				iSkipTo = iDepth;
+			}
+			for (;;)
+			{
+				switch (next_event())
+				{
+				case json_event::NeedInput:
+					return iEvent;
+				case json_event::EndObject:
+				case json_event::EndArray:
+					if (iDepth != *iSkipTo)
+						break;
+					// fall through
+				case json_event::Error:
+				case json_event::EndOfInput:
+					iSkipTo = std::nullopt;
+					return iEvent;
+				default:
+					break;
+				}
+			}
+		}
+		// push interface: returns the event that stopped parsing; see basic_json_sax_handler
+		template <typename Handler>
+		json_event parse(Handler&& aHandler)
+		{
+			for (;;)
+			{
+				bool more = true;
+				switch (next_event())
+				{
+				case json_event::NeedInput:
+				case json_event::EndOfInput:
+				case json_event::Error:
+					return iEvent;
+				case json_event::StartObject:
+					more = aHandler.start_object(*this);
+					break;
+				case json_event::EndObject:
+					more = aHandler.end_object(*this);
+					break;
+				case json_event::StartArray:
+					more = aHandler.start_array(*this);
+					break;
+				case json_event::EndArray:
+					more = aHandler.end_array(*this);
+					break;
+				case json_event::Value:
+					more = aHandler.value(*this);
+					break;
+				case json_event::EndRecord:
+					more = aHandler.end_record(*this);
+					break;
+				}
+				if (!more)
+					return iEvent;
+			}
+		}
+	public:
+		json_event event() const
+		{
+			return iEvent;
+		}
+		json_type type() const
+		{
+			return iType;
+		}
+		bool has_name() const
+		{
+			return iEventHasName;
+		}
+		bool name_is_keyword() const
+		{
+			return iEventHasName && iNameIsKeyword;
+		}
+		string_view_type name() const
+		{
+			return iEventHasName ? string_view_type{ iName } : string_view_type{};
+		}
+		// valid for json_event::Value until the next call to next_event()
+		const value_type& value() const
+		{
+			return iValue;
+		}
+		// number of enclosing composites; for start and end events this includes the composite itself
+		std::size_t depth() const
+		{
+			return iDepth;
+		}
+		uint64_t records() const
+		{
+			return iRecords;
+		}
+		const string_type& error_text() const
+		{
+			return iErrorText;
+		}
+	private:
+		void refill()
+		{
+			iInput->read(&iBuffer[0], static_cast<std::streamsize>(iBuffer.size()));
+			auto const count = static_cast<std::size_t>(iInput->gcount());
+			if (count == 0u)
+				iInputEnded = true;
+			iNext = &iBuffer[0];
+			iEnd = iNext + count;
+		}
+		static bool is_token_state(json_detail::state aState)
+		{
+			switch (aState)
+			{
+			case json_detail::state::String:
+			case json_detail::state::Keyword:
+			case json_detail::state::Name:
+			case json_detail::state::NumberInt:
+			case json_detail::state::NumberFrac:
+			case json_detail::state::NumberExpInt:
+				return true;
+			default:
+				return false;
+			}
+		}
+		json_type context() const
+		{
+			if (iContext.empty())
+				return json_type::Unknown;
+			return iContext.back();
+		}
+		void push_event(json_event aEvent, json_type aType, bool aHasName = false)
+		{
+			iPending[(iPendingHead + iPendingCount++) % iPending.size()] = pending_event{ aEvent, aType, aHasName, iContext.size() };
+		}
+		bool take_name()
+		{
+			if (context() != json_type::Object)
+				return false;
+			if (!iHaveName)
+				throw std::logic_error("missing object field name");
+			iHaveName = false;
+			return true;
+		}
+		void set_name(bool aKeyword)
+		{
+			iName = iToken;
+			iNameIsKeyword = aKeyword;
+			iHaveName = true;
+		}
+		void buy_value(value_type&& aValue)
+		{
+			bool const hasName = take_name();
+			iValue = std::move(aValue);
+			push_event(json_event::Value, static_cast<json_type>(iValue.index() + 2u), hasName);
+			if (iContext.empty())
+				end_record();
+		}
+		void buy_composite(json_type aType)
+		{
+			bool const hasName = take_name();
+			iContext.push_back(aType);
+			push_event(aType == json_type::Object ? json_event::StartObject : json_event::StartArray, aType, hasName);
+		}
+		void end_record()
+		{
+			push_event(json_event::EndRecord, json_type::Unknown);
+			++iRecords;
+		}
+		void append_utf16(char16_t aCodeUnit)
+		{
+			if (utf16::is_high_surrogate(aCodeUnit))
+			{
+				iUtf16HighSurrogate = aCodeUnit;
+				return;
+			}
+			if (utf16::is_low_surrogate(aCodeUnit) && iUtf16HighSurrogate != std::nullopt)
+			{
+				char16_t surrogatePair[] = { *iUtf16HighSurrogate, aCodeUnit };
+				iToken += utf16_to_utf8(std::u16string(&surrogatePair[0], 2));
+			}
+			else
+				iToken += utf16_to_utf8(std::u16string(1, aCodeUnit));
+			iUtf16HighSurrogate = std::nullopt;
+		}
+		bool consume(character_type aCharacter)
+		{
+			try
+			{
+				return process(aCharacter);
+			}
+			catch (std::exception& e)
+			{
+				create_parse_error(e.what());
+				return false;
+			}
+		}
+		bool process(character_type aCharacter)
+		{
+			json_detail::state nextState = json_detail::next_state<syntax>(iState, aCharacter);
+			switch (nextState)
+			{
+			case json_detail::state::Ignore:
+				return true;
+			case json_detail::state::Error:
+			case json_detail::state::EndOfParse:
+				create_parse_error();
+				return false;
+			default:
+				if (iState == nextState)
+				{
+					switch (iState)
+					{
+					case json_detail::state::Object:
+					case json_detail::state::Array:
+						break;
+					case json_detail::state::String:
+					case json_detail::state::Keyword:
+					case json_detail::state::Name:
+					case json_detail::state::NumberInt:
+					case json_detail::state::NumberFrac:
+					case json_detail::state::NumberExpInt:
+						iToken.push_back(aCharacter);
+						return true;
+					default:
+						return true;
+					}
+				}
+			}
+
+			switch (nextState)
+			{
+			case json_detail::state::Close:
+			case json_detail::state::Element:
+				if (!end_element())
+					return false;
+				if constexpr (syntax != json_syntax::Relaxed)
+				{
+					// the state tables let ':' and ',' end any token: only a name may be followed by ':' and only a
+					// value inside a composite by ','; a name must be followed by a value
+					bool const afterName = context() == json_type::Object && iHaveName;
+					if ((aCharacter == ':' && !afterName) || (aCharacter == ',' && (afterName || iContext.empty())) ||
+						(nextState == json_detail::state::Close && afterName))
+					{
+						create_parse_error();
+						return false;
+					}
+				}
+				if (nextState == json_detail::state::Close)
+				{
+					if (iContext.empty() || (aCharacter == '}') != (iContext.back() == json_type::Object))
+					{
+						create_parse_error();
+						return false;
+					}
+					auto const closed = iContext.back();
+					push_event(closed == json_type::Object ? json_event::EndObject : json_event::EndArray, closed);
+					iContext.pop_back();
+					if (iContext.empty())
+						end_record();
+				}
+				switch (context())
+				{
+				case json_type::Object:
+					if constexpr (syntax == json_syntax::Standard)
+					{
+						if (!iHaveName)
+						{
+							if (nextState == json_detail::state::Close)
+								nextState = json_detail::state::NeedObjectValueSeparator;
+							else if (aCharacter == ',')
+								nextState = json_detail::state::NeedObjectValue;
+							else
+								nextState = json_detail::state::NeedObjectValueSeparator;
+						}
+						else
+							nextState = aCharacter != ':' ? json_detail::state::EndName : json_detail::state::NeedValue;
+					}
+					else
+					{
+						if (!iHaveName)
+							nextState = json_detail::state::Object;
+						else
+							nextState = aCharacter != ':' ? json_detail::state::EndName : json_detail::state::NeedValue;
+					}
+					break;
+				case json_type::Array:
+					if constexpr (syntax == json_syntax::Standard)
+					{
+						if (aCharacter == ',')
+							nextState = json_detail::state::NeedValue;
+						else
+							nextState = json_detail::state::NeedValueSeparator;
+					}
+					else
+						nextState = json_detail::state::Value;
+					break;
+				default:
+					// top level: either expect the next record or allow only trailing whitespace
+					if (iPendingCount != 0u || nextState == json_detail::state::Close)
+						nextState = iFormat == json_stream_format::Lines ? json_detail::state::Value : json_detail::state::Element;
+					break;
+				}
+				iElement = element::Unknown;
+				break;
+			case json_detail::state::String:
+				iElement = element::String;
+				iToken.clear();
+				iQuote = aCharacter;
+				break;
+			case json_detail::state::Name:
+				iElement = element::Name;
+				iToken.clear();
+				iQuote = aCharacter;
+				break;
+			case json_detail::state::EndName:
+				if (!iHaveName && iElement == element::Name)
+					set_name(false);
+				break;
+			case json_detail::state::NumberIntNeedDigit:
+				iElement = element::Number;
+				iToken.assign(1, aCharacter);
+				break;
+			case json_detail::state::NumberInt:
+				if (iElement != element::Number)
+				{
+					iElement = element::Number;
+					iToken.clear();
+				}
+				iToken.push_back(aCharacter);
+				break;
+			case json_detail::state::NumberFracNeedDigit:
+			case json_detail::state::NumberFrac:
+			case json_detail::state::NumberExpSign:
+			case json_detail::state::NumberExpIntNeedDigit:
+			case json_detail::state::NumberExpInt:
+				iToken.push_back(aCharacter);
+				break;
+			case json_detail::state::Array:
+				buy_composite(json_type::Array);
+				nextState = json_detail::state::Value;
+				break;
+			case json_detail::state::Object:
+				buy_composite(json_type::Object);
+				break;
+			case json_detail::state::Keyword:
+				iElement = element::Keyword;
+				iToken.assign(1, aCharacter);
+				break;
+			case json_detail::state::StringEnd:
+				if constexpr (syntax == json_syntax::Relaxed)
+				{
+					// relaxed: support for three different quote characters
+					if (aCharacter != iQuote)
+					{
+						iToken.push_back(aCharacter);
+						nextState = json_detail::state::String;
+					}
+				}
+				break;
+			case json_detail::state::Escaping:
+				iEscapeReturn = iState;
+				break;
+			case json_detail::state::EscapingUnicode:
+				iUnicode = 0u;
+				iUnicodeDigits = 0u;
+				break;
+			case json_detail::state::Escaped:
+				if (iState == json_detail::state::Escaping)
+				{
+					switch (aCharacter)
+					{
+					case '\"':
+					case '\'':
+					case '\\':
+					case '/':
+						iToken.push_back(aCharacter);
+						break;
+					case 'b':
+						iToken.push_back('\b');
+						break;
+					case 'f':
+						iToken.push_back('\f');
+						break;
+					case 'n':
+						iToken.push_back('\n');
+						break;
+					case 'r':
+						iToken.push_back('\r');
+						break;
+					case 't':
+						iToken.push_back('\t');
+						break;
+					}
+					nextState = iEscapeReturn;
+				}
+				else if (iState == json_detail::state::EscapingUnicode)
+				{
+					iUnicode = (iUnicode << 4u) | (aCharacter <= '9' ? aCharacter - '0' : (aCharacter | 0x20) - 'a' + 10);
+					if (++iUnicodeDigits == 4u)
+					{
+						append_utf16(static_cast<char16_t>(iUnicode));
+						nextState = iEscapeReturn;
+					}
+					else
+						nextState = json_detail::state::EscapingUnicode;
+				}
+				break;
+			default:
+				break;
+			}
+			iState = nextState;
+			return true;
+		}
+		bool end_element()
+		{
+			switch (iElement)
+			{
+			case element::Unknown:
+				break;
+			case element::String:
+				buy_value(json_string{ iToken });
+				break;
+			case element::Name:
+				if (context() == json_type::Object && !iHaveName)
+					set_name(false);
+				break;
+			case element::Number:
+				if (iState == json_detail::state::NumberInt)
+					std::visit([this](auto&& arg) { buy_value(arg); }, string_to_number(string_view_type{ iToken }));
+				else
+					buy_value(string_to_double(string_view_type{ iToken }));
+				break;
+			case element::Keyword:
+				if (iToken == "true" || iToken == "false" || iToken == "null")
+				{
+					if (context() == json_type::Object && !iHaveName)
+					{
+						create_parse_error("bad object field name");
+						return false;
+					}
+					if (iToken == "null")
+						buy_value(json_null{});
+					else
+						buy_value(json_bool{ iToken == "true" });
+				}
+				else
+				{
+					if constexpr (syntax == json_syntax::StandardNoKeywords)
+					{
+						create_parse_error("keywords unavailable");
+						return false;
+					}
+					if (context() == json_type::Object && !iHaveName)
+					{
+						set_name(true);
+						iElement = element::Name;
+					}
+					else
+						buy_value(json_keyword{ iToken });
+				}
+				break;
+			}
+			return true;
+		}
+		bool finish()
+		{
+			if (!iContext.empty() || (iState != json_detail::state::Value && iState != json_detail::state::Element))
+			{
+				create_parse_error("unexpected end of input");
+				return false;
+			}
+			if (iFormat == json_stream_format::Document && iRecords == 0u)
+			{
+				iErrorText = "empty document";
+				return false;
+			}
+			return true;
+		}
+		void create_parse_error(const string_type& aExtraInfo = {})
+		{
+			iErrorText.clear();
+			if (!aExtraInfo.empty())
+			{
+				iErrorText += "(";
+				iErrorText += aExtraInfo;
+				iErrorText += ") ";
+			}
+			iErrorText += "line " + std::to_string(iLine) + ", col " + std::to_string(iColumn);
+		}
+	private:
+		std::istream* iInput;
+		json_stream_format iFormat;
+		std::vector<character_type> iBuffer;
+		const character_type* iNext;
+		const character_type* iEnd;
+		bool iInputEnded;
+		bool iFinished;
+		json_detail::state iState;
+		element iElement;
+		character_type iQuote;
+		json_detail::state iEscapeReturn;
+		uint32_t iUnicode;
+		uint32_t iUnicodeDigits;
+		std::optional<char16_t> iUtf16HighSurrogate;
+		string_type iToken;
+		string_type iName;
+		bool iHaveName;
+		bool iNameIsKeyword;
+		std::vector<json_type> iContext;
+		std::array<pending_event, 4> iPending;
+		std::size_t iPendingHead;
+		std::size_t iPendingCount;
+		json_event iEvent;
+		json_type iType;
+		bool iEventHasName;
+		std::size_t iDepth;
+		value_type iValue;
+		std::optional<std::size_t> iSkipTo;
+		uint64_t iRecords;
+		uint64_t iLine;
+		uint64_t iColumn;
+		string_type iErrorText;
+	};
+
+	// default no-op callbacks for basic_json_reader::parse(); a handler derives from this and hides the callbacks
+	// it is interested in; returning false stops parsing
+	template <typename Reader>
+	struct basic_json_sax_handler
+	{
+		bool start_object(const Reader&) { return true; }
+		bool end_object(const Reader&) { return true; }
+		bool start_array(const Reader&) { return true; }
+		bool end_array(const Reader&) { return true; }
+		bool value(const Reader&) { return true; }
+		bool end_record(const Reader&) { return true; }
+	};
+
+	typedef basic_json_reader<json_syntax::Standard> json_reader;
+	typedef basic_json_sax_handler<json_reader> json_sax_handler;
+
+	typedef basic_json_reader<json_syntax::Relaxed> rjson_reader;
+	typedef basic_json_sax_handler<rjson_reader> rjson_sax_handler;
+}
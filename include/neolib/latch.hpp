@@ -0,0 +1,97 @@
+// latch.hpp
+/*
+ *  Copyright (c) 2018 Leigh Johnston.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *     * Neither the name of Leigh Johnston nor the names of any
+ *       other contributors to this software may be used to endorse or
+ *       promote products derived from this software without specific prior
+ *       written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ *  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include "neolib.hpp"
+#include <cstddef>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+namespace neolib
+{
+	// Single use completion latch: waiters are released once the count reaches zero.
+	class latch
+	{
+		// construction
+	public:
+		latch(std::ptrdiff_t aCount) : iCount{ aCount }
+		{
+		}
+		latch(const latch&) = delete;
+		latch& operator=(const latch&) = delete;
+		// operations
+	public:
+		void count_down(std::ptrdiff_t aUpdate = 1)
+		{
+			if (iCount.fetch_sub(aUpdate, std::memory_order_acq_rel) == aUpdate)
+			{
+				{
+					std::lock_guard<std::mutex> lk(iMutex);
+				}
+				iConditionVariable.notify_all();
+			}
+		}
+		bool try_wait() const
+		{
+			return iCount.load(std::memory_order_acquire) == 0;
+		}
+		void wait() const
+		{
+			// most batches complete shortly after the waiter runs out of work so spin briefly first
+			for (int spin = 0; spin < SpinCount; ++spin)
+			{
+				if (try_wait())
+					return;
+				std::this_thread::yield();
+			}
+			std::unique_lock<std::mutex> lk(iMutex);
+			iConditionVariable.wait(lk, [this] { return try_wait(); });
+		}
+		void arrive_and_wait(std::ptrdiff_t aUpdate = 1)
+		{
+			count_down(aUpdate);
+			wait();
+		}
+		// attributes
+	private:
+		static constexpr int SpinCount = 64;
+		std::atomic<std::ptrdiff_t> iCount;
+		mutable std::mutex iMutex;
+		mutable std::condition_variable iConditionVariable;
+	};
+}
@@ -45,6 +45,7 @@
 #include <boost/functional/hash.hpp>
 #include <optional>
 #include "variant.hpp"
+#include "flat_hash_map.hpp"
 
 namespace neolib
 {
@@ -553,8 +554,8 @@ namespace neolib
 			}
 		private:
 			lexer& iParent;
-			mutable std::unordered_map<char_type, next_type> iCharMap;
-			mutable std::unordered_map<token_type, next_type> iTokenMap;
+			mutable flat_hash_map<char_type, next_type> iCharMap;
+			mutable flat_hash_map<token_type, next_type> iTokenMap;
 			mutable std::unordered_map<function_type, next_type, boost::hash<function_type>> iFunctionMap;
 			mutable std::unordered_map<scope_type, next_type, boost::hash<function_type>> iScopeMap;
 		};
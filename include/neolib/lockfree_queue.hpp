@@ -0,0 +1,265 @@
+// lockfree_queue.hpp
+/*
+ *  Copyright (c) 2018 Leigh Johnston.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *     * Neither the name of Leigh Johnston nor the names of any
+ *       other contributors to this software may be used to endorse or
+ *       promote products derived from this software without specific prior
+ *       written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ *  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include "neolib.hpp"
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <type_traits>
+
+namespace neolib
+{
+	// Chase-Lev work-stealing deque: the owning thread pushes and pops at the bottom whilst
+	// any other thread may steal from the top. T must be trivially copyable (typically a pointer).
+	template <typename T>
+	class work_stealing_deque
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "neolib::work_stealing_deque: T must be trivially copyable");
+		// types
+	public:
+		typedef T value_type;
+	private:
+		class circular_array
+		{
+		public:
+			circular_array(std::size_t aCapacity) : iMask{ aCapacity - 1 }, iItems{ new std::atomic<T>[aCapacity] }
+			{
+			}
+		public:
+			std::size_t capacity() const
+			{
+				return iMask + 1;
+			}
+			T get(int64_t aIndex) const
+			{
+				return iItems[static_cast<std::size_t>(aIndex) & iMask].load(std::memory_order_relaxed);
+			}
+			void put(int64_t aIndex, T aItem)
+			{
+				iItems[static_cast<std::size_t>(aIndex) & iMask].store(aItem, std::memory_order_relaxed);
+			}
+			std::unique_ptr<circular_array> grow(int64_t aTop, int64_t aBottom) const
+			{
+				auto result = std::make_unique<circular_array>(capacity() * 2);
+				for (int64_t i = aTop; i != aBottom; ++i)
+					result->put(i, get(i));
+				return result;
+			}
+		private:
+			std::size_t iMask;
+			std::unique_ptr<std::atomic<T>[]> iItems;
+		};
+		// construction
+	public:
+		work_stealing_deque(std::size_t aInitialCapacity = 1024) : iTop{ 0 }, iBottom{ 0 }
+		{
+			std::size_t capacity = 1;
+			while (capacity < aInitialCapacity)
+				capacity *= 2;
+			iArrays.push_back(std::make_unique<circular_array>(capacity));
+			iArray.store(iArrays.back().get(), std::memory_order_relaxed);
+		}
+		work_stealing_deque(const work_stealing_deque&) = delete;
+		work_stealing_deque& operator=(const work_stealing_deque&) = delete;
+		// operations
+	public:
+		bool empty() const
+		{
+			return size() == 0;
+		}
+		std::size_t size() const
+		{
+			int64_t b = iBottom.load(std::memory_order_relaxed);
+			int64_t t = iTop.load(std::memory_order_relaxed);
+			return b > t ? static_cast<std::size_t>(b - t) : 0;
+		}
+		// owner thread only
+		void push(T aItem)
+		{
+			int64_t b = iBottom.load(std::memory_order_relaxed);
+			int64_t t = iTop.load(std::memory_order_acquire);
+			circular_array* a = iArray.load(std::memory_order_relaxed);
+			if (b - t > static_cast<int64_t>(a->capacity()) - 1)
+			{
+				// superseded arrays are retained as a concurrent thief may still be reading from them
+				iArrays.push_back(a->grow(t, b));
+				a = iArrays.back().get();
+				iArray.store(a, std::memory_order_release);
+			}
+			a->put(b, aItem);
+			std::atomic_thread_fence(std::memory_order_release);
+			iBottom.store(b + 1, std::memory_order_relaxed);
+		}
+		// owner thread only
+		bool pop(T& aItem)
+		{
+			int64_t b = iBottom.load(std::memory_order_relaxed) - 1;
+			circular_array* a = iArray.load(std::memory_order_relaxed);
+			iBottom.store(b, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64_t t = iTop.load(std::memory_order_relaxed);
+			if (t > b)
+			{
+				iBottom.store(b + 1, std::memory_order_relaxed);
+				return false;
+			}
+			aItem = a->get(b);
+			if (t == b)
+			{
+				// last item: race against thieves for it
+				bool won = iTop.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+				iBottom.store(b + 1, std::memory_order_relaxed);
+				return won;
+			}
+			return true;
+		}
+		// any thread
+		bool steal(T& aItem)
+		{
+			int64_t t = iTop.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64_t b = iBottom.load(std::memory_order_acquire);
+			if (t >= b)
+				return false;
+			circular_array* a = iArray.load(std::memory_order_acquire);
+			T item = a->get(t);
+			if (!iTop.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				return false;
+			aItem = item;
+			return true;
+		}
+		// attributes
+	private:
+		alignas(64) std::atomic<int64_t> iTop;
+		alignas(64) std::atomic<int64_t> iBottom;
+		std::atomic<circular_array*> iArray;
+		std::vector<std::unique_ptr<circular_array>> iArrays;
+	};
+
+	// Bounded multi-producer/multi-consumer ring queue (Vyukov); push fails rather than blocks when full.
+	template <typename T>
+	class bounded_mpmc_queue
+	{
+		// types
+	public:
+		typedef T value_type;
+	private:
+		struct cell
+		{
+			std::atomic<std::size_t> sequence;
+			T data;
+		};
+		// construction
+	public:
+		bounded_mpmc_queue(std::size_t aCapacity = 1024) : iEnqueuePos{ 0 }, iDequeuePos{ 0 }
+		{
+			std::size_t capacity = 2;
+			while (capacity < aCapacity)
+				capacity *= 2;
+			iMask = capacity - 1;
+			iCells.reset(new cell[capacity]);
+			for (std::size_t i = 0; i < capacity; ++i)
+				iCells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+		bounded_mpmc_queue(const bounded_mpmc_queue&) = delete;
+		bounded_mpmc_queue& operator=(const bounded_mpmc_queue&) = delete;
+		// operations
+	public:
+		std::size_t capacity() const
+		{
+			return iMask + 1;
+		}
+		bool empty() const
+		{
+			return iDequeuePos.load(std::memory_order_relaxed) >= iEnqueuePos.load(std::memory_order_relaxed);
+		}
+		template <typename U>
+		bool try_push(U&& aItem)
+		{
+			cell* c;
+			std::size_t pos = iEnqueuePos.load(std::memory_order_relaxed);
+			for (;;)
+			{
+				c = &iCells[pos & iMask];
+				std::size_t seq = c->sequence.load(std::memory_order_acquire);
+				intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+				if (diff == 0)
+				{
+					if (iEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+						break;
+				}
+				else if (diff < 0)
+					return false;
+				else
+					pos = iEnqueuePos.load(std::memory_order_relaxed);
+			}
+			c->data = std::forward<U>(aItem);
+			c->sequence.store(pos + 1, std::memory_order_release);
+			return true;
+		}
+		bool try_pop(T& aItem)
+		{
+			cell* c;
+			std::size_t pos = iDequeuePos.load(std::memory_order_relaxed);
+			for (;;)
+			{
+				c = &iCells[pos & iMask];
+				std::size_t seq = c->sequence.load(std::memory_order_acquire);
+				intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+				if (diff == 0)
+				{
+					if (iDequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+						break;
+				}
+				else if (diff < 0)
+					return false;
+				else
+					pos = iDequeuePos.load(std::memory_order_relaxed);
+			}
+			aItem = std::move(c->data);
+			c->sequence.store(pos + iMask + 1, std::memory_order_release);
+			return true;
+		}
+		// attributes
+	private:
+		std::size_t iMask;
+		std::unique_ptr<cell[]> iCells;
+		alignas(64) std::atomic<std::size_t> iEnqueuePos;
+		alignas(64) std::atomic<std::size_t> iDequeuePos;
+	};
+}
@@ -44,6 +44,19 @@
 #include <new>
 #include <stdexcept>
 #include <memory>
+#include <atomic>
+#include <utility>
+#include <cstdint>
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <vector>
+#include <string>
+#include <typeinfo>
+#include <algorithm>
+#include <type_traits>
+#include "allocator_stats.hpp"
 #include "detail_memory.hpp"
 
 namespace neolib
@@ -54,9 +67,377 @@ namespace neolib
 		return detail::uninitialized_copy(first, last, result, *result);
 	}
 
-	template <typename T, std::size_t ChunkSize = 4096, bool Omega = false, std::size_t Instance = 0>
+	namespace detail
+	{
+		// Pool shared by all threads. Each thread allocates from and frees to its own magazines (fixed size 
+		// free lists, one loaded and one spare) and only goes to the shared lock-free depot of full magazines 
+		// when both run dry or fill up. Chunks are never released so the pool itself is leaked: blocks can 
+		// still be freed during static destruction. Each thread counts its own allocations; stats() sums them.
+		template <std::size_t ElementSize, std::size_t Alignment, std::size_t ChunkSize, std::size_t Instance>
+		class thread_cached_pool
+		{
+		private:
+			struct link
+			{
+				link* iNext;
+				link* iNextMagazine;
+			};
+			struct alignas(std::max_align_t) chunk_header
+			{
+				chunk_header* iNext;
+			};
+		public:
+			static constexpr std::size_t element_size = ((ElementSize > sizeof(link) ? ElementSize : sizeof(link)) + Alignment - 1) / Alignment * Alignment;
+			static constexpr std::size_t chunk_capacity = ChunkSize / element_size > 1 ? ChunkSize / element_size : 2;
+			static constexpr std::size_t magazine_size = chunk_capacity / 2 < 64 ? chunk_capacity / 2 : 64;
+			static constexpr std::size_t magazines_per_chunk = chunk_capacity / magazine_size;
+			static constexpr std::size_t chunk_bytes = magazines_per_chunk * magazine_size * element_size;
+			static_assert(Alignment <= alignof(std::max_align_t), "neolib::detail::thread_cached_pool: over-aligned types not supported");
+		private:
+			enum class thread_state : uint8_t { Unused, Active, Exited };
+			// constant initialized so that the fast paths don't pay for thread_local initialization checks
+			struct cache
+			{
+				link* iLoaded;
+				std::size_t iLoadedCount;
+				link* iSpare;
+				thread_state iState;
+				std::atomic<std::uint64_t> iAllocations;
+				std::atomic<std::uint64_t> iDeallocations;
+			};
+			struct owner
+			{
+				~owner()
+				{
+					cache& c = tCache;
+					if (c.iSpare != nullptr)
+					{
+						instance().returned(magazine_size);
+						instance().give_magazines(c.iSpare, c.iSpare);
+					}
+					if (c.iLoaded != nullptr)
+					{
+						instance().returned(c.iLoadedCount);
+						instance().give_orphans(c.iLoaded);
+					}
+					instance().detach(c);
+					c.iLoaded = nullptr;
+					c.iLoadedCount = 0;
+					c.iSpare = nullptr;
+					c.iState = thread_state::Exited;
+				}
+				void attach()
+				{
+				}
+			};
+			// Treiber stack of full magazines; the head carries a version tag in the pointer's unused upper 
+			// bits to defeat ABA. Popping may read the link of a magazine another thread has just taken: the
+			// memory stays valid as chunks are never released and the version check discards the result.
+			class depot
+			{
+			private:
+				static constexpr unsigned PointerBits = sizeof(void*) == 8 ? 48 : 32;
+				static constexpr std::uint64_t PointerMask = (std::uint64_t{ 1 } << PointerBits) - 1;
+			public:
+				depot() : iHead{ 0 }
+				{
+				}
+			public:
+				void push(link* aFirst, link* aLast)
+				{
+					assert((reinterpret_cast<std::uintptr_t>(aFirst) & ~PointerMask) == 0);
+					std::uint64_t head = iHead.load(std::memory_order_relaxed);
+					do
+					{
+						aLast->iNextMagazine = pointer(head);
+					} while (!iHead.compare_exchange_weak(head, tagged(aFirst, head), std::memory_order_release, std::memory_order_relaxed));
+				}
+				link* pop()
+				{
+					std::uint64_t head = iHead.load(std::memory_order_acquire);
+					link* magazine;
+					do
+					{
+						magazine = pointer(head);
+						if (magazine == nullptr)
+							return nullptr;
+					} while (!iHead.compare_exchange_weak(head, tagged(magazine->iNextMagazine, head), std::memory_order_acquire, std::memory_order_acquire));
+					return magazine;
+				}
+			private:
+				static link* pointer(std::uint64_t aHead)
+				{
+					return reinterpret_cast<link*>(static_cast<std::uintptr_t>(aHead & PointerMask));
+				}
+				static std::uint64_t tagged(link* aPointer, std::uint64_t aPreviousHead)
+				{
+					return ((aPreviousHead >> PointerBits) + 1) << PointerBits | reinterpret_cast<std::uintptr_t>(aPointer);
+				}
+			private:
+				std::atomic<std::uint64_t> iHead;
+			};
+			// construction
+		private:
+			thread_cached_pool() : 
+				iOrphans{ nullptr }, iChunkList{ nullptr }, iChunks{ 0 }, iCirculating{ 0 }, iPeakCirculating{ 0 },
+				iRetiredAllocations{ 0 }, iRetiredDeallocations{ 0 }, iRetiredCrossThreadDeallocations{ 0 }
+			{
+				allocator_registry::instance().add(name(), [this]() { return stats(); });
+			}
+			// operations
+		public:
+			static void* allocate()
+			{
+				cache& c = tCache;
+				link* block = c.iLoaded;
+				if (block != nullptr)
+				{
+					c.iLoaded = block->iNext;
+					--c.iLoadedCount;
+					bump_counter(c.iAllocations);
+					return block;
+				}
+				return allocate_slow(c);
+			}
+			static void deallocate(void* aBlock)
+			{
+				cache& c = tCache;
+				if (c.iState == thread_state::Active && c.iLoadedCount < magazine_size)
+				{
+					link* block = static_cast<link*>(aBlock);
+					block->iNext = c.iLoaded;
+					c.iLoaded = block;
+					++c.iLoadedCount;
+					bump_counter(c.iDeallocations);
+					return;
+				}
+				deallocate_slow(c, aBlock);
+			}
+			static std::size_t chunks()
+			{
+				return instance().iChunks.load(std::memory_order_relaxed);
+			}
+			// Cross thread deallocations are a lower bound: blocks don't record the thread that allocated them 
+			// so only a thread freeing more than it allocated is known to have freed another thread's blocks.
+			// The high-water mark is that of blocks handed out to threads, which includes those cached by threads.
+			static allocator_stats stats()
+			{
+				thread_cached_pool& self = instance();
+				allocator_stats result;
+				result.iAllocations = self.iRetiredAllocations.load(std::memory_order_relaxed);
+				result.iDeallocations = self.iRetiredDeallocations.load(std::memory_order_relaxed);
+				result.iCrossThreadDeallocations = self.iRetiredCrossThreadDeallocations.load(std::memory_order_relaxed);
+				{
+					std::lock_guard<std::mutex> lg{ self.iCachesMutex };
+					for (cache* c : self.iCaches)
+					{
+						std::uint64_t const allocations = c->iAllocations.load(std::memory_order_relaxed);
+						std::uint64_t const deallocations = c->iDeallocations.load(std::memory_order_relaxed);
+						result.iAllocations += allocations;
+						result.iDeallocations += deallocations;
+						if (deallocations > allocations)
+							result.iCrossThreadDeallocations += deallocations - allocations;
+					}
+				}
+				result.iLiveObjects = static_cast<std::size_t>(result.iAllocations > result.iDeallocations ? result.iAllocations - result.iDeallocations : 0);
+				result.iChunksReserved = self.iChunks.load(std::memory_order_relaxed);
+				result.iBytesInUse = result.iLiveObjects * element_size;
+				result.iBytesReserved = result.iChunksReserved * (sizeof(chunk_header) + chunk_bytes);
+				result.iHighWaterMark = self.iPeakCirculating.load(std::memory_order_relaxed) * element_size;
+				return result;
+			}
+			static std::string name()
+			{
+				return "neolib::thread_cached_pool<" + std::to_string(ElementSize) + ", " + std::to_string(Alignment) + ", " + 
+					std::to_string(ChunkSize) + ", " + std::to_string(Instance) + ">";
+			}
+		private:
+			static thread_cached_pool& instance()
+			{
+				static thread_cached_pool* sInstance = new thread_cached_pool{};
+				return *sInstance;
+			}
+			static void* allocate_slow(cache& c)
+			{
+				if (c.iState == thread_state::Unused)
+					attach(c);
+				if (c.iState == thread_state::Exited)
+				{
+					// thread is exiting: take a block from a magazine and leave the rest for others
+					link* magazine = instance().take_magazine();
+					instance().returned(magazine_size - 1);
+					if (magazine->iNext != nullptr)
+						instance().give_orphans(magazine->iNext);
+					instance().iRetiredAllocations.fetch_add(1, std::memory_order_relaxed);
+					return magazine;
+				}
+				c.iLoaded = (c.iSpare != nullptr ? std::exchange(c.iSpare, nullptr) : instance().take_magazine());
+				c.iLoadedCount = magazine_size;
+				return allocate();
+			}
+			static void deallocate_slow(cache& c, void* aBlock)
+			{
+				if (c.iState == thread_state::Unused)
+					attach(c);
+				if (c.iState == thread_state::Exited)
+				{
+					link* block = static_cast<link*>(aBlock);
+					block->iNext = nullptr;
+					instance().returned(1);
+					instance().give_orphans(block);
+					instance().iRetiredDeallocations.fetch_add(1, std::memory_order_relaxed);
+					return;
+				}
+				if (c.iLoadedCount == magazine_size)
+				{
+					if (c.iSpare != nullptr)
+					{
+						instance().returned(magazine_size);
+						instance().give_magazines(c.iSpare, c.iSpare);
+					}
+					c.iSpare = c.iLoaded;
+					c.iLoaded = nullptr;
+					c.iLoadedCount = 0;
+				}
+				deallocate(aBlock);
+			}
+			static void attach(cache& c)
+			{
+				tOwner.attach(); // registers the owner's destructor for this thread
+				c.iState = thread_state::Active;
+				thread_cached_pool& self = instance();
+				std::lock_guard<std::mutex> lg{ self.iCachesMutex };
+				self.iCaches.push_back(&c);
+			}
+			void detach(cache& c)
+			{
+				std::lock_guard<std::mutex> lg{ iCachesMutex };
+				std::uint64_t const allocations = c.iAllocations.load(std::memory_order_relaxed);
+				std::uint64_t const deallocations = c.iDeallocations.load(std::memory_order_relaxed);
+				iRetiredAllocations.fetch_add(allocations, std::memory_order_relaxed);
+				iRetiredDeallocations.fetch_add(deallocations, std::memory_order_relaxed);
+				if (deallocations > allocations)
+					iRetiredCrossThreadDeallocations.fetch_add(deallocations - allocations, std::memory_order_relaxed);
+				iCaches.erase(std::remove(iCaches.begin(), iCaches.end(), &c), iCaches.end());
+			}
+			link* take_magazine()
+			{
+				link* magazine = iDepot.pop();
+				if (magazine == nullptr)
+					magazine = grow();
+				raise_to(iPeakCirculating, iCirculating.fetch_add(magazine_size, std::memory_order_relaxed) + magazine_size);
+				return magazine;
+			}
+			void returned(std::size_t aBlocks)
+			{
+				iCirculating.fetch_sub(aBlocks, std::memory_order_relaxed);
+			}
+			void give_magazines(link* aFirst, link* aLast)
+			{
+				iDepot.push(aFirst, aLast);
+			}
+			// partial magazines left behind by exiting threads are merged here until they fill up
+			void give_orphans(link* aBlocks)
+			{
+				for (;;)
+				{
+					link* tail = aBlocks;
+					while (tail->iNext != nullptr)
+						tail = tail->iNext;
+					tail->iNext = iOrphans.exchange(nullptr, std::memory_order_acquire);
+					link* merged = aBlocks;
+					std::size_t count = 0;
+					for (link* b = merged; b != nullptr; b = b->iNext)
+						++count;
+					while (count >= magazine_size)
+					{
+						link* last = merged;
+						for (std::size_t i = 1; i < magazine_size; ++i)
+							last = last->iNext;
+						link* rest = last->iNext;
+						last->iNext = nullptr;
+						give_magazines(merged, merged);
+						merged = rest;
+						count -= magazine_size;
+					}
+					if (merged == nullptr)
+						return;
+					link* expected = nullptr;
+					if (iOrphans.compare_exchange_strong(expected, merged, std::memory_order_release, std::memory_order_relaxed))
+						return;
+					aBlocks = merged;
+				}
+			}
+			link* grow()
+			{
+				// chunks are chained from a header so they stay reachable from the (leaked) pool
+				chunk_header* header = static_cast<chunk_header*>(::operator new(sizeof(chunk_header) + chunk_bytes));
+				header->iNext = iChunkList.load(std::memory_order_relaxed);
+				while (!iChunkList.compare_exchange_weak(header->iNext, header, std::memory_order_release, std::memory_order_relaxed))
+					;
+				iChunks.fetch_add(1, std::memory_order_relaxed);
+				char* chunk = reinterpret_cast<char*>(header + 1);
+				link* previous = nullptr;
+				for (std::size_t m = 0; m < magazines_per_chunk; ++m)
+				{
+					char* start = chunk + m * magazine_size * element_size;
+					for (std::size_t i = 0; i < magazine_size; ++i)
+						reinterpret_cast<link*>(start + i * element_size)->iNext = (i + 1 < magazine_size ? reinterpret_cast<link*>(start + (i + 1) * element_size) : nullptr);
+					link* magazine = reinterpret_cast<link*>(start);
+					if (previous != nullptr)
+						previous->iNextMagazine = magazine;
+					previous = magazine;
+				}
+				link* first = reinterpret_cast<link*>(chunk);
+				if (magazines_per_chunk > 1)
+					give_magazines(first->iNextMagazine, previous);
+				return first;
+			}
+			// attributes
+		private:
+			depot iDepot;
+			std::atomic<link*> iOrphans;
+			std::atomic<chunk_header*> iChunkList;
+			std::atomic<std::size_t> iChunks;
+			std::atomic<std::size_t> iCirculating;
+			std::atomic<std::size_t> iPeakCirculating;
+			std::mutex iCachesMutex;
+			std::vector<cache*> iCaches;
+			std::atomic<std::uint64_t> iRetiredAllocations;
+			std::atomic<std::uint64_t> iRetiredDeallocations;
+			std::atomic<std::uint64_t> iRetiredCrossThreadDeallocations;
+			static thread_local cache tCache;
+			static thread_local owner tOwner;
+		};
+
+		template <std::size_t ElementSize, std::size_t Alignment, std::size_t ChunkSize, std::size_t Instance>
+		thread_local typename thread_cached_pool<ElementSize, Alignment, ChunkSize, Instance>::cache thread_cached_pool<ElementSize, Alignment, ChunkSize, Instance>::tCache;
+		template <std::size_t ElementSize, std::size_t Alignment, std::size_t ChunkSize, std::size_t Instance>
+		thread_local typename thread_cached_pool<ElementSize, Alignment, ChunkSize, Instance>::owner thread_cached_pool<ElementSize, Alignment, ChunkSize, Instance>::tOwner;
+	}
+
+	namespace detail
+	{
+		// the unit of allocation of the pools serving pool_allocator<T>'s array allocations
+		template <typename T, std::size_t N>
+		struct pool_array_block
+		{
+			alignas(T) unsigned char iStorage[sizeof(T) * N];
+		};
+
+		template <typename T>
+		struct is_pool_array_block : std::false_type {};
+		template <typename T, std::size_t N>
+		struct is_pool_array_block<pool_array_block<T, N>> : std::true_type {};
+	}
+
+	// ThreadSafe pools are shared by all threads with per-thread caching (see detail::thread_cached_pool);
+	// other pools are not thread safe. Arrays of up to max_pooled_array elements come from pools of blocks
+	// of 2, 4, 8 or 16 elements (the count rounded up to a power of two); larger arrays come from std::allocator.
+	template <typename T, std::size_t ChunkSize = 4096, bool Omega = false, std::size_t Instance = 0, bool ThreadSafe = false>
 	class pool_allocator
 	{
+		static_assert(!(Omega && ThreadSafe), "neolib::pool_allocator: omega pools cannot be thread safe");
 	public:
 		typedef T value_type;
 		typedef T* pointer;
@@ -65,8 +446,14 @@ namespace neolib
 		typedef const T& const_reference;
 		typedef std::size_t size_type;
 		typedef ptrdiff_t difference_type;
+	public:
+		static constexpr size_type max_pooled_array = 16;
+		template <size_type N>
+		using array_allocator = pool_allocator<detail::pool_array_block<T, N>, ChunkSize, Omega, Instance, ThreadSafe>;
 	private:
 		typedef std::allocator<T> backup_allocator_t;
+		template <typename U>
+		using thread_cached_pool = detail::thread_cached_pool<sizeof(U), alignof(U), ChunkSize, Instance>;
 
 	// implementation
 	private:
@@ -93,11 +480,13 @@ namespace neolib
 		class pool
 		{
 		public:
-			pool() : iChunks(nullptr), iHead(nullptr) 
+			pool() : iChunks(nullptr), iHead(nullptr), iChunkCount(0), iAllocations(0), iDeallocations(0), iPeakLive(0)
 			{
+				allocator_registry::instance().add(name(), [this]() { return stats(); });
 			}
 			~pool()
 			{
+				allocator_registry::instance().remove(name());
 				chunk* n = iChunks;
 				while (n)
 				{
@@ -118,6 +507,10 @@ namespace neolib
 					iHead = reinterpret_cast<link*>(reinterpret_cast<char*>(p) + element_size());
 				else
 					iHead = p->iNext;
+				detail::bump_counter(iAllocations);
+				std::uint64_t const live = iAllocations.load(std::memory_order_relaxed) - iDeallocations.load(std::memory_order_relaxed);
+				if (live > iPeakLive.load(std::memory_order_relaxed))
+					iPeakLive.store(live, std::memory_order_relaxed);
 				return p;
 			}
 			void deallocate(void* aObject)
@@ -127,6 +520,7 @@ namespace neolib
 					link* p = reinterpret_cast<link*>(aObject);
 					p->iNext = iHead;
 					iHead = p;
+					detail::bump_counter(iDeallocations);
 				}
 			}
 		public:
@@ -143,8 +537,26 @@ namespace neolib
 						reinterpret_cast<link*>(last - element_size())->iNext = (n->iNext != nullptr ? reinterpret_cast<link*>(n->iNext->iMem) : nullptr);
 					}
 					iHead = reinterpret_cast<link*>(iChunks->iMem);
+					iDeallocations.store(iAllocations.load(std::memory_order_relaxed), std::memory_order_relaxed);
 				}
 			}
+			allocator_stats stats() const
+			{
+				allocator_stats result;
+				result.iAllocations = iAllocations.load(std::memory_order_relaxed);
+				result.iDeallocations = iDeallocations.load(std::memory_order_relaxed);
+				result.iLiveObjects = static_cast<std::size_t>(result.iAllocations - result.iDeallocations);
+				result.iChunksReserved = iChunkCount.load(std::memory_order_relaxed);
+				result.iBytesInUse = result.iLiveObjects * element_size();
+				result.iBytesReserved = result.iChunksReserved * sizeof(chunk);
+				result.iHighWaterMark = static_cast<std::size_t>(iPeakLive.load(std::memory_order_relaxed)) * element_size();
+				return result;
+			}
+			static std::string name()
+			{
+				return std::string{ "neolib::pool_allocator<" } + typeid(T).name() + ", " + std::to_string(ChunkSize) + 
+					(Omega ? ", omega" : "") + ", " + std::to_string(Instance) + ">";
+			}
 			void info()
 			{
 				uint32_t total = 0;
@@ -167,6 +579,7 @@ namespace neolib
 				chunk* n = new chunk;
 				n->iNext = iChunks;
 				iChunks = n;
+				detail::bump_counter(iChunkCount);
 
 				constexpr std::size_t nelem = chunk_size() / element_size();
 				char* start = n->iMem;
@@ -183,6 +596,10 @@ namespace neolib
 		private:
 			chunk * iChunks;
 			link* iHead;
+			std::atomic<std::size_t> iChunkCount;
+			std::atomic<std::uint64_t> iAllocations;
+			std::atomic<std::uint64_t> iDeallocations;
+			std::atomic<std::uint64_t> iPeakLive;
 		};
 
 	// construction
@@ -196,7 +613,7 @@ namespace neolib
 		}
 
 		template <typename U>
-		pool_allocator(const pool_allocator<U, ChunkSize, Omega, Instance>& /*rhs*/)
+		pool_allocator(const pool_allocator<U, ChunkSize, Omega, Instance, ThreadSafe>& /*rhs*/)
 		{
 		}
 
@@ -208,20 +625,24 @@ namespace neolib
 	public:
 		pointer allocate(size_type aCount = 1)
 		{
-			if (aCount == 1)
-				return reinterpret_cast<pointer>(sPool.allocate());
+			if (aCount != 1)
+				return allocate_array(aCount);
+			if constexpr (ThreadSafe)
+				return reinterpret_cast<pointer>(thread_cached_pool<T>::allocate());
 			else
-				return backup_allocator().allocate(aCount);
+				return reinterpret_cast<pointer>(sPool.allocate());
 		}
 
 		void deallocate(pointer aObject, size_type aCount = 1)
 		{
 			if constexpr (!Omega)
 			{
-				if (aCount == 1)
-					sPool.deallocate(aObject);
+				if (aCount != 1)
+					deallocate_array(aObject, aCount);
+				else if constexpr (ThreadSafe)
+					thread_cached_pool<T>::deallocate(aObject);
 				else
-					backup_allocator().deallocate(aObject, aCount);
+					sPool.deallocate(aObject);
 			}
 		}
 
@@ -249,13 +670,24 @@ namespace neolib
 
 		void info()
 		{
-			sPool.info();
+			if constexpr (ThreadSafe)
+				std::cout << "Number of chunks: " << thread_cached_pool<T>::chunks() << std::endl;
+			else
+				sPool.info();
+		}
+
+		static allocator_stats stats()
+		{
+			if constexpr (ThreadSafe)
+				return thread_cached_pool<T>::stats();
+			else
+				return sPool.stats();
 		}
 			
 		template <typename U>
 		struct rebind
 		{
-			typedef pool_allocator<U, ChunkSize, Omega, Instance> other;
+			typedef pool_allocator<U, ChunkSize, Omega, Instance, ThreadSafe> other;
 		};
 
 		// this should really return 1 but popular implementations assume otherwise
@@ -270,14 +702,63 @@ namespace neolib
 			static backup_allocator_t sBackupAllocator;
 			return sBackupAllocator;
 		}
+		static constexpr size_type array_block_size(size_type aCount)
+		{
+			return aCount <= 1 || aCount > max_pooled_array ? 0 : aCount <= 2 ? 2 : aCount <= 4 ? 4 : aCount <= 8 ? 8 : 16;
+		}
+		// the block pools themselves only ever allocate single blocks
+		static pointer allocate_array(size_type aCount)
+		{
+			if constexpr (!detail::is_pool_array_block<T>::value)
+			{
+				switch (array_block_size(aCount))
+				{
+				case 2:
+					return reinterpret_cast<pointer>(array_allocator<2>{}.allocate());
+				case 4:
+					return reinterpret_cast<pointer>(array_allocator<4>{}.allocate());
+				case 8:
+					return reinterpret_cast<pointer>(array_allocator<8>{}.allocate());
+				case 16:
+					return reinterpret_cast<pointer>(array_allocator<16>{}.allocate());
+				default:
+					break;
+				}
+			}
+			return backup_allocator().allocate(aCount);
+		}
+		static void deallocate_array(pointer aObject, size_type aCount)
+		{
+			if constexpr (!detail::is_pool_array_block<T>::value)
+			{
+				switch (array_block_size(aCount))
+				{
+				case 2:
+					array_allocator<2>{}.deallocate(reinterpret_cast<typename array_allocator<2>::pointer>(aObject));
+					return;
+				case 4:
+					array_allocator<4>{}.deallocate(reinterpret_cast<typename array_allocator<4>::pointer>(aObject));
+					return;
+				case 8:
+					array_allocator<8>{}.deallocate(reinterpret_cast<typename array_allocator<8>::pointer>(aObject));
+					return;
+				case 16:
+					array_allocator<16>{}.deallocate(reinterpret_cast<typename array_allocator<16>::pointer>(aObject));
+					return;
+				default:
+					break;
+				}
+			}
+			backup_allocator().deallocate(aObject, aCount);
+		}
 
 	// attributes
 	private:
 		static pool sPool;
 	};
 
-	template <typename T, std::size_t ChunkSize, bool Omega, std::size_t Instance>
-	typename pool_allocator<T, ChunkSize, Omega, Instance>::pool pool_allocator<T, ChunkSize, Omega, Instance>::sPool;
+	template <typename T, std::size_t ChunkSize, bool Omega, std::size_t Instance, bool ThreadSafe>
+	typename pool_allocator<T, ChunkSize, Omega, Instance, ThreadSafe>::pool pool_allocator<T, ChunkSize, Omega, Instance, ThreadSafe>::sPool;
 
 	template <typename T, std::size_t N, std::size_t Instance = 0>
 	class reserve_allocator
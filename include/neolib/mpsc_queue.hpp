@@ -0,0 +1,167 @@
+// mpsc_queue.hpp
+/*
+ *  Copyright (c) 2018 Leigh Johnston.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *     * Neither the name of Leigh Johnston nor the names of any
+ *       other contributors to this software may be used to endorse or
+ *       promote products derived from this software without specific prior
+ *       written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ *  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include "neolib.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <deque>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace neolib
+{
+	// Multiple producer single consumer queue. Producers claim cells of a bounded ring without locking (after 
+	// Dmitry Vyukov's bounded MPMC queue); a producer that finds the ring full appends to a locked overflow 
+	// list instead, which the consumer takes in one go once the ring is drained, so nothing is ever dropped.
+	// Moving an element must not throw: a claimed cell that is never filled would stall the consumer.
+	template <typename T, std::size_t Capacity = 1024>
+	class mpsc_queue
+	{
+		static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "neolib::mpsc_queue: capacity must be a power of two");
+		// types
+	public:
+		typedef T value_type;
+	private:
+		struct cell
+		{
+			std::atomic<std::size_t> iSequence;
+			typename std::aligned_storage<sizeof(T), alignof(T)>::type iStorage;
+		};
+		// construction
+	public:
+		mpsc_queue() :
+			iCells{ new cell[Capacity] }, iEnqueuePosition{ 0 }, iDequeuePosition{ 0 }, iOverflowing{ false }, iHaveTaken{ false }
+		{
+			for (std::size_t i = 0; i < Capacity; ++i)
+				iCells[i].iSequence.store(i, std::memory_order_relaxed);
+		}
+		~mpsc_queue()
+		{
+			T discarded;
+			while (pop(discarded))
+				;
+		}
+		mpsc_queue(const mpsc_queue&) = delete;
+		mpsc_queue& operator=(const mpsc_queue&) = delete;
+		// operations
+	public:
+		// any thread
+		void push(T&& aValue)
+		{
+			if (!iOverflowing.load(std::memory_order_acquire) && try_push(aValue))
+				return;
+			std::lock_guard<std::mutex> lg{ iOverflowMutex };
+			iOverflow.push_back(std::move(aValue));
+			iOverflowing.store(true, std::memory_order_release);
+		}
+		// any thread; a push in progress counts as not empty
+		bool empty() const
+		{
+			return iEnqueuePosition.load() == iDequeuePosition.load() && !iOverflowing.load() && !iHaveTaken.load();
+		}
+		// consumer only
+		bool pop(T& aValue)
+		{
+			if (!iTaken.empty())
+			{
+				aValue = std::move(iTaken.front());
+				iTaken.pop_front();
+				if (iTaken.empty())
+					iHaveTaken.store(false);
+				return true;
+			}
+			std::size_t const position = iDequeuePosition.load(std::memory_order_relaxed);
+			cell& c = iCells[position & (Capacity - 1)];
+			if (c.iSequence.load(std::memory_order_acquire) == position + 1)
+			{
+				T& stored = *reinterpret_cast<T*>(&c.iStorage);
+				aValue = std::move(stored);
+				stored.~T();
+				c.iSequence.store(position + Capacity, std::memory_order_release);
+				iDequeuePosition.store(position + 1, std::memory_order_relaxed);
+				return true;
+			}
+			if (iEnqueuePosition.load(std::memory_order_relaxed) != position || !iOverflowing.load(std::memory_order_acquire))
+				return false; // empty, or a producer has yet to finish writing the next cell
+			{
+				std::lock_guard<std::mutex> lg{ iOverflowMutex };
+				iTaken.swap(iOverflow);
+				iHaveTaken.store(true);
+				iOverflowing.store(false, std::memory_order_release);
+			}
+			return pop(aValue);
+		}
+		// implementation
+	private:
+		bool try_push(T& aValue)
+		{
+			std::size_t position = iEnqueuePosition.load(std::memory_order_relaxed);
+			for (;;)
+			{
+				cell& c = iCells[position & (Capacity - 1)];
+				std::intptr_t const difference = static_cast<std::intptr_t>(c.iSequence.load(std::memory_order_acquire)) - static_cast<std::intptr_t>(position);
+				if (difference == 0)
+				{
+					if (iEnqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+					{
+						new (&c.iStorage) T{ std::move(aValue) };
+						c.iSequence.store(position + 1, std::memory_order_release);
+						return true;
+					}
+				}
+				else if (difference < 0)
+					return false; // full
+				else
+					position = iEnqueuePosition.load(std::memory_order_relaxed);
+			}
+		}
+		// attributes
+	private:
+		std::unique_ptr<cell[]> iCells;
+		alignas(64) std::atomic<std::size_t> iEnqueuePosition;
+		alignas(64) std::atomic<std::size_t> iDequeuePosition;
+		std::atomic<bool> iOverflowing;
+		std::mutex iOverflowMutex;
+		std::deque<T> iOverflow;
+		std::deque<T> iTaken;
+		std::atomic<bool> iHaveTaken;
+	};
+}
@@ -204,6 +204,10 @@ namespace neolib
 		
 		// operations
 	public:
+		async_task& io_task() const
+		{
+			return iIoTask;
+		}
 		bool open(const std::string& aRemoteHostName, unsigned short aRemotePort, bool aSecure = false, protocol_family aProtocolFamily = IPv4)
 		{
 			if (opened())
@@ -38,7 +38,10 @@
 #include "neolib.hpp"
 #include <stdexcept>
 #include <vector>
+#include <deque>
+#include <utility>
 #include "async_task.hpp"
+#include "resumer.hpp"
 #include "observable.hpp"
 #include "i_packet.hpp"
 #include "binary_packet.hpp"
@@ -98,15 +101,56 @@ namespace neolib
 		typedef std::unique_ptr<packet_type> queue_item;
 		typedef std::unique_ptr<packet_type> orphaned_queue_item;
 		typedef std::vector<queue_item> send_queue;
+		typedef std::deque<queue_item> read_queue;
+	public:
+		struct read_pending : std::logic_error { read_pending() : std::logic_error("neolib::packet_stream::read_pending") {} };
+		struct stream_closed : std::runtime_error { stream_closed() : std::runtime_error("neolib::packet_stream::stream_closed") {} };
+	public:
+		// co_await stream.read_packet() yields the next packet to arrive; it throws boost::system::system_error 
+		// if the connection failed or stream_closed once the stream has closed and all packets have been read.
+		class read_awaiter
+		{
+			friend class packet_stream;
+		public:
+			read_awaiter(packet_stream& aStream) : iStream{ aStream }
+			{
+			}
+		public:
+			bool await_ready()
+			{
+				return iStream.take_packet(*this);
+			}
+			template <typename Handle>
+			void await_suspend(Handle aHandle)
+			{
+				iResumer = resumer{ aHandle };
+				iStream.iReader = this;
+			}
+			packet_type await_resume()
+			{
+				if (iPacket == nullptr)
+				{
+					if (iError)
+						throw boost::system::system_error(iError);
+					throw stream_closed();
+				}
+				return std::move(*iPacket);
+			}
+		private:
+			packet_stream& iStream;
+			queue_item iPacket;
+			boost::system::error_code iError;
+			resumer iResumer;
+		};
 		
 		// construction
 	public:
 		packet_stream(async_task& aIoTask, bool aSecure = false, protocol_family aProtocolFamily = IPv4) : 
-			iConnection(aIoTask, *this, aSecure, aProtocolFamily)
+			iConnection(aIoTask, *this, aSecure, aProtocolFamily), iReading(false), iReader(nullptr), iReadFinished(false)
 		{
 		}
 		packet_stream(async_task& aIoTask, const std::string& aHostName, unsigned short aPort, bool aSecure = false, protocol_family aProtocolFamily = IPv4) :
-			iConnection(aIoTask, *this, aHostName, aPort, aSecure, aProtocolFamily)
+			iConnection(aIoTask, *this, aHostName, aPort, aSecure, aProtocolFamily), iReading(false), iReader(nullptr), iReadFinished(false)
 		{
 		}
 		~packet_stream()
@@ -120,6 +164,8 @@ namespace neolib
 	public:
 		bool open(const std::string& aRemoteHostName, unsigned short aRemotePort, bool aSecure = false, protocol_family aProtocolFamily = IPv4)
 		{
+			iReadFinished = false;
+			iReadError.clear();
 			return iConnection.open(aRemoteHostName, aRemotePort, aSecure, aProtocolFamily);
 		}
 		bool opened() const
@@ -130,6 +176,7 @@ namespace neolib
 		{
 			remove_all_packets();
 			iConnection.close();
+			finish_reading(boost::system::error_code{});
 		}
 		void send_packet(const packet_type& aPacket, bool aHighPriority = false)
 		{
@@ -168,6 +215,11 @@ namespace neolib
 		{
 			return iSendQueue.empty();
 		}
+		// packets are only queued for reading once read_packet() has been used; observers see them regardless
+		read_awaiter read_packet()
+		{
+			return read_awaiter{ *this };
+		}
 		
 		// implementation
 	private:
@@ -207,6 +259,7 @@ namespace neolib
 		}
 		virtual void connection_failure(const boost::system::error_code& aError)
 		{
+			finish_reading(aError);
 			notify_observers(observer_type::NotifyConnectionFailure, aError);
 		}
 		virtual void packet_sent(const generic_packet_type& aPacket)
@@ -216,15 +269,19 @@ namespace neolib
 		}
 		virtual void packet_arrived(const generic_packet_type& aPacket)
 		{
+			if (iReading)
+				read_packet_arrived(static_cast<const packet_type&>(aPacket));
 			notify_observers(observer_type::NotifyPacketArrived, static_cast<const packet_type&>(aPacket));
 		}
 		virtual void transfer_failure(const generic_packet_type& aPacket, const boost::system::error_code& aError)
 		{
 			orphaned_queue_item failedPacket = remove_packet(static_cast<const packet_type&>(aPacket));
+			finish_reading(aError);
 			notify_observers(observer_type::NotifyTransferFailure, aError);
 		}
 		virtual void connection_closed()
 		{
+			finish_reading(boost::system::error_code{});
 			notify_observers(observer_type::NotifyConnectionClosed);
 		}
 		orphaned_queue_item remove_packet(const packet_type& aPacket)
@@ -243,10 +300,61 @@ namespace neolib
 		{
 			iSendQueue.clear();
 		}
+		bool take_packet(read_awaiter& aReader)
+		{
+			if (iReader != nullptr)
+				throw read_pending();
+			iReading = true;
+			if (!iReadQueue.empty())
+			{
+				aReader.iPacket = std::move(iReadQueue.front());
+				iReadQueue.pop_front();
+				return true;
+			}
+			if (iReadFinished)
+			{
+				aReader.iError = iReadError;
+				return true;
+			}
+			return false;
+		}
+		// readers are resumed from the io task's event loop (not from within the connection's handler) as they may 
+		// well close or destroy the stream
+		void read_packet_arrived(const packet_type& aPacket)
+		{
+			queue_item packet = std::make_unique<packet_type>(aPacket);
+			if (iReader != nullptr)
+			{
+				read_awaiter& reader = *std::exchange(iReader, nullptr);
+				reader.iPacket = std::move(packet);
+				iConnection.io_task().resume(reader.iResumer);
+			}
+			else
+				iReadQueue.push_back(std::move(packet));
+		}
+		void finish_reading(const boost::system::error_code& aError)
+		{
+			if (!iReadFinished)
+			{
+				iReadFinished = true;
+				iReadError = aError;
+			}
+			if (iReader != nullptr)
+			{
+				read_awaiter& reader = *std::exchange(iReader, nullptr);
+				reader.iError = iReadError;
+				iConnection.io_task().resume(reader.iResumer);
+			}
+		}
 		// attributes
 	private:
 		send_queue iSendQueue;
 		connection_type iConnection;
+		bool iReading;
+		read_queue iReadQueue;
+		read_awaiter* iReader;
+		bool iReadFinished;
+		boost::system::error_code iReadError;
 	};
 
 	typedef i_packet_stream_observer<binary_packet, tcp_protocol> i_tcp_binary_packet_stream_observer;
@@ -0,0 +1,337 @@
+// parallel_algorithm.hpp
+/*
+ *  Copyright (c) 2018 Leigh Johnston.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *     * Neither the name of Leigh Johnston nor the names of any
+ *       other contributors to this software may be used to endorse or
+ *       promote products derived from this software without specific prior
+ *       written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ *  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include "neolib.hpp"
+#include <cstddef>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <exception>
+#include <optional>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include "latch.hpp"
+#include "thread_pool.hpp"
+
+namespace neolib
+{
+	namespace detail
+	{
+		// A batch of [0, count) shared between the calling thread and helper tasks posted to a thread pool.
+		// Participants claim chunks that shrink as the batch drains (guided self-scheduling) and completion
+		// is tracked by a per-batch latch so unrelated batches on the same pool don't wait on each other.
+		class parallel_batch
+		{
+			// construction
+		public:
+			parallel_batch(std::size_t aCount, std::size_t aMinChunk, std::size_t aParticipants) :
+				iCount{ aCount }, 
+				iMinChunk{ std::max<std::size_t>(aMinChunk, 1) }, 
+				iDivisor{ std::max<std::size_t>(aParticipants, 1) * 2 }, 
+				iNext{ 0 }, 
+				iLatch{ static_cast<std::ptrdiff_t>(aCount) }
+			{
+			}
+			// operations
+		public:
+			bool claim(std::size_t& aBegin, std::size_t& aEnd)
+			{
+				std::size_t next = iNext.load(std::memory_order_relaxed);
+				for (;;)
+				{
+					if (next >= iCount)
+						return false;
+					std::size_t end = std::min(iCount, next + std::max(iMinChunk, (iCount - next) / iDivisor));
+					if (iNext.compare_exchange_weak(next, end, std::memory_order_relaxed))
+					{
+						aBegin = next;
+						aEnd = end;
+						return true;
+					}
+				}
+			}
+			// process an already claimed chunk then keep claiming; aFinish runs before the work is counted as done
+			template <typename ChunkFunction, typename FinishFunction>
+			void participate(std::size_t aBegin, std::size_t aEnd, ChunkFunction&& aChunk, FinishFunction&& aFinish)
+			{
+				std::size_t claimed = 0;
+				try
+				{
+					do
+					{
+						claimed += aEnd - aBegin;
+						aChunk(aBegin, aEnd);
+					} while (claim(aBegin, aEnd));
+					aFinish();
+				}
+				catch (...)
+				{
+					fail(std::current_exception());
+				}
+				iLatch.count_down(static_cast<std::ptrdiff_t>(claimed));
+			}
+			void wait()
+			{
+				iLatch.wait();
+				if (iException)
+					std::rethrow_exception(iException);
+			}
+		private:
+			void fail(std::exception_ptr aException)
+			{
+				{
+					std::lock_guard<std::mutex> lk(iMutex);
+					if (!iException)
+						iException = aException;
+				}
+				// nobody will process what is left so account for it here
+				std::size_t next = iNext.exchange(iCount, std::memory_order_relaxed);
+				if (next < iCount)
+					iLatch.count_down(static_cast<std::ptrdiff_t>(iCount - next));
+			}
+			// attributes
+		private:
+			const std::size_t iCount;
+			const std::size_t iMinChunk;
+			const std::size_t iDivisor;
+			std::atomic<std::size_t> iNext;
+			latch iLatch;
+			std::mutex iMutex;
+			std::exception_ptr iException;
+		};
+
+		inline std::size_t parallel_grain_size(std::size_t aCount, std::size_t aThreads)
+		{
+			return std::max<std::size_t>(1, std::min<std::size_t>(4096, aCount / (std::max<std::size_t>(aThreads, 1) * 16)));
+		}
+
+		// aParticipant(batch, begin, end) is only invoked once a chunk has been claimed so helpers that start
+		// after the batch has drained never touch the caller's frame.
+		template <typename Participant>
+		inline void parallel_run(thread_pool& aThreadPool, std::size_t aCount, std::size_t aGrainSize, Participant&& aParticipant)
+		{
+			if (aCount == 0)
+				return;
+			const std::size_t threads = aThreadPool.max_threads();
+			const std::size_t grainSize = (aGrainSize != 0 ? aGrainSize : parallel_grain_size(aCount, threads));
+			const std::size_t helpers = std::min(threads, (aCount + grainSize - 1) / grainSize - 1);
+			auto batch = std::allocate_shared<parallel_batch>(task_allocator<parallel_batch>{}, aCount, grainSize, helpers + 1);
+			for (std::size_t i = 0; i < helpers; ++i)
+				aThreadPool.post([batch, &aParticipant]()
+				{
+					std::size_t begin, end;
+					if (batch->claim(begin, end))
+						aParticipant(*batch, begin, end);
+				});
+			std::size_t begin, end;
+			if (batch->claim(begin, end))
+				aParticipant(*batch, begin, end);
+			batch->wait();
+		}
+
+		template <typename RandomIt, typename T, typename BinaryOp, typename UnaryOp>
+		inline T parallel_transform_reduce(thread_pool& aThreadPool, RandomIt aFirst, RandomIt aLast, T aInit, BinaryOp aReduce, UnaryOp aTransform, std::size_t aGrainSize)
+		{
+			std::optional<T> result;
+			std::mutex resultMutex;
+			parallel_run(aThreadPool, static_cast<std::size_t>(std::distance(aFirst, aLast)), aGrainSize, 
+				[&](parallel_batch& aBatch, std::size_t aBegin, std::size_t aEnd)
+			{
+				std::optional<T> partial;
+				aBatch.participate(aBegin, aEnd, 
+					[&](std::size_t aChunkBegin, std::size_t aChunkEnd)
+				{
+					std::size_t i = aChunkBegin;
+					if (!partial)
+						partial.emplace(aTransform(aFirst[i++]));
+					for (; i < aChunkEnd; ++i)
+						*partial = aReduce(std::move(*partial), aTransform(aFirst[i]));
+				}, 
+					[&]()
+				{
+					std::lock_guard<std::mutex> lk(resultMutex);
+					if (!result)
+						result.emplace(std::move(*partial));
+					else
+						*result = aReduce(std::move(*result), std::move(*partial));
+				});
+			});
+			return result ? aReduce(std::move(aInit), std::move(*result)) : aInit;
+		}
+	}
+
+	// Calls aFunction(i) for each i in [aFirst, aLast) on the default thread pool.
+	template <typename Index, typename Function>
+	inline void parallel_for(Index aFirst, Index aLast, Function aFunction, std::size_t aGrainSize = 0)
+	{
+		if (aLast <= aFirst)
+			return;
+		detail::parallel_run(thread_pool::default_thread_pool(), static_cast<std::size_t>(aLast - aFirst), aGrainSize, 
+			[&](detail::parallel_batch& aBatch, std::size_t aBegin, std::size_t aEnd)
+		{
+			aBatch.participate(aBegin, aEnd, 
+				[&](std::size_t aChunkBegin, std::size_t aChunkEnd)
+			{
+				for (std::size_t i = aChunkBegin; i < aChunkEnd; ++i)
+					aFunction(static_cast<Index>(aFirst + i));
+			}, []() {});
+		});
+	}
+
+	template <typename RandomIt, typename Function>
+	inline void parallel_for_each(RandomIt aFirst, RandomIt aLast, Function aFunction, std::size_t aGrainSize = 0)
+	{
+		detail::parallel_run(thread_pool::default_thread_pool(), static_cast<std::size_t>(std::distance(aFirst, aLast)), aGrainSize, 
+			[&](detail::parallel_batch& aBatch, std::size_t aBegin, std::size_t aEnd)
+		{
+			aBatch.participate(aBegin, aEnd, 
+				[&](std::size_t aChunkBegin, std::size_t aChunkEnd)
+			{
+				for (auto i = aFirst + aChunkBegin, end = aFirst + aChunkEnd; i != end; ++i)
+					aFunction(*i);
+			}, []() {});
+		});
+	}
+
+	template <typename RandomIt, typename OutputRandomIt, typename UnaryOp>
+	inline OutputRandomIt parallel_transform(RandomIt aFirst, RandomIt aLast, OutputRandomIt aDestination, UnaryOp aOperation, std::size_t aGrainSize = 0)
+	{
+		const std::size_t count = static_cast<std::size_t>(std::distance(aFirst, aLast));
+		detail::parallel_run(thread_pool::default_thread_pool(), count, aGrainSize, 
+			[&](detail::parallel_batch& aBatch, std::size_t aBegin, std::size_t aEnd)
+		{
+			aBatch.participate(aBegin, aEnd, 
+				[&](std::size_t aChunkBegin, std::size_t aChunkEnd)
+			{
+				std::transform(aFirst + aChunkBegin, aFirst + aChunkEnd, aDestination + aChunkBegin, aOperation);
+			}, []() {});
+		});
+		return aDestination + count;
+	}
+
+	// As with std::reduce the operation must be associative and commutative as partial results are combined in no particular order.
+	template <typename RandomIt, typename T, typename BinaryOp, typename UnaryOp>
+	inline T parallel_transform_reduce(RandomIt aFirst, RandomIt aLast, T aInit, BinaryOp aReduce, UnaryOp aTransform, std::size_t aGrainSize = 0)
+	{
+		return detail::parallel_transform_reduce(thread_pool::default_thread_pool(), aFirst, aLast, std::move(aInit), aReduce, aTransform, aGrainSize);
+	}
+
+	template <typename RandomIt, typename T, typename BinaryOp = std::plus<>>
+	inline T parallel_reduce(RandomIt aFirst, RandomIt aLast, T aInit, BinaryOp aReduce = BinaryOp{}, std::size_t aGrainSize = 0)
+	{
+		return detail::parallel_transform_reduce(thread_pool::default_thread_pool(), aFirst, aLast, std::move(aInit), aReduce, 
+			[](const typename std::iterator_traits<RandomIt>::value_type& aValue) -> const typename std::iterator_traits<RandomIt>::value_type& { return aValue; }, aGrainSize);
+	}
+
+	// Hands disjoint runs of [aFirst, aLast) to aFunction(span) on the default thread pool. aContainer must provide
+	// for_each_segment() (segmented_array, tag_array); aFunction is shared by all workers and is called concurrently.
+	template <typename Container, typename Iterator, typename Function>
+	inline void parallel_for_each_segment(Container& aContainer, Iterator aFirst, Iterator aLast, Function aFunction, std::size_t aGrainSize = 0)
+	{
+		detail::parallel_run(thread_pool::default_thread_pool(), static_cast<std::size_t>(std::distance(aFirst, aLast)), aGrainSize, 
+			[&](detail::parallel_batch& aBatch, std::size_t aBegin, std::size_t aEnd)
+		{
+			aBatch.participate(aBegin, aEnd, 
+				[&](std::size_t aChunkBegin, std::size_t aChunkEnd)
+			{
+				aContainer.for_each_segment(aFirst + aChunkBegin, aFirst + aChunkEnd, std::ref(aFunction));
+			}, []() {});
+		});
+	}
+
+	// Each worker folds the spans it claims into a partial that starts as aIdentity using aFold(T, span); partials are
+	// then combined with aReduce in no particular order so aIdentity must be an identity of aReduce.
+	template <typename Container, typename Iterator, typename T, typename BinaryOp, typename Fold>
+	inline T parallel_reduce_segments(Container& aContainer, Iterator aFirst, Iterator aLast, T aIdentity, BinaryOp aReduce, Fold aFold, std::size_t aGrainSize = 0)
+	{
+		T result = aIdentity;
+		std::mutex resultMutex;
+		detail::parallel_run(thread_pool::default_thread_pool(), static_cast<std::size_t>(std::distance(aFirst, aLast)), aGrainSize, 
+			[&](detail::parallel_batch& aBatch, std::size_t aBegin, std::size_t aEnd)
+		{
+			T partial = aIdentity;
+			aBatch.participate(aBegin, aEnd, 
+				[&](std::size_t aChunkBegin, std::size_t aChunkEnd)
+			{
+				aContainer.for_each_segment(aFirst + aChunkBegin, aFirst + aChunkEnd, [&](auto aSpan) { partial = aFold(std::move(partial), aSpan); });
+			}, 
+				[&]()
+			{
+				std::lock_guard<std::mutex> lk(resultMutex);
+				result = aReduce(std::move(result), std::move(partial));
+			});
+		});
+		return result;
+	}
+
+	// Sorts equal slices in parallel then merges neighbouring slices pairwise, a round at a time.
+	template <typename RandomIt, typename Compare>
+	inline void parallel_sort(RandomIt aFirst, RandomIt aLast, Compare aCompare)
+	{
+		const std::size_t SerialThreshold = 16384;
+		const std::size_t count = static_cast<std::size_t>(std::distance(aFirst, aLast));
+		const std::size_t threads = thread_pool::default_thread_pool().max_threads();
+		if (count < SerialThreshold || threads < 2)
+		{
+			std::sort(aFirst, aLast, aCompare);
+			return;
+		}
+		std::size_t slices = 2;
+		while (slices < threads && count / (slices * 2) >= SerialThreshold / 2)
+			slices *= 2;
+		std::vector<std::size_t> bounds(slices + 1);
+		for (std::size_t i = 0; i <= slices; ++i)
+			bounds[i] = count * i / slices;
+		parallel_for(std::size_t{ 0 }, slices, [&](std::size_t aSlice)
+		{
+			std::sort(aFirst + bounds[aSlice], aFirst + bounds[aSlice + 1], aCompare);
+		}, 1);
+		for (std::size_t width = 1; width < slices; width *= 2)
+			parallel_for(std::size_t{ 0 }, slices / (width * 2), [&](std::size_t aPair)
+			{
+				const std::size_t left = aPair * width * 2;
+				std::inplace_merge(aFirst + bounds[left], aFirst + bounds[left + width], aFirst + bounds[left + width * 2], aCompare);
+			}, 1);
+	}
+
+	template <typename RandomIt>
+	inline void parallel_sort(RandomIt aFirst, RandomIt aLast)
+	{
+		parallel_sort(aFirst, aLast, std::less<>{});
+	}
+}
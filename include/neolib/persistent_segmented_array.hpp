@@ -0,0 +1,660 @@
+// persistent_segmented_array.hpp
+/*
+ *  Copyright (c) 2018 Leigh Johnston.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *     * Neither the name of Leigh Johnston nor the names of any
+ *       other contributors to this software may be used to endorse or
+ *       promote products derived from this software without specific prior
+ *       written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ *  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include "neolib.hpp"
+#include <memory>
+#include <atomic>
+#include <iterator>
+#include <algorithm>
+#include <stdexcept>
+#include "vecarray.hpp"
+#include "span.hpp"
+
+namespace neolib
+{
+	/* Copy-on-write counterpart to segmented_array. Segments are the leaves of a B+-tree whose inner nodes keep a
+	   per-child element count (as array_btree) but nodes carry no parent or sibling links so that any node can be
+	   shared between versions; every node is reference counted. Copying (snapshot()) is O(1). A mutation copies the
+	   nodes on the path to the affected segment that are still shared with another version and updates uniquely
+	   owned nodes in place, so a reader holding its own snapshot never sees a node change under it. */
+	template <typename T, std::size_t SegmentSize = 64, typename Alloc = std::allocator<T> >
+	class persistent_segmented_array
+	{
+	public:
+		typedef T value_type;
+		typedef Alloc allocator_type;
+		typedef typename allocator_type::const_reference const_reference;
+		typedef typename allocator_type::const_pointer const_pointer;
+		typedef typename allocator_type::size_type size_type;
+		typedef typename allocator_type::difference_type difference_type;
+	public:
+		static constexpr size_type InnerNodeCapacity = 64 / sizeof(size_type);
+	private:
+		typedef neolib::vecarray<T, SegmentSize, SegmentSize, neolib::nocheck> segment_type;
+		struct node
+		{
+			node() : 
+				iReferenceCount{ 1 }
+			{
+			}
+			std::atomic<std::size_t> iReferenceCount;
+		};
+		struct leaf : node
+		{
+			leaf()
+			{
+			}
+			leaf(const leaf& aOther) :
+				iSegment{ aOther.iSegment }
+			{
+			}
+			segment_type iSegment;
+		};
+		struct alignas(64) inner : node
+		{
+			inner() :
+				iCount{ 0 }, iCounts{}, iChildren{}
+			{
+			}
+			size_type iCount;
+			alignas(64) size_type iCounts[InnerNodeCapacity];
+			node* iChildren[InnerNodeCapacity];
+		};
+		typedef typename allocator_type:: template rebind<leaf>::other leaf_allocator_type;
+		typedef typename allocator_type:: template rebind<inner>::other inner_allocator_type;
+	public:
+		class const_iterator : public std::iterator<std::random_access_iterator_tag, value_type, difference_type, const_pointer, const_reference>
+		{
+			friend class persistent_segmented_array;
+
+		public:
+			const_iterator() :
+				iContainer{ nullptr }, iLeaf{ nullptr }, iPosition{ 0 }, iLeafStart{ 0 }
+			{
+			}
+		private:
+			const_iterator(const persistent_segmented_array& aContainer, size_type aPosition) :
+				iContainer{ &aContainer }, iLeaf{ nullptr }, iPosition{ aPosition }, iLeafStart{ 0 }
+			{
+				locate();
+			}
+
+		public:
+			const_iterator& operator++()
+			{
+				if (++iPosition - iLeafStart >= iLeaf->iSegment.size())
+					locate();
+				return *this;
+			}
+			const_iterator& operator--()
+			{
+				if (iPosition-- == iLeafStart || iLeaf == nullptr)
+					locate();
+				return *this;
+			}
+			const_iterator operator++(int) { const_iterator ret(*this); operator++(); return ret; }
+			const_iterator operator--(int) { const_iterator ret(*this); operator--(); return ret; }
+			const_iterator& operator+=(difference_type aDifference)
+			{
+				iPosition += aDifference;
+				if (iLeaf == nullptr || iPosition < iLeafStart || iPosition - iLeafStart >= iLeaf->iSegment.size())
+					locate();
+				return *this;
+			}
+			const_iterator& operator-=(difference_type aDifference) { return operator+=(-aDifference); }
+			const_iterator operator+(difference_type aDifference) const { const_iterator result(*this); result += aDifference; return result; }
+			const_iterator operator-(difference_type aDifference) const { const_iterator result(*this); result -= aDifference; return result; }
+			const_reference operator[](difference_type aDifference) const { return *((*this) + aDifference); }
+			difference_type operator-(const const_iterator& aOther) const { return static_cast<difference_type>(iPosition) - static_cast<difference_type>(aOther.iPosition); }
+			const_reference operator*() const { return iLeaf->iSegment[iPosition - iLeafStart]; }
+			const_pointer operator->() const { return &operator*(); }
+			bool operator==(const const_iterator& aOther) const { return iPosition == aOther.iPosition; }
+			bool operator!=(const const_iterator& aOther) const { return iPosition != aOther.iPosition; }
+			bool operator<(const const_iterator& aOther) const { return iPosition < aOther.iPosition; }
+			bool operator<=(const const_iterator& aOther) const { return iPosition <= aOther.iPosition; }
+			bool operator>(const const_iterator& aOther) const { return iPosition > aOther.iPosition; }
+			bool operator>=(const const_iterator& aOther) const { return iPosition >= aOther.iPosition; }
+
+		private:
+			void locate()
+			{
+				if (iPosition < iContainer->size())
+				{
+					size_type offset;
+					iLeaf = iContainer->find_leaf(iPosition, offset);
+					iLeafStart = iPosition - offset;
+				}
+				else
+				{
+					iLeaf = nullptr;
+					iLeafStart = iPosition;
+				}
+			}
+
+		private:
+			const persistent_segmented_array* iContainer;
+			const leaf* iLeaf;
+			size_type iPosition;
+			size_type iLeafStart;
+		};
+		typedef const_iterator iterator;
+		typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+		typedef const_reverse_iterator reverse_iterator;
+
+	public:
+		persistent_segmented_array(const Alloc& aAllocator = Alloc()) :
+			iLeafAllocator(aAllocator), iInnerAllocator(aAllocator), iRoot(nullptr), iHeight(0), iSize(0)
+		{
+		}
+		persistent_segmented_array(const size_type aCount, const value_type& aValue, const Alloc& aAllocator = Alloc()) :
+			iLeafAllocator(aAllocator), iInnerAllocator(aAllocator), iRoot(nullptr), iHeight(0), iSize(0)
+		{
+			for (size_type i = 0; i < aCount; ++i)
+				push_back(aValue);
+		}
+		template <typename InputIterator>
+		persistent_segmented_array(InputIterator aFirst, InputIterator aLast, const Alloc& aAllocator = Alloc()) :
+			iLeafAllocator(aAllocator), iInnerAllocator(aAllocator), iRoot(nullptr), iHeight(0), iSize(0)
+		{
+			for (; aFirst != aLast; ++aFirst)
+				push_back(*aFirst);
+		}
+		persistent_segmented_array(const persistent_segmented_array& aOther) :
+			iLeafAllocator(aOther.iLeafAllocator), iInnerAllocator(aOther.iInnerAllocator), iRoot(acquire(aOther.iRoot)), iHeight(aOther.iHeight), iSize(aOther.iSize)
+		{
+		}
+		persistent_segmented_array(persistent_segmented_array&& aOther) :
+			iLeafAllocator(aOther.iLeafAllocator), iInnerAllocator(aOther.iInnerAllocator), iRoot(aOther.iRoot), iHeight(aOther.iHeight), iSize(aOther.iSize)
+		{
+			aOther.iRoot = nullptr;
+			aOther.iHeight = 0;
+			aOther.iSize = 0;
+		}
+		~persistent_segmented_array()
+		{
+			release(iRoot, iHeight);
+		}
+		persistent_segmented_array& operator=(const persistent_segmented_array& aOther)
+		{
+			persistent_segmented_array newContents(aOther);
+			newContents.swap(*this);
+			return *this;
+		}
+		persistent_segmented_array& operator=(persistent_segmented_array&& aOther)
+		{
+			persistent_segmented_array newContents(std::move(aOther));
+			newContents.swap(*this);
+			return *this;
+		}
+
+	public:
+		// An independent version sharing all of this version's storage; O(1) and safe to hand to another thread.
+		persistent_segmented_array snapshot() const
+		{
+			return *this;
+		}
+		size_type size() const
+		{
+			return iSize;
+		}
+		bool empty() const
+		{
+			return iSize == 0;
+		}
+		const_iterator begin() const
+		{
+			return const_iterator(*this, 0);
+		}
+		const_iterator end() const
+		{
+			return const_iterator(*this, iSize);
+		}
+		const_reverse_iterator rbegin() const
+		{
+			return const_reverse_iterator(end());
+		}
+		const_reverse_iterator rend() const
+		{
+			return const_reverse_iterator(begin());
+		}
+		const_reference front() const
+		{
+			return (*this)[0];
+		}
+		const_reference back() const
+		{
+			return (*this)[iSize - 1];
+		}
+		const_reference operator[](size_type aIndex) const
+		{
+			size_type offset;
+			return find_leaf(aIndex, offset)->iSegment[offset];
+		}
+		const_reference at(size_type aIndex) const
+		{
+			if (aIndex < iSize)
+				return (*this)[aIndex];
+			throw std::out_of_range("neolib::persistent_segmented_array::at");
+		}
+		void set(size_type aIndex, const value_type& aValue)
+		{
+			node** slot = &iRoot;
+			for (size_type height = iHeight; height > 0; --height)
+			{
+				inner& parent = unique_inner(*slot, height);
+				size_type child = 0;
+				for (; aIndex >= parent.iCounts[child]; ++child)
+					aIndex -= parent.iCounts[child];
+				slot = &parent.iChildren[child];
+			}
+			unique_leaf(*slot).iSegment[aIndex] = aValue;
+		}
+		const_iterator insert(const_iterator aPosition, const value_type& aValue)
+		{
+			insert(aPosition.iPosition, aValue);
+			return const_iterator(*this, aPosition.iPosition);
+		}
+		template <class InputIterator>
+		typename std::enable_if<!std::is_integral<InputIterator>::value, const_iterator>::type
+		insert(const_iterator aPosition, InputIterator aFirst, InputIterator aLast)
+		{
+			size_type index = aPosition.iPosition;
+			for (; aFirst != aLast; ++aFirst)
+				insert(index++, *aFirst);
+			return const_iterator(*this, aPosition.iPosition);
+		}
+		void insert(size_type aIndex, const value_type& aValue)
+		{
+			if (iRoot == nullptr)
+			{
+				leaf* newLeaf = allocate_leaf();
+				try
+				{
+					newLeaf->iSegment.push_back(aValue);
+				}
+				catch (...)
+				{
+					release(newLeaf, 0);
+					throw;
+				}
+				iRoot = newLeaf;
+			}
+			else
+			{
+				size_type siblingCount = 0;
+				node* sibling = insert(iRoot, iHeight, aIndex, aValue, aIndex == iSize, siblingCount);
+				if (sibling != nullptr)
+				{
+					inner* newRoot = allocate_inner();
+					newRoot->iCount = 2;
+					newRoot->iChildren[0] = iRoot;
+					newRoot->iCounts[0] = iSize + 1 - siblingCount;
+					newRoot->iChildren[1] = sibling;
+					newRoot->iCounts[1] = siblingCount;
+					iRoot = newRoot;
+					++iHeight;
+				}
+			}
+			++iSize;
+		}
+		const_iterator erase(const_iterator aPosition)
+		{
+			erase(aPosition.iPosition);
+			return const_iterator(*this, aPosition.iPosition);
+		}
+		const_iterator erase(const_iterator aFirst, const_iterator aLast)
+		{
+			for (size_type count = aLast.iPosition - aFirst.iPosition; count > 0; --count)
+				erase(aFirst.iPosition);
+			return const_iterator(*this, aFirst.iPosition);
+		}
+		void erase(size_type aIndex)
+		{
+			erase(iRoot, iHeight, aIndex);
+			if (--iSize == 0)
+			{
+				release(iRoot, iHeight);
+				iRoot = nullptr;
+				iHeight = 0;
+				return;
+			}
+			while (iHeight > 0 && static_cast<inner*>(iRoot)->iCount == 1)
+			{
+				inner& root = unique_inner(iRoot, iHeight);
+				node* child = root.iChildren[0];
+				root.iCount = 0;
+				release(iRoot, iHeight);
+				iRoot = child;
+				--iHeight;
+			}
+		}
+		void push_front(const value_type& aValue)
+		{
+			insert(size_type{ 0 }, aValue);
+		}
+		void push_back(const value_type& aValue)
+		{
+			insert(iSize, aValue);
+		}
+		void pop_front()
+		{
+			erase(size_type{ 0 });
+		}
+		void pop_back()
+		{
+			erase(iSize - 1);
+		}
+		void clear()
+		{
+			release(iRoot, iHeight);
+			iRoot = nullptr;
+			iHeight = 0;
+			iSize = 0;
+		}
+		void swap(persistent_segmented_array& aOther)
+		{
+			std::swap(iLeafAllocator, aOther.iLeafAllocator);
+			std::swap(iInnerAllocator, aOther.iInnerAllocator);
+			std::swap(iRoot, aOther.iRoot);
+			std::swap(iHeight, aOther.iHeight);
+			std::swap(iSize, aOther.iSize);
+		}
+		template <typename Function>
+		void for_each_segment(const_iterator aFirst, const_iterator aLast, Function aFunction) const
+		{
+			if (aFirst.iPosition < aLast.iPosition)
+				visit(iRoot, iHeight, aFirst.iPosition, aLast.iPosition, aFunction);
+		}
+		template <typename Function>
+		void for_each_segment(Function aFunction) const
+		{
+			for_each_segment(begin(), end(), aFunction);
+		}
+
+	private:
+		const leaf* find_leaf(size_type aIndex, size_type& aOffset) const
+		{
+			const node* x = iRoot;
+			for (size_type height = iHeight; height > 0; --height)
+			{
+				const inner& parent = *static_cast<const inner*>(x);
+				size_type child = 0;
+				for (; aIndex >= parent.iCounts[child]; ++child)
+					aIndex -= parent.iCounts[child];
+				x = parent.iChildren[child];
+			}
+			aOffset = aIndex;
+			return static_cast<const leaf*>(x);
+		}
+		// Inserts into the subtree in aSlot; if the node there had to split its new right sibling is returned.
+		node* insert(node*& aSlot, size_type aHeight, size_type aIndex, const value_type& aValue, bool aAppend, size_type& aSiblingCount)
+		{
+			if (aHeight == 0)
+			{
+				segment_type& segment = unique_leaf(aSlot).iSegment;
+				if (segment.size() < SegmentSize)
+				{
+					segment.insert(segment.begin() + aIndex, aValue);
+					return nullptr;
+				}
+				/* appending to the array leaves the full segment alone so that sequential growth packs segments */
+				const size_type keep = (aAppend ? SegmentSize : SegmentSize / 2);
+				leaf* sibling = allocate_leaf();
+				try
+				{
+					if (aIndex <= keep && keep < SegmentSize)
+					{
+						sibling->iSegment.insert(sibling->iSegment.end(), segment.begin() + keep, segment.end());
+						segment.erase(segment.begin() + keep, segment.end());
+						segment.insert(segment.begin() + aIndex, aValue);
+					}
+					else
+					{
+						sibling->iSegment.insert(sibling->iSegment.end(), segment.begin() + keep, segment.begin() + aIndex);
+						sibling->iSegment.push_back(aValue);
+						sibling->iSegment.insert(sibling->iSegment.end(), segment.begin() + aIndex, segment.end());
+						segment.erase(segment.begin() + keep, segment.end());
+					}
+				}
+				catch (...)
+				{
+					release(sibling, 0);
+					throw;
+				}
+				aSiblingCount = sibling->iSegment.size();
+				return sibling;
+			}
+			inner& parent = unique_inner(aSlot, aHeight);
+			size_type child = 0;
+			for (; child + 1 < parent.iCount && aIndex > parent.iCounts[child]; ++child)
+				aIndex -= parent.iCounts[child];
+			size_type newChildCount = 0;
+			node* newChild = insert(parent.iChildren[child], aHeight - 1, aIndex, aValue, aAppend, newChildCount);
+			++parent.iCounts[child];
+			if (newChild == nullptr)
+				return nullptr;
+			parent.iCounts[child] -= newChildCount;
+			if (parent.iCount < InnerNodeCapacity)
+			{
+				insert_child(parent, child + 1, newChild, newChildCount);
+				return nullptr;
+			}
+			const size_type keep = (child + 1 == InnerNodeCapacity ? InnerNodeCapacity : InnerNodeCapacity / 2);
+			inner* sibling = allocate_inner();
+			for (size_type moved = keep; moved < parent.iCount; ++moved)
+				insert_child(*sibling, sibling->iCount, parent.iChildren[moved], parent.iCounts[moved]);
+			parent.iCount = keep;
+			if (child + 1 <= keep && keep < InnerNodeCapacity)
+				insert_child(parent, child + 1, newChild, newChildCount);
+			else
+				insert_child(*sibling, child + 1 - keep, newChild, newChildCount);
+			aSiblingCount = 0;
+			for (size_type i = 0; i < sibling->iCount; ++i)
+				aSiblingCount += sibling->iCounts[i];
+			return sibling;
+		}
+		void erase(node*& aSlot, size_type aHeight, size_type aIndex)
+		{
+			if (aHeight == 0)
+			{
+				segment_type& segment = unique_leaf(aSlot).iSegment;
+				segment.erase(segment.begin() + aIndex);
+				return;
+			}
+			inner& parent = unique_inner(aSlot, aHeight);
+			size_type child = 0;
+			for (; aIndex >= parent.iCounts[child]; ++child)
+				aIndex -= parent.iCounts[child];
+			erase(parent.iChildren[child], aHeight - 1, aIndex);
+			--parent.iCounts[child];
+			rebalance(parent, child, aHeight - 1);
+		}
+		// Drops an emptied child or merges an underfull one into a neighbour when the two fit in one node.
+		void rebalance(inner& aParent, size_type aChild, size_type aChildHeight)
+		{
+			const size_type capacity = (aChildHeight == 0 ? SegmentSize : InnerNodeCapacity);
+			const size_type used = fill(aParent.iChildren[aChild], aChildHeight);
+			if (used == 0)
+			{
+				release(aParent.iChildren[aChild], aChildHeight);
+				remove_child(aParent, aChild);
+				return;
+			}
+			if (used >= capacity / 2 || aParent.iCount == 1)
+				return;
+			const size_type left = (aChild > 0 ? aChild - 1 : aChild);
+			const size_type right = left + 1;
+			if (fill(aParent.iChildren[left], aChildHeight) + fill(aParent.iChildren[right], aChildHeight) > capacity)
+				return;
+			if (aChildHeight == 0)
+			{
+				segment_type& target = unique_leaf(aParent.iChildren[left]).iSegment;
+				const segment_type& source = static_cast<leaf*>(aParent.iChildren[right])->iSegment;
+				target.insert(target.end(), source.begin(), source.end());
+			}
+			else
+			{
+				inner& target = unique_inner(aParent.iChildren[left], aChildHeight);
+				const inner& source = *static_cast<inner*>(aParent.iChildren[right]);
+				for (size_type i = 0; i < source.iCount; ++i)
+					insert_child(target, target.iCount, acquire(source.iChildren[i]), source.iCounts[i]);
+			}
+			aParent.iCounts[left] += aParent.iCounts[right];
+			release(aParent.iChildren[right], aChildHeight);
+			remove_child(aParent, right);
+		}
+		static size_type fill(const node* aNode, size_type aHeight)
+		{
+			return aHeight == 0 ? static_cast<const leaf*>(aNode)->iSegment.size() : static_cast<const inner*>(aNode)->iCount;
+		}
+		static void insert_child(inner& aParent, size_type aIndex, node* aChild, size_type aCount)
+		{
+			for (size_type i = aParent.iCount; i > aIndex; --i)
+			{
+				aParent.iChildren[i] = aParent.iChildren[i - 1];
+				aParent.iCounts[i] = aParent.iCounts[i - 1];
+			}
+			aParent.iChildren[aIndex] = aChild;
+			aParent.iCounts[aIndex] = aCount;
+			++aParent.iCount;
+		}
+		static void remove_child(inner& aParent, size_type aIndex)
+		{
+			--aParent.iCount;
+			for (size_type i = aIndex; i < aParent.iCount; ++i)
+			{
+				aParent.iChildren[i] = aParent.iChildren[i + 1];
+				aParent.iCounts[i] = aParent.iCounts[i + 1];
+			}
+		}
+		template <typename Function>
+		static void visit(const node* aNode, size_type aHeight, size_type aBegin, size_type aEnd, Function& aFunction)
+		{
+			if (aHeight == 0)
+			{
+				const segment_type& segment = static_cast<const leaf*>(aNode)->iSegment;
+				aFunction(span<const value_type>{ &segment[aBegin], aEnd - aBegin });
+				return;
+			}
+			const inner& parent = *static_cast<const inner*>(aNode);
+			size_type start = 0;
+			for (size_type child = 0; child < parent.iCount && start < aEnd; start += parent.iCounts[child++])
+			{
+				const size_type end = start + parent.iCounts[child];
+				if (end > aBegin)
+					visit(parent.iChildren[child], aHeight - 1, std::max(aBegin, start) - start, std::min(aEnd, end) - start, aFunction);
+			}
+		}
+		// A node is only ever modified while this version is its sole owner; otherwise it is copied first.
+		leaf& unique_leaf(node*& aSlot)
+		{
+			if (aSlot->iReferenceCount.load(std::memory_order_acquire) != 1)
+			{
+				leaf* copy = allocate_leaf(*static_cast<leaf*>(aSlot));
+				release(aSlot, 0);
+				aSlot = copy;
+			}
+			return *static_cast<leaf*>(aSlot);
+		}
+		inner& unique_inner(node*& aSlot, size_type aHeight)
+		{
+			if (aSlot->iReferenceCount.load(std::memory_order_acquire) != 1)
+			{
+				const inner& original = *static_cast<inner*>(aSlot);
+				inner* copy = allocate_inner();
+				for (size_type i = 0; i < original.iCount; ++i)
+					insert_child(*copy, i, acquire(original.iChildren[i]), original.iCounts[i]);
+				release(aSlot, aHeight);
+				aSlot = copy;
+			}
+			return *static_cast<inner*>(aSlot);
+		}
+		static node* acquire(node* aNode)
+		{
+			if (aNode != nullptr)
+				aNode->iReferenceCount.fetch_add(1, std::memory_order_relaxed);
+			return aNode;
+		}
+		void release(node* aNode, size_type aHeight)
+		{
+			if (aNode == nullptr || aNode->iReferenceCount.fetch_sub(1, std::memory_order_acq_rel) != 1)
+				return;
+			if (aHeight == 0)
+			{
+				leaf* garbage = static_cast<leaf*>(aNode);
+				std::allocator_traits<leaf_allocator_type>::destroy(iLeafAllocator, garbage);
+				std::allocator_traits<leaf_allocator_type>::deallocate(iLeafAllocator, garbage, 1);
+			}
+			else
+			{
+				inner* garbage = static_cast<inner*>(aNode);
+				for (size_type i = 0; i < garbage->iCount; ++i)
+					release(garbage->iChildren[i], aHeight - 1);
+				std::allocator_traits<inner_allocator_type>::destroy(iInnerAllocator, garbage);
+				std::allocator_traits<inner_allocator_type>::deallocate(iInnerAllocator, garbage, 1);
+			}
+		}
+		template <typename... Args>
+		leaf* allocate_leaf(Args&&... aArguments)
+		{
+			leaf* newLeaf = std::allocator_traits<leaf_allocator_type>::allocate(iLeafAllocator, 1);
+			try
+			{
+				std::allocator_traits<leaf_allocator_type>::construct(iLeafAllocator, newLeaf, std::forward<Args>(aArguments)...);
+			}
+			catch (...)
+			{
+				std::allocator_traits<leaf_allocator_type>::deallocate(iLeafAllocator, newLeaf, 1);
+				throw;
+			}
+			return newLeaf;
+		}
+		inner* allocate_inner()
+		{
+			inner* newInner = std::allocator_traits<inner_allocator_type>::allocate(iInnerAllocator, 1);
+			std::allocator_traits<inner_allocator_type>::construct(iInnerAllocator, newInner);
+			return newInner;
+		}
+
+	private:
+		leaf_allocator_type iLeafAllocator;
+		inner_allocator_type iInnerAllocator;
+		node* iRoot;
+		size_type iHeight;
+		size_type iSize;
+	};
+}
@@ -962,7 +962,7 @@ namespace std
 	{
 		std::size_t operator()(const neolib::basic_quick_string<charT, Traits, Alloc>& sv) const noexcept
 		{
-			return neolib::fast_hash(&*sv.as_view().cbegin(), sv.size());
+			return neolib::fast_hash<std::size_t>(sv.data(), sv.size() * sizeof(charT));
 		}
 	};
 }
\ No newline at end of file
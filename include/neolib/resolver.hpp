@@ -41,6 +41,7 @@
 #include <memory>
 #include <boost/bind.hpp>
 #include "async_task.hpp"
+#include "resumer.hpp"
 
 namespace neolib
 {
@@ -143,6 +144,59 @@ namespace neolib
 		};
 		typedef std::shared_ptr<request> request_pointer;
 		typedef std::vector<request_pointer> request_list;
+		// co_await resolver.resolve(host) yields the resolved host or throws boost::system::system_error
+		class resolve_awaiter : private requester
+		{
+		public:
+			resolve_awaiter(basic_resolver<Protocol>& aParent, const std::string& aHostName, neolib::protocol_family aProtocolFamily) :
+				iParent(aParent), iHostName(aHostName), iProtocolFamily(aProtocolFamily), iResolved(false)
+			{
+			}
+			resolve_awaiter(const resolve_awaiter&) = delete;
+			~resolve_awaiter()
+			{
+				iParent.remove_requester(*this);
+			}
+		public:
+			bool await_ready() const
+			{
+				return false;
+			}
+			template <typename Handle>
+			void await_suspend(Handle aHandle)
+			{
+				iResumer = resumer{ aHandle };
+				iParent.resolve(*this, iHostName, iProtocolFamily);
+			}
+			iterator await_resume() const
+			{
+				if (!iResolved)
+					throw boost::system::system_error(iError);
+				return iHost;
+			}
+		private:
+			// as with the other networking awaiters the coroutine is resumed from the io task's next event loop
+			// iteration rather than from inside the resolver's completion handler
+			void host_resolved(const std::string&, iterator aHost) override
+			{
+				iResolved = true;
+				iHost = aHost;
+				iParent.iIoTask.resume(iResumer);
+			}
+			void host_not_resolved(const std::string&, const boost::system::error_code& aError) override
+			{
+				iError = aError;
+				iParent.iIoTask.resume(iResumer);
+			}
+		private:
+			basic_resolver<Protocol>& iParent;
+			std::string iHostName;
+			neolib::protocol_family iProtocolFamily;
+			bool iResolved;
+			iterator iHost;
+			boost::system::error_code iError;
+			resumer iResumer;
+		};
 
 		// exceptions
 	public:
@@ -169,7 +223,11 @@ namespace neolib
 			request_pointer newRequest(new request(*this, aRequester, aHostName, aProtocolFamily));
 			iRequests.push_back(newRequest);
 			iResolver.async_resolve(typename resolver_type::query(aHostName, unsigned_integer_to_string<char>(0)),
-				boost::bind(&request::handle_resolve, *newRequest, boost::asio::placeholders::error, boost::asio::placeholders::iterator));
+				boost::bind(&request::handle_resolve, newRequest, boost::asio::placeholders::error, boost::asio::placeholders::iterator));
+		}
+		resolve_awaiter resolve(const std::string& aHostName, protocol_family aProtocolFamily = IPv4orIPv6)
+		{
+			return resolve_awaiter{ *this, aHostName, aProtocolFamily };
 		}
 		void remove_requester(requester& aRequester)
 		{
@@ -182,6 +240,16 @@ namespace neolib
 	private:
 		void handle_resolve(request& aRequest, const boost::system::error_code& aError, iterator aEndPointIterator)
 		{
+			// the request leaves the list before the requester hears about it: a requester (or a coroutine 
+			// resumed by one) is free to destroy this resolver
+			request_pointer finishedRequest;
+			for (typename request_list::iterator i = iRequests.begin(); i != iRequests.end(); ++i)
+				if (&**i == &aRequest)
+				{
+					finishedRequest = *i;
+					iRequests.erase(i);
+					break;
+				}
 			if (aRequest.has_requester())
 			{
 				if (!aError)
@@ -202,12 +270,6 @@ namespace neolib
 				else
 					aRequest.requester().host_not_resolved(aRequest.host_name(), aError);
 			}
-			for (request_list::iterator i = iRequests.begin(); i != iRequests.end(); ++i)
-				if (&**i == &aRequest)
-				{
-					iRequests.erase(i);
-					break;
-				}
 		}
 
 		// attibutes
@@ -0,0 +1,142 @@
+// resumer.hpp
+/*
+ *  Copyright (c) 2018 Leigh Johnston.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *     * Neither the name of Leigh Johnston nor the names of any
+ *       other contributors to this software may be used to endorse or
+ *       promote products derived from this software without specific prior
+ *       written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ *  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include "neolib.hpp"
+#include <cstddef>
+#include <utility>
+#include "task.hpp"
+
+namespace neolib
+{
+	// Type erased coroutine handle: lets awaiters resume their coroutine without this header (or its
+	// users) depending on the coroutine support header.
+	class resumer
+	{
+		// types
+	private:
+		typedef void(*resume_function)(void*);
+		// construction
+	public:
+		resumer() : iAddress{ nullptr }, iResume{ nullptr }
+		{
+		}
+		template <typename Handle>
+		explicit resumer(Handle aHandle) : 
+			iAddress{ aHandle.address() }, iResume{ [](void* aAddress) { Handle::from_address(aAddress).resume(); } }
+		{
+		}
+		// operations
+	public:
+		explicit operator bool() const
+		{
+			return iAddress != nullptr;
+		}
+		void operator()() const
+		{
+			iResume(iAddress);
+		}
+		// attributes
+	private:
+		void* iAddress;
+		resume_function iResume;
+	};
+
+	namespace detail
+	{
+		// Asio completion handler that resumes a coroutine; asio's operation storage for it comes from
+		// the task block slabs rather than the heap.
+		template <typename Awaiter>
+		class completion_handler
+		{
+		public:
+			typedef task_allocator<void> allocator_type;
+		public:
+			explicit completion_handler(Awaiter& aAwaiter) : iAwaiter{ &aAwaiter }
+			{
+			}
+		public:
+			template <typename... Args>
+			void operator()(Args&&... aArgs) const
+			{
+				iAwaiter->complete(std::forward<Args>(aArgs)...);
+			}
+			allocator_type get_allocator() const
+			{
+				return allocator_type{};
+			}
+			friend void* asio_handler_allocate(std::size_t aSize, completion_handler*)
+			{
+				return allocate_task_block(aSize);
+			}
+			friend void asio_handler_deallocate(void* aBlock, std::size_t aSize, completion_handler*)
+			{
+				deallocate_task_block(aBlock, aSize);
+			}
+		private:
+			Awaiter* iAwaiter;
+		};
+
+		class resume_handler
+		{
+		public:
+			typedef task_allocator<void> allocator_type;
+		public:
+			explicit resume_handler(const resumer& aResumer) : iResumer{ aResumer }
+			{
+			}
+		public:
+			void operator()() const
+			{
+				iResumer();
+			}
+			allocator_type get_allocator() const
+			{
+				return allocator_type{};
+			}
+			friend void* asio_handler_allocate(std::size_t aSize, resume_handler*)
+			{
+				return allocate_task_block(aSize);
+			}
+			friend void asio_handler_deallocate(void* aBlock, std::size_t aSize, resume_handler*)
+			{
+				deallocate_task_block(aBlock, aSize);
+			}
+		private:
+			resumer iResumer;
+		};
+	}
+}
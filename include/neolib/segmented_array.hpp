@@ -40,12 +40,14 @@
 #include <memory>
 #include <iterator>
 #include "vecarray.hpp"
+#include "span.hpp"
 #include "array_tree.hpp"
+#include "array_btree.hpp"
 
 namespace neolib
 {
-	template <typename T, std::size_t SegmentSize = 64, typename Alloc = std::allocator<T> >
-	class segmented_array : private array_tree<Alloc>
+	template <typename T, std::size_t SegmentSize = 64, typename Alloc = std::allocator<T>, template <typename> class Tree = array_tree>
+	class segmented_array : private Tree<Alloc>
 	{
 	public:
 		typedef T value_type;
@@ -57,7 +59,7 @@ namespace neolib
 		typedef typename allocator_type::size_type size_type;
 		typedef typename allocator_type::difference_type difference_type;
 	private:
-		typedef array_tree<Alloc> base;
+		typedef Tree<Alloc> base;
 		typedef neolib::vecarray<T, SegmentSize, SegmentSize, neolib::nocheck> segment_type;
 		class node : public base::node
 		{
@@ -334,9 +336,14 @@ namespace neolib
 			insert(begin(), aFirst, aLast);
 		}
 		segmented_array(const segmented_array& aOther, const Alloc& aAllocator = Alloc()) :
-			iAllocator(aAllocator), iSize(0)
+			base(aAllocator), iAllocator(aAllocator), iSize(0)
+		{
+			build(aOther.begin(), aOther.end());
+		}
+		segmented_array(segmented_array&& aOther) :
+			iAllocator(aOther.iAllocator), iSize(0)
 		{
-			insert(begin(), aOther.begin(), aOther.end());
+			swap(aOther);
 		}
 		~segmented_array()
 		{
@@ -514,6 +521,62 @@ namespace neolib
 			std::swap(iAllocator, aOther.iAllocator);
 			std::swap(iSize, aOther.iSize);
 		}
+		// Moves every element of aOther in front of aPosition by relinking whole segments; the allocators must compare equal.
+		void splice(const_iterator aPosition, segmented_array& aOther)
+		{
+			if (&aOther == this || aOther.empty())
+				return;
+			segmented_array tail = split(aPosition);
+			join(aOther);
+			join(tail);
+		}
+		// Removes [aPosition, end()) and returns it as a new array; only the segment containing aPosition is copied.
+		segmented_array split(const_iterator aPosition)
+		{
+			segmented_array result{ Alloc{ iAllocator } };
+			if (aPosition == end())
+				return result;
+			node* first = aPosition.iNode;
+			if (aPosition.iSegmentPosition == first->segment().size())
+				first = static_cast<node*>(first->next());
+			else if (aPosition.iSegmentPosition != 0)
+			{
+				segment_type& segment = first->segment();
+				const size_type moved = segment.size() - aPosition.iSegmentPosition;
+				node* tail = allocate_node(first);
+				tail->segment().insert(tail->segment().begin(), std::make_move_iterator(segment.begin() + aPosition.iSegmentPosition), std::make_move_iterator(segment.end()));
+				tail->set_size(moved);
+				segment.erase(segment.begin() + aPosition.iSegmentPosition, segment.end());
+				first->set_size(first->size() - moved);
+				base::insert_node(tail, aPosition.iContainerPosition);
+				first = tail;
+			}
+			base::split(first, result);
+			result.iSize = iSize - aPosition.iContainerPosition;
+			iSize = aPosition.iContainerPosition;
+			return result;
+		}
+		// Calls aFunction with each contiguous run of [aFirst, aLast) in turn as a span so that inner loops see plain memory.
+		template <typename Function>
+		void for_each_segment(const_iterator aFirst, const_iterator aLast, Function aFunction) const
+		{
+			detail::for_each_segment_span<const value_type>(aFirst.iNode, aFirst.iSegmentPosition, aLast.iContainerPosition - aFirst.iContainerPosition, aFunction);
+		}
+		template <typename Function>
+		void for_each_segment(iterator aFirst, iterator aLast, Function aFunction)
+		{
+			detail::for_each_segment_span<value_type>(aFirst.iNode, aFirst.iSegmentPosition, aLast.iContainerPosition - aFirst.iContainerPosition, aFunction);
+		}
+		template <typename Function>
+		void for_each_segment(Function aFunction) const
+		{
+			for_each_segment(begin(), end(), aFunction);
+		}
+		template <typename Function>
+		void for_each_segment(Function aFunction)
+		{
+			for_each_segment(begin(), end(), aFunction);
+		}
 
 	private:
 		template <class InputIterator>
@@ -523,6 +586,29 @@ namespace neolib
 			size_type count = std::distance(aFirst, aLast);
 			if (count == 0)
 				return iterator{*this, aPosition.iNode, aPosition.iContainerPosition, aPosition.iSegmentPosition};
+			if (count > 1 && (aPosition.iNode == nullptr || count > aPosition.iNode->segment().available()))
+			{
+				auto pos = aPosition.iContainerPosition;
+				if (empty())
+					build(aFirst, aLast);
+				else if (count > SegmentSize)
+				{
+					segmented_array middle{ Alloc{ iAllocator } };
+					middle.build(aFirst, aLast);
+					segmented_array tail = split(aPosition);
+					join(middle);
+					join(tail);
+				}
+				else
+				{
+					for (; aFirst != aLast; ++aFirst)
+					{
+						aPosition = do_insert(aPosition, aFirst, std::next(aFirst));
+						++aPosition;
+					}
+				}
+				return iterator{*this, pos};
+			}
 			node* before = aPosition.iNode;
 			node* after = aPosition.iNode ? static_cast<node*>(aPosition.iNode->next()) : nullptr;
 			node* lastNode = aPosition.iNode;
@@ -599,6 +685,46 @@ namespace neolib
 			}
 			return iterator{*this, pos};
 		}
+		// Packs full segments from a range and builds the tree over them bottom-up in O(n); the array must be empty.
+		template <class ForwardIterator>
+		void build(ForwardIterator aFirst, ForwardIterator aLast)
+		{
+			size_type count = std::distance(aFirst, aLast);
+			try
+			{
+				for (size_type remaining = count; remaining > 0;)
+				{
+					node* newNode = allocate_node(static_cast<node*>(base::back_node()));
+					const size_type addCount = std::min(remaining, newNode->segment().available());
+					ForwardIterator stop = aFirst;
+					std::advance(stop, addCount);
+					newNode->segment().insert(newNode->segment().end(), aFirst, stop);
+					newNode->set_size(addCount);
+					aFirst = stop;
+					remaining -= addCount;
+				}
+			}
+			catch (...)
+			{
+				while (base::front_node() != nullptr)
+				{
+					node* garbage = static_cast<node*>(base::front_node());
+					base::set_front_node(garbage->next());
+					std::allocator_traits<node_allocator_type>::destroy(iAllocator, garbage);
+					std::allocator_traits<node_allocator_type>::deallocate(iAllocator, garbage, 1);
+				}
+				base::set_back_node(nullptr);
+				throw;
+			}
+			base::build(base::front_node(), base::back_node());
+			iSize = count;
+		}
+		void join(segmented_array& aOther)
+		{
+			base::join(aOther);
+			iSize += aOther.iSize;
+			aOther.iSize = 0;
+		}
 		node* find_node(size_type aContainerPosition, size_type& aSegmentPosition) const
 		{
 			size_type nodeIndex = 0;
@@ -0,0 +1,134 @@
+// span.hpp
+/*
+ *  Copyright (c) 2018 Leigh Johnston.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *     * Neither the name of Leigh Johnston nor the names of any
+ *       other contributors to this software may be used to endorse or
+ *       promote products derived from this software without specific prior
+ *       written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ *  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include "neolib.hpp"
+#include <cstddef>
+#include <algorithm>
+#include <type_traits>
+
+namespace neolib
+{
+	// A non-owning view of a contiguous sequence; a subset of C++20 std::span.
+	template <typename T>
+	class span
+	{
+	public:
+		typedef T element_type;
+		typedef typename std::remove_cv<T>::type value_type;
+		typedef std::size_t size_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef T* pointer;
+		typedef T& reference;
+		typedef T* iterator;
+	public:
+		constexpr span() noexcept :
+			iData{ nullptr }, iSize{ 0 }
+		{
+		}
+		constexpr span(pointer aData, size_type aSize) noexcept :
+			iData{ aData }, iSize{ aSize }
+		{
+		}
+		constexpr span(pointer aFirst, pointer aLast) noexcept :
+			iData{ aFirst }, iSize{ static_cast<size_type>(aLast - aFirst) }
+		{
+		}
+		template <typename U, typename = typename std::enable_if<std::is_convertible<U(*)[], T(*)[]>::value>::type>
+		constexpr span(const span<U>& aOther) noexcept :
+			iData{ aOther.data() }, iSize{ aOther.size() }
+		{
+		}
+	public:
+		constexpr pointer data() const noexcept
+		{
+			return iData;
+		}
+		constexpr size_type size() const noexcept
+		{
+			return iSize;
+		}
+		constexpr bool empty() const noexcept
+		{
+			return iSize == 0;
+		}
+		constexpr iterator begin() const noexcept
+		{
+			return iData;
+		}
+		constexpr iterator end() const noexcept
+		{
+			return iData + iSize;
+		}
+		constexpr reference operator[](size_type aIndex) const
+		{
+			return iData[aIndex];
+		}
+		constexpr reference front() const
+		{
+			return iData[0];
+		}
+		constexpr reference back() const
+		{
+			return iData[iSize - 1];
+		}
+		constexpr span subspan(size_type aOffset, size_type aCount) const
+		{
+			return span{ iData + aOffset, aCount };
+		}
+	private:
+		pointer iData;
+		size_type iSize;
+	};
+
+	namespace detail
+	{
+		// The for_each_segment() loop of the segmented containers: calls aFunction with a span over each run of 
+		// the aCount elements starting aSegmentPosition into aNode's segment, following the nodes' next() links.
+		template <typename Element, typename Node, typename Function>
+		inline void for_each_segment_span(Node* aNode, std::size_t aSegmentPosition, std::size_t aCount, Function& aFunction)
+		{
+			for (; aCount > 0; aNode = static_cast<Node*>(aNode->next()), aSegmentPosition = 0)
+			{
+				auto& segment = aNode->segment();
+				const std::size_t count = std::min<std::size_t>(segment.size() - aSegmentPosition, aCount);
+				if (count != 0)
+					aFunction(span<Element>{ &segment[aSegmentPosition], count });
+				aCount -= count;
+			}
+		}
+	}
+}
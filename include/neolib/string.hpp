@@ -174,3 +174,11 @@ namespace neolib
 		return std::strcmp(lhs.c_str(), rhs.c_str()) < 0;
 	}
 }
+
+namespace std
+{
+	template <> struct hash<neolib::string> : hash<neolib::i_string>
+	{
+		typedef neolib::string argument_type;
+	};
+}
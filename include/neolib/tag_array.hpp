@@ -40,6 +40,7 @@
 #include <memory>
 #include <iterator>
 #include "vecarray.hpp"
+#include "span.hpp"
 #include "array_tree.hpp"
 
 namespace neolib
@@ -545,6 +546,27 @@ namespace neolib
 		{
 			return aWhere.segment().tag();
 		}
+		// Calls aFunction with each contiguous run of [aFirst, aLast) in turn as a span so that inner loops see plain memory.
+		template <typename Function>
+		void for_each_segment(const_iterator aFirst, const_iterator aLast, Function aFunction) const
+		{
+			detail::for_each_segment_span<const value_type>(aFirst.iNode, aFirst.iSegmentPosition, aLast.iContainerPosition - aFirst.iContainerPosition, aFunction);
+		}
+		template <typename Function>
+		void for_each_segment(iterator aFirst, iterator aLast, Function aFunction)
+		{
+			detail::for_each_segment_span<value_type>(aFirst.iNode, aFirst.iSegmentPosition, aLast.iContainerPosition - aFirst.iContainerPosition, aFunction);
+		}
+		template <typename Function>
+		void for_each_segment(Function aFunction) const
+		{
+			for_each_segment(begin(), end(), aFunction);
+		}
+		template <typename Function>
+		void for_each_segment(Function aFunction)
+		{
+			for_each_segment(begin(), end(), aFunction);
+		}
 
 	private:
 		template <class InputIterator>
@@ -36,12 +36,150 @@
 #pragma once
 
 #include "neolib.hpp"
+#include <cstddef>
+#include <new>
+#include <functional>
 #include <future>
 #include <atomic>
+#include <type_traits>
 #include "i_task.hpp"
 
 namespace neolib
 {
+	namespace detail
+	{
+		// blocks come from per-thread recycled slabs; a block freed by another thread is handed back to its owner
+		void* allocate_task_block(std::size_t aSize);
+		void deallocate_task_block(void* aBlock, std::size_t aSize);
+	}
+
+	template <typename T>
+	class task_allocator
+	{
+	public:
+		typedef T value_type;
+		typedef T* pointer;
+		typedef const T* const_pointer;
+		typedef std::size_t size_type;
+		typedef std::ptrdiff_t difference_type;
+	public:
+		task_allocator()
+		{
+		}
+		template <typename U>
+		task_allocator(const task_allocator<U>&)
+		{
+		}
+	public:
+		pointer allocate(size_type aCount = 1)
+		{
+			static_assert(alignof(T) <= alignof(std::max_align_t), "neolib::task_allocator: over-aligned types not supported");
+			return static_cast<pointer>(detail::allocate_task_block(sizeof(T) * aCount));
+		}
+		void deallocate(pointer aObject, size_type aCount = 1)
+		{
+			detail::deallocate_task_block(aObject, sizeof(T) * aCount);
+		}
+		template <typename U>
+		struct rebind
+		{
+			typedef task_allocator<U> other;
+		};
+		template <typename U>
+		bool operator==(const task_allocator<U>&) const { return true; }
+		template <typename U>
+		bool operator!=(const task_allocator<U>&) const { return false; }
+	};
+
+	// Fire-and-forget task: type erased callable held in inline storage (spilling to a task block if it 
+	// doesn't fit) with the task itself allocated from the recycled task slabs; not reference counted.
+	class small_task
+	{
+	public:
+		static constexpr std::size_t storage_size = 48;
+	private:
+		typedef void(*invoke_function)(void*);
+		typedef void(*destroy_function)(void*);
+		template <typename Function>
+		static constexpr bool stored_inline()
+		{
+			return sizeof(Function) <= storage_size && alignof(Function) <= alignof(std::max_align_t);
+		}
+		// construction
+	private:
+		small_task() : iInvoke{ nullptr }, iDestroy{ nullptr }
+		{
+		}
+		~small_task()
+		{
+		}
+		small_task(const small_task&) = delete;
+		small_task& operator=(const small_task&) = delete;
+	public:
+		template <typename Function>
+		static small_task* create(Function&& aFunction)
+		{
+			typedef typename std::decay<Function>::type function_type;
+			static_assert(alignof(function_type) <= alignof(std::max_align_t), "neolib::small_task: over-aligned callables not supported");
+			small_task* newTask = new (detail::allocate_task_block(sizeof(small_task))) small_task{};
+			try
+			{
+				if constexpr (stored_inline<function_type>())
+				{
+					new (newTask->iStorage) function_type{ std::forward<Function>(aFunction) };
+					newTask->iInvoke = [](void* aStorage) { (*static_cast<function_type*>(aStorage))(); };
+					newTask->iDestroy = [](void* aStorage) { static_cast<function_type*>(aStorage)->~function_type(); };
+				}
+				else
+				{
+					task_allocator<function_type> allocator;
+					function_type* storage = allocator.allocate();
+					try
+					{
+						new (storage) function_type{ std::forward<Function>(aFunction) };
+					}
+					catch (...)
+					{
+						allocator.deallocate(storage);
+						throw;
+					}
+					*reinterpret_cast<function_type**>(newTask->iStorage) = storage;
+					newTask->iInvoke = [](void* aStorage) { (**static_cast<function_type**>(aStorage))(); };
+					newTask->iDestroy = [](void* aStorage)
+					{
+						function_type* function = *static_cast<function_type**>(aStorage);
+						function->~function_type();
+						task_allocator<function_type>{}.deallocate(function);
+					};
+				}
+			}
+			catch (...)
+			{
+				newTask->~small_task();
+				detail::deallocate_task_block(newTask, sizeof(small_task));
+				throw;
+			}
+			return newTask;
+		}
+		// operations
+	public:
+		void run()
+		{
+			iInvoke(iStorage);
+		}
+		void destroy()
+		{
+			iDestroy(iStorage);
+			this->~small_task();
+			detail::deallocate_task_block(this, sizeof(small_task));
+		}
+		// attributes
+	private:
+		invoke_function iInvoke;
+		destroy_function iDestroy;
+		alignas(std::max_align_t) unsigned char iStorage[storage_size];
+	};
+
 	class task : public i_task
 	{
 		// construction
@@ -71,11 +209,13 @@ namespace neolib
 		std::atomic<bool> iCancelled;
 	};
 
-	template <typename T>
+	// Runs a callable of any type, delivering its result (or the exception it threw) through a future.
+	template <typename T, typename Function = std::function<T()>>
 	class function_task : public task
 	{
 	public:
-		function_task(std::function<T()> aFunction) : task{}, iFunction{ aFunction }
+		template <typename F>
+		function_task(F&& aFunction) : task{}, iFunction{ std::forward<F>(aFunction) }, iPromise{ std::allocator_arg, task_allocator<T>{} }
 		{
 		}
 	public:
@@ -91,17 +231,23 @@ namespace neolib
 		}
 		void run() override
 		{
-			iPromise.set_value(iFunction());
+			try
+			{
+				if constexpr (std::is_void<T>::value)
+				{
+					iFunction();
+					iPromise.set_value();
+				}
+				else
+					iPromise.set_value(iFunction());
+			}
+			catch (...)
+			{
+				iPromise.set_exception(std::current_exception());
+			}
 		}
 	private:
-		std::function<T()> iFunction;
+		Function iFunction;
 		std::promise<T> iPromise;
 	};
-
-	template <>
-	inline void function_task<void>::run()
-	{
-		iFunction();
-		iPromise.set_value();
-	}
 }
@@ -0,0 +1,344 @@
+// task_graph.hpp
+/*
+ *  Copyright (c) 2018 Leigh Johnston.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *     * Neither the name of Leigh Johnston nor the names of any
+ *       other contributors to this software may be used to endorse or
+ *       promote products derived from this software without specific prior
+ *       written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ *  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include "neolib.hpp"
+#include <cstddef>
+#include <stdexcept>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <type_traits>
+#include "task.hpp"
+#include "thread_pool.hpp"
+
+namespace neolib
+{
+	// thrown by task_node::get() for a cancelled node; a task body may also throw it to cancel itself
+	struct task_cancelled : std::runtime_error { task_cancelled() : std::runtime_error("neolib::task_cancelled") {} };
+
+	namespace detail
+	{
+		// A node in a task graph. A node is linked to its predecessors once, when it is made, so every graph is
+		// acyclic. Nodes are reference counted and own their successors until they finish;
+		// once every predecessor has finished (or, for an "any" join, the first has completed) a node's body is 
+		// posted to the thread pool, or is run by the finishing thread for the bodiless join nodes, so that
+		// nothing ever blocks inside a pool worker. A cancelled or failed predecessor cancels or fails its successors.
+		class task_node_base : public task, public std::enable_shared_from_this<task_node_base>
+		{
+		public:
+			struct not_ready : std::logic_error { not_ready() : std::logic_error("neolib::task_node::not_ready") {} };
+			struct already_linked : std::logic_error { already_linked() : std::logic_error("neolib::task_node::already_linked") {} };
+		public:
+			enum class node_state : uint32_t
+			{
+				Waiting,
+				Scheduled,
+				Running,
+				Completed,
+				Failed,
+				Cancelled
+			};
+			enum class join_mode
+			{
+				All,
+				Any
+			};
+			typedef std::vector<std::shared_ptr<task_node_base>> node_list;
+			// construction
+		protected:
+			task_node_base(neolib::thread_pool& aThreadPool, join_mode aJoinMode, bool aInline);
+			// operations
+		public:
+			neolib::thread_pool& thread_pool() const;
+			node_state state() const;
+			bool finished() const;
+			void wait() const;
+			void link(const node_list& aPredecessors);
+			// implementation
+		public:
+			// from i_task
+			void run() override;
+			void cancel() override;
+		protected:
+			void check_value() const;
+			std::size_t winner() const;
+			virtual void execute() = 0;
+		private:
+			void add_successor(const std::shared_ptr<task_node_base>& aSuccessor);
+			void predecessor_finished(const task_node_base& aPredecessor);
+			void proceed();
+			void record_exception(std::exception_ptr aException, bool aReplace = false);
+			bool transition(node_state aFrom, node_state aTo);
+			void notify_finished();
+			void execute_and_finish();
+			// attributes
+		private:
+			neolib::thread_pool& iThreadPool;
+			const join_mode iJoinMode;
+			const bool iInline;
+			std::atomic<node_state> iState;
+			std::atomic<std::size_t> iRemaining;
+			std::atomic<bool> iWon;
+			std::size_t iWinner;
+			std::vector<const task_node_base*> iPredecessors;
+			node_list iSuccessors;
+			std::exception_ptr iException;
+			mutable std::mutex iMutex;
+			mutable std::condition_variable iConditionVariable;
+		};
+
+		template <typename T>
+		class task_node_result : public task_node_base
+		{
+		public:
+			typedef T value_type;
+		protected:
+			using task_node_base::task_node_base;
+		public:
+			const value_type& value() const
+			{
+				check_value();
+				return *iValue;
+			}
+		protected:
+			std::optional<value_type> iValue;
+		};
+
+		template <>
+		class task_node_result<void> : public task_node_base
+		{
+		public:
+			typedef void value_type;
+		protected:
+			using task_node_base::task_node_base;
+		public:
+			void value() const
+			{
+				check_value();
+			}
+		};
+
+		template <typename T>
+		class function_node : public task_node_result<T>
+		{
+		public:
+			function_node(neolib::thread_pool& aThreadPool, std::function<T()> aFunction) :
+				task_node_result<T>{ aThreadPool, task_node_base::join_mode::All, false }, iFunction{ std::move(aFunction) }
+			{
+			}
+		protected:
+			void execute() override
+			{
+				if constexpr (std::is_void<T>::value)
+					iFunction();
+				else
+					this->iValue.emplace(iFunction());
+				// release captures (including any predecessor) as soon as possible
+				iFunction = nullptr;
+			}
+		private:
+			std::function<T()> iFunction;
+		};
+
+		class when_all_node : public task_node_result<void>
+		{
+		public:
+			when_all_node(neolib::thread_pool& aThreadPool) :
+				task_node_result<void>{ aThreadPool, join_mode::All, true }
+			{
+			}
+		protected:
+			void execute() override
+			{
+			}
+		};
+
+		class when_any_node : public task_node_result<std::size_t>
+		{
+		public:
+			when_any_node(neolib::thread_pool& aThreadPool) :
+				task_node_result<std::size_t>{ aThreadPool, join_mode::Any, true }
+			{
+			}
+		protected:
+			void execute() override
+			{
+				iValue.emplace(winner());
+			}
+		};
+
+		template <typename Node, typename... Args>
+		inline std::shared_ptr<Node> make_node(const task_node_base::node_list& aPredecessors, Args&&... aArguments)
+		{
+			auto node = std::allocate_shared<Node>(task_allocator<Node>{}, std::forward<Args>(aArguments)...);
+			node->link(aPredecessors);
+			return node;
+		}
+	}
+
+	template <typename T>
+	class task_node
+	{
+		template <typename>
+		friend class task_node;
+		// types
+	public:
+		typedef T value_type;
+		typedef detail::task_node_result<T> state_type;
+		typedef std::shared_ptr<state_type> state_pointer;
+		// construction
+	public:
+		task_node()
+		{
+		}
+		task_node(state_pointer aState) : iState{ std::move(aState) }
+		{
+		}
+		// operations
+	public:
+		bool valid() const
+		{
+			return iState != nullptr;
+		}
+		bool ready() const
+		{
+			return iState->finished();
+		}
+		bool cancelled() const
+		{
+			return iState->state() == detail::task_node_base::node_state::Cancelled;
+		}
+		bool failed() const
+		{
+			return iState->state() == detail::task_node_base::node_state::Failed;
+		}
+		void cancel()
+		{
+			iState->cancel();
+		}
+		// blocks the calling thread so don't call from within a task body
+		void wait() const
+		{
+			iState->wait();
+		}
+		// doesn't block: throws not_ready if the node hasn't finished, task_cancelled if it was cancelled 
+		// or rethrows the exception that failed it
+		decltype(auto) get() const
+		{
+			return iState->value();
+		}
+		std::shared_ptr<i_task> task() const
+		{
+			return iState;
+		}
+		const state_pointer& state() const
+		{
+			return iState;
+		}
+		// aFunction receives this node's value (nothing if void) and runs on the same thread pool once this node completes
+		template <typename Function>
+		auto then(Function aFunction) const
+		{
+			if constexpr (std::is_void<T>::value)
+			{
+				typedef decltype(aFunction()) result_type;
+				return task_node<result_type>{ detail::make_node<detail::function_node<result_type>>({ iState }, 
+					iState->thread_pool(), std::function<result_type()>{ std::move(aFunction) }) };
+			}
+			else
+			{
+				typedef decltype(aFunction(std::declval<const T&>())) result_type;
+				auto predecessor = iState;
+				return task_node<result_type>{ detail::make_node<detail::function_node<result_type>>({ iState },
+					iState->thread_pool(), std::function<result_type()>{ [predecessor, aFunction]() mutable { return aFunction(predecessor->value()); } }) };
+			}
+		}
+		// attributes
+	private:
+		state_pointer iState;
+	};
+
+	template <typename Function>
+	inline auto spawn(Function aFunction, thread_pool& aThreadPool = thread_pool::default_thread_pool())
+	{
+		typedef decltype(aFunction()) result_type;
+		return task_node<result_type>{ detail::make_node<detail::function_node<result_type>>({}, aThreadPool, std::function<result_type()>{ std::move(aFunction) }) };
+	}
+
+	// completes once all of aNodes have completed; fails or is cancelled if any of them is
+	template <typename... T>
+	inline task_node<void> when_all(const task_node<T>&... aNodes)
+	{
+		detail::task_node_base::node_list predecessors{ aNodes.state()... };
+		auto& threadPool = (predecessors.empty() ? thread_pool::default_thread_pool() : predecessors[0]->thread_pool());
+		return task_node<void>{ detail::make_node<detail::when_all_node>(predecessors, threadPool) };
+	}
+
+	template <typename T>
+	inline task_node<void> when_all(const std::vector<task_node<T>>& aNodes)
+	{
+		detail::task_node_base::node_list predecessors;
+		for (auto const& node : aNodes)
+			predecessors.push_back(node.state());
+		auto& threadPool = (predecessors.empty() ? thread_pool::default_thread_pool() : predecessors[0]->thread_pool());
+		return task_node<void>{ detail::make_node<detail::when_all_node>(predecessors, threadPool) };
+	}
+
+	// completes with the index of the first of aNodes to complete; fails or is cancelled only if all of them do
+	template <typename... T>
+	inline task_node<std::size_t> when_any(const task_node<T>&... aNodes)
+	{
+		detail::task_node_base::node_list predecessors{ aNodes.state()... };
+		auto& threadPool = (predecessors.empty() ? thread_pool::default_thread_pool() : predecessors[0]->thread_pool());
+		return task_node<std::size_t>{ detail::make_node<detail::when_any_node>(predecessors, threadPool) };
+	}
+
+	template <typename T>
+	inline task_node<std::size_t> when_any(const std::vector<task_node<T>>& aNodes)
+	{
+		detail::task_node_base::node_list predecessors;
+		for (auto const& node : aNodes)
+			predecessors.push_back(node.state());
+		auto& threadPool = (predecessors.empty() ? thread_pool::default_thread_pool() : predecessors[0]->thread_pool());
+		return task_node<std::size_t>{ detail::make_node<detail::when_any_node>(predecessors, threadPool) };
+	}
+}
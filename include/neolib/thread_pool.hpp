@@ -39,8 +39,13 @@
 #include <memory>
 #include <vector>
 #include <deque>
+#include <functional>
+#include <exception>
 #include <future>
 #include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <type_traits>
 #include "i_thread.hpp"
 #include "task.hpp"
 
@@ -53,11 +58,36 @@ namespace neolib
 		friend class thread_pool_thread;
 	public:
 		typedef std::shared_ptr<i_task> task_pointer;
+		typedef std::function<void(std::exception_ptr)> exception_handler;
 	public:
 		struct no_threads : std::logic_error { no_threads() : std::logic_error("neolib::thread_pool::no_threads") {} };
 		struct task_not_found : std::logic_error { task_not_found() : std::logic_error("neolib::thread_pool::task_not_found") {} };
 	private:
 		typedef std::vector<std::unique_ptr<i_thread>> thread_list;
+	public:
+		class schedule_awaiter
+		{
+		public:
+			schedule_awaiter(thread_pool& aThreadPool, int32_t aPriority) : iThreadPool{ aThreadPool }, iPriority{ aPriority }
+			{
+			}
+		public:
+			bool await_ready() const
+			{
+				return false;
+			}
+			template <typename Handle>
+			void await_suspend(Handle aHandle)
+			{
+				iThreadPool.post([aHandle]() mutable { aHandle.resume(); }, iPriority);
+			}
+			void await_resume() const
+			{
+			}
+		private:
+			thread_pool& iThreadPool;
+			int32_t iPriority;
+		};
 	public:
 		thread_pool();
 		~thread_pool();
@@ -72,32 +102,77 @@ namespace neolib
 		void start(task_pointer aTask, int32_t aPriority = 0);
 		bool try_start(i_task& aTask, int32_t aPriority = 0);
 		bool try_start(task_pointer aTask, int32_t aPriority = 0);
-		std::pair<std::future<void>, task_pointer> run(std::function<void()> aFunction, int32_t aPriority = 0);
-		template <typename T>
-		std::pair<std::future<T>, task_pointer> run(std::function<T()> aFunction, int32_t aPriority = 0);
+		template <typename Function>
+		std::pair<std::future<std::invoke_result_t<std::decay_t<Function>&>>, task_pointer> run(Function&& aFunction, int32_t aPriority = 0);
+		template <typename Function>
+		void post(Function&& aFunction, int32_t aPriority = 0);
+		schedule_awaiter schedule(int32_t aPriority = 0);
 	public:
 		bool idle() const;
 		bool busy() const;
 		void wait() const;
+	public:
+		// Called on the worker thread with the exception that ended a task given to start() or post(); without a
+		// handler the exception is discarded. run() delivers its task's exception through the future instead.
+		void set_exception_handler(exception_handler aHandler);
 	public:
 		static thread_pool& default_thread_pool();
 		std::recursive_mutex& mutex() const;
 	private:
-		void steal_work(thread_pool_thread& aIdleThread);
-		void thread_gone_idle();
+		typedef std::pair<small_task*, int32_t> task_queue_entry;
+		typedef std::deque<task_queue_entry> task_queue;
+		typedef std::vector<thread_pool_thread*> thread_snapshot;
+	private:
+		const thread_snapshot& threads() const;
+		void add(small_task* aTask, int32_t aPriority);
+		void add_priority_task(small_task* aTask, int32_t aPriority);
+		bool take_priority_task(small_task*& aTask, bool aUrgentOnly);
+		bool steal_work(thread_pool_thread& aIdleThread, small_task*& aTask);
+		bool have_work() const;
+		bool stopping() const;
+		void park();
+		void wake_one();
+		void tasks_completed(std::size_t aCount);
+		void task_threw(std::exception_ptr aException);
 	private:
 		mutable std::recursive_mutex iMutex;
 		std::size_t iMaxThreads;
 		thread_list iThreads;
+		std::vector<std::unique_ptr<thread_snapshot>> iSnapshots;
+		std::atomic<const thread_snapshot*> iSnapshot;
+		std::mutex iPriorityMutex;
+		task_queue iPriorityTasks;
+		std::atomic<std::size_t> iPriorityTaskCount;
+		std::atomic<int32_t> iTopPriority;
+		std::atomic<std::size_t> iOutstanding;
+		std::atomic<std::size_t> iParked;
+		std::atomic<bool> iStopping;
+		std::mutex iParkMutex;
+		std::condition_variable iParkConditionVariable;
 		mutable std::mutex iWaitMutex;
 		mutable std::condition_variable iWaitConditionVariable;
+		std::mutex iExceptionHandlerMutex;
+		exception_handler iExceptionHandler;
 	};
 
-	template <typename T>
-	inline std::pair<std::future<T>, thread_pool::task_pointer> thread_pool::run(std::function<T()> aFunction, int32_t aPriority)
+	template <typename Function>
+	inline std::pair<std::future<std::invoke_result_t<std::decay_t<Function>&>>, thread_pool::task_pointer> thread_pool::run(Function&& aFunction, int32_t aPriority)
 	{
-		auto newTask = std::make_shared<function_task<T>>(aFunction);
+		typedef std::invoke_result_t<std::decay_t<Function>&> result_type;
+		typedef function_task<result_type, std::decay_t<Function>> task_type;
+		auto newTask = std::allocate_shared<task_type>(task_allocator<task_type>{}, std::forward<Function>(aFunction));
 		start(newTask, aPriority);
 		return std::make_pair(newTask->get_future(), newTask);
 	}
+
+	template <typename Function>
+	inline void thread_pool::post(Function&& aFunction, int32_t aPriority)
+	{
+		add(small_task::create(std::forward<Function>(aFunction)), aPriority);
+	}
+
+	inline thread_pool::schedule_awaiter thread_pool::schedule(int32_t aPriority)
+	{
+		return schedule_awaiter{ *this, aPriority };
+	}
 }
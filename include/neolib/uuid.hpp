@@ -44,7 +44,8 @@
 #include <iostream>
 #include <sstream>
 #include <iomanip>
-#include <boost/functional/hash.hpp>
+#include <cstring>
+#include "fast_hash.hpp"
 
 namespace neolib
 {
@@ -128,8 +129,13 @@ namespace std
 		typedef std::size_t result_type;
 		result_type operator()(argument_type const& aUuid) const
 		{
-			auto const& t = std::tie(aUuid.iPart1, aUuid.iPart2, aUuid.iPart3, aUuid.iPart4, aUuid.iPart5);
-			return boost::hash<decltype(t)>{}(t);
+			uint8_t bytes[16];
+			std::memcpy(bytes, &aUuid.iPart1, 4);
+			std::memcpy(bytes + 4, &aUuid.iPart2, 2);
+			std::memcpy(bytes + 6, &aUuid.iPart3, 2);
+			std::memcpy(bytes + 8, &aUuid.iPart4, 2);
+			std::memcpy(bytes + 10, aUuid.iPart5.data(), 6);
+			return neolib::fast_hash<std::size_t>(bytes, sizeof(bytes));
 		}
 	};
 }
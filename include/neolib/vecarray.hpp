@@ -38,12 +38,14 @@
 #include "neolib.hpp"
 #include <cassert>
 #include <cstddef>
+#include <cstring>
 #include <stdexcept>
 #include <memory>
 #include <algorithm>
 #include <iterator>
 #include <type_traits>
 #include <vector>
+#include <initializer_list>
 
 namespace neolib
 {
@@ -54,7 +56,7 @@ namespace neolib
 
 	struct nocheck
 	{
-		inline static void test(bool aValid)
+		static constexpr void test(bool aValid)
 		{
 			(void)aValid;
 			assert(aValid);
@@ -64,13 +66,18 @@ namespace neolib
 	template <typename Exception>
 	struct check
 	{
-		inline static void test(bool aValid)
+		static constexpr void test(bool aValid)
 		{
 			if (!aValid)
 				throw Exception();
 		}
 	};
 
+	// Types whose objects can be moved to new storage with memcpy/memmove, the source then being discarded without
+	// running its destructor; specialize for element types that are safe to relocate but not trivially copyable.
+	template <typename T>
+	struct is_trivially_relocatable : std::is_trivially_copyable<T> {};
+
 	namespace detail
 	{
 		template <typename InputIter1, typename InputIter2, typename ForwardIter1, typename ForwardIter2>
@@ -84,7 +91,7 @@ namespace neolib
 			catch(...)
 			{
 				auto last = dest1 + (last1 - first1);
-				typedef std::iterator_traits<ForwardIter1>::value_type value_type;
+				typedef typename std::iterator_traits<ForwardIter1>::value_type value_type;
 				for (auto i = dest1; i != last; ++i)
 					(*i).~value_type();
 				throw;
@@ -346,10 +353,10 @@ namespace neolib
 		typedef std::reverse_iterator<iterator> reverse_iterator;
 		typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
 	public:
-		template <std::size_t ArraySize, std::size_t MaxVectorSize>
+		template <std::size_t ArraySize2, std::size_t MaxVectorSize2>
 		struct is_fixed_size
 		{
-			constexpr bool value() const { return ArraySize == MaxVectorSize; }
+			constexpr bool value() const { return ArraySize2 == MaxVectorSize2; }
 		};
 
 	public:
@@ -359,19 +366,25 @@ namespace neolib
 		}
 		vecarray(const vecarray& rhs) : iSize{ 0 }
 		{
-			insert(begin(), rhs.begin(), rhs.end());
+			insert(begin(), rhs.data(), rhs.data() + rhs.size());
 		}
 		vecarray(vecarray&& rhs) : iSize{0}
 		{
-			if (using_vector())
+			if (rhs.using_vector())
+			{
+				new (iAlignedBuffer.iVector) vector_type{ std::move(rhs.vector()) };
+				iSize = USING_VECTOR;
+			}
+			else if (RELOCATABLE)
 			{
-				vector() = std::move(rhs.vector());
+				std::memcpy(static_cast<void*>(iAlignedBuffer.iData), rhs.iAlignedBuffer.iData, rhs.iSize * sizeof(value_type));
 				iSize = rhs.iSize;
+				rhs.iSize = 0;
 			}
 			else
 			{
-				for (auto&& element : rhs)
-					push_back(std::move(element));
+				std::uninitialized_copy(std::make_move_iterator(rhs.data()), std::make_move_iterator(rhs.data() + rhs.iSize), data());
+				iSize = rhs.iSize;
 				rhs.clear();
 			}
 		}
@@ -421,7 +434,9 @@ namespace neolib
 		size_type capacity() const { return MaxVectorSize; }
 		size_type max_size() const { return MaxVectorSize; }
 		size_type after(size_type position) const { return position < size() ? size() - position : 0; }
-		// element access
+		// element access; the elements are contiguous whether held in the array or the vector
+		pointer data() { return using_array() ? reinterpret_cast<pointer>(iAlignedBuffer.iData) : vector().data(); }
+		const_pointer data() const { return using_array() ? reinterpret_cast<const_pointer>(iAlignedBuffer.iData) : vector().data(); }
 		reference operator[](size_type n) { return *(begin() + n); }
 		const_reference operator[](size_type n) const { return *(begin() + n); }
 		reference at(size_type n) { if (n < size()) return operator[](n); throw std::out_of_range("vecarray::at"); }
@@ -464,14 +479,31 @@ namespace neolib
 		iterator insert(const_iterator position, value_type value)
 		{
 			need(1, position);
-			size_type index = position - const_iterator(vector().begin());
+			size_type index = position - cbegin();
 			insert(position, 1, value);
 			return begin() + index;
 		}
 		void insert(const_iterator position, size_type count, const value_type& value)
 		{
+			CheckPolicy::test(size() + count <= MaxVectorSize);
 			need(count, position);
-			if (using_array())
+			if (using_array() && RELOCATABLE)
+			{
+				value_type copy{ value };
+				const size_type after = static_cast<size_type>(cend() - position);
+				pointer gap = open_gap(position, count);
+				try
+				{
+					std::uninitialized_fill_n(gap, count, copy);
+				}
+				catch (...)
+				{
+					std::memmove(static_cast<void*>(gap), gap + count, after * sizeof(value_type));
+					throw;
+				}
+				iSize += count;
+			}
+			else if (using_array())
 			{
 				const_iterator next = position;
 				while (count > 0)
@@ -488,11 +520,16 @@ namespace neolib
 			if (using_array())
 			{
 				assert(iSize > 0);
-				iterator dest = std::next(begin(), std::distance(cbegin(), position));
-				auto garbage = std::copy(std::make_move_iterator(std::next(dest)), std::make_move_iterator(end()), dest);
-				(*garbage).~value_type();
+				pointer dest = data() + (position - cbegin());
+				if (RELOCATABLE)
+				{
+					dest->~value_type();
+					std::memmove(static_cast<void*>(dest), dest + 1, (data() + iSize - (dest + 1)) * sizeof(value_type));
+				}
+				else
+					std::move(dest + 1, data() + iSize, dest)->~value_type();
 				--iSize;
-				return dest;
+				return iterator(dest);
 			}
 			else
 				return vector().erase(position.vector_iter());
@@ -504,13 +541,21 @@ namespace neolib
 			if (using_array())
 			{
 				assert(iSize > 0);
-				iterator first2 = std::next(begin(), std::distance(cbegin(), first));
-				iterator last2 = std::next(begin(), std::distance(cbegin(), last));
-				auto garbage = std::copy(std::make_move_iterator(last2), std::make_move_iterator(end()), first2);
-				for (auto i = garbage; i != end(); ++i)
-					(*i).~value_type();
+				pointer first2 = data() + (first - cbegin());
+				pointer last2 = data() + (last - cbegin());
+				if (RELOCATABLE)
+				{
+					for (pointer i = first2; i != last2; ++i)
+						i->~value_type();
+					std::memmove(static_cast<void*>(first2), last2, (data() + iSize - last2) * sizeof(value_type));
+				}
+				else
+				{
+					for (pointer i = std::move(last2, data() + iSize, first2); i != data() + iSize; ++i)
+						i->~value_type();
+				}
 				iSize -= (last - first);
-				return first2;
+				return iterator(first2);
 			}
 			else
 				return vector().erase(first.vector_iter(), last.vector_iter());
@@ -668,12 +713,19 @@ namespace neolib
 			{
 				vector_type copy;
 				copy.reserve(ArraySize * 2);
-				copy.insert(copy.begin(), std::make_move_iterator(begin()), std::make_move_iterator(end()));
+				copy.insert(copy.begin(), std::make_move_iterator(data()), std::make_move_iterator(data() + iSize));
 				clear();
 				new (iAlignedBuffer.iVector) vector_type{ std::move(copy) };
 				iSize = USING_VECTOR;
 			}
 		}
+		// Shifts the elements from aPosition up by aCount with memmove leaving uninitialized storage; array mode only.
+		pointer open_gap(const_iterator aPosition, size_type aCount)
+		{
+			pointer gap = data() + (aPosition - cbegin());
+			std::memmove(static_cast<void*>(gap + aCount), gap, (data() + iSize - gap) * sizeof(value_type));
+			return gap;
+		}
 		template <class InputIterator>
 		typename std::enable_if<!std::is_same<typename std::iterator_traits<InputIterator>::iterator_category, std::input_iterator_tag>::value, void>::type
 		do_insert(const_iterator position, InputIterator first, InputIterator last)
@@ -681,7 +733,22 @@ namespace neolib
 			difference_type n = last - first;
 			CheckPolicy::test(size() + n <= MaxVectorSize);
 			need(n, position);
-			if (using_array())
+			if (using_array() && RELOCATABLE)
+			{
+				const size_type after = static_cast<size_type>(cend() - position);
+				pointer gap = open_gap(position, n);
+				try
+				{
+					std::uninitialized_copy(first, last, gap);
+				}
+				catch (...)
+				{
+					std::memmove(static_cast<void*>(gap), gap + n, after * sizeof(value_type));
+					throw;
+				}
+				iSize += n;
+			}
+			else if (using_array())
 			{
 				const_iterator theEnd = end();
 				difference_type t = theEnd - position;
@@ -732,5 +799,163 @@ namespace neolib
 		} iAlignedBuffer;
 		size_type iSize;
 		static const size_type USING_VECTOR = static_cast<size_type>(-1);
+		static constexpr bool RELOCATABLE = is_trivially_relocatable<value_type>::value;
+	};
+
+	// A vecarray that never spills to the heap: capacity is fixed at Capacity and the elements are always contiguous.
+	template <typename T, std::size_t Capacity, typename CheckPolicy = check<vecarray_overflow>, typename Alloc = std::allocator<T> >
+	using static_vector = vecarray<T, Capacity, Capacity, CheckPolicy, Alloc>;
+
+	/* Fixed capacity vector usable in constant expressions. The elements live in a plain array that is
+	   value-initialized on construction, so T must be a trivial type; iterators are pointers. */
+	template <typename T, std::size_t Capacity, typename CheckPolicy = check<vecarray_overflow> >
+	class literal_vecarray
+	{
+		static_assert(std::is_trivial<T>::value, "neolib::literal_vecarray: element type must be trivial");
+	public:
+		typedef T value_type;
+		typedef T* pointer;
+		typedef const T* const_pointer;
+		typedef T& reference;
+		typedef const T& const_reference;
+		typedef std::size_t size_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef pointer iterator;
+		typedef const_pointer const_iterator;
+		typedef std::reverse_iterator<iterator> reverse_iterator;
+		typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+	public:
+		// construction
+		constexpr literal_vecarray() : iData{}, iSize{ 0 }
+		{
+		}
+		constexpr literal_vecarray(size_type n, const value_type& value) : iData{}, iSize{ 0 }
+		{
+			insert(end(), n, value);
+		}
+		template <typename ForwardIterator, typename = typename std::enable_if<!std::is_integral<ForwardIterator>::value>::type>
+		constexpr literal_vecarray(ForwardIterator first, ForwardIterator last) : iData{}, iSize{ 0 }
+		{
+			insert(end(), first, last);
+		}
+		constexpr literal_vecarray(std::initializer_list<T> init) : iData{}, iSize{ 0 }
+		{
+			insert(end(), init.begin(), init.end());
+		}
+		// traversals
+		constexpr const_iterator cbegin() const { return iData; }
+		constexpr const_iterator begin() const { return iData; }
+		constexpr iterator begin() { return iData; }
+		constexpr const_iterator cend() const { return iData + iSize; }
+		constexpr const_iterator end() const { return iData + iSize; }
+		constexpr iterator end() { return iData + iSize; }
+		constexpr reverse_iterator rbegin() { return reverse_iterator(end()); }
+		constexpr const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+		constexpr reverse_iterator rend() { return reverse_iterator(begin()); }
+		constexpr const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+		constexpr bool empty() const { return iSize == 0; }
+		constexpr bool full() const { return iSize == Capacity; }
+		constexpr size_type size() const { return iSize; }
+		constexpr size_type available() const { return Capacity - iSize; }
+		constexpr size_type capacity() const { return Capacity; }
+		constexpr size_type max_size() const { return Capacity; }
+		// element access
+		constexpr pointer data() { return iData; }
+		constexpr const_pointer data() const { return iData; }
+		constexpr reference operator[](size_type n) { return iData[n]; }
+		constexpr const_reference operator[](size_type n) const { return iData[n]; }
+		constexpr reference at(size_type n) { if (n < iSize) return iData[n]; throw std::out_of_range("literal_vecarray::at"); }
+		constexpr const_reference at(size_type n) const { if (n < iSize) return iData[n]; throw std::out_of_range("literal_vecarray::at"); }
+		constexpr reference front() { return iData[0]; }
+		constexpr reference back() { return iData[iSize - 1]; }
+		constexpr const_reference front() const { return iData[0]; }
+		constexpr const_reference back() const { return iData[iSize - 1]; }
+		// modifiers
+		constexpr void push_back(const value_type& value)
+		{
+			CheckPolicy::test(iSize < Capacity);
+			iData[iSize++] = value;
+		}
+		constexpr void pop_back()
+		{
+			--iSize;
+		}
+		constexpr iterator insert(const_iterator position, const value_type& value)
+		{
+			return insert(position, 1, value);
+		}
+		constexpr iterator insert(const_iterator position, size_type count, const value_type& value)
+		{
+			const value_type copy = value;
+			iterator gap = open_gap(position, count);
+			for (size_type i = 0; i < count; ++i)
+				gap[i] = copy;
+			return gap;
+		}
+		template <typename ForwardIterator>
+		constexpr typename std::enable_if<!std::is_integral<ForwardIterator>::value, iterator>::type
+		insert(const_iterator position, ForwardIterator first, ForwardIterator last)
+		{
+			size_type count = 0;
+			for (ForwardIterator i = first; i != last; ++i)
+				++count;
+			iterator gap = open_gap(position, count);
+			for (iterator dest = gap; first != last; ++dest, ++first)
+				*dest = *first;
+			return gap;
+		}
+		constexpr iterator erase(const_iterator position)
+		{
+			return erase(position, position + 1);
+		}
+		constexpr iterator erase(const_iterator first, const_iterator last)
+		{
+			iterator dest = iData + (first - iData);
+			const size_type count = static_cast<size_type>(last - first);
+			for (iterator source = dest + count; source != end(); ++source)
+				*(source - count) = *source;
+			iSize -= count;
+			return dest;
+		}
+		constexpr void clear()
+		{
+			iSize = 0;
+		}
+		constexpr void resize(size_type n, const value_type& value = value_type{})
+		{
+			if (iSize > n)
+				iSize = n;
+			else if (iSize < n)
+				insert(end(), n - iSize, value);
+		}
+		// equality
+		constexpr bool operator==(const literal_vecarray& rhs) const
+		{
+			if (iSize != rhs.iSize)
+				return false;
+			for (size_type i = 0; i < iSize; ++i)
+				if (!(iData[i] == rhs.iData[i]))
+					return false;
+			return true;
+		}
+		constexpr bool operator!=(const literal_vecarray& rhs) const
+		{
+			return !operator==(rhs);
+		}
+
+	private:
+		constexpr iterator open_gap(const_iterator aPosition, size_type aCount)
+		{
+			CheckPolicy::test(iSize + aCount <= Capacity);
+			iterator gap = iData + (aPosition - iData);
+			for (iterator source = end(); source != gap; --source)
+				*(source - 1 + aCount) = *(source - 1);
+			iSize += aCount;
+			return gap;
+		}
+
+	private:
+		T iData[Capacity];
+		size_type iSize;
 	};
 }
@@ -36,47 +36,91 @@
 #pragma once
 
 #include "neolib.hpp"
+#include <cstdint>
 #include <vector>
 #include <memory>
+#include <string>
+#include <string_view>
+#include <optional>
+#include <istream>
+#include <functional>
+#include <stdexcept>
+#include "flat_hash_map.hpp"
 
 namespace neolib
 {
+	class thread_pool;
+
 	class zip
 	{
 	public:
 		typedef std::vector<uint8_t> buffer_type;
+		// receives an entry's uncompressed data in order, in chunks of bounded size
+		typedef std::function<void(const uint8_t* aData, std::size_t aLength)> chunk_sink;
+		// makes the sink for an entry (an empty sink fails that entry); called concurrently by parallel_extract
+		typedef std::function<chunk_sink(std::size_t aIndex)> sink_factory;
 	public:
 		struct zip_file_too_big : std::runtime_error { zip_file_too_big() : std::runtime_error("neolib::zip::zip_file_too_big") {} };
 		struct file_not_found : std::runtime_error { file_not_found() : std::runtime_error("neolib::zip::file_not_found") {} };
+		struct bad_entry : std::runtime_error { bad_entry() : std::runtime_error("neolib::zip::bad_entry") {} };
 	public:
+		// The archive file is memory mapped rather than read so only the parts actually extracted are paged in.
 		zip(const std::string& aZipFilePath);
 		zip(const buffer_type& aZipFile);
 		zip(buffer_type&& aZipFile);
 		zip(const void* aZipFileData, std::size_t aZipFileDataLength);
+		zip(const zip&) = delete;
+		zip(zip&&) = default;
+		zip& operator=(const zip&) = delete;
+		zip& operator=(zip&&) = default;
 	public:
 		size_t file_count() const { return iFiles.size(); }
 		std::size_t index_of(const std::string& aFile) const;
+		std::optional<std::size_t> find(std::string_view aFile) const;
+		uint64_t file_size(size_t aIndex) const;
+		// Entries with absolute paths or paths that climb out of aTargetDirectory are refused.
 		bool extract(size_t aIndex, const std::string& aTargetDirectory);
 		bool extract_to(size_t aIndex, buffer_type& aBuffer);
+		bool extract_to(size_t aIndex, const chunk_sink& aSink);
 		std::string extract_to_string(size_t aIndex);
+		// Inflates on demand as the stream is read; a corrupt entry or CRC mismatch sets badbit.
+		std::unique_ptr<std::istream> open(size_t aIndex) const;
+		bool parallel_extract(thread_pool& aThreadPool, const std::vector<std::size_t>& aIndices, const sink_factory& aSinks);
+		bool extract_all(thread_pool& aThreadPool, const std::string& aTargetDirectory);
 		const std::string& file_path(size_t aIndex) const;
+		// whether the archive itself could be read; a failed extraction is reported only by the call that failed
 		bool ok() const { return !iError; }
+	private:
+		struct entry
+		{
+			uint64_t iHeaderOffset;
+			uint64_t iCompressedSize;
+			uint64_t iUncompressedSize;
+			uint32_t iCrc32;
+			uint16_t iCompression;
+		};
 	private:
 		bool parse();
-		const uint8_t* data_front();
-		const uint8_t* data_back();
+		bool extract_entry(size_t aIndex, const chunk_sink& aSink) const;
+		const uint8_t* entry_data(size_t aIndex) const;
+		const uint8_t* data_front() const;
+		const uint8_t* data_back() const;
 	private:
 		buffer_type iZipFile;
+		std::shared_ptr<const void> iMapping;
 		const uint8_t* iZipFileData;
 		std::size_t iZipFileDataLength;
 		bool iError;
 		struct dir_header;
+		struct zip64_dir_locator;
+		struct zip64_dir_header;
 		struct dir_file_header;
 		struct local_header;
-		typedef unsigned long dword;
-		typedef unsigned short word;
-		typedef unsigned char byte;
-		std::vector<const dir_file_header*> iDirEntries;
+		typedef uint32_t dword;
+		typedef uint16_t word;
+		typedef uint8_t byte;
+		std::vector<entry> iEntries;
 		std::vector<std::string> iFiles;
+		flat_hash_map<std::string_view, std::size_t> iIndex;
 	};
 }
@@ -0,0 +1,143 @@
+// allocator_stats.cpp
+/*
+ *  Copyright (c) 2018 Leigh Johnston.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *     * Neither the name of Leigh Johnston nor the names of any
+ *       other contributors to this software may be used to endorse or
+ *       promote products derived from this software without specific prior
+ *       written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ *  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <neolib/neolib.hpp>
+#include <sstream>
+#include <neolib/allocator_stats.hpp>
+
+namespace neolib
+{
+	namespace
+	{
+		void write_json_string(std::ostream& aStream, const std::string& aString)
+		{
+			static const char sHexDigits[] = "0123456789abcdef";
+			aStream << '"';
+			for (char c : aString)
+			{
+				if (c == '"' || c == '\\')
+					aStream << '\\' << c;
+				else if (static_cast<unsigned char>(c) < 0x20)
+					aStream << "\\u00" << sHexDigits[(c >> 4) & 0xF] << sHexDigits[c & 0xF];
+				else
+					aStream << c;
+			}
+			aStream << '"';
+		}
+	}
+
+	allocator_registry::allocator_registry()
+	{
+	}
+
+	allocator_registry& allocator_registry::instance()
+	{
+		static allocator_registry* sInstance = new allocator_registry{};
+		return *sInstance;
+	}
+
+	void allocator_registry::add(const std::string& aName, stats_source aSource)
+	{
+		std::lock_guard<std::mutex> lg{ iMutex };
+		iEntries[aName] = entry{ std::move(aSource), std::chrono::steady_clock::time_point{}, 0, 0 };
+	}
+
+	void allocator_registry::remove(const std::string& aName)
+	{
+		std::lock_guard<std::mutex> lg{ iMutex };
+		iEntries.erase(aName);
+	}
+
+	allocator_registry::snapshot_type allocator_registry::snapshot()
+	{
+		std::lock_guard<std::mutex> lg{ iMutex };
+		snapshot_type result;
+		result.reserve(iEntries.size());
+		auto const now = std::chrono::steady_clock::now();
+		for (auto& e : iEntries)
+		{
+			allocator_stats stats = e.second.iSource();
+			if (e.second.iLastRead != std::chrono::steady_clock::time_point{})
+			{
+				double const seconds = std::chrono::duration<double>(now - e.second.iLastRead).count();
+				if (seconds > 0.0 && stats.iAllocations >= e.second.iLastAllocations && stats.iDeallocations >= e.second.iLastDeallocations)
+				{
+					stats.iAllocationRate = (stats.iAllocations - e.second.iLastAllocations) / seconds;
+					stats.iDeallocationRate = (stats.iDeallocations - e.second.iLastDeallocations) / seconds;
+				}
+			}
+			e.second.iLastRead = now;
+			e.second.iLastAllocations = stats.iAllocations;
+			e.second.iLastDeallocations = stats.iDeallocations;
+			result.emplace_back(e.first, stats);
+		}
+		return result;
+	}
+
+	std::string allocator_registry::to_json()
+	{
+		std::ostringstream json;
+		dump(json);
+		return json.str();
+	}
+
+	void allocator_registry::dump(std::ostream& aStream)
+	{
+		auto const allocators = snapshot();
+		aStream << "{\"allocators\":{";
+		bool first = true;
+		for (auto const& a : allocators)
+		{
+			if (!first)
+				aStream << ',';
+			first = false;
+			write_json_string(aStream, a.first);
+			auto const& s = a.second;
+			aStream << ":{"
+				<< "\"live_objects\":" << s.iLiveObjects
+				<< ",\"chunks_reserved\":" << s.iChunksReserved
+				<< ",\"bytes_in_use\":" << s.iBytesInUse
+				<< ",\"bytes_reserved\":" << s.iBytesReserved
+				<< ",\"high_water_mark\":" << s.iHighWaterMark
+				<< ",\"allocations\":" << s.iAllocations
+				<< ",\"deallocations\":" << s.iDeallocations
+				<< ",\"cross_thread_deallocations\":" << s.iCrossThreadDeallocations
+				<< ",\"allocations_per_second\":" << s.iAllocationRate
+				<< ",\"deallocations_per_second\":" << s.iDeallocationRate
+				<< '}';
+		}
+		aStream << "}}";
+	}
+}
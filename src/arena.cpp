@@ -0,0 +1,328 @@
+// arena.cpp
+/*
+ *  Copyright (c) 2018 Leigh Johnston.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *     * Neither the name of Leigh Johnston nor the names of any
+ *       other contributors to this software may be used to endorse or
+ *       promote products derived from this software without specific prior
+ *       written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ *  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <neolib/neolib.hpp>
+#include <cstdint>
+#include <neolib/arena.hpp>
+
+namespace neolib
+{
+	struct alignas(std::max_align_t) arena::page_header
+	{
+		arena* iOwner;
+		page_header* iNext;
+	};
+
+	struct alignas(std::max_align_t) arena::large_block_header
+	{
+		arena* iOwner;
+		large_block_header* iPrevious;
+		large_block_header* iNext;
+		large_block_header* iNextRemote;
+	};
+
+	namespace
+	{
+		thread_local arena* tCurrentArena;
+
+		// the default arena is freed with its thread unless blocks from it are still alive in which case it
+		// is left for them
+		struct default_arena
+		{
+			~default_arena()
+			{
+				if (iArena != nullptr && iArena->live_allocations() == 0)
+					delete iArena;
+				iArena = nullptr;
+			}
+			arena& get()
+			{
+				if (iArena == nullptr)
+					iArena = new arena{};
+				return *iArena;
+			}
+			arena* iArena;
+		};
+
+		thread_local default_arena tDefaultArena;
+	}
+
+	arena::arena() :
+		iThread{ std::this_thread::get_id() },
+		iPages{ nullptr },
+		iCursor{ nullptr },
+		iLimit{ nullptr },
+		iLargeBlocks{ nullptr },
+		iRemoteLargeBlocks{ nullptr },
+		iBytesReserved{ 0 },
+		iAllocations{ 0 },
+		iDeallocations{ 0 },
+		iRemoteDeallocations{ 0 }
+	{
+		for (std::size_t sizeClass = 0; sizeClass < SizeClassCount; ++sizeClass)
+		{
+			iFree[sizeClass] = nullptr;
+			iRemoteFree[sizeClass] = nullptr;
+		}
+	}
+
+	arena::~arena()
+	{
+		release_all();
+		if (iPages != nullptr)
+			::operator delete(iPages, std::align_val_t{ PageSize });
+	}
+
+	void* arena::allocate(std::size_t aSize)
+	{
+		++iAllocations;
+		if (aSize <= MaxSmallSize)
+			return allocate_small(size_class(aSize));
+		else if (aSize <= MaxBumpSize)
+			return allocate_bump(aSize);
+		else
+			return allocate_large(aSize);
+	}
+
+	void arena::deallocate(void* aBlock, std::size_t aSize)
+	{
+		if (aBlock == nullptr)
+			return;
+		if (aSize > MaxBumpSize)
+		{
+			static_cast<large_block_header*>(aBlock)[-1].iOwner->deallocate_large(static_cast<large_block_header*>(aBlock) - 1);
+			return;
+		}
+		arena& owner = *page_of(aBlock).iOwner;
+		if (aSize <= MaxSmallSize)
+			owner.deallocate_small(aBlock, size_class(aSize));
+		else if (owner.owned_by_this_thread())
+			++owner.iDeallocations;
+		else
+			owner.iRemoteDeallocations.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void arena::release_all()
+	{
+		// keep the first page for reuse
+		while (iPages != nullptr && iPages->iNext != nullptr)
+		{
+			page_header* next = iPages->iNext;
+			::operator delete(iPages, std::align_val_t{ PageSize });
+			iBytesReserved -= PageSize;
+			iPages = next;
+		}
+		if (iPages != nullptr)
+		{
+			iCursor = reinterpret_cast<char*>(iPages + 1);
+			iLimit = reinterpret_cast<char*>(iPages) + PageSize;
+		}
+		free_remote_large_blocks();
+		while (iLargeBlocks != nullptr)
+		{
+			large_block_header* next = iLargeBlocks->iNext;
+			::operator delete(iLargeBlocks);
+			iLargeBlocks = next;
+		}
+		for (std::size_t sizeClass = 0; sizeClass < SizeClassCount; ++sizeClass)
+		{
+			iFree[sizeClass] = nullptr;
+			iRemoteFree[sizeClass].store(nullptr, std::memory_order_relaxed);
+		}
+		iBytesReserved = (iPages != nullptr ? PageSize : 0);
+		iAllocations = 0;
+		iDeallocations = 0;
+		iRemoteDeallocations.store(0, std::memory_order_relaxed);
+	}
+
+	std::size_t arena::bytes_reserved() const
+	{
+		return iBytesReserved;
+	}
+
+	std::size_t arena::live_allocations() const
+	{
+		return iAllocations - iDeallocations - iRemoteDeallocations.load(std::memory_order_relaxed);
+	}
+
+	arena& arena::current()
+	{
+		if (tCurrentArena != nullptr)
+			return *tCurrentArena;
+		return tDefaultArena.get();
+	}
+
+	arena::page_header& arena::page_of(void* aBlock)
+	{
+		return *reinterpret_cast<page_header*>(reinterpret_cast<std::uintptr_t>(aBlock) & ~static_cast<std::uintptr_t>(PageSize - 1));
+	}
+
+	bool arena::owned_by_this_thread() const
+	{
+		return iThread == std::this_thread::get_id();
+	}
+
+	void* arena::allocate_small(std::size_t aSizeClass)
+	{
+		free_block* block = iFree[aSizeClass];
+		if (block == nullptr)
+			block = iRemoteFree[aSizeClass].exchange(nullptr, std::memory_order_acquire);
+		if (block != nullptr)
+		{
+			iFree[aSizeClass] = block->iNext;
+			return block;
+		}
+		return allocate_bump(MinSize << aSizeClass);
+	}
+
+	void* arena::allocate_bump(std::size_t aSize)
+	{
+		aSize = (aSize + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+		if (static_cast<std::size_t>(iLimit - iCursor) < aSize)
+			new_page();
+		void* block = iCursor;
+		iCursor += aSize;
+		return block;
+	}
+
+	void* arena::allocate_large(std::size_t aSize)
+	{
+		free_remote_large_blocks();
+		large_block_header* block = static_cast<large_block_header*>(::operator new(sizeof(large_block_header) + aSize));
+		block->iOwner = this;
+		block->iPrevious = nullptr;
+		block->iNext = iLargeBlocks;
+		if (iLargeBlocks != nullptr)
+			iLargeBlocks->iPrevious = block;
+		iLargeBlocks = block;
+		return block + 1;
+	}
+
+	void arena::deallocate_small(void* aBlock, std::size_t aSizeClass)
+	{
+		free_block* block = static_cast<free_block*>(aBlock);
+		if (owned_by_this_thread())
+		{
+			++iDeallocations;
+			block->iNext = iFree[aSizeClass];
+			iFree[aSizeClass] = block;
+		}
+		else
+		{
+			iRemoteDeallocations.fetch_add(1, std::memory_order_relaxed);
+			block->iNext = iRemoteFree[aSizeClass].load(std::memory_order_relaxed);
+			while (!iRemoteFree[aSizeClass].compare_exchange_weak(block->iNext, block, std::memory_order_release, std::memory_order_relaxed))
+				;
+		}
+	}
+
+	void arena::deallocate_large(large_block_header* aBlock)
+	{
+		if (owned_by_this_thread())
+		{
+			++iDeallocations;
+			if (aBlock->iPrevious != nullptr)
+				aBlock->iPrevious->iNext = aBlock->iNext;
+			else
+				iLargeBlocks = aBlock->iNext;
+			if (aBlock->iNext != nullptr)
+				aBlock->iNext->iPrevious = aBlock->iPrevious;
+			::operator delete(aBlock);
+		}
+		else
+		{
+			// only the owner may unlink the block; it does so on its next large allocation
+			iRemoteDeallocations.fetch_add(1, std::memory_order_relaxed);
+			aBlock->iNextRemote = iRemoteLargeBlocks.load(std::memory_order_relaxed);
+			while (!iRemoteLargeBlocks.compare_exchange_weak(aBlock->iNextRemote, aBlock, std::memory_order_release, std::memory_order_relaxed))
+				;
+		}
+	}
+
+	void arena::free_remote_large_blocks()
+	{
+		large_block_header* block = iRemoteLargeBlocks.exchange(nullptr, std::memory_order_acquire);
+		while (block != nullptr)
+		{
+			large_block_header* next = block->iNextRemote;
+			if (block->iPrevious != nullptr)
+				block->iPrevious->iNext = block->iNext;
+			else
+				iLargeBlocks = block->iNext;
+			if (block->iNext != nullptr)
+				block->iNext->iPrevious = block->iPrevious;
+			::operator delete(block);
+			block = next;
+		}
+	}
+
+	void arena::new_page()
+	{
+		page_header* page = static_cast<page_header*>(::operator new(PageSize, std::align_val_t{ PageSize }));
+		page->iOwner = this;
+		page->iNext = iPages;
+		iPages = page;
+		iBytesReserved += PageSize;
+		iCursor = reinterpret_cast<char*>(page + 1);
+		iLimit = reinterpret_cast<char*>(page) + PageSize;
+	}
+
+	scoped_arena::scoped_arena() :
+		iOwnedArena{ std::make_unique<arena>() }, iArena{ *iOwnedArena }, iPrevious{ tCurrentArena }
+	{
+		tCurrentArena = &iArena;
+	}
+
+	scoped_arena::scoped_arena(arena& aArena) :
+		iArena{ aArena }, iPrevious{ tCurrentArena }
+	{
+		tCurrentArena = &iArena;
+	}
+
+	scoped_arena::~scoped_arena()
+	{
+		tCurrentArena = iPrevious;
+	}
+
+	arena& scoped_arena::get() const
+	{
+		return iArena;
+	}
+
+	void scoped_arena::release_all()
+	{
+		iArena.release_all();
+	}
+}
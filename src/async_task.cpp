@@ -47,12 +47,33 @@ namespace neolib
 	namespace
 	{
 		const std::size_t kMaxiumPollIterations = 256;
+
+		thread_local async_task* tCurrentTask;
+
+		class current_task_scope
+		{
+		public:
+			current_task_scope(async_task& aTask) : iPrevious{ tCurrentTask }
+			{
+				tCurrentTask = &aTask;
+			}
+			~current_task_scope()
+			{
+				tCurrentTask = iPrevious;
+			}
+		private:
+			async_task* iPrevious;
+		};
 	}
 
 	bool io_service::do_io(bool aProcessEvents)
 	{
 		std::size_t iterationsLeft = kMaxiumPollIterations;
 		bool didSome = false;
+		// an io service stops whenever it runs out of work; work queued since (e.g. a timer armed by a resumed 
+		// coroutine) would otherwise never run
+		if (iNativeIoService.stopped())
+			iNativeIoService.restart();
 		while (iterationsLeft-- > 0)
 		{
 			if (iTask.halted())
@@ -87,6 +108,7 @@ namespace neolib
 	{
 		if (iHalted)
 			return false;
+		current_task_scope scope{ *this };
 		bool didSome = false;
 		didSome = (iTimerIoService.do_io(false) || didSome);
 		didSome = (iNetworkingIoService.do_io(false) || didSome);
@@ -160,8 +182,25 @@ namespace neolib
 		iHalted = true;
 	}
 
+	async_task::schedule_awaiter async_task::schedule()
+	{
+		return schedule_awaiter{ *this };
+	}
+
+	void async_task::resume(const resumer& aResumer)
+	{
+		// resumed from the next do_io() rather than from inside whatever callback is completing
+		iNetworkingIoService.native_object().post(detail::resume_handler{ aResumer });
+	}
+
+	async_task* async_task::current()
+	{
+		return tCurrentTask;
+	}
+
 	void async_task::run()
 	{
+		current_task_scope scope{ *this };
 		while(!iThread.finished())
 			do_io(yield_type::Sleep);
 	}
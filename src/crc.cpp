@@ -35,13 +35,333 @@
 
 #include <neolib/neolib.hpp>
 #include <cstddef>
-#include <zlib/zlib.h>
+#include <cstring>
+#include <vector>
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define NEOLIB_CRC_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#include <emmintrin.h>
+#include <smmintrin.h>
+#include <nmmintrin.h>
+#include <wmmintrin.h>
+#endif
+#include <neolib/parallel_algorithm.hpp>
 #include <neolib/crc.hpp>
 
+#if defined(NEOLIB_CRC_X86) && defined(__GNUC__)
+#define NEOLIB_CRC_TARGET(features) __attribute__((target(features)))
+#else
+#define NEOLIB_CRC_TARGET(features)
+#endif
+
 namespace neolib
 {
-	uint32_t crc32(const uint8_t *aData, uint32_t aDataLength)
+	namespace
+	{
+		class crc_tables
+		{
+		public:
+			crc_tables(uint32_t aPolynomial) : iPolynomial{ aPolynomial }
+			{
+				for (uint32_t i = 0; i < 256; ++i)
+				{
+					uint32_t value = i;
+					for (int bit = 0; bit < 8; ++bit)
+						value = (value & 1u) ? (value >> 1) ^ aPolynomial : value >> 1;
+					iSlices[0][i] = value;
+				}
+				for (std::size_t slice = 1; slice < 16; ++slice)
+					for (uint32_t i = 0; i < 256; ++i)
+						iSlices[slice][i] = (iSlices[slice - 1][i] >> 8) ^ iSlices[0][iSlices[slice - 1][i] & 0xFFu];
+				// iPowers[k] = x^(2^k) mod P, so that x^n is a product of at most 64 of these
+				iPowers[0] = 1u << 30;
+				for (std::size_t k = 1; k < 64; ++k)
+					iPowers[k] = multiply(iPowers[k - 1], iPowers[k - 1]);
+			}
+		public:
+			// reflected polynomial product modulo P
+			uint32_t multiply(uint32_t aA, uint32_t aB) const
+			{
+				uint32_t product = 0;
+				for (uint32_t mask = 1u << 31; mask != 0; mask >>= 1)
+				{
+					if (aA & mask)
+					{
+						product ^= aB;
+						if ((aA & (mask - 1)) == 0)
+							break;
+					}
+					aB = (aB & 1u) ? (aB >> 1) ^ iPolynomial : aB >> 1;
+				}
+				return product;
+			}
+			// x^(8 * aBytes) mod P: multiplying a CRC register by this appends aBytes zero bytes to it
+			uint32_t shift(uint64_t aBytes) const
+			{
+				uint32_t result = 1u << 31;
+				for (std::size_t k = 3; aBytes != 0; aBytes >>= 1, ++k)
+					if (aBytes & 1u)
+						result = multiply(iPowers[k & 63], result);
+				return result;
+			}
+			// slice-by-16: sixteen table lookups per sixteen bytes with no dependency between them
+			uint32_t update(uint32_t aRegister, const uint8_t* aData, std::size_t aLength) const
+			{
+				for (; aLength >= 16; aLength -= 16, aData += 16)
+				{
+					uint32_t const w0 = read32(aData) ^ aRegister;
+					uint32_t const w1 = read32(aData + 4);
+					uint32_t const w2 = read32(aData + 8);
+					uint32_t const w3 = read32(aData + 12);
+					aRegister =
+						iSlices[15][w0 & 0xFFu] ^ iSlices[14][(w0 >> 8) & 0xFFu] ^ iSlices[13][(w0 >> 16) & 0xFFu] ^ iSlices[12][w0 >> 24] ^
+						iSlices[11][w1 & 0xFFu] ^ iSlices[10][(w1 >> 8) & 0xFFu] ^ iSlices[9][(w1 >> 16) & 0xFFu] ^ iSlices[8][w1 >> 24] ^
+						iSlices[7][w2 & 0xFFu] ^ iSlices[6][(w2 >> 8) & 0xFFu] ^ iSlices[5][(w2 >> 16) & 0xFFu] ^ iSlices[4][w2 >> 24] ^
+						iSlices[3][w3 & 0xFFu] ^ iSlices[2][(w3 >> 8) & 0xFFu] ^ iSlices[1][(w3 >> 16) & 0xFFu] ^ iSlices[0][w3 >> 24];
+				}
+				while (aLength--)
+					aRegister = iSlices[0][(aRegister ^ *aData++) & 0xFFu] ^ (aRegister >> 8);
+				return aRegister;
+			}
+		private:
+			static uint32_t read32(const uint8_t* aData)
+			{
+				return static_cast<uint32_t>(aData[0]) | (static_cast<uint32_t>(aData[1]) << 8) | (static_cast<uint32_t>(aData[2]) << 16) | (static_cast<uint32_t>(aData[3]) << 24);
+			}
+		private:
+			uint32_t iPolynomial;
+			uint32_t iSlices[16][256];
+			uint32_t iPowers[64];
+		};
+
+		const crc_tables& tables(crc_polynomial aPolynomial)
+		{
+			static const crc_tables sCrc32{ static_cast<uint32_t>(crc_polynomial::Crc32) };
+			static const crc_tables sCrc32c{ static_cast<uint32_t>(crc_polynomial::Crc32c) };
+			return aPolynomial == crc_polynomial::Crc32c ? sCrc32c : sCrc32;
+		}
+
+#ifdef NEOLIB_CRC_X86
+		struct cpu_features
+		{
+			bool sse42;
+			bool pclmul;
+			cpu_features() : sse42{ false }, pclmul{ false }
+			{
+#ifdef _MSC_VER
+				int registers[4];
+				__cpuid(registers, 1);
+				unsigned int const ecx = static_cast<unsigned int>(registers[2]);
+#else
+				unsigned int eax, ebx, ecx = 0, edx;
+				if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+					return;
+#endif
+				sse42 = (ecx & (1u << 20)) != 0;
+				// the folding code also uses SSE4.1, which every CPU with SSE4.2 has
+				pclmul = sse42 && (ecx & (1u << 1)) != 0;
+			}
+		};
+
+		const cpu_features& cpu()
+		{
+			static const cpu_features sFeatures;
+			return sFeatures;
+		}
+
+		NEOLIB_CRC_TARGET("sse4.2")
+		uint32_t crc32c_stream(uint32_t aRegister, const uint8_t* aData, std::size_t aLength)
+		{
+#if defined(_M_X64) || defined(__x86_64__)
+			uint64_t value = aRegister;
+			for (; aLength >= 8; aLength -= 8, aData += 8)
+			{
+				uint64_t word;
+				std::memcpy(&word, aData, sizeof(word));
+				value = _mm_crc32_u64(value, word);
+			}
+			aRegister = static_cast<uint32_t>(value);
+#else
+			for (; aLength >= 4; aLength -= 4, aData += 4)
+			{
+				uint32_t word;
+				std::memcpy(&word, aData, sizeof(word));
+				aRegister = _mm_crc32_u32(aRegister, word);
+			}
+#endif
+			while (aLength--)
+				aRegister = _mm_crc32_u8(aRegister, *aData++);
+			return aRegister;
+		}
+
+		// The crc32 instruction has a latency of three cycles but a throughput of one per cycle, so three independent
+		// streams are run over adjacent blocks and their registers merged by shifting.
+		NEOLIB_CRC_TARGET("sse4.2")
+		uint32_t crc32c_hardware(uint32_t aRegister, const uint8_t* aData, std::size_t aLength)
+		{
+			std::size_t const Block = 4096;
+			if (aLength >= Block * 3)
+			{
+				const crc_tables& crc32cTables = tables(crc_polynomial::Crc32c);
+				static uint32_t const sBlockShift = crc32cTables.shift(Block);
+				for (; aLength >= Block * 3; aLength -= Block * 3, aData += Block * 3)
+				{
+					uint64_t a = aRegister;
+					uint64_t b = 0;
+					uint64_t c = 0;
+					for (std::size_t i = 0; i < Block; i += 8)
+					{
+						uint64_t wordA, wordB, wordC;
+						std::memcpy(&wordA, aData + i, 8);
+						std::memcpy(&wordB, aData + Block + i, 8);
+						std::memcpy(&wordC, aData + Block * 2 + i, 8);
+#if defined(_M_X64) || defined(__x86_64__)
+						a = _mm_crc32_u64(a, wordA);
+						b = _mm_crc32_u64(b, wordB);
+						c = _mm_crc32_u64(c, wordC);
+#else
+						a = _mm_crc32_u32(_mm_crc32_u32(static_cast<uint32_t>(a), static_cast<uint32_t>(wordA)), static_cast<uint32_t>(wordA >> 32));
+						b = _mm_crc32_u32(_mm_crc32_u32(static_cast<uint32_t>(b), static_cast<uint32_t>(wordB)), static_cast<uint32_t>(wordB >> 32));
+						c = _mm_crc32_u32(_mm_crc32_u32(static_cast<uint32_t>(c), static_cast<uint32_t>(wordC)), static_cast<uint32_t>(wordC >> 32));
+#endif
+					}
+					uint32_t const ab = crc32cTables.multiply(sBlockShift, static_cast<uint32_t>(a)) ^ static_cast<uint32_t>(b);
+					aRegister = crc32cTables.multiply(sBlockShift, ab) ^ static_cast<uint32_t>(c);
+				}
+			}
+			return crc32c_stream(aRegister, aData, aLength);
+		}
+
+		/* CRC-32 by carry-less multiplication: four 128 bit accumulators are folded forward 64 bytes at a time, then
+		   folded into one and Barrett reduced to 32 bits. See Gopal et al., "Fast CRC Computation for Generic
+		   Polynomials Using PCLMULQDQ Instruction" (Intel, 2009). aLength must be at least 64 and a multiple of 16. */
+		NEOLIB_CRC_TARGET("sse4.1,pclmul")
+		uint32_t crc32_fold(uint32_t aRegister, const uint8_t* aData, std::size_t aLength)
+		{
+			alignas(16) static const uint64_t k1k2[] = { 0x0154442BD4ull, 0x01C6E41596ull };
+			alignas(16) static const uint64_t k3k4[] = { 0x01751997D0ull, 0x00CCAA009Eull };
+			alignas(16) static const uint64_t k5k0[] = { 0x0163CD6124ull, 0x0000000000ull };
+			alignas(16) static const uint64_t poly[] = { 0x01DB710641ull, 0x01F7011641ull };
+
+			__m128i x1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aData));
+			__m128i x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aData + 16));
+			__m128i x3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aData + 32));
+			__m128i x4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aData + 48));
+			x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(static_cast<int>(aRegister)));
+			__m128i x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(k1k2));
+			aData += 64;
+			aLength -= 64;
+			for (; aLength >= 64; aLength -= 64, aData += 64)
+			{
+				__m128i const x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+				__m128i const x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+				__m128i const x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+				__m128i const x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+				x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+				x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+				x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+				x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+				x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128(reinterpret_cast<const __m128i*>(aData)));
+				x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128(reinterpret_cast<const __m128i*>(aData + 16)));
+				x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128(reinterpret_cast<const __m128i*>(aData + 32)));
+				x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128(reinterpret_cast<const __m128i*>(aData + 48)));
+			}
+			// fold the four accumulators into one
+			x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(k3k4));
+			x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, x0, 0x11), x2), _mm_clmulepi64_si128(x1, x0, 0x00));
+			x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, x0, 0x11), x3), _mm_clmulepi64_si128(x1, x0, 0x00));
+			x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, x0, 0x11), x4), _mm_clmulepi64_si128(x1, x0, 0x00));
+			for (; aLength >= 16; aLength -= 16, aData += 16)
+			{
+				x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, x0, 0x11), _mm_loadu_si128(reinterpret_cast<const __m128i*>(aData))), _mm_clmulepi64_si128(x1, x0, 0x00));
+			}
+			// 128 bits to 64 bits
+			x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+			__m128i const mask = _mm_setr_epi32(~0, 0, ~0, 0);
+			x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+			x0 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(k5k0));
+			x2 = _mm_srli_si128(x1, 4);
+			x1 = _mm_xor_si128(_mm_clmulepi64_si128(_mm_and_si128(x1, mask), x0, 0x00), x2);
+			// Barrett reduction to 32 bits
+			x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(poly));
+			x2 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask), x0, 0x10);
+			x2 = _mm_clmulepi64_si128(_mm_and_si128(x2, mask), x0, 0x00);
+			x1 = _mm_xor_si128(x1, x2);
+			return static_cast<uint32_t>(_mm_extract_epi32(x1, 1));
+		}
+#endif
+
+		// Continues a CRC register (the CRC value before its final inversion).
+		uint32_t update(crc_polynomial aPolynomial, uint32_t aRegister, const uint8_t* aData, std::size_t aLength)
+		{
+#ifdef NEOLIB_CRC_X86
+			if (aPolynomial == crc_polynomial::Crc32c && cpu().sse42)
+				return crc32c_hardware(aRegister, aData, aLength);
+			if (aPolynomial == crc_polynomial::Crc32 && cpu().pclmul && aLength >= 64)
+			{
+				std::size_t const folded = aLength & ~static_cast<std::size_t>(15);
+				aRegister = crc32_fold(aRegister, aData, folded);
+				aData += folded;
+				aLength -= folded;
+			}
+#endif
+			return tables(aPolynomial).update(aRegister, aData, aLength);
+		}
+	}
+
+	uint32_t crc(crc_polynomial aPolynomial, uint32_t aCrc, const void* aData, uint64_t aLength)
+	{
+		const uint8_t* data = static_cast<const uint8_t*>(aData);
+		uint32_t crcRegister = ~aCrc;
+		// split so that lengths beyond the range of size_t on 32 bit targets are still accepted
+		std::size_t const MaxChunk = static_cast<std::size_t>(1) << (sizeof(std::size_t) * 8 - 2);
+		while (aLength != 0)
+		{
+			std::size_t const chunk = aLength > MaxChunk ? MaxChunk : static_cast<std::size_t>(aLength);
+			crcRegister = update(aPolynomial, crcRegister, data, chunk);
+			data += chunk;
+			aLength -= chunk;
+		}
+		return ~crcRegister;
+	}
+
+	uint32_t crc_combine(crc_polynomial aPolynomial, uint32_t aCrc1, uint32_t aCrc2, uint64_t aLength2)
+	{
+		const crc_tables& polynomialTables = tables(aPolynomial);
+		return polynomialTables.multiply(polynomialTables.shift(aLength2), aCrc1) ^ aCrc2;
+	}
+
+	uint32_t parallel_crc(thread_pool& aThreadPool, crc_polynomial aPolynomial, const void* aData, uint64_t aLength)
 	{
-		return ::crc32(::crc32(0, NULL, 0), aData, aDataLength);
+		uint64_t const BlockSize = 1024 * 1024;
+		if (aLength <= BlockSize * 2)
+			return crc(aPolynomial, 0u, aData, aLength);
+		const uint8_t* data = static_cast<const uint8_t*>(aData);
+		std::size_t const blocks = static_cast<std::size_t>((aLength + BlockSize - 1) / BlockSize);
+		std::vector<uint32_t> blockCrcs(blocks);
+		detail::parallel_run(aThreadPool, blocks, 1,
+			[&](detail::parallel_batch& aBatch, std::size_t aBegin, std::size_t aEnd)
+		{
+			aBatch.participate(aBegin, aEnd,
+				[&](std::size_t aChunkBegin, std::size_t aChunkEnd)
+			{
+				for (std::size_t block = aChunkBegin; block < aChunkEnd; ++block)
+				{
+					uint64_t const offset = block * BlockSize;
+					blockCrcs[block] = crc(aPolynomial, 0u, data + offset, std::min(BlockSize, aLength - offset));
+				}
+			}, []() {});
+		});
+		uint32_t result = blockCrcs[0];
+		// all but the last block are BlockSize long so one shift constant does for them
+		const crc_tables& polynomialTables = tables(aPolynomial);
+		uint32_t const blockShift = polynomialTables.shift(BlockSize);
+		for (std::size_t block = 1; block < blocks - 1; ++block)
+			result = polynomialTables.multiply(blockShift, result) ^ blockCrcs[block];
+		return crc_combine(aPolynomial, result, blockCrcs[blocks - 1], aLength - (blocks - 1) * BlockSize);
 	}
-}
\ No newline at end of file
+}
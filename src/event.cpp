@@ -20,7 +20,6 @@
 #include <neolib/neolib.hpp>
 #include <neolib/async_thread.hpp>
 #include <neolib/async_task.hpp>
-#include <neolib/timer.hpp>
 #include <neolib/event.hpp>
 
 namespace neolib
@@ -33,10 +32,81 @@ namespace neolib
 			iOwner{ aOwner }
 		{
 		}
+	protected:
+		void exec() override
+		{
+			iOwner.run_local_thread(*this);
+		}
 	private:
 		async_event_queue& iOwner;
 	};
 
+	async_event_queue::delivery_queue::delivery_queue() :
+		iWakePending{ false }, iWaiters{ 0 }
+	{
+	}
+
+	void async_event_queue::delivery_queue::push(queued_event&& aEvent)
+	{
+		iEvents.push(std::move(aEvent));
+		// only the first event since the consumer last looked needs to wake it
+		if (!iWakePending.exchange(true))
+			wake();
+	}
+
+	bool async_event_queue::delivery_queue::pop(queued_event& aEvent)
+	{
+		return iEvents.pop(aEvent);
+	}
+
+	bool async_event_queue::delivery_queue::empty() const
+	{
+		return iEvents.empty();
+	}
+
+	void async_event_queue::delivery_queue::set_poster(std::function<void()> aPoster)
+	{
+		iPoster = aPoster;
+	}
+
+	bool async_event_queue::delivery_queue::wait(std::optional<std::chrono::steady_clock::time_point> aDeadline)
+	{
+		std::unique_lock<std::mutex> lock{ iMutex };
+		++iWaiters;
+		iWakePending = false;
+		bool woken = true;
+		if (iEvents.empty())
+		{
+			if (aDeadline)
+				woken = (iCondition.wait_until(lock, *aDeadline) == std::cv_status::no_timeout);
+			else
+				iCondition.wait(lock);
+		}
+		--iWaiters;
+		return woken;
+	}
+
+	void async_event_queue::delivery_queue::wake()
+	{
+		if (iPoster)
+			iPoster();
+		if (iWaiters.load() != 0)
+		{
+			std::lock_guard<std::mutex> lg{ iMutex };
+			iCondition.notify_all();
+		}
+	}
+
+	void async_event_queue::delivery_queue::begin_delivery()
+	{
+		iWakePending = false;
+	}
+
+	std::vector<async_event_queue::queued_event>& async_event_queue::delivery_queue::batch()
+	{
+		return iBatch;
+	}
+
 	async_event_queue::async_event_queue() :
 		async_event_queue{ std::make_shared<local_thread>(*this) }
 	{
@@ -46,33 +116,45 @@ namespace neolib
 	async_event_queue::async_event_queue(async_task& aTask) : 
 		async_event_queue{ std::shared_ptr<async_task>{std::shared_ptr<async_task>{}, &aTask} }
 	{
+		iEvents.set_poster([this]()
+		{
+			iTask->networking_io_service().native_object().post([this]() { publish_events(); });
+		});
 		std::lock_guard lg{ instance_mutex() };
 		instance_ptrs().aliased = this;
 	}
 
 	async_event_queue::async_event_queue(std::shared_ptr<async_task> aTask) :
-		iTask { aTask },
-		iTimer {
-			*aTask,
-			[this](neolib::callback_timer& aTimer)
-			{
-				publish_events();
-				if (!iEvents.empty() && !aTimer.waiting())
-					aTimer.again();
-				if (iCache.first && std::chrono::steady_clock::now() > iCache.second)
-					iCache.first.reset();
-			}, 1, false
-		},
-		iHaveThreadedCallbacks{ false },
-		iTerminated{ false }
+		iTask{ aTask },
+		iThreadQueues{ nullptr },
+		iCoalescing{ false },
+		iTerminated{ false },
+		iStopping{ false }
 	{
 	}
 
 	async_event_queue::~async_event_queue()
 	{
 		exec();
-		while (iHaveThreadedCallbacks)
-			std::this_thread::sleep_for(std::chrono::milliseconds{ 1 });
+		for (bool pending = true; pending && !iTerminated;)
+		{
+			pending = false;
+			for (auto q = iThreadQueues.load(); q != nullptr; q = q->next)
+				if (!q->queue.empty())
+					pending = true;
+			if (pending)
+				std::this_thread::sleep_for(std::chrono::milliseconds{ 1 });
+		}
+		iStopping = true;
+		iEvents.wake();
+		if (dynamic_cast<local_thread*>(&*iTask) != nullptr)
+			iTask->thread().abort();
+		for (auto q = iThreadQueues.exchange(nullptr); q != nullptr;)
+		{
+			auto next = q->next;
+			delete q;
+			q = next;
+		}
 		std::lock_guard lg{ instance_mutex() };
 		if (instance_ptrs().aliased == this)
 			instance_ptrs().aliased = nullptr;
@@ -104,109 +186,249 @@ namespace neolib
 
 	bool async_event_queue::exec()
 	{
-		bool didSome = false;
-		if (iHaveThreadedCallbacks)
-		{
-			event_callback_list work;
-			{
-				destroyable_mutex_lock_guard<event_mutex> guard{ iThreadedCallbacksMutex };
-				work = std::move(iThreadedCallbacks[std::this_thread::get_id()]);
-				iThreadedCallbacks.erase(iThreadedCallbacks.find(std::this_thread::get_id()));
-				iHaveThreadedCallbacks = !iThreadedCallbacks.empty();
-			}
-			for (auto& cl : work)
-			{
-				for (auto& cb : cl.second)
-				{
-					if (iTerminated)
-						return didSome;
-					cb();
-					didSome = true;
-				}
-			}
-		}
-		return didSome;
+		auto q = find_thread_queue(std::this_thread::get_id());
+		if (q == nullptr)
+			return false;
+		q->queue.begin_delivery();
+		return deliver(q->queue);
+	}
+
+	bool async_event_queue::wait(std::chrono::milliseconds aTimeout)
+	{
+		auto& q = thread_queue_for(std::this_thread::get_id());
+		q.queue.wait(std::chrono::steady_clock::now() + aTimeout);
+		return !q.queue.empty();
 	}
 
 	void async_event_queue::terminate()
 	{
-		destroyable_mutex_lock_guard<event_mutex> guard{ iThreadedCallbacksMutex };
 		iTerminated = true;
-		iEvents.clear();
-		if (iTimer.waiting())
-			iTimer.cancel();
-		iThreadedCallbacks.clear();
-		iHaveThreadedCallbacks = false;
+		iEvents.wake();
+		for (auto q = iThreadQueues.load(); q != nullptr; q = q->next)
+			q->queue.wake();
 	}
 
 	void async_event_queue::persist(std::shared_ptr<async_event_queue> aPtr, uint32_t aDuration_ms)
 	{
-		iCache.first = aPtr;
-		iCache.second = std::chrono::steady_clock::now() + std::chrono::milliseconds(aDuration_ms);
+		{
+			std::lock_guard<std::mutex> lg{ iCacheMutex };
+			iCache.first = aPtr;
+			iCache.second = std::chrono::steady_clock::now() + std::chrono::milliseconds(aDuration_ms);
+		}
+		iEvents.wake(); // so that the local thread waits for the new expiry time
+	}
+
+	bool async_event_queue::coalescing() const
+	{
+		return iCoalescing;
 	}
 
-	void async_event_queue::enqueue_to_thread(const void* aEvent, std::thread::id aThreadId, callback aCallback)
+	void async_event_queue::set_coalescing(bool aCoalescing)
+	{
+		iCoalescing = aCoalescing;
+	}
+
+	void async_event_queue::enqueue_to_thread(const void* aEvent, std::thread::id aThreadId, callback aCallback, const void* aHandler)
 	{
 		if (iTerminated)
 			return;
-		destroyable_mutex_lock_guard<event_mutex> guard{ iThreadedCallbacksMutex };
-		iThreadedCallbacks[aThreadId][aEvent].push_back(aCallback);
-		iHaveThreadedCallbacks = true;
+		thread_queue_for(aThreadId).queue.push(queued_event{ aEvent, aHandler, std::move(aCallback), nullptr });
 	}
 
-	void async_event_queue::unqueue(const void* aEvent)
-	{
+	void async_event_queue::unqueue(const void* aEvent)
+	{
 		if (iTerminated)
 			return;
-		destroyable_mutex_lock_guard<event_mutex> guard{ iThreadedCallbacksMutex };
-		remove(aEvent);
-	}
+		remove(aEvent);
+	}
 
 	void async_event_queue::add(const void* aEvent, callback aCallback, neolib::lifetime::destroyed_flag aDestroyedFlag)
 	{
 		if (iTerminated)
 			return;
-		destroyable_mutex_lock_guard<event_mutex> guard{ iEventsMutex };
-		iEvents.emplace(aEvent, std::make_pair(aCallback, aDestroyedFlag));
-		if (!iTimer.waiting())
-			iTimer.again();
+		auto pending = std::make_unique<pending_event>(aEvent, std::move(aCallback), aDestroyedFlag);
+		{
+			std::lock_guard<std::mutex> lg{ iPendingMutex };
+			link(*pending);
+		}
+		iEvents.push(queued_event{ aEvent, aEvent, callback{}, std::move(pending) });
 	}
 
 	void async_event_queue::remove(const void* aEvent)
 	{
 		if (iTerminated)
 			return;
-		event_list toPublish;
+		std::vector<std::pair<callback, event_lifetime::destroyed_flag>> toPublish;
 		{
-			destroyable_mutex_lock_guard<event_mutex> guard{ iEventsMutex };
-			auto events = iEvents.equal_range(aEvent);
-			if (events.first == events.second)
+			std::lock_guard<std::mutex> lg{ iPendingMutex };
+			auto existing = iPending.find(aEvent);
+			if (existing == iPending.end())
 				throw event_not_found();
-			toPublish.insert(events.first, events.second);
-			iEvents.erase(events.first, events.second);
+			// the claimed triggers stay in the queue until it is consumed and are skipped then
+			for (auto pending = existing->second.first; pending != nullptr; pending = pending->iNext)
+			{
+				pending->iClaimed = true;
+				toPublish.emplace_back(std::move(pending->iCallback), pending->iDestroyedFlag);
+			}
+			iPending.erase(existing);
 		}
 		for (auto& e : toPublish)
-			if (!e.second.second)
-				e.second.first();
+			if (!e.second)
+				e.first();
 	}
 
 	bool async_event_queue::has(const void* aEvent) const
 	{
-		destroyable_mutex_lock_guard<event_mutex> guard{ iEventsMutex };
-		return iEvents.find(aEvent) != iEvents.end();
+		std::lock_guard<std::mutex> lg{ iPendingMutex };
+		return iPending.find(aEvent) != iPending.end();
 	}
 
-	void async_event_queue::publish_events()
+	// called with iPendingMutex held
+	void async_event_queue::link(pending_event& aPending)
+	{
+		auto& list = iPending[aPending.iEvent];
+		aPending.iPrevious = list.last;
+		if (list.last != nullptr)
+			list.last->iNext = &aPending;
+		else
+			list.first = &aPending;
+		list.last = &aPending;
+	}
+
+	// called with iPendingMutex held
+	void async_event_queue::unlink(pending_event& aPending)
+	{
+		auto existing = iPending.find(aPending.iEvent);
+		auto& list = existing->second;
+		if (aPending.iPrevious != nullptr)
+			aPending.iPrevious->iNext = aPending.iNext;
+		else
+			list.first = aPending.iNext;
+		if (aPending.iNext != nullptr)
+			aPending.iNext->iPrevious = aPending.iPrevious;
+		else
+			list.last = aPending.iPrevious;
+		aPending.iClaimed = true;
+		if (list.first == nullptr)
+			iPending.erase(existing);
+	}
+
+	bool async_event_queue::publish_events()
+	{
+		iEvents.begin_delivery();
+		return deliver(iEvents);
+	}
+
+	bool async_event_queue::deliver(delivery_queue& aQueue)
 	{
 		if (iTerminated)
-			return;
-		event_list toPublish;
 		{
-			destroyable_mutex_lock_guard<event_mutex> guard{ iEventsMutex };
-			toPublish.swap(iEvents);
+			for (queued_event discarded; aQueue.pop(discarded);)
+				if (discarded.iPending != nullptr)
+				{
+					std::lock_guard<std::mutex> lg{ iPendingMutex };
+					if (!discarded.iPending->iClaimed)
+						unlink(*discarded.iPending);
+				}
+			return false;
 		}
-		for (auto& e : toPublish)
-			if (!e.second.second)
-				e.second.first();
+		// the batch buffer is borrowed so that a callback can deliver (e.g. call exec()) recursively
+		std::vector<queued_event> batch;
+		batch.swap(aQueue.batch());
+		for (queued_event e; aQueue.pop(e);)
+			batch.push_back(std::move(e));
+		bool havePending = false;
+		for (auto& e : batch)
+			havePending = havePending || e.iPending != nullptr;
+		if (havePending)
+		{
+			// claim the add()ed triggers that remove() hasn't already published
+			std::lock_guard<std::mutex> lg{ iPendingMutex };
+			for (auto& e : batch)
+				if (e.iPending != nullptr && !e.iPending->iClaimed)
+				{
+					unlink(*e.iPending);
+					e.iCallback = std::move(e.iPending->iCallback);
+				}
+		}
+		if (iCoalescing && batch.size() > 1)
+		{
+			for (auto e = batch.rbegin(); e != batch.rend(); ++e)
+				if (e->iCallback && e->iHandler != nullptr)
+					for (auto earlier = std::next(e); earlier != batch.rend(); ++earlier)
+						if (earlier->iEvent == e->iEvent && earlier->iHandler == e->iHandler)
+							earlier->iCallback = nullptr;
+		}
+		bool didSome = false;
+		for (auto& e : batch)
+		{
+			if (iTerminated)
+				break;
+			if (!e.iCallback || (e.iPending != nullptr && e.iPending->iDestroyedFlag))
+				continue;
+			e.iCallback();
+			didSome = true;
+		}
+		batch.clear();
+		if (aQueue.batch().empty())
+			batch.swap(aQueue.batch());
+		return didSome;
+	}
+
+	async_event_queue::thread_queue* async_event_queue::find_thread_queue(std::thread::id aThreadId) const
+	{
+		for (auto q = iThreadQueues.load(); q != nullptr; q = q->next)
+			if (q->threadId == aThreadId)
+				return q;
+		return nullptr;
+	}
+
+	async_event_queue::thread_queue& async_event_queue::thread_queue_for(std::thread::id aThreadId)
+	{
+		// thread queues are only ever added (lock-free, to the front of the list) and are freed with the event queue
+		auto existing = find_thread_queue(aThreadId);
+		if (existing != nullptr)
+			return *existing;
+		auto newQueue = std::make_unique<thread_queue>();
+		newQueue->threadId = aThreadId;
+		newQueue->next = iThreadQueues.load();
+		while (!iThreadQueues.compare_exchange_weak(newQueue->next, newQueue.get()))
+		{
+			for (auto q = newQueue->next; q != nullptr; q = q->next)
+				if (q->threadId == aThreadId)
+					return *q;
+		}
+		return *newQueue.release();
+	}
+
+	void async_event_queue::run_local_thread(local_thread& aThread)
+	{
+		while (!aThread.finished() && !iStopping)
+		{
+			std::optional<std::chrono::steady_clock::time_point> cacheExpiry;
+			{
+				std::lock_guard<std::mutex> lg{ iCacheMutex };
+				if (iCache.first && iCache.second != std::chrono::steady_clock::time_point::max())
+					cacheExpiry = iCache.second;
+			}
+			iEvents.wait(cacheExpiry);
+			if (iStopping)
+				break;
+			publish_events();
+			release_expired_cache();
+		}
+	}
+
+	void async_event_queue::release_expired_cache()
+	{
+		std::lock_guard<std::mutex> lg{ iCacheMutex };
+		if (!iCache.first || std::chrono::steady_clock::now() <= iCache.second)
+			return;
+		// the queue can't be destroyed from its own thread so while the cache holds the only reference the 
+		// queue stays cached (instance() goes on returning it) until persist() is called again
+		if (iCache.first.use_count() == 1)
+			iCache.second = std::chrono::steady_clock::time_point::max();
+		else
+			iCache.first.reset();
 	}
-}
\ No newline at end of file
+}
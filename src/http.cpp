@@ -190,7 +190,7 @@ namespace neolib
 		return false;
 	}
 
-	void http::request(const std::string& aUrl, type_e aType, const headers_t& aRequestHeaders, const neolib::variant<body_t, std::string>& aRequestBody)
+	http::request_awaiter http::request(const std::string& aUrl, type_e aType, const headers_t& aRequestHeaders, const neolib::variant<body_t, std::string>& aRequestBody)
 	{
 		bool secure = false;
 		if (make_ci_string(aUrl).find("http://") == 0)
@@ -198,19 +198,19 @@ namespace neolib
 		else if (make_ci_string(aUrl).find("https://") == 0)
 			secure = true;
 		else
-			return;
+			return failed_request();
 		typedef std::pair<std::string::const_iterator, std::string::const_iterator> string_pair;
 		neolib::vecarray<string_pair, 2> parts;
 		std::string delim = "//";
 		neolib::tokens(aUrl.begin(),aUrl.end(), delim.begin(), delim.end(), parts, 2, true, true);
 		if (parts.size() != 2)
-			return;
+			return failed_request();
 		string_pair second = parts[1];
 		parts.clear();
 		delim = "/";
 		neolib::tokens(second.first, second.second, delim.begin(), delim.end(), parts, 2);
 		if (parts.empty())
-			return;
+			return failed_request();
 		std::string resource = "/";
 		if (parts.size() == 2)
 			resource = "/" + std::string(parts[1].first, aUrl.end());
@@ -219,15 +219,15 @@ namespace neolib
 		delim = ":";
 		neolib::tokens(first.first, first.second, delim.begin(), delim.end(), parts, 2);
 		if (parts.empty())
-			return;
+			return failed_request();
 		std::optional<unsigned short> port;
 		if (parts.size() == 2)
 			port = static_cast<unsigned short>(neolib::string_to_uint32(std::string(parts[1].first, parts[1].second)));
 		std::string address = std::string(parts[0].first, parts[0].second);
-		request(address, resource, aType, port ? *port : secure ? 443 : 80, secure, aRequestHeaders, aRequestBody);
+		return request(address, resource, aType, port ? *port : secure ? 443 : 80, secure, aRequestHeaders, aRequestBody);
 	}
 
-	void http::request(const std::string& aHost, const std::string& aResource, type_e aType, unsigned short aPort, bool aSecure, const headers_t& aRequestHeaders, const neolib::variant<body_t, std::string>& aRequestBody)
+	http::request_awaiter http::request(const std::string& aHost, const std::string& aResource, type_e aType, unsigned short aPort, bool aSecure, const headers_t& aRequestHeaders, const neolib::variant<body_t, std::string>& aRequestBody)
 	{
 		init();
 		iHost = aHost;
@@ -243,7 +243,18 @@ namespace neolib
 		if (iPacketStream.open(aHost, aPort, aSecure))
 			notify_observers(i_http_observer::NotifyStarted);
 		else
+		{
+			iState = Finished;
 			notify_observers(i_http_observer::NotifyFailure);
+		}
+		return request_awaiter{ *this };
+	}
+
+	http::request_awaiter http::failed_request()
+	{
+		init();
+		iState = Finished;
+		return request_awaiter{ *this };
 	}
 
 	double http::percent_done() const
@@ -288,6 +299,7 @@ namespace neolib
 
 	void http::connection_failure(packet_stream_type& aStream, const boost::system::error_code&)
 	{
+		iState = Finished;
 		iBodyLength.reset();
 		iBody.clear();
 		notify_observers(i_http_observer::NotifyFailure);
@@ -357,6 +369,7 @@ namespace neolib
 
 	void http::transfer_failure(packet_stream_type& aStream, const boost::system::error_code&)
 	{
+		iState = Finished;
 		iBodyLength.reset();
 		iBody.clear();
 		notify_observers(i_http_observer::NotifyFailure);
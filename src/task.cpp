@@ -0,0 +1,194 @@
+// task.cpp
+/*
+ *  Copyright (c) 2018 Leigh Johnston.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *     * Neither the name of Leigh Johnston nor the names of any
+ *       other contributors to this software may be used to endorse or
+ *       promote products derived from this software without specific prior
+ *       written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ *  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <neolib/neolib.hpp>
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <neolib/task.hpp>
+
+namespace neolib
+{
+	namespace
+	{
+		class task_slab_cache
+		{
+		public:
+			static constexpr std::size_t SizeClassGranularity = 64;
+			static constexpr std::size_t SizeClassCount = 8;
+			static constexpr std::size_t MaxBlockSize = SizeClassGranularity * SizeClassCount;
+			static constexpr std::size_t SlabSize = 16 * 1024;
+		private:
+			struct alignas(std::max_align_t) block_header
+			{
+				task_slab_cache* iOwner;
+				block_header* iNext;
+			};
+			// construction
+		private:
+			task_slab_cache()
+			{
+				for (std::size_t sizeClass = 0; sizeClass < SizeClassCount; ++sizeClass)
+				{
+					iFree[sizeClass] = nullptr;
+					iRemoteFree[sizeClass] = nullptr;
+				}
+			}
+			// operations
+		public:
+			static std::size_t size_class(std::size_t aSize)
+			{
+				return aSize == 0 ? 0 : (aSize - 1) / SizeClassGranularity;
+			}
+			static task_slab_cache* current()
+			{
+				return tCurrent;
+			}
+			static task_slab_cache& acquire()
+			{
+				if (tCurrent == nullptr)
+					tOwner.adopt();
+				return *tCurrent;
+			}
+			void* allocate(std::size_t aSizeClass)
+			{
+				block_header* block = iFree[aSizeClass];
+				if (block == nullptr)
+					block = iFree[aSizeClass] = iRemoteFree[aSizeClass].exchange(nullptr, std::memory_order_acquire);
+				if (block == nullptr)
+					block = grow(aSizeClass);
+				iFree[aSizeClass] = block->iNext;
+				return block + 1;
+			}
+			static void deallocate(void* aBlock, std::size_t aSizeClass)
+			{
+				block_header* block = static_cast<block_header*>(aBlock) - 1;
+				task_slab_cache& owner = *block->iOwner;
+				if (&owner == tCurrent)
+				{
+					block->iNext = owner.iFree[aSizeClass];
+					owner.iFree[aSizeClass] = block;
+				}
+				else
+				{
+					block->iNext = owner.iRemoteFree[aSizeClass].load(std::memory_order_relaxed);
+					while (!owner.iRemoteFree[aSizeClass].compare_exchange_weak(block->iNext, block, std::memory_order_release, std::memory_order_relaxed))
+						;
+				}
+			}
+		private:
+			block_header* grow(std::size_t aSizeClass)
+			{
+				const std::size_t blockSize = sizeof(block_header) + (aSizeClass + 1) * SizeClassGranularity;
+				iSlabs.push_back(std::make_unique<std::max_align_t[]>(SlabSize / sizeof(std::max_align_t)));
+				char* start = reinterpret_cast<char*>(iSlabs.back().get());
+				char* last = start + (SlabSize / blockSize - 1) * blockSize;
+				for (char* p = start; p <= last; p += blockSize)
+				{
+					block_header* block = reinterpret_cast<block_header*>(p);
+					block->iOwner = this;
+					block->iNext = (p != last ? reinterpret_cast<block_header*>(p + blockSize) : nullptr);
+				}
+				return reinterpret_cast<block_header*>(start);
+			}
+		private:
+			// caches outlive their threads (blocks may still be in flight) and are adopted by new threads
+			struct owner
+			{
+				~owner()
+				{
+					if (tCurrent != nullptr)
+					{
+						std::lock_guard<std::mutex> lk(orphanage_mutex());
+						orphanage().push_back(tCurrent);
+						tCurrent = nullptr;
+					}
+				}
+				void adopt()
+				{
+					{
+						std::lock_guard<std::mutex> lk(orphanage_mutex());
+						if (!orphanage().empty())
+						{
+							tCurrent = orphanage().back();
+							orphanage().pop_back();
+						}
+					}
+					if (tCurrent == nullptr)
+						tCurrent = new task_slab_cache{};
+				}
+			};
+			static std::mutex& orphanage_mutex()
+			{
+				static std::mutex* sMutex = new std::mutex{};
+				return *sMutex;
+			}
+			static std::vector<task_slab_cache*>& orphanage()
+			{
+				static std::vector<task_slab_cache*>* sOrphanage = new std::vector<task_slab_cache*>{};
+				return *sOrphanage;
+			}
+		private:
+			block_header* iFree[SizeClassCount];
+			std::atomic<block_header*> iRemoteFree[SizeClassCount];
+			std::vector<std::unique_ptr<std::max_align_t[]>> iSlabs;
+			static thread_local task_slab_cache* tCurrent;
+			static thread_local owner tOwner;
+		};
+
+		thread_local task_slab_cache* task_slab_cache::tCurrent;
+		thread_local task_slab_cache::owner task_slab_cache::tOwner;
+	}
+
+	namespace detail
+	{
+		void* allocate_task_block(std::size_t aSize)
+		{
+			if (aSize > task_slab_cache::MaxBlockSize)
+				return ::operator new(aSize);
+			return task_slab_cache::acquire().allocate(task_slab_cache::size_class(aSize));
+		}
+
+		void deallocate_task_block(void* aBlock, std::size_t aSize)
+		{
+			if (aSize > task_slab_cache::MaxBlockSize)
+				::operator delete(aBlock);
+			else
+				task_slab_cache::deallocate(aBlock, task_slab_cache::size_class(aSize));
+		}
+	}
+}
@@ -0,0 +1,251 @@
+// task_graph.cpp
+/*
+ *  Copyright (c) 2018 Leigh Johnston.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *     * Neither the name of Leigh Johnston nor the names of any
+ *       other contributors to this software may be used to endorse or
+ *       promote products derived from this software without specific prior
+ *       written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ *  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <neolib/neolib.hpp>
+#include <algorithm>
+#include <neolib/task_graph.hpp>
+
+namespace neolib
+{
+	namespace detail
+	{
+		task_node_base::task_node_base(neolib::thread_pool& aThreadPool, join_mode aJoinMode, bool aInline) :
+			iThreadPool{ aThreadPool }, iJoinMode{ aJoinMode }, iInline{ aInline }, iState{ node_state::Waiting }, iRemaining{ 0 }, iWon{ false }, iWinner{ 0 }
+		{
+		}
+
+		neolib::thread_pool& task_node_base::thread_pool() const
+		{
+			return iThreadPool;
+		}
+
+		task_node_base::node_state task_node_base::state() const
+		{
+			return iState.load(std::memory_order_acquire);
+		}
+
+		bool task_node_base::finished() const
+		{
+			auto const currentState = state();
+			return currentState == node_state::Completed || currentState == node_state::Failed || currentState == node_state::Cancelled;
+		}
+
+		void task_node_base::wait() const
+		{
+			std::unique_lock<std::mutex> lk(iMutex);
+			iConditionVariable.wait(lk, [this] { return finished(); });
+		}
+
+		void task_node_base::link(const node_list& aPredecessors)
+		{
+			if (!iPredecessors.empty() || state() != node_state::Waiting)
+				throw already_linked();
+			if (aPredecessors.empty())
+			{
+				proceed();
+				return;
+			}
+			for (auto const& predecessor : aPredecessors)
+				iPredecessors.push_back(&*predecessor);
+			iRemaining.store(aPredecessors.size(), std::memory_order_release);
+			auto self = shared_from_this();
+			for (auto const& predecessor : aPredecessors)
+				predecessor->add_successor(self);
+		}
+
+		void task_node_base::run()
+		{
+			if (!transition(node_state::Scheduled, node_state::Running))
+				return;
+			if (cancelled())
+			{
+				iState.store(node_state::Cancelled, std::memory_order_release);
+				notify_finished();
+				return;
+			}
+			execute_and_finish();
+		}
+
+		void task_node_base::cancel()
+		{
+			task::cancel();
+			if (transition(node_state::Waiting, node_state::Cancelled))
+				notify_finished();
+		}
+
+		void task_node_base::check_value() const
+		{
+			switch (state())
+			{
+			case node_state::Completed:
+				return;
+			case node_state::Failed:
+				std::rethrow_exception(iException);
+			case node_state::Cancelled:
+				throw task_cancelled();
+			default:
+				throw not_ready();
+			}
+		}
+
+		std::size_t task_node_base::winner() const
+		{
+			return iWinner;
+		}
+
+		void task_node_base::add_successor(const std::shared_ptr<task_node_base>& aSuccessor)
+		{
+			{
+				std::lock_guard<std::mutex> lk(iMutex);
+				if (!finished())
+				{
+					iSuccessors.push_back(aSuccessor);
+					return;
+				}
+			}
+			aSuccessor->predecessor_finished(*this);
+		}
+
+		void task_node_base::predecessor_finished(const task_node_base& aPredecessor)
+		{
+			auto const predecessorState = aPredecessor.state();
+			if (iJoinMode == join_mode::All)
+			{
+				if (predecessorState == node_state::Cancelled)
+					task::cancel();
+				else if (predecessorState == node_state::Failed)
+					record_exception(aPredecessor.iException);
+				if (iRemaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+					proceed();
+			}
+			else
+			{
+				if (predecessorState == node_state::Completed)
+				{
+					if (!iWon.exchange(true, std::memory_order_acq_rel))
+					{
+						// other predecessors may still be failing so don't go through proceed()
+						iWinner = std::find(iPredecessors.begin(), iPredecessors.end(), &aPredecessor) - iPredecessors.begin();
+						if (cancelled())
+						{
+							if (transition(node_state::Waiting, node_state::Cancelled))
+								notify_finished();
+						}
+						else if (transition(node_state::Waiting, node_state::Running))
+							execute_and_finish();
+					}
+				}
+				else if (predecessorState == node_state::Failed && !iWon.load(std::memory_order_acquire))
+					record_exception(aPredecessor.iException);
+				if (iRemaining.fetch_sub(1, std::memory_order_acq_rel) == 1 && !iWon.load(std::memory_order_acquire))
+				{
+					// every predecessor failed or was cancelled
+					if (!iException)
+						task::cancel();
+					proceed();
+				}
+			}
+		}
+
+		void task_node_base::proceed()
+		{
+			if (cancelled())
+			{
+				if (transition(node_state::Waiting, node_state::Cancelled))
+					notify_finished();
+			}
+			else if (iException)
+			{
+				if (transition(node_state::Waiting, node_state::Failed))
+					notify_finished();
+			}
+			else if (iInline)
+			{
+				if (transition(node_state::Waiting, node_state::Running))
+					execute_and_finish();
+			}
+			else if (transition(node_state::Waiting, node_state::Scheduled))
+			{
+				// posted directly rather than via thread_pool::start() as a node cancelled whilst queued must still finish
+				iThreadPool.post([self = shared_from_this()]() { self->run(); });
+			}
+		}
+
+		void task_node_base::record_exception(std::exception_ptr aException, bool aReplace)
+		{
+			std::lock_guard<std::mutex> lk(iMutex);
+			if (!iException || aReplace)
+				iException = aException;
+		}
+
+		bool task_node_base::transition(node_state aFrom, node_state aTo)
+		{
+			return iState.compare_exchange_strong(aFrom, aTo, std::memory_order_acq_rel);
+		}
+
+		void task_node_base::notify_finished()
+		{
+			node_list successors;
+			{
+				std::lock_guard<std::mutex> lk(iMutex);
+				successors.swap(iSuccessors);
+			}
+			iConditionVariable.notify_all();
+			for (auto& successor : successors)
+				successor->predecessor_finished(*this);
+		}
+
+		void task_node_base::execute_and_finish()
+		{
+			node_state finalState = node_state::Completed;
+			try
+			{
+				execute();
+			}
+			catch (const task_cancelled&)
+			{
+				finalState = node_state::Cancelled;
+			}
+			catch (...)
+			{
+				// under the lock: in join_mode::Any a losing predecessor may be failing at the same time
+				record_exception(std::current_exception(), true);
+				finalState = node_state::Failed;
+			}
+			iState.store(finalState, std::memory_order_release);
+			notify_finished();
+		}
+	}
+}
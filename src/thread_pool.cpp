@@ -34,9 +34,8 @@
 */
 
 #include <neolib/neolib.hpp>
-#include <condition_variable>
-#include <neolib/raii.hpp>
-#include <neolib/lifetime.hpp>
+#include <algorithm>
+#include <neolib/lockfree_queue.hpp>
 #include <neolib/thread.hpp>
 #include <neolib/thread_pool.hpp>
 
@@ -45,162 +44,189 @@ namespace neolib
 	class thread_pool_thread : public thread
 	{
 	public:
-		typedef std::shared_ptr<i_task> task_pointer;
-		typedef std::pair<task_pointer, int32_t> task_queue_entry;
-		typedef std::deque<task_queue_entry> task_queue;
-	public:
-		struct no_active_task : std::logic_error { no_active_task() : std::logic_error("neolib::thread_pool_thread::no_active_task") {} };
-		struct already_active : std::logic_error { already_active() : std::logic_error("neolib::thread_pool_thread::already_active") {} };
+		typedef thread_pool::task_pointer task_pointer;
+	private:
+		typedef work_stealing_deque<small_task*> local_queue;
+		typedef bounded_mpmc_queue<small_task*> inbox;
 	public:
-		thread_pool_thread(thread_pool& aThreadPool) : thread{ "neolib::thread_pool_thread" }, iThreadPool{ aThreadPool }, iPoolMutex{ aThreadPool.mutex() }, iStopped{ false }
+		thread_pool_thread(thread_pool& aThreadPool) : 
+			thread{ "neolib::thread_pool_thread" }, iThreadPool{ aThreadPool }, iActive{ false }, iCompleted{ 0 }
 		{
 			start();
 		}
+		~thread_pool_thread()
+		{
+			small_task* leftover;
+			while (iInbox.try_pop(leftover))
+				leftover->destroy();
+			while (iLocalQueue.steal(leftover))
+				leftover->destroy();
+		}
+	public:
+		static thread_pool_thread* current()
+		{
+			return tCurrentThread;
+		}
+		thread_pool& pool() const
+		{
+			return iThreadPool;
+		}
 	public:
 		virtual void exec()
 		{
-			while (!finished())
+			tCurrentThread = this;
+			small_task* nextTask;
+			while (!iThreadPool.stopping())
 			{
-				std::unique_lock<std::mutex> lk(iCondVarMutex);
-				iConditionVariable.wait(lk, [this] { return iActiveTask != nullptr || iStopped; });
-				lk.unlock();
-				if (iStopped)
-					return;
-				if (!iActiveTask->cancelled())
-					iActiveTask->run();
-				std::lock_guard<std::recursive_mutex> lk2(iPoolMutex);
-				release();
-				next_task();
+				if (next_task(nextTask))
+				{
+					iActive.store(true, std::memory_order_relaxed);
+					run_task(*nextTask);
+					iActive.store(false, std::memory_order_relaxed);
+				}
+				else
+					iThreadPool.park();
 			}
+			flush_completed();
 		}
 	public:
 		bool active() const
 		{
-			std::lock_guard<std::mutex> lk(iCondVarMutex);
-			return iActiveTask != nullptr;
+			return iActive.load(std::memory_order_relaxed);
 		}
-		bool idle() const
+		bool have_work() const
 		{
-			std::lock_guard<std::recursive_mutex> lk(iPoolMutex);
-			std::lock_guard<std::mutex> lk2(iCondVarMutex);
-			return iActiveTask == nullptr && iWaitingTasks.empty();
+			return !iLocalQueue.empty() || !iInbox.empty();
 		}
-		void add(task_pointer aTask, int32_t aPriority)
+		// called by this thread only
+		void push_local(small_task* aTask)
 		{
-			std::lock_guard<std::recursive_mutex> lk(iPoolMutex);
-			auto where = std::upper_bound(iWaitingTasks.begin(), iWaitingTasks.end(), task_queue_entry{ task_pointer{}, aPriority },
-				[](const task_queue_entry& aLeft, const task_queue_entry& aRight)
-			{
-				return aLeft.second > aRight.second;
-			});
-			iWaitingTasks.emplace(where, aTask, aPriority);
-			if (!active())
-				next_task();
+			iLocalQueue.push(aTask);
 		}
-		bool steal_work(thread_pool_thread& aIdleThread)
+		// called by any thread
+		bool push_inbox(small_task* aTask)
 		{
-			std::unique_lock<std::recursive_mutex> lk(iPoolMutex);
-			if (!iWaitingTasks.empty())
-			{
-				auto newTask = iWaitingTasks.front();
-				iWaitingTasks.pop_front();
-				aIdleThread.add(newTask.first, newTask.second);
-				return true;
-			}
-			return false;
+			return iInbox.try_push(aTask);
+		}
+		// called by any thread
+		bool steal_work(small_task*& aTask)
+		{
+			return iInbox.try_pop(aTask) || iLocalQueue.steal(aTask);
 		}
 		void stop()
 		{
-			{
-				std::lock_guard<std::mutex> lk(iCondVarMutex);
-				iStopped = true;
-			}
-			iConditionVariable.notify_one();
 			wait();
 		}
 	private:
-		void next_task()
+		bool next_task(small_task*& aTask)
 		{
-			std::unique_lock<std::recursive_mutex> lk(iPoolMutex);
-			if (active())
-				throw already_active();
-			if (iWaitingTasks.empty())
-				iThreadPool.steal_work(*this);
-			if (!iWaitingTasks.empty())
+			if (iThreadPool.take_priority_task(aTask, true))
+				return true;
+			if (iLocalQueue.pop(aTask) || iInbox.try_pop(aTask))
+				return true;
+			// out of local work so publish our completions before looking elsewhere; this keeps
+			// the shared outstanding task counter off the per-task path
+			flush_completed();
+			return iThreadPool.steal_work(*this, aTask) || iThreadPool.take_priority_task(aTask, false);
+		}
+		void run_task(small_task& aTask)
+		{
+			// the task is retired and counted however it ends so that the pool's outstanding task count (and 
+			// so wait()) stays right; a task started with run() has already passed its exception to its future
+			try
 			{
-				{
-					std::lock_guard<std::mutex> lk2(iCondVarMutex);
-					iActiveTask = iWaitingTasks.front().first;
-					iWaitingTasks.pop_front();
-				}
-				iConditionVariable.notify_one();
+				aTask.run();
 			}
-			else
-				iThreadPool.thread_gone_idle();
+			catch (...)
+			{
+				iThreadPool.task_threw(std::current_exception());
+			}
+			aTask.destroy();
+			++iCompleted;
 		}
-		void release()
+		void flush_completed()
 		{
-			task_pointer currentTask;
+			if (iCompleted != 0)
 			{
-				std::lock_guard<std::mutex> lk(iCondVarMutex);
-				if (iActiveTask == nullptr)
-					throw no_active_task();
-				currentTask = iActiveTask;
-				iActiveTask = nullptr;
+				iThreadPool.tasks_completed(iCompleted);
+				iCompleted = 0;
 			}
 		}
 	private:
 		thread_pool& iThreadPool;
-		std::recursive_mutex& iPoolMutex;
-		mutable std::mutex iCondVarMutex;
-		std::condition_variable iConditionVariable;
-		task_queue iWaitingTasks;
-		task_pointer iActiveTask;
-		bool iStopped;
+		local_queue iLocalQueue;
+		inbox iInbox;
+		std::atomic<bool> iActive;
+		std::size_t iCompleted;
+		static thread_local thread_pool_thread* tCurrentThread;
 	};
 
-	thread_pool::thread_pool() : iMaxThreads{ 0 }
+	thread_local thread_pool_thread* thread_pool_thread::tCurrentThread;
+
+	thread_pool::thread_pool() : 
+		iMaxThreads{ 0 }, 
+		iSnapshot{ nullptr },
+		iPriorityTaskCount{ 0 }, 
+		iTopPriority{ 0 }, 
+		iOutstanding{ 0 }, 
+		iParked{ 0 }, 
+		iStopping{ false }
 	{
+		iSnapshots.push_back(std::make_unique<thread_snapshot>());
+		iSnapshot.store(iSnapshots.back().get());
 		reserve(std::thread::hardware_concurrency());
 	}
 
 	thread_pool::~thread_pool()
 	{
 		wait();
+		iStopping = true;
+		{
+			std::lock_guard<std::mutex> lk(iParkMutex);
+		}
+		iParkConditionVariable.notify_all();
 		for (auto& t : iThreads)
 			static_cast<thread_pool_thread&>(*t).stop();
+		for (auto& leftover : iPriorityTasks)
+			leftover.first->destroy();
 	}
 
 	void thread_pool::reserve(std::size_t aMaxThreads)
 	{
 		std::lock_guard<std::recursive_mutex> lk(iMutex);
 		iMaxThreads = aMaxThreads;
+		if (iThreads.size() >= iMaxThreads)
+			return;
 		while (iThreads.size() < iMaxThreads)
 			iThreads.push_back(std::make_unique<thread_pool_thread>(*this));
+		// submitters read the thread list without locking so publish a new immutable snapshot; 
+		// superseded snapshots live as long as the pool as a submitter may still be using one
+		auto newSnapshot = std::make_unique<thread_snapshot>();
+		for (auto& t : iThreads)
+			newSnapshot->push_back(&static_cast<thread_pool_thread&>(*t));
+		iSnapshots.push_back(std::move(newSnapshot));
+		iSnapshot.store(iSnapshots.back().get(), std::memory_order_release);
 	}
 
 	std::size_t thread_pool::active_threads() const
 	{
-		std::lock_guard<std::recursive_mutex> lk(iMutex);
 		std::size_t result = 0;
-		for (auto& t : iThreads)
-			if (static_cast<thread_pool_thread&>(*t).active())
+		for (auto t : threads())
+			if (t->active())
 				++result;
 		return result;
 	}
 
 	std::size_t thread_pool::available_threads() const
 	{
-		std::lock_guard<std::recursive_mutex> lk(iMutex);
 		return max_threads() - active_threads();
 	}
 
 	std::size_t thread_pool::total_threads() const
 	{
-		std::lock_guard<std::recursive_mutex> lk(iMutex);
 		std::size_t result = 0;
-		for (auto& t : iThreads)
-			if (!static_cast<thread_pool_thread&>(*t).finished())
+		for (auto t : threads())
+			if (!t->finished())
 				++result;
 		return result;
 	}
@@ -217,19 +243,40 @@ namespace neolib
 
 	void thread_pool::start(task_pointer aTask, int32_t aPriority)
 	{
-		std::lock_guard<std::recursive_mutex> lk(iMutex);
-		if (iThreads.empty())
+		add(small_task::create([task = std::move(aTask)]()
+		{
+			if (!task->cancelled())
+				task->run();
+		}), aPriority);
+	}
+
+	void thread_pool::add(small_task* aTask, int32_t aPriority)
+	{
+		auto const& threadList = threads();
+		if (threadList.empty())
+		{
+			aTask->destroy();
 			throw no_threads();
-		for (auto& t : iThreads)
+		}
+		iOutstanding.fetch_add(1, std::memory_order_relaxed);
+		auto currentThread = thread_pool_thread::current();
+		if (aPriority != 0)
+			add_priority_task(aTask, aPriority);
+		else if (currentThread != nullptr && &currentThread->pool() == this)
+			currentThread->push_local(aTask);
+		else
 		{
-			auto& tpt = static_cast<thread_pool_thread&>(*t);
-			if (!tpt.active())
-			{
-				tpt.add(aTask, aPriority);
-				return;
-			}
+			// external submitters spread work round-robin across the worker inboxes
+			thread_local std::size_t tNextThread;
+			bool added = false;
+			for (std::size_t i = 0; !added && i < threadList.size(); ++i)
+				added = threadList[tNextThread++ % threadList.size()]->push_inbox(aTask);
+			if (!added)
+				add_priority_task(aTask, aPriority);
 		}
-		static_cast<thread_pool_thread&>(*iThreads[0]).add(aTask, aPriority);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (iParked.load(std::memory_order_relaxed) != 0)
+			wake_one();
 	}
 
 	bool thread_pool::try_start(i_task& aTask, int32_t aPriority)
@@ -248,22 +295,9 @@ namespace neolib
 		return true;
 	}
 
-	std::pair<std::future<void>, thread_pool::task_pointer> thread_pool::run(std::function<void()> aFunction, int32_t aPriority)
-	{
-		auto newTask = std::make_shared<function_task<void>>(aFunction);
-		start(newTask, aPriority);
-		return std::make_pair(newTask->get_future(), newTask);
-	}
-
 	bool thread_pool::idle() const
 	{
-		std::lock_guard<std::recursive_mutex> lk(iMutex);
-		for (auto& t : iThreads)
-		{
-			if (!static_cast<thread_pool_thread&>(*t).idle())
-				return false;
-		}
-		return true;
+		return iOutstanding.load(std::memory_order_acquire) == 0;
 	}
 
 	bool thread_pool::busy() const
@@ -277,6 +311,12 @@ namespace neolib
 		iWaitConditionVariable.wait(lk, [this] { return idle(); });
 	}
 
+	void thread_pool::set_exception_handler(exception_handler aHandler)
+	{
+		std::lock_guard<std::mutex> lk(iExceptionHandlerMutex);
+		iExceptionHandler = std::move(aHandler);
+	}
+
 	thread_pool& thread_pool::default_thread_pool()
 	{
 		static thread_pool sDefaultThreadPool;
@@ -288,23 +328,116 @@ namespace neolib
 		return iMutex;
 	}
 
-	void thread_pool::steal_work(thread_pool_thread& aIdleThread)
+	const thread_pool::thread_snapshot& thread_pool::threads() const
+	{
+		return *iSnapshot.load(std::memory_order_acquire);
+	}
+
+	void thread_pool::add_priority_task(small_task* aTask, int32_t aPriority)
+	{
+		std::lock_guard<std::mutex> lk(iPriorityMutex);
+		auto where = std::upper_bound(iPriorityTasks.begin(), iPriorityTasks.end(), task_queue_entry{ nullptr, aPriority },
+			[](const task_queue_entry& aLeft, const task_queue_entry& aRight)
+		{
+			return aLeft.second > aRight.second;
+		});
+		iPriorityTasks.emplace(where, aTask, aPriority);
+		iTopPriority.store(iPriorityTasks.front().second, std::memory_order_relaxed);
+		iPriorityTaskCount.store(iPriorityTasks.size(), std::memory_order_relaxed);
+	}
+
+	bool thread_pool::take_priority_task(small_task*& aTask, bool aUrgentOnly)
+	{
+		// positive priority tasks are taken ahead of the worker queues, the rest only once those are dry
+		if (iPriorityTaskCount.load(std::memory_order_relaxed) == 0)
+			return false;
+		if (aUrgentOnly && iTopPriority.load(std::memory_order_relaxed) <= 0)
+			return false;
+		std::lock_guard<std::mutex> lk(iPriorityMutex);
+		if (iPriorityTasks.empty() || (aUrgentOnly && iPriorityTasks.front().second <= 0))
+			return false;
+		aTask = iPriorityTasks.front().first;
+		iPriorityTasks.pop_front();
+		if (!iPriorityTasks.empty())
+			iTopPriority.store(iPriorityTasks.front().second, std::memory_order_relaxed);
+		iPriorityTaskCount.store(iPriorityTasks.size(), std::memory_order_relaxed);
+		return true;
+	}
+
+	bool thread_pool::steal_work(thread_pool_thread& aIdleThread, small_task*& aTask)
+	{
+		auto const& threadList = threads();
+		auto self = std::find(threadList.begin(), threadList.end(), &aIdleThread);
+		std::size_t start = (self != threadList.end() ? static_cast<std::size_t>(self - threadList.begin()) : 0);
+		for (std::size_t i = 1; i <= threadList.size(); ++i)
+		{
+			auto victim = threadList[(start + i) % threadList.size()];
+			if (victim != &aIdleThread && victim->steal_work(aTask))
+				return true;
+		}
+		return false;
+	}
+
+	bool thread_pool::have_work() const
+	{
+		if (iPriorityTaskCount.load(std::memory_order_relaxed) != 0)
+			return true;
+		for (auto t : threads())
+			if (t->have_work())
+				return true;
+		return false;
+	}
+
+	bool thread_pool::stopping() const
+	{
+		return iStopping.load(std::memory_order_relaxed);
+	}
+
+	void thread_pool::park()
+	{
+		std::unique_lock<std::mutex> lk(iParkMutex);
+		iParked.fetch_add(1, std::memory_order_relaxed);
+		// pairs with the fence in start(): either the submitter sees us parked or we see its work
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		iParkConditionVariable.wait(lk, [this] { return stopping() || have_work(); });
+		iParked.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	void thread_pool::wake_one()
 	{
-		std::lock_guard<std::recursive_mutex> lk(iMutex);
-		if (iThreads.empty())
-			throw no_threads();
-		for (auto& t : iThreads)
 		{
-			if (&*t == &aIdleThread)
-				continue;
-			auto& tpt = static_cast<thread_pool_thread&>(*t);
-			if (tpt.steal_work(aIdleThread))
-				return;
+			std::lock_guard<std::mutex> lk(iParkMutex);
 		}
+		iParkConditionVariable.notify_one();
 	}
 
-	void thread_pool::thread_gone_idle()
+	void thread_pool::tasks_completed(std::size_t aCount)
 	{
-		iWaitConditionVariable.notify_one();
+		if (iOutstanding.fetch_sub(aCount, std::memory_order_acq_rel) == aCount)
+		{
+			{
+				std::lock_guard<std::mutex> lk(iWaitMutex);
+			}
+			iWaitConditionVariable.notify_all();
+		}
+	}
+
+	void thread_pool::task_threw(std::exception_ptr aException)
+	{
+		exception_handler handler;
+		{
+			std::lock_guard<std::mutex> lk(iExceptionHandlerMutex);
+			handler = iExceptionHandler;
+		}
+		if (!handler)
+			return;
+		try
+		{
+			handler(aException);
+		}
+		catch (...)
+		{
+			// the worker must still retire the task; an exception from the handler itself has nowhere to go
+		}
 	}
 }
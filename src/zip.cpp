@@ -34,12 +34,19 @@
 */
 
 #include <neolib/neolib.hpp>
+#include <cstring>
 #include <fstream>
 #include <string>
+#include <atomic>
+#include <algorithm>
+#include <limits>
 #include <zlib/zlib.h>
 #include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
 #include <neolib/string_utils.hpp>
 #include <neolib/crc.hpp>
+#include <neolib/parallel_algorithm.hpp>
 #include <neolib/zip.hpp>
 
 #pragma pack(1)
@@ -53,6 +60,35 @@ namespace neolib
 		{
 			return reinterpret_cast<const char*>(p);
 		}
+
+		// Where an entry goes under aTargetDirectory: its path is normalised and refused (false) if it is absolute or
+		// would climb out of the target directory, so a crafted archive can't write anywhere else.
+		bool target_path(const std::string& aTargetDirectory, const std::string& aEntryPath, boost::filesystem::path& aTarget)
+		{
+			if (aEntryPath.empty() || aEntryPath[0] == '/' || aEntryPath[0] == '\\' || aEntryPath.find(':') != std::string::npos)
+				return false;
+			aTarget = aTargetDirectory;
+			std::size_t components = 0;
+			for (std::size_t start = 0; start < aEntryPath.size();)
+			{
+				std::size_t const end = std::min(aEntryPath.find_first_of("/\\", start), aEntryPath.size());
+				std::string const component = aEntryPath.substr(start, end - start);
+				start = end + 1;
+				if (component.empty() || component == ".")
+					continue;
+				if (component == "..")
+					return false;
+				aTarget /= component;
+				++components;
+			}
+			return components != 0;
+		}
+
+		// archivers mark a directory entry with a trailing separator; some Windows tools write a backslash
+		bool is_directory_entry(const std::string& aEntryPath)
+		{
+			return !aEntryPath.empty() && (aEntryPath.back() == '/' || aEntryPath.back() == '\\');
+		}
 	}
 
 	struct zip::local_header
@@ -84,6 +120,30 @@ namespace neolib
 		word iCommentLength;
 	};
 
+	struct zip::zip64_dir_locator
+	{
+		enum { Signature = 0x07064b50 };
+		dword iSignature;
+		dword iDisk;
+		uint64_t iDirHeaderOffset;
+		dword iTotalDisks;
+	};
+
+	struct zip::zip64_dir_header
+	{
+		enum { Signature = 0x06064b50 };
+		dword iSignature;
+		uint64_t iSize;
+		word iVersionMade;
+		word iVersionNeeded;
+		dword iDisk;
+		dword iStartDisk;
+		uint64_t iDirEntries;
+		uint64_t iTotalDirEntries;
+		uint64_t iDirSize;
+		uint64_t iDirOffset;
+	};
+
 	struct zip::dir_file_header
 	{
 		enum { Signature = 0x02014b50 };
@@ -108,27 +168,178 @@ namespace neolib
 
 	#pragma pack()
 
+	namespace
+	{
+		struct mapped_file
+		{
+			boost::interprocess::file_mapping file;
+			boost::interprocess::mapped_region region;
+			mapped_file(const std::string& aPath) :
+				file{ aPath.c_str(), boost::interprocess::read_only },
+				region{ file, boost::interprocess::read_only }
+			{
+			}
+		};
+
+		// Produces the uncompressed bytes of one entry a chunk at a time, checking the size and CRC at the end.
+		class entry_reader
+		{
+		public:
+			static constexpr std::size_t ChunkSize = 64 * 1024;
+		public:
+			entry_reader(const uint8_t* aData, uint64_t aCompressedSize, uint64_t aUncompressedSize, uint32_t aCrc32, uint16_t aCompression) :
+				iInput{ aData }, iInputLeft{ aCompressedSize }, iExpectedSize{ aUncompressedSize }, iExpectedCrc32{ aCrc32 }, iStored{ aCompression == 0 }, iInflating{ false }, iFinished{ false }
+			{
+				if (!iStored)
+				{
+					if (aCompression != Z_DEFLATED)
+						throw zip::bad_entry();
+					iStream.zalloc = Z_NULL;
+					iStream.zfree = Z_NULL;
+					iStream.opaque = Z_NULL;
+					iStream.next_in = Z_NULL;
+					iStream.avail_in = 0;
+					if (inflateInit2(&iStream, -MAX_WBITS) != Z_OK)
+						throw zip::bad_entry();
+					iInflating = true;
+				}
+			}
+			~entry_reader()
+			{
+				if (iInflating)
+					inflateEnd(&iStream);
+			}
+			entry_reader(const entry_reader&) = delete;
+			entry_reader& operator=(const entry_reader&) = delete;
+		public:
+			// The next chunk, empty once the entry is exhausted. Stored entries are returned in place (no copy);
+			// deflated ones are inflated into aBuffer, which must hold ChunkSize bytes.
+			std::pair<const uint8_t*, std::size_t> next(uint8_t* aBuffer)
+			{
+				if (iFinished)
+					return std::make_pair(nullptr, 0);
+				std::pair<const uint8_t*, std::size_t> chunk = iStored ? next_stored() : next_inflated(aBuffer);
+				iCrc32.update(chunk.first, chunk.second);
+				if (chunk.second == 0)
+				{
+					iFinished = true;
+					if (iCrc32.length() != iExpectedSize || iCrc32.value() != iExpectedCrc32)
+						throw zip::bad_entry();
+				}
+				return chunk;
+			}
+		private:
+			std::pair<const uint8_t*, std::size_t> next_stored()
+			{
+				std::size_t const length = static_cast<std::size_t>(std::min<uint64_t>(iInputLeft, ChunkSize));
+				const uint8_t* const chunk = iInput;
+				iInput += length;
+				iInputLeft -= length;
+				return std::make_pair(chunk, length);
+			}
+			std::pair<const uint8_t*, std::size_t> next_inflated(uint8_t* aBuffer)
+			{
+				iStream.next_out = static_cast<Bytef*>(aBuffer);
+				iStream.avail_out = static_cast<uInt>(ChunkSize);
+				while (iStream.avail_out != 0)
+				{
+					if (iStream.avail_in == 0 && iInputLeft != 0)
+					{
+						// avail_in is only 32 bits wide so very large entries are fed in pieces
+						uInt const length = static_cast<uInt>(std::min<uint64_t>(iInputLeft, std::numeric_limits<uInt>::max()));
+						iStream.next_in = static_cast<Bytef*>(const_cast<uint8_t*>(iInput));
+						iStream.avail_in = length;
+						iInput += length;
+						iInputLeft -= length;
+					}
+					int const result = inflate(&iStream, Z_NO_FLUSH);
+					if (result == Z_STREAM_END)
+						break;
+					if (result != Z_OK || (iStream.avail_in == 0 && iInputLeft == 0 && iStream.avail_out != 0))
+						throw zip::bad_entry();
+				}
+				return std::make_pair(aBuffer, ChunkSize - iStream.avail_out);
+			}
+		private:
+			const uint8_t* iInput;
+			uint64_t iInputLeft;
+			uint64_t iExpectedSize;
+			uint32_t iExpectedCrc32;
+			bool iStored;
+			bool iInflating;
+			bool iFinished;
+			z_stream iStream;
+			crc32_engine iCrc32;
+		};
+
+		class entry_streambuf : public std::streambuf
+		{
+		public:
+			entry_streambuf(const uint8_t* aData, uint64_t aCompressedSize, uint64_t aUncompressedSize, uint32_t aCrc32, uint16_t aCompression) :
+				iReader{ aData, aCompressedSize, aUncompressedSize, aCrc32, aCompression }, iBuffer(entry_reader::ChunkSize)
+			{
+			}
+		protected:
+			int_type underflow() override
+			{
+				if (gptr() < egptr())
+					return traits_type::to_int_type(*gptr());
+				auto const chunk = iReader.next(&iBuffer[0]);
+				if (chunk.second == 0)
+					return traits_type::eof();
+				char* const begin = const_cast<char*>(reinterpret_cast<const char*>(chunk.first));
+				setg(begin, begin, begin + chunk.second);
+				return traits_type::to_int_type(*gptr());
+			}
+		private:
+			entry_reader iReader;
+			std::vector<uint8_t> iBuffer;
+		};
+
+		class entry_stream : public std::istream
+		{
+		public:
+			entry_stream(const uint8_t* aData, uint64_t aCompressedSize, uint64_t aUncompressedSize, uint32_t aCrc32, uint16_t aCompression) :
+				std::istream{ nullptr }, iBuffer{ aData, aCompressedSize, aUncompressedSize, aCrc32, aCompression }
+			{
+				rdbuf(&iBuffer);
+			}
+		private:
+			entry_streambuf iBuffer;
+		};
+	}
+
 	zip::zip(const std::string& aZipFilePath) : iZipFileData{}, iZipFileDataLength{}, iError{false}
 	{
 		auto fileSize = boost::filesystem::file_size(aZipFilePath);
-		if (fileSize > iZipFile.max_size())
+		if (fileSize > std::numeric_limits<std::size_t>::max())
 			throw zip_file_too_big();
-		iZipFile.resize(static_cast<std::size_t>(fileSize));
-		iZipFileData = &iZipFile[0];
-		iZipFileDataLength = iZipFile.size();
-		std::ifstream input(aZipFilePath, std::ios::binary | std::ios::in);
-		if (input.read(reinterpret_cast<char*>(&iZipFile[0]), iZipFile.size()))
-			parse();
-		else
+		if (fileSize == 0)
+		{
 			iError = true;
+			return;
+		}
+		try
+		{
+			auto mapping = std::make_shared<mapped_file>(aZipFilePath);
+			iZipFileData = static_cast<const uint8_t*>(mapping->region.get_address());
+			iZipFileDataLength = mapping->region.get_size();
+			iMapping = mapping;
+		}
+		catch (const boost::interprocess::interprocess_exception&)
+		{
+			iError = true;
+			return;
+		}
+		parse();
 	}
 
-	zip::zip(const buffer_type& aZipFile) : iZipFile{aZipFile}, iZipFileData{&iZipFile[0]}, iZipFileDataLength{iZipFile.size()}, iError{false}
+	zip::zip(const buffer_type& aZipFile) : iZipFile{aZipFile}, iZipFileData{iZipFile.data()}, iZipFileDataLength{iZipFile.size()}, iError{false}
 	{
 		parse();
 	}
 
-	zip::zip(buffer_type&& aZipFile) : iZipFile{std::move(aZipFile)}, iZipFileData{&iZipFile[0]}, iZipFileDataLength{iZipFile.size()}, iError{false}
+	zip::zip(buffer_type&& aZipFile) : iZipFile{std::move(aZipFile)}, iZipFileData{iZipFile.data()}, iZipFileDataLength{iZipFile.size()}, iError{false}
 	{
 		parse();
 	}
@@ -140,107 +351,187 @@ namespace neolib
 
 	std::size_t zip::index_of(const std::string& aFile) const
 	{
-		for (std::size_t i = 0; i < file_count(); ++i)
-			if (file_path(i) == aFile)
-				return i;
-		throw file_not_found();
+		auto index = find(aFile);
+		if (index == std::nullopt)
+			throw file_not_found();
+		return *index;
+	}
+
+	std::optional<std::size_t> zip::find(std::string_view aFile) const
+	{
+		auto existing = iIndex.find(aFile);
+		if (existing == iIndex.end())
+			return std::optional<std::size_t>{};
+		return existing->second;
+	}
+
+	uint64_t zip::file_size(size_t aIndex) const
+	{
+		return iEntries[aIndex].iUncompressedSize;
 	}
 
 	bool zip::extract(size_t aIndex, const std::string& aTargetDirectory)
 	{
-		buffer_type data;
-		if (extract_to(aIndex, data))
+		boost::filesystem::path target;
+		if (iError || aIndex >= iFiles.size() || !target_path(aTargetDirectory, file_path(aIndex), target))
+			return false;
+		boost::system::error_code ec;
+		if (is_directory_entry(file_path(aIndex)))
 		{
-			std::ofstream out(aTargetDirectory + "/" + file_path(aIndex), std::ios::out | std::ios::binary);
-			out.write(reinterpret_cast<const char*>(data[0]), data.size());
-			if (out)
-				return true;
+			boost::filesystem::create_directories(target, ec);
+			return !ec;
 		}
-		iError = true;
-		return false;
+		boost::filesystem::create_directories(target.parent_path(), ec);
+		std::ofstream out(target.string(), std::ios::out | std::ios::binary);
+		bool const extracted = out && extract_to(aIndex, [&](const uint8_t* aData, std::size_t aLength)
+		{
+			out.write(reinterpret_cast<const char*>(aData), aLength);
+		});
+		return extracted && out;
 	}
 
 	bool zip::extract_to(size_t aIndex, buffer_type& aBuffer)
 	{
-		if (iError)
+		aBuffer.clear();
+		if (iError || aIndex >= iFiles.size())
 			return false;
-		if (aIndex > iFiles.size())
-			return false;
-		const local_header* lh = reinterpret_cast<const local_header*>(data_front() + iDirEntries[aIndex]->iHeaderOffset);
-		if (byte_cast(lh) < byte_cast(data_front()) ||
-			byte_cast(lh) > byte_cast(data_back()) - sizeof(local_header) + 1)
+		if (file_size(aIndex) > aBuffer.max_size())
+			throw zip_file_too_big();
+		aBuffer.reserve(static_cast<std::size_t>(file_size(aIndex)));
+		return extract_to(aIndex, [&aBuffer](const uint8_t* aData, std::size_t aLength)
 		{
-			iError = true;
+			aBuffer.insert(aBuffer.end(), aData, aData + aLength);
+		});
+	}
+
+	bool zip::extract_to(size_t aIndex, const chunk_sink& aSink)
+	{
+		if (iError || aIndex >= iFiles.size())
 			return false;
-		}
-		if (lh->iSignature != local_header::Signature)
+		return extract_entry(aIndex, aSink);
+	}
+
+	std::string zip::extract_to_string(size_t aIndex)
+	{
+		std::string result;
+		extract_to(aIndex, [&result](const uint8_t* aData, std::size_t aLength)
 		{
-			iError = true;
+			result.append(reinterpret_cast<const char*>(aData), aLength);
+		});
+		return result;
+	}
+
+	std::unique_ptr<std::istream> zip::open(size_t aIndex) const
+	{
+		const uint8_t* const data = (!iError && aIndex < iFiles.size() ? entry_data(aIndex) : nullptr);
+		if (data == nullptr)
+			throw bad_entry();
+		const entry& e = iEntries[aIndex];
+		return std::make_unique<entry_stream>(data, e.iCompressedSize, e.iUncompressedSize, e.iCrc32, e.iCompression);
+	}
+
+	bool zip::parallel_extract(thread_pool& aThreadPool, const std::vector<std::size_t>& aIndices, const sink_factory& aSinks)
+	{
+		if (iError)
 			return false;
-		}
-		const uint8_t* compressedData = reinterpret_cast<const uint8_t*>(lh + 1) + lh->iFilenameLength + lh->iExtraLength;
-		if (byte_cast(compressedData) < byte_cast(data_front()) ||
-			byte_cast(compressedData) + lh->iCompressedSize - 1 > byte_cast(data_back()))
+		std::atomic<bool> ok{ true };
+		detail::parallel_run(aThreadPool, aIndices.size(), 1,
+			[&](detail::parallel_batch& aBatch, std::size_t aBegin, std::size_t aEnd)
 		{
-			iError = true;
+			aBatch.participate(aBegin, aEnd,
+				[&](std::size_t aChunkBegin, std::size_t aChunkEnd)
+			{
+				for (std::size_t i = aChunkBegin; i < aChunkEnd; ++i)
+				{
+					chunk_sink const sink = (aIndices[i] < iFiles.size() ? aSinks(aIndices[i]) : chunk_sink{});
+					if (!sink || !extract_entry(aIndices[i], sink))
+						ok = false;
+				}
+			}, []() {});
+		});
+		return ok;
+	}
+
+	bool zip::extract_all(thread_pool& aThreadPool, const std::string& aTargetDirectory)
+	{
+		if (iError)
 			return false;
-		}
-		if (lh->iCompression == Z_NO_COMPRESSION)
+		// create the directory tree up front so that workers only ever write files; entries that can't be placed
+		// are skipped, failing the call but not the rest of the archive
+		bool ok = true;
+		std::vector<std::size_t> files;
+		std::vector<boost::filesystem::path> targets(file_count());
+		for (std::size_t i = 0; i < file_count(); ++i)
 		{
-			if (crc32(reinterpret_cast<const uint8_t*>(compressedData), lh->iCompressedSize) != lh->iCrc32)
+			boost::system::error_code ec;
+			if (!target_path(aTargetDirectory, file_path(i), targets[i]))
+				ok = false;
+			else if (is_directory_entry(file_path(i)))
+				boost::filesystem::create_directories(targets[i], ec);
+			else
 			{
-				iError = true;
-				return false;
+				boost::filesystem::create_directories(targets[i].parent_path(), ec);
+				if (!ec)
+					files.push_back(i);
 			}
-			aBuffer.resize(lh->iCompressedSize);
-			std::copy(compressedData, compressedData + aBuffer.size(), &aBuffer[0]);
-			return true;
+			if (ec)
+				ok = false;
 		}
-		else if (lh->iCompression != Z_DEFLATED)
+		std::vector<std::unique_ptr<std::ofstream>> outputs(file_count());
+		bool const extracted = parallel_extract(aThreadPool, files, [&](std::size_t aIndex) -> chunk_sink
 		{
-			iError = true;
+			outputs[aIndex] = std::make_unique<std::ofstream>(targets[aIndex].string(), std::ios::out | std::ios::binary);
+			std::ofstream& out = *outputs[aIndex];
+			if (!out)
+				return chunk_sink{};
+			return [&out](const uint8_t* aData, std::size_t aLength)
+			{
+				out.write(reinterpret_cast<const char*>(aData), aLength);
+			};
+		});
+		for (auto const& out : outputs)
+			if (out && !out->flush())
+				ok = false;
+		return extracted && ok;
+	}
+
+	const std::string& zip::file_path(size_t aIndex) const
+	{
+		return iFiles[aIndex];
+	}
+
+	bool zip::extract_entry(size_t aIndex, const chunk_sink& aSink) const
+	{
+		const uint8_t* const data = entry_data(aIndex);
+		if (data == nullptr)
 			return false;
-		}
-		z_stream stream;
-		stream.next_in = static_cast<Bytef*>(const_cast<uint8_t*>(compressedData));
-		stream.avail_in = static_cast<uInt>(lh->iCompressedSize);
-		aBuffer.resize(lh->iUncompressedSize);
-		stream.next_out = static_cast<Bytef*>(&aBuffer[0]);
-		stream.avail_out = static_cast<uInt>(aBuffer.size());
-		stream.zalloc = static_cast<alloc_func>(0);
-		stream.zfree = static_cast<free_func>(0);
-		int result = inflateInit2(&stream, -MAX_WBITS);
-		if (result == Z_OK)
+		const entry& e = iEntries[aIndex];
+		try
 		{
-			result = inflate(&stream, Z_FINISH);
-			inflateEnd(&stream);
-			if (result == Z_STREAM_END)
-				result = Z_OK;
-			inflateEnd(&stream);
+			entry_reader reader{ data, e.iCompressedSize, e.iUncompressedSize, e.iCrc32, e.iCompression };
+			std::vector<uint8_t> buffer(e.iCompression == 0 ? 0 : entry_reader::ChunkSize);
+			for (auto chunk = reader.next(buffer.data()); chunk.second != 0; chunk = reader.next(buffer.data()))
+				aSink(chunk.first, chunk.second);
 		}
-		if (result != Z_OK)
+		catch (const bad_entry&)
 		{
-			iError = true;
-			return false;
-		}
-		if (crc32(reinterpret_cast<const uint8_t*>(&aBuffer[0]), aBuffer.size()) != lh->iCrc32)
-		{
-			iError = true;
 			return false;
 		}
 		return true;
 	}
 
-	std::string zip::extract_to_string(size_t aIndex)
-	{
-		buffer_type buffer;
-		extract_to(aIndex, buffer);
-		return std::string(buffer.begin(), buffer.end());
-	}
-
-	const std::string& zip::file_path(size_t aIndex) const
+	const uint8_t* zip::entry_data(size_t aIndex) const
 	{
-		return iFiles[aIndex];
+		const entry& e = iEntries[aIndex];
+		if (e.iHeaderOffset > iZipFileDataLength || iZipFileDataLength - e.iHeaderOffset < sizeof(local_header))
+			return nullptr;
+		const local_header* lh = reinterpret_cast<const local_header*>(data_front() + e.iHeaderOffset);
+		if (lh->iSignature != local_header::Signature)
+			return nullptr;
+		uint64_t const dataOffset = e.iHeaderOffset + sizeof(local_header) + lh->iFilenameLength + lh->iExtraLength;
+		if (dataOffset > iZipFileDataLength || iZipFileDataLength - dataOffset < e.iCompressedSize)
+			return nullptr;
+		return data_front() + dataOffset;
 	}
 
 	bool zip::parse()
@@ -250,49 +541,131 @@ namespace neolib
 			iError = true;
 			return false;
 		}
-		const dir_header* dh = reinterpret_cast<const dir_header*>(data_back() - sizeof(dir_header) + 1);
-		if (dh->iSignature != dir_header::Signature)
+		// the end of central directory record is followed only by a comment of at most 64K
+		const dir_header* dh = nullptr;
+		std::size_t const lastCandidate = iZipFileDataLength - sizeof(dir_header);
+		std::size_t const firstCandidate = lastCandidate - std::min<std::size_t>(lastCandidate, 0xFFFF);
+		for (std::size_t candidate = lastCandidate + 1; dh == nullptr && candidate-- > firstCandidate;)
+		{
+			const dir_header* const header = reinterpret_cast<const dir_header*>(data_front() + candidate);
+			if (header->iSignature == dir_header::Signature && candidate + sizeof(dir_header) + header->iCommentLength <= iZipFileDataLength)
+				dh = header;
+		}
+		if (dh == nullptr)
 		{
 			iError = true;
 			return false;
 		}
-		const dir_file_header* fh = reinterpret_cast<const dir_file_header*>(data_back() - (dh->iDirSize + sizeof(dir_header)) + 1);
-		for (size_t i = 0; i < dh->iDirEntries; ++i)
+		uint64_t entries = dh->iDirEntries;
+		uint64_t dirSize = dh->iDirSize;
+		uint64_t dirOffset = dh->iDirOffset;
+		uint64_t dirEnd = byte_cast(dh) - byte_cast(data_front());
+		// ZIP64: the real counts and offsets are in a record found through a locator just before the usual one
+		if (dirEnd >= sizeof(zip64_dir_locator))
 		{
-			if (byte_cast(fh) < byte_cast(data_front()) ||
-				byte_cast(fh) + sizeof(fh->iSignature) >= byte_cast(dh))
+			const zip64_dir_locator* locator = reinterpret_cast<const zip64_dir_locator*>(byte_cast(dh) - sizeof(zip64_dir_locator));
+			if (locator->iSignature == zip64_dir_locator::Signature)
 			{
-				iError = false;
+				// the record ends where the locator starts: its size field counts everything after the signature and
+				// itself, so the right record is the one that reaches exactly to the locator
+				uint64_t const locatorOffset = dirEnd - sizeof(zip64_dir_locator);
+				auto const record_at = [&](uint64_t aOffset) -> const zip64_dir_header*
+				{
+					if (aOffset > locatorOffset || locatorOffset - aOffset < sizeof(zip64_dir_header))
+						return nullptr;
+					const zip64_dir_header* const candidate = reinterpret_cast<const zip64_dir_header*>(data_front() + aOffset);
+					if (candidate->iSignature != zip64_dir_header::Signature ||
+						candidate->iSize != locatorOffset - aOffset - sizeof(candidate->iSignature) - sizeof(candidate->iSize))
+						return nullptr;
+					return candidate;
+				};
+				// the locator's offset is only right if nothing was prepended to the archive; otherwise look back
+				// from the locator over the fixed part of the record and up to 64K of extensible data
+				const zip64_dir_header* dh64 = record_at(locator->iDirHeaderOffset);
+				if (locatorOffset >= sizeof(zip64_dir_header))
+				{
+					uint64_t const lastCandidate = locatorOffset - sizeof(zip64_dir_header);
+					uint64_t const firstCandidate = lastCandidate - std::min<uint64_t>(lastCandidate, 0xFFFF);
+					for (uint64_t candidate = lastCandidate + 1; dh64 == nullptr && candidate-- > firstCandidate;)
+						dh64 = record_at(candidate);
+				}
+				if (dh64 == nullptr)
+				{
+					iError = true;
+					return false;
+				}
+				entries = dh64->iDirEntries;
+				dirSize = dh64->iDirSize;
+				dirOffset = dh64->iDirOffset;
+				dirEnd = byte_cast(dh64) - byte_cast(data_front());
+			}
+		}
+		if (dirSize > dirEnd)
+		{
+			iError = true;
+			return false;
+		}
+		// the directory immediately precedes its end record; any difference from the recorded offset is data
+		// prepended to the archive (e.g. a self-extractor) which every other offset needs adjusting for
+		uint64_t const dirStart = dirEnd - dirSize;
+		int64_t const adjustment = static_cast<int64_t>(dirStart) - static_cast<int64_t>(dirOffset);
+		iEntries.reserve(static_cast<std::size_t>(std::min<uint64_t>(entries, dirSize / sizeof(dir_file_header))));
+		iFiles.reserve(iEntries.capacity());
+		const char* next = byte_cast(data_front()) + dirStart;
+		const char* const end = byte_cast(data_front()) + dirEnd;
+		for (uint64_t i = 0; i < entries; ++i)
+		{
+			const dir_file_header* fh = reinterpret_cast<const dir_file_header*>(next);
+			if (end - next < static_cast<std::ptrdiff_t>(sizeof(dir_file_header)) || fh->iSignature != dir_file_header::Signature)
+			{
+				iError = true;
 				return false;
 			}
-			if (fh->iSignature != dir_file_header::Signature)
+			const char* const filename = next + sizeof(dir_file_header);
+			const char* const extra = filename + fh->iFilenameLength;
+			next = extra + fh->iExtraLength + fh->iCommentLength;
+			if (next > end)
 			{
-				iError = false;
+				iError = true;
 				return false;
 			}
-			else
+			entry e{ fh->iHeaderOffset, fh->iCompressedSize, fh->iUncompressedSize, fh->iCrc32, fh->iCompression };
+			// sizes and offset that didn't fit in 32 bits are in the ZIP64 extra field, in this order, if saturated
+			for (const char* field = extra; field + 4 <= extra + fh->iExtraLength;)
 			{
-				if (byte_cast(reinterpret_cast<const char*>(fh) + sizeof(*fh) + fh->iFilenameLength + fh->iExtraLength + fh->iCommentLength) > 
-					byte_cast(dh))
+				word id, size;
+				std::memcpy(&id, field, sizeof(id));
+				std::memcpy(&size, field + 2, sizeof(size));
+				const char* value = field + 4;
+				const char* const valueEnd = std::min(value + size, extra + fh->iExtraLength);
+				if (id == 0x0001)
 				{
-					iError = false;
-					return false;
+					for (uint64_t* target : { &e.iUncompressedSize, &e.iCompressedSize, &e.iHeaderOffset })
+						if (*target == 0xFFFFFFFFu && value + sizeof(uint64_t) <= valueEnd)
+						{
+							std::memcpy(target, value, sizeof(uint64_t));
+							value += sizeof(uint64_t);
+						}
+					break;
 				}
-				iDirEntries.push_back(fh);
-				std::string filename(reinterpret_cast<const char*>(fh + 1), fh->iFilenameLength);
-				iFiles.push_back(filename);
-				fh = reinterpret_cast<const dir_file_header*>(reinterpret_cast<const char*>(fh) + sizeof(*fh) + fh->iFilenameLength + fh->iExtraLength + fh->iCommentLength);
+				field = value + size;
 			}
+			e.iHeaderOffset = static_cast<uint64_t>(static_cast<int64_t>(e.iHeaderOffset) + adjustment);
+			iEntries.push_back(e);
+			iFiles.emplace_back(filename, static_cast<std::size_t>(fh->iFilenameLength));
 		}
+		iIndex.reserve(iFiles.size());
+		for (std::size_t i = 0; i < iFiles.size(); ++i)
+			iIndex.emplace(iFiles[i], i);
 		return true;
 	}
 
-	const uint8_t* zip::data_front()
+	const uint8_t* zip::data_front() const
 	{
 		return iZipFileData;
 	}
 
-	const uint8_t* zip::data_back()
+	const uint8_t* zip::data_back() const
 	{
 		return (iZipFileData + iZipFileDataLength - 1);
 	}
@@ -0,0 +1,280 @@
+#include <neolib/neolib.hpp>
+#include <iostream>
+#include <list>
+#include <map>
+#include <algorithm>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <typeinfo>
+#include <boost/pool/pool_alloc.hpp>
+#include <neolib/allocator.hpp>
+#include <neolib/arena.hpp>
+#include <neolib/json.hpp>
+#include <neolib/xml.hpp>
+#include <neolib/segmented_array.hpp>
+#include <neolib/vecarray.hpp>
+#include "test.hpp"
+
+namespace
+{
+	template <typename Allocator>
+	long long churn_ms(std::size_t aThreads, std::size_t aIterations)
+	{
+		std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+		std::vector<std::thread> threads;
+		for (std::size_t t = 0; t < aThreads; ++t)
+			threads.emplace_back([aIterations]()
+			{
+				std::list<int, Allocator> list;
+				for (std::size_t i = 0; i < aIterations; ++i)
+				{
+					list.push_back(static_cast<int>(i));
+					if (list.size() > 100)
+						list.pop_front();
+				}
+			});
+		for (auto& thread : threads)
+			thread.join();
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+		return std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count();
+	}
+
+	template <typename Allocator>
+	long long build_and_drop_ms(std::size_t aRounds, std::size_t aElements)
+	{
+		std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+		for (std::size_t round = 0; round < aRounds; ++round)
+		{
+			neolib::scoped_arena arena;
+			std::map<int, int, std::less<int>, typename std::allocator_traits<Allocator>::template rebind_alloc<std::pair<const int, int>>> map;
+			for (std::size_t i = 0; i < aElements; ++i)
+				map.emplace(static_cast<int>(i * 7919 % aElements), static_cast<int>(i));
+		}
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+		return std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count();
+	}
+
+	template <typename Allocator>
+	void test_pool_allocator_arrays()
+	{
+		using neolib::test::check;
+		typedef typename Allocator::template array_allocator<8> block_allocator;
+		Allocator allocator;
+		auto const before = block_allocator::stats().iAllocations;
+		for (std::size_t count = 0; count <= Allocator::max_pooled_array + 4; ++count)
+		{
+			int* array = allocator.allocate(count);
+			for (std::size_t i = 0; i < count; ++i)
+				array[i] = static_cast<int>(i);
+			bool intact = true;
+			for (std::size_t i = 0; i < count; ++i)
+				intact = intact && array[i] == static_cast<int>(i);
+			check(intact, "pooled arrays hold every element");
+			allocator.deallocate(array, count);
+		}
+		check(block_allocator::stats().iAllocations - before == 4, "arrays of 5 to 8 elements come from the 8 element block pool");
+		check(block_allocator::stats().iLiveObjects == 0, "pooled arrays are returned to their pool");
+		std::vector<int, Allocator> vector;
+		for (int i = 0; i < 1000; ++i)
+			vector.push_back(i);
+		bool inOrder = true;
+		for (int i = 0; i < 1000; ++i)
+			inOrder = inOrder && vector[i] == i;
+		check(inOrder, "a vector grows through pooled and unpooled arrays");
+	}
+
+	// distinct types so that each allocator under test starts from a fresh pool with zeroed counters
+	template <std::size_t Size>
+	struct stats_probe
+	{
+		char bytes[Size];
+	};
+
+	template <typename Allocator>
+	void free_on_another_thread(Allocator& aAllocator, std::vector<typename Allocator::pointer>& aObjects)
+	{
+		std::thread{ [&]()
+		{
+			for (auto object : aObjects)
+				aAllocator.deallocate(object, 1);
+		} }.join();
+		aObjects.clear();
+	}
+
+	// allocates ten, frees four, allocates two more then frees the rest, half of them from another thread
+	template <typename Allocator>
+	void exercise_allocator_stats(std::size_t aElementSize, const std::string& aName)
+	{
+		using neolib::test::check;
+		Allocator allocator;
+		std::vector<typename Allocator::pointer> objects;
+		for (int i = 0; i < 10; ++i)
+			objects.push_back(allocator.allocate(1));
+		for (int i = 0; i < 4; ++i)
+		{
+			allocator.deallocate(objects.back(), 1);
+			objects.pop_back();
+		}
+		auto stats = Allocator::stats();
+		check(stats.iAllocations == 10 && stats.iDeallocations == 4, aName + " counts allocations and deallocations");
+		check(stats.iLiveObjects == 6 && stats.iBytesInUse == 6 * aElementSize, aName + " counts live objects");
+		for (int i = 0; i < 2; ++i)
+			objects.push_back(allocator.allocate(1));
+		std::vector<typename Allocator::pointer> elsewhere(objects.begin() + 4, objects.end());
+		objects.resize(4);
+		free_on_another_thread(allocator, elsewhere);
+		for (auto object : objects)
+			allocator.deallocate(object, 1);
+		stats = Allocator::stats();
+		check(stats.iAllocations == 12 && stats.iDeallocations == 12 && stats.iLiveObjects == 0 && stats.iBytesInUse == 0,
+			aName + " counts blocks freed by another thread");
+	}
+}
+
+namespace
+{
+	template <typename Container>
+	bool same_as(const Container& aContainer, const std::vector<int>& aReference)
+	{
+		return aContainer.size() == aReference.size() && std::equal(aContainer.begin(), aContainer.end(), aReference.begin());
+	}
+
+	template <typename Container>
+	void edit_like_vector(Container& aContainer, std::vector<int>& aReference)
+	{
+		for (int i = 0; i < 1000; ++i)
+		{
+			aContainer.push_back(i);
+			aReference.push_back(i);
+		}
+		for (int i = 0; i < 100; ++i)
+		{
+			std::size_t const position = static_cast<std::size_t>(i) * 7 % aReference.size();
+			aContainer.insert(aContainer.begin() + position, -i);
+			aReference.insert(aReference.begin() + position, -i);
+			aContainer.erase(aContainer.begin() + position / 2);
+			aReference.erase(aReference.begin() + position / 2);
+		}
+	}
+}
+
+void benchmark_pool_allocators()
+{
+	const std::size_t ITERATIONS = 2000000;
+	const std::size_t threads = std::max<std::size_t>(std::thread::hardware_concurrency(), 2);
+	for (std::size_t t : { std::size_t{ 1 }, threads })
+	{
+		std::cout << "\nthreads: " << t << std::endl;
+		std::cout << "std::allocator: " << churn_ms<std::allocator<int>>(t, ITERATIONS) << "ms" << std::endl;
+		std::cout << "boost::fast_pool_allocator (mutex): " << churn_ms<boost::fast_pool_allocator<int, boost::default_user_allocator_new_delete>>(t, ITERATIONS) << "ms" << std::endl;
+		std::cout << "neolib::thread_safe_fast_pool_allocator: " << churn_ms<neolib::thread_safe_fast_pool_allocator<int>>(t, ITERATIONS) << "ms" << std::endl;
+	}
+	neolib::allocator_registry::instance().dump(std::cout);
+	std::cout << std::endl;
+}
+
+void benchmark_arena_allocator()
+{
+	const std::size_t ROUNDS = 100;
+	const std::size_t ELEMENTS = 10000;
+	std::cout << "std::allocator: " << build_and_drop_ms<std::allocator<int>>(ROUNDS, ELEMENTS) << "ms" << std::endl;
+	std::cout << "neolib::arena_allocator: " << build_and_drop_ms<neolib::arena_allocator<int>>(ROUNDS, ELEMENTS) << "ms" << std::endl;
+}
+
+void test_pool_allocators()
+{
+	test_pool_allocator_arrays<neolib::pool_allocator<int>>();
+	test_pool_allocator_arrays<neolib::thread_safe_fast_pool_allocator<int>>();
+}
+
+void test_arena_allocator()
+{
+	using neolib::test::check;
+	neolib::scoped_arena scope;
+	{
+		std::vector<int> reference;
+		neolib::segmented_array<int, 64, neolib::arena_allocator<int>> segmentedArray;
+		edit_like_vector(segmentedArray, reference);
+		check(same_as(segmentedArray, reference), "segmented_array with arena_allocator matches std::vector");
+	}
+	{
+		std::vector<int> reference;
+		neolib::vecarray<int, 16, 4096, neolib::check<neolib::vecarray_overflow>, neolib::arena_allocator<int>> vecArray;
+		edit_like_vector(vecArray, reference);
+		check(same_as(vecArray, reference), "vecarray spilling to an arena_allocator vector matches std::vector");
+	}
+	{
+		typedef neolib::basic_json<neolib::json_syntax::Standard, neolib::arena_allocator<neolib::json_type>> arena_json;
+		arena_json json;
+		std::istringstream input{ "{\"name\": \"arena\", \"values\": [1, 2, 3], \"nested\": {\"flag\": true}}" };
+		check(json.read(input), "basic_json with arena_allocator parses");
+		auto& root = json.root().as<arena_json::json_object>();
+		check(root["name"].as<arena_json::json_string>() == "arena", "basic_json with arena_allocator reads strings");
+		check(root["values"].as<arena_json::json_array>().size() == 3 && root["values"].as<arena_json::json_array>()[2].as<arena_json::json_int>() == 3, "basic_json with arena_allocator reads arrays");
+		check(root["nested"].as<arena_json::json_object>()["flag"].as<arena_json::json_bool>(), "basic_json with arena_allocator reads nested objects");
+	}
+	{
+		typedef neolib::basic_xml<char, neolib::arena_allocator<char>> arena_xml;
+		arena_xml xml;
+		std::istringstream input{ "<root><item name=\"a\">first</item><item name=\"b\">second</item></root>" };
+		check(xml.read(input) && xml.got_root(), "basic_xml with arena_allocator parses");
+		std::size_t items = 0;
+		for (auto const& item : xml.root())
+			if (item.name() == "item" && item.has_attribute("name"))
+				++items;
+		check(items == 2, "basic_xml with arena_allocator reads elements and attributes");
+		xml.root().append("added").set_attribute("name", "c");
+		std::ostringstream output;
+		check(xml.write(output) && output.str().find("added") != std::string::npos, "basic_xml with arena_allocator writes");
+	}
+	check(scope.get().bytes_reserved() != 0, "containers allocate from the current arena");
+	check(scope.get().live_allocations() == 0, "containers return every block to the arena");
+}
+
+void test_allocator_stats()
+{
+	using neolib::test::check;
+	{
+		typedef stats_probe<24> probe;
+		typedef neolib::pool_allocator<probe> allocator;
+		exercise_allocator_stats<allocator>(sizeof(probe), "pool_allocator");
+		auto const stats = allocator::stats();
+		check(stats.iHighWaterMark == 10 * sizeof(probe), "pool_allocator records the peak of live objects");
+		check(stats.iChunksReserved == 1 && stats.iBytesReserved >= 4096, "pool_allocator counts its chunks");
+	}
+	{
+		typedef stats_probe<40> probe;
+		typedef neolib::fast_pool_allocator<probe> allocator;
+		exercise_allocator_stats<allocator>(sizeof(probe), "fast_pool_allocator");
+		check(allocator::stats().iHighWaterMark == 10 * sizeof(probe), "fast_pool_allocator records the peak of live objects");
+	}
+	{
+		typedef stats_probe<200> probe;
+		typedef neolib::thread_safe_fast_pool_allocator<probe> allocator;
+		typedef neolib::detail::thread_cached_pool<sizeof(probe), alignof(probe), 16 * 1024, 0> pool;
+		exercise_allocator_stats<allocator>(pool::element_size, "thread_safe_fast_pool_allocator");
+		auto const stats = allocator::stats();
+		// threads take whole magazines so the peak is that of the magazines handed out
+		check(stats.iHighWaterMark >= 10 * pool::element_size && stats.iHighWaterMark % (pool::magazine_size * pool::element_size) == 0,
+			"thread_safe_fast_pool_allocator records the peak of blocks handed out");
+		check(stats.iCrossThreadDeallocations == 4, "thread_safe_fast_pool_allocator counts deallocations by a thread that didn't allocate");
+	}
+
+	// the registry reports every pool as valid JSON
+	neolib::json report;
+	std::istringstream input{ neolib::allocator_registry::instance().to_json() };
+	check(report.read(input), "allocator_registry::to_json() produces valid JSON");
+	auto& allocators = report.root().as<neolib::json_object>()["allocators"].as<neolib::json_object>();
+	auto const* pool = allocators.find(std::string{ "neolib::pool_allocator<" } + typeid(stats_probe<24>).name() + ", 4096, 0>");
+	check(pool != nullptr, "allocator_registry::to_json() lists a pool_allocator");
+	auto const field = [&](const char* aName)
+	{
+		auto const* value = pool->as<neolib::json_object>().find(aName);
+		return value != nullptr && value->type() == neolib::json_type::Int ? value->as<neolib::json_int>() : -1;
+	};
+	check(field("live_objects") == 0 && field("allocations") == 12 && field("deallocations") == 12 &&
+		field("high_water_mark") == static_cast<int>(10 * sizeof(stats_probe<24>)) && field("chunks_reserved") == 1, "allocator_registry::to_json() reports a pool's counters");
+}
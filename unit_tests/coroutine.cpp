@@ -0,0 +1,98 @@
+#include <neolib/neolib.hpp>
+#include <stdexcept>
+#include <thread>
+#include <neolib/coroutine.hpp>
+#include <neolib/async_thread.hpp>
+#include <neolib/resolver.hpp>
+#include "test.hpp"
+
+namespace
+{
+	using neolib::test::check;
+
+	neolib::co_task<int> answer()
+	{
+		co_return 42;
+	}
+
+	neolib::co_task<int> add_to_answer(int aValue)
+	{
+		co_return co_await answer() + aValue;
+	}
+
+	neolib::co_task<void> fail()
+	{
+		co_await answer();
+		throw std::runtime_error("coroutine failed");
+	}
+
+	neolib::co_task<bool> catch_failure()
+	{
+		try
+		{
+			co_await fail();
+		}
+		catch (const std::runtime_error&)
+		{
+			co_return true;
+		}
+		co_return false;
+	}
+
+	neolib::co_task<std::thread::id> resume_on(neolib::thread_pool& aThreadPool)
+	{
+		co_await aThreadPool.schedule();
+		co_return std::this_thread::get_id();
+	}
+
+	neolib::co_task<std::thread::id> resume_on(neolib::async_task& aIoTask)
+	{
+		co_await aIoTask.schedule();
+		co_return std::this_thread::get_id();
+	}
+
+	neolib::co_task<std::chrono::steady_clock::duration> sleep_on(neolib::async_task& aIoTask, uint32_t aDuration_ms)
+	{
+		co_await aIoTask.schedule();
+		auto const start = std::chrono::steady_clock::now();
+		co_await neolib::timer_for(aDuration_ms);
+		co_return std::chrono::steady_clock::now() - start;
+	}
+
+	neolib::co_task<std::thread::id> resolve_on(neolib::async_task& aIoTask, const std::string& aHostName, bool& aResolved)
+	{
+		co_await aIoTask.schedule();
+		neolib::tcp_resolver resolver{ aIoTask };
+		auto const host = co_await resolver.resolve(aHostName);
+		aResolved = (host != neolib::tcp_resolver::iterator{});
+		co_return std::this_thread::get_id();
+	}
+}
+
+void test_coroutines()
+{
+	check(neolib::sync_wait(answer()) == 42, "sync_wait() delivers a coroutine's result");
+	check(neolib::sync_wait(add_to_answer(1)) == 43, "a coroutine can await another");
+	check(neolib::sync_wait(catch_failure()), "an awaited coroutine's exception is rethrown in its awaiter");
+	bool rethrown = false;
+	try
+	{
+		neolib::sync_wait(fail());
+	}
+	catch (const std::runtime_error&)
+	{
+		rethrown = true;
+	}
+	check(rethrown, "sync_wait() rethrows a coroutine's exception");
+
+	neolib::thread_pool threadPool;
+	check(neolib::sync_wait(resume_on(threadPool)) != std::this_thread::get_id(), "thread_pool::schedule() resumes on a pool thread");
+
+	neolib::async_thread ioThread{ "neolib::test_coroutines" };
+	ioThread.start();
+	check(neolib::sync_wait(resume_on(ioThread)) == ioThread.thread_object().get_id(), "async_task::schedule() resumes on the task's thread");
+	check(neolib::sync_wait(sleep_on(ioThread, 20)) >= std::chrono::milliseconds{ 20 }, "timer_for() resumes once its period has elapsed");
+	bool resolved = false;
+	check(neolib::sync_wait(resolve_on(ioThread, "localhost", resolved)) == ioThread.thread_object().get_id(), "a resolve resumes on the io task's thread");
+	check(resolved, "localhost resolves");
+}
@@ -0,0 +1,101 @@
+#include <neolib/neolib.hpp>
+#include <iostream>
+#include <random>
+#include <chrono>
+#include <vector>
+#include <zlib/zlib.h>
+#include <neolib/crc.hpp>
+#include <neolib/thread_pool.hpp>
+#include "test.hpp"
+
+namespace
+{
+	template <typename Function>
+	long long time_taken(Function aFunction)
+	{
+		std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+		aFunction();
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+		return std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count();
+	}
+
+	// one bit at a time, straight from the definition
+	uint32_t bitwise_crc(neolib::crc_polynomial aPolynomial, uint32_t aCrc, const uint8_t* aData, std::size_t aLength)
+	{
+		uint32_t value = ~aCrc;
+		for (std::size_t i = 0; i < aLength; ++i)
+		{
+			value ^= aData[i];
+			for (int bit = 0; bit < 8; ++bit)
+				value = (value >> 1) ^ (static_cast<uint32_t>(aPolynomial) & (0u - (value & 1u)));
+		}
+		return ~value;
+	}
+}
+
+void benchmark_crc()
+{
+	const std::size_t BYTES = 1024 * 1024 * 1024;
+	std::vector<uint8_t> data(BYTES);
+	std::mt19937 random;
+	for (auto& byte : data)
+		byte = static_cast<uint8_t>(random());
+	auto const mbps = [&](long long aMicroseconds) { return aMicroseconds != 0 ? static_cast<long long>(BYTES / aMicroseconds) : 0ll; };
+	uint32_t checksum = 0;
+	for (auto polynomial : { neolib::crc_polynomial::Crc32, neolib::crc_polynomial::Crc32c })
+	{
+		const char* name = (polynomial == neolib::crc_polynomial::Crc32 ? "crc32" : "crc32c");
+		long long serial = time_taken([&]() { checksum = neolib::crc(polynomial, 0u, data.data(), data.size()); });
+		std::cout << name << ": " << mbps(serial) << "MB/s (" << std::hex << checksum << std::dec << ")" << std::endl;
+		long long parallel = time_taken([&]() { checksum = neolib::parallel_crc(neolib::thread_pool::default_thread_pool(), polynomial, data.data(), data.size()); });
+		std::cout << name << " (parallel_crc): " << mbps(parallel) << "MB/s (" << std::hex << checksum << std::dec << ")" << std::endl;
+	}
+}
+
+void test_crc()
+{
+	using neolib::test::check;
+	using neolib::crc_polynomial;
+	check(neolib::crc(crc_polynomial::Crc32, 0u, "123456789", 9) == 0xCBF43926u, "CRC-32 check value");
+	check(neolib::crc(crc_polynomial::Crc32c, 0u, "123456789", 9) == 0xE3069283u, "CRC-32C check value");
+	std::vector<uint8_t> data(1024 * 1024 * 3 + 5);
+	std::mt19937 random;
+	for (auto& byte : data)
+		byte = static_cast<uint8_t>(random());
+	std::vector<std::size_t> lengths;
+	for (std::size_t length = 0; length <= 300; ++length)
+		lengths.push_back(length);
+	for (std::size_t length = 301; length <= 20000; length = length * 5 / 4 + 7)
+		lengths.push_back(length);
+	// unaligned starts take the scalar head before the wide loops
+	for (std::size_t offset : { 0, 1, 7 })
+		for (std::size_t length : lengths)
+		{
+			const uint8_t* const start = data.data() + offset;
+			uint32_t const crc32 = neolib::crc(crc_polynomial::Crc32, 0u, start, length);
+			check(crc32 == bitwise_crc(crc_polynomial::Crc32, 0u, start, length), "CRC-32 matches the bitwise reference");
+			check(crc32 == static_cast<uint32_t>(::crc32(0ul, start, static_cast<uInt>(length))), "CRC-32 matches zlib");
+			check(neolib::crc(crc_polynomial::Crc32c, 0u, start, length) == bitwise_crc(crc_polynomial::Crc32c, 0u, start, length), "CRC-32C matches the bitwise reference");
+		}
+	for (auto polynomial : { crc_polynomial::Crc32, crc_polynomial::Crc32c })
+	{
+		std::size_t const length = 100000;
+		uint32_t const whole = neolib::crc(polynomial, 0u, data.data(), length);
+		check(neolib::crc(polynomial, neolib::crc(polynomial, 0u, data.data(), 12345), data.data() + 12345, length - 12345) == whole, "a CRC continues across calls");
+		for (int split = 0; split < 50; ++split)
+		{
+			std::size_t const first = std::uniform_int_distribution<std::size_t>{ 0, length }(random);
+			uint32_t const crc1 = neolib::crc(polynomial, 0u, data.data(), first);
+			uint32_t const crc2 = neolib::crc(polynomial, 0u, data.data() + first, length - first);
+			check(neolib::crc_combine(polynomial, crc1, crc2, length - first) == whole, "crc_combine() of a split equals the CRC of the whole");
+		}
+		check(neolib::parallel_crc(neolib::thread_pool::default_thread_pool(), polynomial, data.data(), data.size()) ==
+			neolib::crc(polynomial, 0u, data.data(), data.size()), "parallel_crc() equals the serial CRC");
+	}
+	neolib::crc32c_engine head;
+	neolib::crc32c_engine tail;
+	head.update(data.data(), 1000).update(data.data() + 1000, 3000);
+	tail.update(data.data() + 4000, 5000);
+	head.append(tail);
+	check(head.value() == neolib::crc32c(0u, data.data(), 9000), "an engine appending a later engine equals the CRC of the whole");
+}
@@ -0,0 +1,238 @@
+#include <neolib/neolib.hpp>
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <optional>
+#include <future>
+#include <mutex>
+#include <neolib/event.hpp>
+#include "test.hpp"
+
+namespace
+{
+	double triggers_per_second(neolib::event_dispatch_mode aDispatchMode, std::size_t aThreads, std::size_t aTriggers)
+	{
+		neolib::event<int> event;
+		event.set_dispatch_mode(aDispatchMode);
+		std::atomic<long long> total{ 0 };
+		std::vector<neolib::sink> sinks;
+		for (int h = 0; h < 4; ++h)
+			sinks.push_back(~event([&total](int aValue) { total.fetch_add(aValue, std::memory_order_relaxed); }));
+		std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+		std::vector<std::thread> threads;
+		for (std::size_t t = 0; t < aThreads; ++t)
+			threads.emplace_back([&event, aTriggers]()
+			{
+				for (std::size_t i = 0; i < aTriggers; ++i)
+					event.trigger(1);
+			});
+		for (auto& thread : threads)
+			thread.join();
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+		return aThreads * aTriggers / std::chrono::duration<double>(end - begin).count();
+	}
+	// runs the same subscription scenarios under a dispatch mode; the modes must agree
+	std::vector<std::string> dispatch_scenarios(neolib::event_dispatch_mode aDispatchMode)
+	{
+		std::vector<std::string> results;
+		{
+			neolib::event<int> event;
+			event.set_dispatch_mode(aDispatchMode);
+			std::string order;
+			neolib::sink sink;
+			sink += event([&](int aValue) { order += "a" + std::to_string(aValue); });
+			sink += event([&](int aValue) { order += "b" + std::to_string(aValue); if (aValue == 2) event.accept(); });
+			sink += event([&](int aValue) { order += "c" + std::to_string(aValue); });
+			bool const first = event.trigger(1);
+			bool const second = event.trigger(2);
+			results.push_back("order: " + order + (first ? " 1" : " 0") + (second ? " 1" : " 0"));
+		}
+		{
+			neolib::event<> event;
+			event.set_dispatch_mode(aDispatchMode);
+			std::string order;
+			neolib::sink later;
+			neolib::sink added;
+			neolib::sink sink = event([&]()
+			{
+				order += "a";
+				later = neolib::sink{};
+				if (order.size() == 1)
+					added = event([&]() { order += "x"; });
+			});
+			later = event([&]() { order += "b"; });
+			event.trigger();
+			event.trigger();
+			results.push_back("changes during trigger: " + order);
+		}
+		{
+			std::optional<neolib::event<>> event{ std::in_place };
+			event->set_dispatch_mode(aDispatchMode);
+			std::string order;
+			neolib::sink sink;
+			sink += (*event)([&]() { order += "a"; event.reset(); });
+			sink += (*event)([&]() { order += "b"; });
+			bool const result = event->trigger();
+			results.push_back("destroyed during trigger: " + order + (result ? " 1" : " 0"));
+		}
+		return results;
+	}
+}
+
+void benchmark_event_dispatch()
+{
+	const std::size_t TRIGGERS = 1000000;
+	const std::size_t threads = std::max<std::size_t>(std::thread::hardware_concurrency(), 2);
+	for (std::size_t t : { std::size_t{ 1 }, threads })
+	{
+		std::cout << "\nthreads: " << t << std::endl;
+		std::cout << "locking dispatch: " << triggers_per_second(neolib::event_dispatch_mode::Locking, t, TRIGGERS) << " triggers/s" << std::endl;
+		std::cout << "snapshot dispatch: " << triggers_per_second(neolib::event_dispatch_mode::Snapshot, t, TRIGGERS) << " triggers/s" << std::endl;
+	}
+}
+
+void benchmark_async_event_latency()
+{
+	const int TRIGGERS = 1000;
+	neolib::event<std::chrono::steady_clock::time_point> event;
+	event.set_trigger_type(neolib::event_trigger_type::Asynchronous);
+	std::atomic<int> delivered{ 0 };
+	std::atomic<long long> totalLatency{ 0 };
+	neolib::sink sink = ~event([&](std::chrono::steady_clock::time_point aSent)
+	{
+		totalLatency += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - aSent).count();
+		++delivered;
+	});
+	for (int i = 0; i < TRIGGERS; ++i)
+	{
+		event.trigger(std::chrono::steady_clock::now());
+		while (delivered != i + 1)
+			std::this_thread::yield();
+	}
+	std::cout << "mean async event latency: " << totalLatency / TRIGGERS << "us" << std::endl;
+}
+void test_event_dispatch()
+{
+	using neolib::test::check;
+	auto const locking = dispatch_scenarios(neolib::event_dispatch_mode::Locking);
+	auto const snapshot = dispatch_scenarios(neolib::event_dispatch_mode::Snapshot);
+	check(locking == snapshot, "snapshot dispatch behaves like locking dispatch");
+	check(snapshot[0] == "order: a1b1c1a2b2 1 0", "handlers run in subscription order until one accepts");
+	check(snapshot[1] == "changes during trigger: aax", "a trigger skips handlers removed and not handlers added while it runs");
+	check(snapshot[2] == "destroyed during trigger: a 0", "a trigger stops when a handler destroys the event");
+
+	// triggers racing dispatch mode changes and subscription changes must neither touch a freed dispatcher
+	// nor lose or repeat a call to a handler that stays subscribed
+	const std::size_t TRIGGERS = 20000;
+	const std::size_t threads = std::max<std::size_t>(std::thread::hardware_concurrency(), 2);
+	neolib::event<int> event;
+	std::atomic<std::size_t> calls{ 0 };
+	auto const handler = [&](int) { ++calls; };
+	neolib::sink sink = ~event(handler, &calls);
+	std::atomic<bool> finished{ false };
+	std::thread changer{ [&]()
+	{
+		bool snapshotMode = false;
+		while (!finished)
+		{
+			snapshotMode = !snapshotMode;
+			event.set_dispatch_mode(snapshotMode ? neolib::event_dispatch_mode::Snapshot : neolib::event_dispatch_mode::Locking);
+			event(handler, &calls); // resubscribing publishes a new snapshot
+		}
+	} };
+	std::vector<std::thread> triggerers;
+	for (std::size_t t = 0; t < threads; ++t)
+		triggerers.emplace_back([&]()
+		{
+			for (std::size_t i = 0; i < TRIGGERS; ++i)
+				event.trigger(1);
+		});
+	for (auto& triggerer : triggerers)
+		triggerer.join();
+	finished = true;
+	changer.join();
+	check(calls == threads * TRIGGERS, "every trigger calls a subscribed handler exactly once while the dispatch mode changes");
+}
+
+void test_async_event_queue()
+{
+	using neolib::test::check;
+	auto queue = neolib::async_event_queue::instance();
+	{
+		// handlers subscribed here and triggered elsewhere are queued to this thread
+		neolib::event<int> event;
+		std::vector<int> first;
+		std::vector<int> second;
+		neolib::sink sink;
+		sink += event([&](int aValue) { first.push_back(aValue); });
+		sink += event([&](int aValue) { second.push_back(aValue); });
+		auto const triggerElsewhere = [&]() { std::thread{ [&]() { for (int i = 1; i <= 3; ++i) event.trigger(i); } }.join(); };
+		queue->set_coalescing(true);
+		triggerElsewhere();
+		queue->exec();
+		check(first == std::vector<int>{ 3 } && second == std::vector<int>{ 3 }, "coalescing delivers the last trigger to every handler");
+		queue->set_coalescing(false);
+		first.clear();
+		second.clear();
+		triggerElsewhere();
+		queue->exec();
+		check(first == std::vector<int>{ 1, 2, 3 } && second == std::vector<int>{ 1, 2, 3 }, "without coalescing every trigger is delivered");
+	}
+	{
+		neolib::event<int> event;
+		event.set_trigger_type(neolib::event_trigger_type::Asynchronous);
+		std::mutex deliveredMutex;
+		std::vector<int> delivered;
+		std::promise<void> gate;
+		std::shared_future<void> opened = gate.get_future().share();
+		std::atomic<bool> blocking{ false };
+		neolib::sink sink = ~event([&](int aValue)
+		{
+			{
+				std::lock_guard<std::mutex> lg{ deliveredMutex };
+				delivered.push_back(aValue);
+			}
+			if (aValue == 0)
+			{
+				blocking = true;
+				opened.wait();
+			}
+		});
+		// hold up the queue's thread so the next triggers stay queued
+		event.trigger(0);
+		while (!blocking)
+			std::this_thread::yield();
+		event.trigger(1);
+		event.trigger(2);
+		check(queue->has(event), "has() finds an event's queued triggers");
+		queue->remove(event);
+		check(!queue->has(event), "remove() takes every queued trigger of the event");
+		{
+			std::lock_guard<std::mutex> lg{ deliveredMutex };
+			check(delivered == std::vector<int>{ 0, 1, 2 }, "remove() publishes the triggers it takes");
+		}
+		bool threw = false;
+		try
+		{
+			queue->remove(event);
+		}
+		catch (const neolib::async_event_queue::event_not_found&)
+		{
+			threw = true;
+		}
+		check(threw, "remove() throws event_not_found when nothing is queued");
+		gate.set_value();
+		event.trigger(3);
+		for (bool done = false; !done; std::this_thread::yield())
+		{
+			std::lock_guard<std::mutex> lg{ deliveredMutex };
+			done = delivered.size() >= 4;
+		}
+		std::lock_guard<std::mutex> lg{ deliveredMutex };
+		check(delivered == std::vector<int>{ 0, 1, 2, 3 }, "triggers taken by remove() are not delivered again");
+	}
+}
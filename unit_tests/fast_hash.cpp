@@ -0,0 +1,194 @@
+#include <neolib/neolib.hpp>
+#include <iostream>
+#include <random>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <neolib/fast_hash.hpp>
+#include "test.hpp"
+
+namespace
+{
+	template <typename Function>
+	long long time_taken(Function aFunction)
+	{
+		std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+		aFunction();
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+		return std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count();
+	}
+
+	struct known_answer
+	{
+		std::size_t length;
+		uint64_t seed;
+		uint64_t low;
+		uint64_t high;
+	};
+
+	// digests of the first length bytes of known_answer_input(); the scalar, SSE2 and AVX2 stripe accumulators and the
+	// portable 64x64 multiply all produce these
+	const known_answer sKnownAnswers[] =
+	{
+		{ 0, 0x0000000000000000ull, 0x0409638EE2BDE459ull, 0xD99F0CC8E1B80C02ull },
+		{ 0, 0x0123456789ABCDEFull, 0x2B4E3DF129B1F482ull, 0x3FF1DFD178B50A45ull },
+		{ 1, 0x0000000000000000ull, 0xFDDEEEEA8CC2709Cull, 0x928EEDDC26E649B9ull },
+		{ 1, 0x0123456789ABCDEFull, 0x9238C26D4F1ABAE8ull, 0x1D465BCACD90AC39ull },
+		{ 2, 0x0000000000000000ull, 0xCA53C1E8890F395Cull, 0x7889B71232E086DBull },
+		{ 2, 0x0123456789ABCDEFull, 0x9EAA02E14B8898CBull, 0xBCD0F8969C1602AEull },
+		{ 3, 0x0000000000000000ull, 0xAA4DADA6D17EEBB0ull, 0xDE04554C9EC5C5E5ull },
+		{ 3, 0x0123456789ABCDEFull, 0xA1AEA1C588AAADBBull, 0xC08985EBA9517893ull },
+		{ 4, 0x0000000000000000ull, 0x8D9D4657E96CC294ull, 0x303F043DFEFFDC2Full },
+		{ 4, 0x0123456789ABCDEFull, 0x0F7AFA8710DA7E08ull, 0xD03940508B241AFCull },
+		{ 7, 0x0000000000000000ull, 0x935A88298D5507C9ull, 0xD0D46A21E46BA9B9ull },
+		{ 7, 0x0123456789ABCDEFull, 0xB270F6403668B004ull, 0xD1FA5922554DD3AFull },
+		{ 8, 0x0000000000000000ull, 0x9654832F28858268ull, 0x4680F85765AD5A58ull },
+		{ 8, 0x0123456789ABCDEFull, 0x261D186451A89FADull, 0xCDE2098E5C85A8CBull },
+		{ 9, 0x0000000000000000ull, 0x708E1187F06D6AAAull, 0xC9F1F83260FFD439ull },
+		{ 9, 0x0123456789ABCDEFull, 0x9E13A60FCAE4C71Eull, 0xD22D28BB639BED8Eull },
+		{ 15, 0x0000000000000000ull, 0xB10EA23D7453482Eull, 0x435E97BE9452FEFDull },
+		{ 15, 0x0123456789ABCDEFull, 0xA42785E4163AF0FDull, 0x390EE27BF5C30D49ull },
+		{ 16, 0x0000000000000000ull, 0x36B53F8551944DB0ull, 0xE62F0A3A469585BFull },
+		{ 16, 0x0123456789ABCDEFull, 0x5EEF37151B6C191Cull, 0x4C76DF3E71223260ull },
+		{ 17, 0x0000000000000000ull, 0x904849BDD1E93C7Cull, 0x91F184AE1730BAF2ull },
+		{ 17, 0x0123456789ABCDEFull, 0x3666B60A397C36CFull, 0x24B3073112F4857Bull },
+		{ 31, 0x0000000000000000ull, 0x21008267C30EB404ull, 0xA86C823C1AA8716Full },
+		{ 31, 0x0123456789ABCDEFull, 0xA25D3782224044A6ull, 0x1C59A44BFC9FD74Bull },
+		{ 32, 0x0000000000000000ull, 0x4D1435B5E345C9CBull, 0xAF35E64EEE294FC6ull },
+		{ 32, 0x0123456789ABCDEFull, 0x2E0C6BE266EB96ECull, 0xFEC45FFFEAE8DA4Aull },
+		{ 33, 0x0000000000000000ull, 0x35ECEB8164DEE4AEull, 0x9D7D5DB63DDF72C3ull },
+		{ 33, 0x0123456789ABCDEFull, 0x2309FBA44607D4B7ull, 0x58D91A0AE774ED51ull },
+		{ 48, 0x0000000000000000ull, 0x3EC1B034DBE02BD7ull, 0x261B39C4FD693ECCull },
+		{ 48, 0x0123456789ABCDEFull, 0x01D882DD10C0F235ull, 0xB5ED186453A085D3ull },
+		{ 49, 0x0000000000000000ull, 0x30161CB91C8DF53Eull, 0xB3328289003921C2ull },
+		{ 49, 0x0123456789ABCDEFull, 0xDCFEDFFA0F32435Full, 0x634E90EBABFA0818ull },
+		{ 63, 0x0000000000000000ull, 0x0794C5DE59C19D99ull, 0xDC247B5F67AA1257ull },
+		{ 63, 0x0123456789ABCDEFull, 0x213DABD1D014B010ull, 0xE74DCA359105DAA3ull },
+		{ 64, 0x0000000000000000ull, 0xEFD3E3780F38A91Cull, 0x46364EA8CA5986A1ull },
+		{ 64, 0x0123456789ABCDEFull, 0xE9F939251D10AA2Aull, 0x2A442BE9FAAF8B3Eull },
+		{ 65, 0x0000000000000000ull, 0x54E9E0F63ADBFDEFull, 0xAC5C5686B0C46405ull },
+		{ 65, 0x0123456789ABCDEFull, 0x3A4121AE445D6E9Eull, 0xAF97B57292E7843Bull },
+		{ 96, 0x0000000000000000ull, 0xAAFAA5FF0421FF8Cull, 0x7049C5298DC55A9Aull },
+		{ 96, 0x0123456789ABCDEFull, 0x83E4E55B64FED41Full, 0x2B71E5132630534Bull },
+		{ 127, 0x0000000000000000ull, 0xEEFE7C161F11D539ull, 0x030EB4F9D680C5C0ull },
+		{ 127, 0x0123456789ABCDEFull, 0x485C45A493F79E6Eull, 0xE2092E2BB1633364ull },
+		{ 128, 0x0000000000000000ull, 0x4329D1A474B869F6ull, 0x90A3BFA9BAD65707ull },
+		{ 128, 0x0123456789ABCDEFull, 0x4019BB0550939145ull, 0x514C0D8175C1BD29ull },
+		{ 129, 0x0000000000000000ull, 0x53CCFA01FCBB2523ull, 0x9CA7402DCE3AB1E5ull },
+		{ 129, 0x0123456789ABCDEFull, 0x304FF0B64EC7C283ull, 0xA92A0BC41D8C99C7ull },
+		{ 200, 0x0000000000000000ull, 0x84FE0EE28745F44Cull, 0x6EAD21248BA9B264ull },
+		{ 200, 0x0123456789ABCDEFull, 0x71869FB7D69DD4BEull, 0x4898E1C2432011EFull },
+		{ 240, 0x0000000000000000ull, 0xA3F1383B3C5C55B0ull, 0x13625FB17E7A41BBull },
+		{ 240, 0x0123456789ABCDEFull, 0xEB82015E55435414ull, 0xF4DC67D04D5F87DCull },
+		{ 255, 0x0000000000000000ull, 0x9EA72F9C7F36B91Bull, 0x386EA01DC8465DDFull },
+		{ 255, 0x0123456789ABCDEFull, 0xAEC6F559656ECFCDull, 0x48FFF9ECBFC835BDull },
+		{ 256, 0x0000000000000000ull, 0xE4E465A228B2D552ull, 0x7D239D188B7B6743ull },
+		{ 256, 0x0123456789ABCDEFull, 0x0A69D252EF011D5Full, 0x66F867CEB40B50F3ull },
+		{ 257, 0x0000000000000000ull, 0xF02447F8500D00B6ull, 0x4470BBE0DACBFB66ull },
+		{ 257, 0x0123456789ABCDEFull, 0xDC630DA9CB2090B2ull, 0xCE20683B1BA34027ull },
+		{ 300, 0x0000000000000000ull, 0xF4141CFCCD347BF0ull, 0x2A88F98F5FDA7BC5ull },
+		{ 300, 0x0123456789ABCDEFull, 0x59291B8C599FD2C2ull, 0xDC5364906F0B6051ull },
+		{ 511, 0x0000000000000000ull, 0x354098543EFBCF69ull, 0x6FB71F6A33C8E036ull },
+		{ 511, 0x0123456789ABCDEFull, 0x55A23EFA3226D338ull, 0x9385E56972385F2Dull },
+		{ 512, 0x0000000000000000ull, 0xA0980D938123DC9Eull, 0xCDDE3D942DCFE65Cull },
+		{ 512, 0x0123456789ABCDEFull, 0x8EB22E490122ECFFull, 0x7E0A808CD4B0857Cull },
+		{ 1000, 0x0000000000000000ull, 0x9D1CF70D2BAE62B6ull, 0xFD96372A3D7ECA8Full },
+		{ 1000, 0x0123456789ABCDEFull, 0xC7D1217FA69934ABull, 0xE593098267FB3987ull },
+		{ 1024, 0x0000000000000000ull, 0xB836B5D1495E2F2Bull, 0x06B8D338856B6642ull },
+		{ 1024, 0x0123456789ABCDEFull, 0x28F31E9FEBA265A2ull, 0x095FAD17476B285Bull },
+		{ 1025, 0x0000000000000000ull, 0xE0B8C573D72C751Full, 0x30CC7E79D203442Bull },
+		{ 1025, 0x0123456789ABCDEFull, 0x2814472BF94AF2C0ull, 0x5990597B421E1499ull },
+		{ 4096, 0x0000000000000000ull, 0x05E7DDD428CEBC33ull, 0x4D403BEA6B3C6A0Eull },
+		{ 4096, 0x0123456789ABCDEFull, 0xE408FA100D4F71F5ull, 0x406D8B902CDB2E44ull },
+		{ 4999, 0x0000000000000000ull, 0x21C83405821EEC75ull, 0x54C3E738BACE9BFEull },
+		{ 4999, 0x0123456789ABCDEFull, 0x9F1EFB2AB5B571B9ull, 0xF94238A81C191414ull }
+	};
+
+	std::vector<uint8_t> known_answer_input()
+	{
+		std::vector<uint8_t> result(5000);
+		for (std::size_t i = 0; i < result.size(); ++i)
+			result[i] = static_cast<uint8_t>(i * 31 + 7);
+		return result;
+	}
+}
+
+void test_fast_hash()
+{
+	using neolib::test::check;
+	check(neolib::fast_hash<uint32_t, neolib::hash_algorithm::Fnv1a>("", 0) == 0x811C9DC5u &&
+		neolib::fast_hash<uint32_t, neolib::hash_algorithm::Fnv1a>("a", 1) == 0xE40C292Cu &&
+		neolib::fast_hash<uint32_t, neolib::hash_algorithm::Fnv1a>("foobar", 6) == 0xBF9CF968u, "FNV-1a 32 bit reference values");
+	check(neolib::fast_hash<uint64_t, neolib::hash_algorithm::Fnv1a>("", 0) == 0xCBF29CE484222325ull &&
+		neolib::fast_hash<uint64_t, neolib::hash_algorithm::Fnv1a>("a", 1) == 0xAF63DC4C8601EC8Cull &&
+		neolib::fast_hash<uint64_t, neolib::hash_algorithm::Fnv1a>("foobar", 6) == 0x85944171F73967E8ull, "FNV-1a 64 bit reference values");
+
+	auto const input = known_answer_input();
+	for (auto const& answer : sKnownAnswers)
+	{
+		auto const digest = neolib::fast_hash128(input.data(), answer.length, answer.seed);
+		check(digest.low == answer.low && digest.high == answer.high, "fast_hash128 of " + std::to_string(answer.length) + " bytes matches its known answer");
+		check(neolib::fast_hash64(input.data(), answer.length, answer.seed) == answer.low, "fast_hash64 is the low half of fast_hash128");
+		if (answer.seed == 0)
+			check(neolib::fast_hash<uint64_t>(input.data(), answer.length) == answer.low, "fast_hash<uint64_t> is unseeded fast_hash64");
+	}
+
+	// streamed digests equal the one-shot digest however the input is split, including across the stripe and buffer boundaries
+	std::mt19937 random{ 42 };
+	neolib::fast_hasher hasher;
+	for (auto const& answer : sKnownAnswers)
+	{
+		hasher.reset(answer.seed);
+		for (std::size_t i = 0; i < answer.length; ++i)
+			hasher.update(&input[i], 1);
+		check(hasher.digest128() == neolib::hash128{ answer.low, answer.high }, "byte at a time fast_hasher matches the one-shot digest");
+		for (int split = 0; split < 20; ++split)
+		{
+			hasher.reset(answer.seed);
+			std::size_t const maxChunk = std::size_t{ 1 } << (split % 10);
+			for (std::size_t fed = 0; fed < answer.length;)
+			{
+				std::size_t const chunk = std::min(answer.length - fed, std::uniform_int_distribution<std::size_t>{ 0, maxChunk }(random));
+				hasher.update(&input[fed], chunk);
+				fed += chunk;
+			}
+			check(hasher.digest128() == neolib::hash128{ answer.low, answer.high } && hasher.digest64() == answer.low, "chunked fast_hasher matches the one-shot digest");
+		}
+	}
+	hasher.reset();
+	hasher.update(std::string_view{ "foobar" });
+	check(hasher.digest64() == neolib::fast_hash64("foobar", 6), "fast_hasher hashes a string_view's characters");
+}
+
+void benchmark_fast_hash()
+{
+	const std::size_t BYTES = 256 * 1024 * 1024;
+	std::vector<uint8_t> data(BYTES + 64);
+	std::mt19937 random;
+	for (auto& byte : data)
+		byte = static_cast<uint8_t>(random());
+	for (std::size_t length : { 8, 16, 32, 64, 256, 1024, 65536, 16 * 1024 * 1024 })
+	{
+		std::size_t const count = BYTES / length;
+		uint64_t checksum = 0;
+		auto const mbps = [&](long long aMicroseconds) { return aMicroseconds != 0 ? static_cast<long long>(BYTES / aMicroseconds) : 0ll; };
+		long long fnv = time_taken([&]()
+		{
+			for (std::size_t i = 0; i < count; ++i)
+				checksum += neolib::fast_hash<uint64_t, neolib::hash_algorithm::Fnv1a>(&data[(i * length) % BYTES + i % 64], length);
+		});
+		long long wyhash = time_taken([&]()
+		{
+			for (std::size_t i = 0; i < count; ++i)
+				checksum += neolib::fast_hash64(&data[(i * length) % BYTES + i % 64], length);
+		});
+		long long streamed = time_taken([&]()
+		{
+			neolib::fast_hasher hasher;
+			for (std::size_t i = 0; i < count; ++i)
+				hasher.update(&data[i * length], length);
+			checksum += hasher.digest64();
+		});
+		std::cout << length << " byte keys: FNV-1a " << mbps(fnv) << "MB/s, fast_hash64 " << mbps(wyhash) << "MB/s, fast_hasher (streamed) " << mbps(streamed) << "MB/s (checksum " << checksum << ")" << std::endl;
+	}
+}
@@ -0,0 +1,143 @@
+#include <neolib/neolib.hpp>
+#include <iostream>
+#include <random>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <algorithm>
+#include <stdexcept>
+#include <neolib/flat_hash_map.hpp>
+#include "test.hpp"
+
+namespace
+{
+	// Throws once the shared budget of calls runs out.
+	struct fallible_hash
+	{
+		std::size_t operator()(int aKey) const
+		{
+			if (calls_left()-- == 0)
+				throw std::runtime_error("fallible_hash");
+			return neolib::hash<int>{}(aKey);
+		}
+		static int& calls_left()
+		{
+			static int sCallsLeft = -1;
+			return sCallsLeft;
+		}
+	};
+
+	template <typename Function>
+	long long time_taken(Function aFunction)
+	{
+		std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+		aFunction();
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+		return std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count();
+	}
+
+	template <typename Map, typename Key>
+	void benchmark_map(const char* aName, const std::vector<Key>& aKeys, const std::vector<Key>& aMissingKeys, std::size_t aPasses)
+	{
+		// look up in a different order from insertion so node based maps don't get sequential node access for free
+		std::vector<Key> lookups = aKeys;
+		std::shuffle(lookups.begin(), lookups.end(), std::mt19937{});
+		Map map;
+		std::size_t checksum = 0;
+		long long insert = time_taken([&]()
+		{
+			for (std::size_t i = 0; i < aKeys.size(); ++i)
+				map[aKeys[i]] = i;
+		});
+		long long findHit = time_taken([&]()
+		{
+			for (std::size_t pass = 0; pass < aPasses; ++pass)
+				for (const auto& key : lookups)
+					checksum += map.find(key)->second;
+		});
+		long long findMiss = time_taken([&]()
+		{
+			for (std::size_t pass = 0; pass < aPasses; ++pass)
+				for (const auto& key : aMissingKeys)
+					checksum += map.count(key);
+		});
+		long long eraseInsert = time_taken([&]()
+		{
+			for (std::size_t i = 0; i < aKeys.size(); i += 2)
+				map.erase(aKeys[i]);
+			for (std::size_t i = 0; i < aKeys.size(); i += 2)
+				map.emplace(aKeys[i], i);
+		});
+		std::cout << aName << ": insert: " << insert << "ms, find (hit): " << findHit << "ms, find (miss): " << findMiss << "ms, erase/reinsert: " << eraseInsert << "ms (checksum " << checksum << ")" << std::endl;
+	}
+}
+
+void benchmark_flat_hash_map()
+{
+	const std::size_t KEYS = 1000000;
+	const std::size_t PASSES = 10;
+	std::mt19937 random;
+
+	std::vector<std::unique_ptr<int>> objects;
+	std::vector<const void*> pointers;
+	std::vector<const void*> missingPointers;
+	for (std::size_t i = 0; i < KEYS * 2; ++i)
+	{
+		objects.push_back(std::make_unique<int>(static_cast<int>(i)));
+		(i % 2 == 0 ? pointers : missingPointers).push_back(objects.back().get());
+	}
+	std::shuffle(pointers.begin(), pointers.end(), random);
+	std::cout << "\n" << KEYS << " pointer keys" << std::endl;
+	benchmark_map<std::unordered_map<const void*, std::size_t>>("std::unordered_map", pointers, missingPointers, PASSES);
+	benchmark_map<neolib::flat_hash_map<const void*, std::size_t>>("neolib::flat_hash_map", pointers, missingPointers, PASSES);
+
+	std::vector<std::string> strings;
+	std::vector<std::string> missingStrings;
+	std::uniform_int_distribution<int> letter{ 'a', 'z' };
+	std::uniform_int_distribution<std::size_t> length{ 4, 12 };
+	for (std::size_t i = 0; i < KEYS; ++i)
+	{
+		std::string key = std::to_string(i);
+		for (std::size_t n = length(random); key.size() < n;)
+			key += static_cast<char>(letter(random));
+		strings.push_back(key);
+		missingStrings.push_back(key + '_');
+	}
+	std::cout << "\n" << KEYS << " short string keys" << std::endl;
+	benchmark_map<std::unordered_map<std::string, std::size_t>>("std::unordered_map", strings, missingStrings, PASSES);
+	benchmark_map<neolib::flat_hash_map<std::string, std::size_t>>("neolib::flat_hash_map", strings, missingStrings, PASSES);
+}
+
+void test_flat_hash_map()
+{
+	using neolib::test::check;
+	typedef neolib::flat_hash_map<int, std::string, fallible_hash> map_type;
+	bool threw = false;
+	for (int budget = 1; budget < 300; budget += 7)
+	{
+		map_type map;
+		int inserted = 0;
+		for (int key = 0; key < 200; ++key)
+		{
+			fallible_hash::calls_left() = budget;
+			try
+			{
+				map.emplace(key, std::to_string(key) + " is long enough not to fit in the small string buffer");
+				++inserted;
+			}
+			catch (const std::runtime_error&)
+			{
+				threw = true;
+			}
+			fallible_hash::calls_left() = -1;
+			bool intact = map.size() == static_cast<std::size_t>(inserted);
+			for (auto const& entry : map)
+				intact = intact && entry.second == std::to_string(entry.first) + " is long enough not to fit in the small string buffer" &&
+					map.find(entry.first) != map.end();
+			check(intact, "a hasher throwing during a rehash leaves the map as it was");
+		}
+	}
+	check(threw, "the hasher threw during a rehash");
+}
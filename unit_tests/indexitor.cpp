@@ -0,0 +1,190 @@
+#include <neolib/neolib.hpp>
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <neolib/indexitor.hpp>
+#include "test.hpp"
+
+namespace
+{
+	template <typename Function>
+	long long time_taken(Function aFunction)
+	{
+		std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+		aFunction();
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+		return std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count();
+	}
+
+	typedef neolib::indexitor<char, std::size_t> skipped_text;
+
+	// the expected find_by_foreign_index result for each foreign index, worked out element by element
+	std::vector<std::pair<std::size_t, std::size_t>> expected_finds(const skipped_text& aText, std::size_t aForeignIndices)
+	{
+		std::vector<std::pair<std::size_t, std::size_t>> result(aForeignIndices, std::make_pair(aText.size(), aText.foreign_index(aText.end())));
+		std::size_t start = 0;
+		for (std::size_t i = 0; i < aText.size(); ++i)
+		{
+			auto const& skip = std::make_pair(aText.skip_before(aText.begin() + i), aText.skip_after(aText.begin() + i));
+			for (std::size_t foreignIndex = start + skip.first; foreignIndex < start + skip.first + aText[i].second && foreignIndex < aForeignIndices; ++foreignIndex)
+				result[foreignIndex] = std::make_pair(i, start + skip.first);
+			start += skip.first + aText[i].second + skip.second;
+		}
+		return result;
+	}
+
+	// checks every lookup both with the red-black tree descent (each lookup follows a change) and with the block layout
+	void check_lookups(skipped_text& aText, std::mt19937& aRandom)
+	{
+		using neolib::test::check;
+		const skipped_text& constText = aText;
+		const std::size_t total = constText.foreign_index(constText.end());
+		const std::size_t queries = total + 3;
+		auto const& expected = expected_finds(aText, queries);
+		std::vector<std::size_t> expectedForeignIndices;
+		for (std::size_t position = 0, start = 0; position <= aText.size(); ++position)
+		{
+			expectedForeignIndices.push_back(start + constText.skip_before(constText.begin() + position));
+			if (position < aText.size())
+				start += constText.skip_before(constText.begin() + position) + aText[position].second + constText.skip_after(constText.begin() + position);
+		}
+		auto const touch = [&]()
+		{
+			auto const position = std::uniform_int_distribution<std::size_t>{ 0, aText.size() - 1 }(aRandom);
+			aText.update_foreign_index(constText.begin() + position, aText[position].second, 
+				skipped_text::skip_type{ constText.skip_before(constText.begin() + position), constText.skip_after(constText.begin() + position) });
+		};
+		std::vector<std::size_t> foreignIndices(queries);
+		for (std::size_t foreignIndex = 0; foreignIndex < queries; ++foreignIndex)
+			foreignIndices[foreignIndex] = foreignIndex;
+		std::vector<std::size_t> positions(aText.size() + 2);
+		for (std::size_t position = 0; position < positions.size(); ++position)
+			positions[position] = position;
+		for (int pass = 0; pass < 2; ++pass)
+		{
+			const bool tree = (pass == 0);
+			for (std::size_t foreignIndex = 0; foreignIndex < queries; ++foreignIndex)
+			{
+				if (tree)
+					touch();
+				auto const& found = constText.find_by_foreign_index(foreignIndex);
+				check(static_cast<std::size_t>(found.first - constText.begin()) == expected[foreignIndex].first &&
+					found.second == expected[foreignIndex].second, "find_by_foreign_index finds the element spanning the foreign index");
+				auto const& foundMutable = aText.find_by_foreign_index(foreignIndex);
+				check(static_cast<std::size_t>(foundMutable.first - aText.begin()) == expected[foreignIndex].first, "mutable find_by_foreign_index agrees");
+			}
+			for (std::size_t position = 0; position <= aText.size(); ++position)
+			{
+				if (tree)
+					touch();
+				check(constText.foreign_index(constText.begin() + position) == expectedForeignIndices[position], "foreign_index is the start of the element after its skip");
+			}
+			for (std::size_t first = 0; first < queries; first += 4)
+			{
+				if (tree)
+					touch();
+				auto const last = std::min(first + 4, queries);
+				auto const& found = constText.find_by_foreign_index(neolib::span<const std::size_t>{ foreignIndices.data() + first, last - first });
+				for (std::size_t foreignIndex = first; foreignIndex < last; ++foreignIndex)
+					check(static_cast<std::size_t>(found[foreignIndex - first].first - constText.begin()) == expected[foreignIndex].first &&
+						found[foreignIndex - first].second == expected[foreignIndex].second, "batched find_by_foreign_index agrees");
+			}
+			auto const& found = constText.find_by_foreign_index(neolib::span<const std::size_t>{ foreignIndices.data(), foreignIndices.size() });
+			for (std::size_t foreignIndex = 0; foreignIndex < queries; ++foreignIndex)
+				check(static_cast<std::size_t>(found[foreignIndex].first - constText.begin()) == expected[foreignIndex].first &&
+					found[foreignIndex].second == expected[foreignIndex].second, "batched find_by_foreign_index agrees");
+			if (tree)
+				touch();
+			auto const& foreignIndicesOfPositions = constText.foreign_index(neolib::span<const std::size_t>{ positions.data(), positions.size() });
+			for (std::size_t position = 0; position < positions.size(); ++position)
+				check(foreignIndicesOfPositions[position] == expectedForeignIndices[std::min(position, aText.size())], "batched foreign_index agrees");
+		}
+	}
+}
+
+void test_indexitor()
+{
+	std::mt19937 random;
+	skipped_text text;
+	auto const element = [&]()
+	{
+		// zero width elements share their start with the next element
+		return skipped_text::value_type{ 'a', std::uniform_int_distribution<std::size_t>{ 0, 4 }(random) };
+	};
+	auto const skip = [&]()
+	{
+		return skipped_text::skip_type{ std::uniform_int_distribution<std::size_t>{ 0, 1 }(random), std::uniform_int_distribution<std::size_t>{ 0, 1 }(random) };
+	};
+	for (std::size_t i = 0; i < 300; ++i)
+		text.push_back(element(), skip());
+	check_lookups(text, random);
+	for (std::size_t i = 0; i < 50; ++i)
+		text.erase(text.begin() + std::uniform_int_distribution<std::size_t>{ 0, text.size() - 1 }(random));
+	for (std::size_t i = 0; i < 50; ++i)
+		text.insert(text.begin() + std::uniform_int_distribution<std::size_t>{ 0, text.size() }(random), element(), skip());
+	check_lookups(text, random);
+	std::vector<skipped_text::foreign_index_update> updates;
+	for (std::size_t i = 0; i < text.size(); i += 3)
+		updates.emplace_back(text.begin() + i, element().second, skip());
+	text.update_foreign_indices(neolib::span<const skipped_text::foreign_index_update>{ updates.data(), updates.size() });
+	check_lookups(text, random);
+	skipped_text other;
+	other.push_back(element(), skip());
+	other.swap(text);
+	check_lookups(other, random);
+	check_lookups(text, random);
+}
+
+void benchmark_indexitor()
+{
+	const std::size_t GLYPHS = 1000000;
+	const std::size_t QUERIES = 1000000;
+	typedef neolib::indexitor<char32_t, std::size_t> glyph_text;
+	std::mt19937 random;
+	glyph_text text;
+	for (std::size_t i = 0; i < GLYPHS; ++i)
+		text.push_back(glyph_text::value_type{ U'a', std::uniform_int_distribution<std::size_t>{ 1, 4 }(random) });
+	const glyph_text& constText = text;
+	const std::size_t bytes = constText.foreign_index(constText.end());
+	std::vector<std::size_t> offsets(QUERIES);
+	for (std::size_t i = 0; i < QUERIES; ++i)
+		offsets[i] = bytes * i / QUERIES;
+	std::vector<std::size_t> positions(QUERIES);
+	for (std::size_t i = 0; i < QUERIES; ++i)
+		positions[i] = GLYPHS * i / QUERIES;
+	std::size_t checksum = 0;
+	std::cout << "\n" << GLYPHS << " glyphs, " << QUERIES << " sorted queries" << std::endl;
+	std::cout << "find_by_foreign_index: " << time_taken([&]()
+	{
+		for (auto offset : offsets)
+			checksum += constText.find_by_foreign_index(offset).second;
+	}) << "ms" << std::endl;
+	std::cout << "batched find_by_foreign_index: " << time_taken([&]()
+	{
+		for (const auto& result : constText.find_by_foreign_index(neolib::span<const std::size_t>{ offsets.data(), offsets.size() }))
+			checksum -= result.second;
+	}) << "ms" << std::endl;
+	std::cout << "foreign_index: " << time_taken([&]()
+	{
+		for (auto position : positions)
+			checksum += constText.foreign_index(constText.begin() + position);
+	}) << "ms" << std::endl;
+	std::cout << "batched foreign_index: " << time_taken([&]()
+	{
+		for (auto foreignIndex : constText.foreign_index(neolib::span<const std::size_t>{ positions.data(), positions.size() }))
+			checksum -= foreignIndex;
+	}) << "ms" << std::endl;
+	std::vector<glyph_text::foreign_index_update> updates;
+	for (std::size_t i = 0; i < GLYPHS; i += 2)
+		updates.emplace_back(constText.begin() + i, 2);
+	std::cout << "update_foreign_index: " << time_taken([&]()
+	{
+		for (const auto& update : updates)
+			text.update_foreign_index(update.position, update.foreignIndex);
+	}) << "ms" << std::endl;
+	std::cout << "update_foreign_indices: " << time_taken([&]()
+	{
+		text.update_foreign_indices(neolib::span<const glyph_text::foreign_index_update>{ updates.data(), updates.size() });
+	}) << "ms (checksum " << checksum << ")" << std::endl;
+}
@@ -0,0 +1,649 @@
+#include <neolib/neolib.hpp>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <fstream>
+#include <cstdio>
+#include <random>
+#include <neolib/json.hpp>
+#include <neolib/json_reader.hpp>
+#include "test.hpp"
+
+namespace
+{
+	template <typename Function>
+	long long time_taken(Function aFunction)
+	{
+		std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+		aFunction();
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+		return std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count();
+	}
+
+	// the valid documents from the NoFussJSON unit tests
+	const char* const sCorpus[] =
+	{
+		"\"foo\"", "\"tab\\ttab\"", "\"LF\\nLF\"", "\"a\\tb\\nc\\td\"", "\"Q: \\u0051\"", "\"Omega: \\u03A9\"", "\"1 g clef 2 g clef 3: 1\\uD834\\uDD1E2\\uD834\\uDD1E3\"",
+		"0", "1", "4294967295", "281474976710656", "-1", "-281474976710656", "18446744073709551615", "0.1", "123456789012345678901234567890",
+		"42", "-42", "42e2", "-42e2", "42e-2", "-42e-2", "42.42", "-42.42", "42.42e2", "-42.42e2", "42.42e-2", "-42.42e-2",
+		"true", "false", "null", "[]", "[[],[],[]]", "[1 ]", "[ 1]", "[ 1 ]", "[1,2,3]", "[1,2,3,\"foo\", 42 , \"bar\", true, false, null]", "[1,2,3,[\"a\",\"b\",\"c\"],4,5,6]",
+		"{}", "{ \"test\": 42 }", "{ \"test\": 42, \"foo\": \"bar\" }", "{ \"test\": 42, \"obj\": { \"foo\": \"bar\" } }"
+	};
+
+	template <typename Json>
+	void benchmark_parse(const char* aName, const std::string& aDocument, neolib::json_parse_mode aParseMode, std::string& aOutput)
+	{
+		Json json;
+		json.set_parse_mode(aParseMode);
+		std::istringstream input{ aDocument };
+		bool ok = false;
+		long long parse = time_taken([&]() { ok = json.read(input); });
+		std::ostringstream output;
+		if (ok)
+			json.write(output);
+		aOutput = output.str();
+		// no node destructors run for a tree that only views the document; what remains is freeing the arena blocks
+		long long release = time_taken([&]() { json.clear(); });
+		std::cout << aName << ": " << (parse != 0 ? static_cast<long long>(aDocument.size() / parse) : 0ll) << "MB/s" << (ok ? "" : " (parse failed)") << ", clear: " << release << "us" << std::endl;
+	}
+
+
+	// parses aDocument in aParseMode and writes it back out; empty if the parse fails
+	std::string reparse(const std::string& aDocument, neolib::json_parse_mode aParseMode, bool& aOk)
+	{
+		neolib::fast_json json;
+		json.set_parse_mode(aParseMode);
+		std::istringstream input{ aDocument };
+		aOk = json.read(input);
+		std::ostringstream output;
+		if (aOk)
+			json.write(output);
+		return output.str();
+	}
+
+	// a random JSON string literal, heavy on escapes (including at either end and as surrogate pairs)
+	std::string random_string(std::mt19937& aRandom)
+	{
+		static const char* const sPieces[] = { "a", "key", " ", "\\\"", "\\\\", "\\/", "\\b", "\\f", "\\n", "\\r", "\\t", "\\u0041", "\\u00e9", "\\u03A9", "\\uD834\\uDD1E", "\xC3\xA9" };
+		std::string result = "\"";
+		for (auto pieces = std::uniform_int_distribution<int>{ 0, 4 }(aRandom); pieces-- > 0;)
+			result += sPieces[std::uniform_int_distribution<std::size_t>{ 0, std::size(sPieces) - 1 }(aRandom)];
+		return result + "\"";
+	}
+
+	std::string random_value(std::mt19937& aRandom, int aDepth)
+	{
+		static const char* const sScalars[] = { "0", "-1", "42", "4294967295", "18446744073709551615", "-42.42e-2", "0.5", "true", "false", "null" };
+		static const char* const sSpace[] = { "", " ", "\n", "\t ", "\r\n" };
+		auto pick = [&](std::size_t aCount) { return std::uniform_int_distribution<std::size_t>{ 0, aCount - 1 }(aRandom); };
+		auto space = [&]() { return std::string{ sSpace[pick(std::size(sSpace))] }; };
+		switch (aDepth > 0 ? pick(4) : pick(2))
+		{
+		case 0:
+			return sScalars[pick(std::size(sScalars))];
+		case 1:
+			return random_string(aRandom);
+		case 2:
+			{
+				std::string result = "[" + space();
+				for (auto elements = pick(5); elements-- > 0;)
+					result += random_value(aRandom, aDepth - 1) + space() + (elements != 0 ? "," + space() : "");
+				return result + "]";
+			}
+		default:
+			{
+				std::string result = "{" + space();
+				for (auto members = pick(5); members-- > 0;)
+					result += random_string(aRandom) + space() + ":" + space() + random_value(aRandom, aDepth - 1) + space() + (members != 0 ? "," + space() : "");
+				return result + "}";
+			}
+		}
+	}
+
+	// a flat rendering of a parsed document shared by the tree and the event stream: names, brackets and typed scalars
+	template <typename String>
+	std::string text_token(char aType, const String& aText)
+	{
+		return aType + std::to_string(aText.size()) + ":" + std::string{ aText.begin(), aText.end() };
+	}
+
+	template <typename Double, typename Int64, typename Uint64, typename Int, typename Uint>
+	std::string number_token(neolib::json_type aType, Double aDouble, Int64 aInt64, Uint64 aUint64, Int aInt, Uint aUint)
+	{
+		std::ostringstream result;
+		result.precision(17);
+		result << 'n' << static_cast<int>(aType) << ':';
+		switch (aType)
+		{
+		case neolib::json_type::Double:
+			result << aDouble;
+			break;
+		case neolib::json_type::Int64:
+			result << aInt64;
+			break;
+		case neolib::json_type::Uint64:
+			result << aUint64;
+			break;
+		case neolib::json_type::Int:
+			result << aInt;
+			break;
+		default:
+			result << aUint;
+			break;
+		}
+		return result.str();
+	}
+
+	void render_tree(const neolib::fast_json_value& aValue, std::string& aOutput)
+	{
+		typedef neolib::fast_json_value value_type;
+		if (aValue.has_name())
+			aOutput += text_token(aValue.name_is_keyword() ? 'K' : 'N', aValue.name().as_view());
+		switch (aValue.type())
+		{
+		case neolib::json_type::Object:
+		case neolib::json_type::Array:
+			aOutput += (aValue.type() == neolib::json_type::Object ? "{" : "[");
+			if (aValue.has_children())
+				for (auto child = aValue.first_child(); child != nullptr; child = child->is_last_sibling() ? nullptr : child->next_sibling())
+					render_tree(*child, aOutput);
+			aOutput += (aValue.type() == neolib::json_type::Object ? "}" : "]");
+			break;
+		case neolib::json_type::String:
+			aOutput += text_token('s', aValue.as<value_type::json_string>().as_view());
+			break;
+		case neolib::json_type::Keyword:
+			aOutput += text_token('k', aValue.as<value_type::json_keyword>().text.as_view());
+			break;
+		case neolib::json_type::Bool:
+			aOutput += aValue.as<value_type::json_bool>() ? "T" : "F";
+			break;
+		case neolib::json_type::Null:
+			aOutput += "Z";
+			break;
+		default:
+			aOutput += number_token(aValue.type(),
+				aValue.type() == neolib::json_type::Double ? aValue.as<value_type::json_double>() : 0.0,
+				aValue.type() == neolib::json_type::Int64 ? aValue.as<value_type::json_int64>() : 0,
+				aValue.type() == neolib::json_type::Uint64 ? aValue.as<value_type::json_uint64>() : 0u,
+				aValue.type() == neolib::json_type::Int ? aValue.as<value_type::json_int>() : 0,
+				aValue.type() == neolib::json_type::Uint ? aValue.as<value_type::json_uint>() : 0u);
+			break;
+		}
+	}
+
+	// feeds aDocument to a json_reader in random sized chunks and renders the events; empty on an error event
+	std::string render_events(const std::string& aDocument, neolib::json_stream_format aFormat, std::mt19937& aRandom)
+	{
+		typedef neolib::json_reader reader_type;
+		reader_type reader{ aFormat };
+		std::string result;
+		std::size_t fed = 0;
+		for (auto event = reader.next_event(); event != neolib::json_event::EndOfInput; event = reader.next_event())
+		{
+			if (event != neolib::json_event::EndRecord && event != neolib::json_event::NeedInput && reader.has_name())
+				result += text_token(reader.name_is_keyword() ? 'K' : 'N', reader.name());
+			switch (event)
+			{
+			case neolib::json_event::NeedInput:
+				if (fed < aDocument.size())
+				{
+					std::size_t const chunk = std::min(aDocument.size() - fed, std::uniform_int_distribution<std::size_t>{ 1, 17 }(aRandom));
+					reader.feed(aDocument.data() + fed, chunk);
+					fed += chunk;
+				}
+				else
+					reader.end_input();
+				break;
+			case neolib::json_event::Error:
+				return std::string{};
+			case neolib::json_event::StartObject:
+				result += "{";
+				break;
+			case neolib::json_event::EndObject:
+				result += "}";
+				break;
+			case neolib::json_event::StartArray:
+				result += "[";
+				break;
+			case neolib::json_event::EndArray:
+				result += "]";
+				break;
+			case neolib::json_event::EndRecord:
+				result += "|";
+				break;
+			case neolib::json_event::Value:
+				{
+					auto const& value = reader.value();
+					switch (reader.type())
+					{
+					case neolib::json_type::String:
+						result += text_token('s', std::get<reader_type::json_string>(value));
+						break;
+					case neolib::json_type::Keyword:
+						result += text_token('k', std::get<reader_type::json_keyword>(value).text);
+						break;
+					case neolib::json_type::Bool:
+						result += std::get<reader_type::json_bool>(value) ? "T" : "F";
+						break;
+					case neolib::json_type::Null:
+						result += "Z";
+						break;
+					default:
+						result += number_token(reader.type(),
+							reader.type() == neolib::json_type::Double ? std::get<reader_type::json_double>(value) : 0.0,
+							reader.type() == neolib::json_type::Int64 ? std::get<reader_type::json_int64>(value) : 0,
+							reader.type() == neolib::json_type::Uint64 ? std::get<reader_type::json_uint64>(value) : 0u,
+							reader.type() == neolib::json_type::Int ? std::get<reader_type::json_int>(value) : 0,
+							reader.type() == neolib::json_type::Uint ? std::get<reader_type::json_uint>(value) : 0u);
+						break;
+					}
+				}
+				break;
+			default:
+				break;
+			}
+		}
+		return result;
+	}
+
+	std::size_t sLiveBytes;
+
+	// counts the bytes a document's arena holds
+	template <typename T>
+	struct counting_allocator
+	{
+		typedef T value_type;
+		template <typename U>
+		struct rebind
+		{
+			typedef counting_allocator<U> other;
+		};
+		counting_allocator() = default;
+		template <typename U>
+		counting_allocator(const counting_allocator<U>&) {}
+		T* allocate(std::size_t aCount)
+		{
+			sLiveBytes += aCount * sizeof(T);
+			return std::allocator<T>{}.allocate(aCount);
+		}
+		void deallocate(T* aObject, std::size_t aCount)
+		{
+			sLiveBytes -= aCount * sizeof(T);
+			std::allocator<T>{}.deallocate(aObject, aCount);
+		}
+		template <typename U>
+		bool operator==(const counting_allocator<U>&) const { return true; }
+		template <typename U>
+		bool operator!=(const counting_allocator<U>&) const { return false; }
+	};
+
+	std::string corpus_document(std::size_t aBytes)
+	{
+		std::string corpus = "[";
+		for (std::size_t record = 0; corpus.size() < aBytes; ++record)
+		{
+			corpus += (record != 0 ? ",\n" : "\n");
+			corpus += "{ \"record\": " + std::to_string(record) + ", \"source\": \"telemetry\", \"tests\": [";
+			bool first = true;
+			for (auto test : sCorpus)
+			{
+				corpus += (first ? "" : ", ");
+				corpus += test;
+				first = false;
+			}
+			corpus += "] }";
+		}
+		corpus += "\n]\n";
+		return corpus;
+	}
+}
+
+void benchmark_json()
+{
+	const std::size_t BYTES = 64 * 1024 * 1024;
+	std::string const corpus = corpus_document(BYTES);
+	std::cout << "\n" << corpus.size() / (1024 * 1024) << "MB document built from the NoFussJSON test corpus" << std::endl;
+	std::vector<uint32_t> index;
+	std::size_t errorOffset = 0;
+	long long stageOne = 0;
+	for (int pass = 0; pass < 4; ++pass)
+	{
+		// the first pass also pays for growing the index
+		long long const passTime = time_taken([&]() { neolib::json_detail::structural::build_index(corpus.data(), corpus.size(), index, errorOffset); });
+		if (pass == 0 || passTime < stageOne)
+			stageOne = passTime;
+	}
+	std::cout << "structural index: " << (stageOne != 0 ? static_cast<long long>(corpus.size() / stageOne) : 0ll) << "MB/s (" << index.size() << " entries)" << std::endl;
+	std::string scalarOutput;
+	std::string indexedOutput;
+	benchmark_parse<neolib::fast_json>("fast_json (scalar)", corpus, neolib::json_parse_mode::Scalar, scalarOutput);
+	benchmark_parse<neolib::fast_json>("fast_json (structural index)", corpus, neolib::json_parse_mode::StructuralIndex, indexedOutput);
+	std::cout << "trees " << (scalarOutput == indexedOutput ? "identical" : "DIFFER") << std::endl;
+}
+
+void benchmark_json_reader()
+{
+	const std::size_t BYTES = 64 * 1024 * 1024;
+	const char* const path = "benchmark_json_reader.jsonl";
+	std::size_t bytes = 0;
+	{
+		std::ofstream output{ path, std::ios::binary };
+		for (std::size_t record = 0; bytes < BYTES; ++record)
+		{
+			std::string line = "{ \"record\": " + std::to_string(record) + ", \"source\": \"telemetry\", \"tests\": [";
+			bool first = true;
+			for (auto test : sCorpus)
+			{
+				line += (first ? "" : ", ");
+				line += test;
+				first = false;
+			}
+			line += "] }\n";
+			output << line;
+			bytes += line.size();
+		}
+	}
+	std::cout << "\n" << bytes / (1024 * 1024) << "MB JSON Lines file built from the NoFussJSON test corpus" << std::endl;
+	uint64_t readerRecords = 0;
+	uint64_t readerSum = 0;
+	bool readerOk = true;
+	long long const reader = time_taken([&]()
+	{
+		std::ifstream input{ path, std::ios::binary };
+		neolib::json_reader records{ input, neolib::json_stream_format::Lines };
+		for (auto event = records.next_event(); event != neolib::json_event::EndOfInput; event = records.next_event())
+		{
+			if (event == neolib::json_event::Error)
+			{
+				readerOk = false;
+				break;
+			}
+			if (event == neolib::json_event::StartArray && records.name() == "tests")
+				records.skip();
+			else if (event == neolib::json_event::Value && records.depth() == 1 && records.name() == "record")
+				readerSum += std::get<neolib::json_reader::json_int>(records.value());
+		}
+		readerRecords = records.records();
+	});
+	std::cout << "json_reader (filter without a tree): " << (reader != 0 ? static_cast<long long>(bytes / reader) : 0ll) << "MB/s" << (readerOk ? "" : " (parse failed)") << std::endl;
+	uint64_t domRecords = 0;
+	uint64_t domSum = 0;
+	long long const dom = time_taken([&]()
+	{
+		std::ifstream input{ path, std::ios::binary };
+		std::string line;
+		while (std::getline(input, line))
+		{
+			std::istringstream record{ line };
+			neolib::fast_json json{ record };
+			domSum += json.root().as<neolib::fast_json_object>()["record"].as<neolib::fast_json_int>();
+			++domRecords;
+		}
+	});
+	std::cout << "fast_json per line: " << (dom != 0 ? static_cast<long long>(bytes / dom) : 0ll) << "MB/s" << std::endl;
+	std::cout << "results " << (readerRecords == domRecords && readerSum == domSum ? "identical" : "DIFFER") << " (" << readerRecords << " records)" << std::endl;
+	std::remove(path);
+}
+
+void benchmark_json_map()
+{
+	const std::size_t BYTES = 64 * 1024 * 1024;
+	const char* const path = "benchmark_json_map.json";
+	std::size_t bytes = 0;
+	{
+		std::string const corpus = corpus_document(BYTES);
+		std::ofstream{ path, std::ios::binary } << corpus;
+		bytes = corpus.size();
+	}
+	std::cout << "\n" << bytes / (1024 * 1024) << "MB file built from the NoFussJSON test corpus" << std::endl;
+	std::string readOutput;
+	std::string mapOutput;
+	{
+		neolib::fast_json json;
+		bool ok = false;
+		long long const load = time_taken([&]() { ok = json.read(path); });
+		std::cout << "fast_json::read: " << (load != 0 ? static_cast<long long>(bytes / load) : 0ll) << "MB/s" << (ok ? "" : " (parse failed)") << std::endl;
+		std::ostringstream output;
+		if (ok)
+			json.write(output);
+		readOutput = output.str();
+	}
+	{
+		neolib::fast_json json;
+		bool ok = false;
+		long long const load = time_taken([&]() { ok = json.map(path); });
+		std::cout << "fast_json::map: " << (load != 0 ? static_cast<long long>(bytes / load) : 0ll) << "MB/s" << (ok ? "" : " (parse failed)") << std::endl;
+		std::ostringstream output;
+		if (ok)
+			json.write(output);
+		mapOutput = output.str();
+	}
+	std::cout << "trees " << (readOutput == mapOutput ? "identical" : "DIFFER") << std::endl;
+	std::remove(path);
+}
+
+void benchmark_json_index()
+{
+	const std::size_t MEMBERS = 100000;
+	const std::size_t ELEMENTS = 1000000;
+	const std::size_t STRIDE = 100000;
+	std::string document = "{ \"members\": {";
+	for (std::size_t member = 0; member < MEMBERS; ++member)
+		document += (member != 0 ? ", \"key" : " \"key") + std::to_string(member) + "\": " + std::to_string(member);
+	document += " }, \"elements\": [";
+	for (std::size_t element = 0; element < ELEMENTS; ++element)
+		document += (element != 0 ? ", " : " ") + std::to_string(element);
+	document += " ] }\n";
+	std::vector<std::string> keys;
+	for (std::size_t member = 0; member < MEMBERS; ++member)
+		keys.push_back("key" + std::to_string(member));
+	std::cout << "\n" << MEMBERS << " member object, " << ELEMENTS << " element array" << std::endl;
+	for (auto objectIndex : { neolib::json_object_index::Lazy, neolib::json_object_index::Eager })
+	{
+		neolib::fast_json json;
+		json.set_object_index(objectIndex);
+		std::istringstream input{ document };
+		bool ok = false;
+		long long const parse = time_taken([&]() { ok = json.read(input); });
+		if (!ok)
+		{
+			std::cout << "parse failed" << std::endl;
+			return;
+		}
+		auto& root = json.root().as<neolib::fast_json_object>();
+		auto& members = root["members"].as<neolib::fast_json_object>();
+		long long sum = 0;
+		long long const first = time_taken([&]() { sum += members.find(keys[MEMBERS / 2])->as<neolib::fast_json_int>(); });
+		long long const lookups = time_taken([&]()
+		{
+			for (auto const& key : keys)
+				sum += members.find(key)->as<neolib::fast_json_int>();
+		});
+		std::cout << (objectIndex == neolib::json_object_index::Lazy ? "lazy" : "eager") << " object index: parse " << parse / 1000 << "ms, first lookup " << first << "us, " <<
+			lookups * 1000 / static_cast<long long>(MEMBERS) << "ns per lookup (checksum " << sum << ")" << std::endl;
+	}
+	neolib::fast_json json;
+	std::istringstream input{ document };
+	json.read(input);
+	auto& elementsValue = json.root().as<neolib::fast_json_object>()["elements"];
+	auto& elements = elementsValue.as<neolib::fast_json_array>();
+	long long sum = 0;
+	long long const indexed = time_taken([&]()
+	{
+		for (std::size_t element = 0; element < elements.size(); element += STRIDE)
+			sum += elements[element].as<neolib::fast_json_int>();
+	});
+	long long const walked = time_taken([&]()
+	{
+		for (std::size_t element = 0; element < ELEMENTS; element += STRIDE)
+		{
+			auto value = elementsValue.first_child();
+			for (std::size_t sibling = 0; sibling < element; ++sibling)
+				value = value->next_sibling();
+			sum += value->as<neolib::fast_json_int>();
+		}
+	});
+	std::cout << "array element access (every " << STRIDE << "th): indexed " << indexed << "us, sibling walk " << walked << "us (checksum " << sum << ")" << std::endl;
+}
+
+void test_json_parse_modes()
+{
+	using neolib::test::check;
+	using neolib::json_parse_mode;
+	// escapes in names and at the very start of strings
+	{
+		neolib::fast_json json;
+		json.set_parse_mode(json_parse_mode::Scalar);
+		std::istringstream input{ "{ \"\\\"\": \"\\u00e9v\", \"k\\u0041\\n\": \"\\uD834\\uDD1Ex\" }" };
+		check(json.read(input), "the scalar parser accepts escapes in names");
+		auto const& root = json.root().as<neolib::fast_json_object>();
+		check(root.find("\"") != nullptr && root.find("\"")->as<neolib::fast_json_string>() == "\xC3\xA9v", "an escaped quote in a name and a leading \\u escape");
+		check(root.find("kA\n") != nullptr && root.find("kA\n")->as<neolib::fast_json_string>() == "\xF0\x9D\x84\x9Ex", "escapes in a name and a leading surrogate pair");
+	}
+	// both parse modes must build the same tree, or both fail
+	std::vector<std::string> documents{ std::begin(sCorpus), std::end(sCorpus) };
+	std::mt19937 random;
+	for (int i = 0; i < 2000; ++i)
+		documents.push_back(random_value(random, 4));
+	for (auto const& document : documents)
+	{
+		bool scalarOk = false;
+		bool indexedOk = false;
+		std::string const scalar = reparse(document, json_parse_mode::Scalar, scalarOk);
+		std::string const indexed = reparse(document, json_parse_mode::StructuralIndex, indexedOk);
+		check(scalarOk && indexedOk && scalar == indexed, "scalar and structural index parses of a valid document are identical");
+	}
+	for (const char* invalid : { "[1}", "{\"a\":1]", "[}", "{]", "[[1]}", "{\"a\":[1}}", "[1,]", "{\"a\"}", "\"\\x\"", "[\"\\u12\"]", "]", "[1]]" })
+	{
+		bool scalarOk = true;
+		bool indexedOk = true;
+		reparse(invalid, json_parse_mode::Scalar, scalarOk);
+		reparse(invalid, json_parse_mode::StructuralIndex, indexedOk);
+		check(!scalarOk && !indexedOk, "both parse modes reject an invalid document");
+	}
+}
+
+void test_json_reader()
+{
+	using neolib::test::check;
+	std::vector<std::string> documents{ std::begin(sCorpus), std::end(sCorpus) };
+	std::mt19937 random{ 42 };
+	for (int i = 0; i < 1000; ++i)
+		documents.push_back(random_value(random, 4));
+	std::string lines;
+	std::string linesExpected;
+	for (auto const& document : documents)
+	{
+		neolib::fast_json json;
+		std::istringstream input{ document };
+		bool const ok = json.read(input);
+		std::string expected;
+		if (ok)
+			render_tree(json.root(), expected);
+		expected += "|";
+		check(ok && render_events(document, neolib::json_stream_format::Document, random) == expected, "chunked json_reader events match the tree");
+		if (document.find('\n') == std::string::npos)
+		{
+			lines += document + "\n";
+			linesExpected += expected;
+		}
+	}
+	check(render_events(lines, neolib::json_stream_format::Lines, random) == linesExpected, "chunked JSON Lines events match the trees");
+	for (const char* invalid : { "[1}", "{\"a\":1]", "[}", "{]", "[[1]}", "tru:", "1:", "\"a\":1", "[1:]", "{\"a\":1:}", "1,", "[1,]", "{tru,1}", "{tru}", "{tru 1}", "]", "[1]]" })
+		check(render_events(invalid, neolib::json_stream_format::Document, random).empty(), "json_reader reports an error for an invalid document");
+	check(render_events("{tru :1}", neolib::json_stream_format::Document, random) == "{K3:tru" + number_token(neolib::json_type::Int, 0.0, 0, 0u, 1, 0u) + "}|",
+		"a keyword may name an object member");
+}
+
+void test_json_index_memory()
+{
+	using neolib::test::check;
+	typedef neolib::basic_json<neolib::json_syntax::Standard, counting_allocator<neolib::json_type>> json_type;
+	typedef json_type::json_value::json_string json_string;
+	std::string document = "{";
+	for (int i = 0; i < 100; ++i)
+		document += (i != 0 ? ",\"k" : "\"k") + std::to_string(i) + "\":" + std::to_string(i);
+	document += "}";
+	json_type json;
+	std::istringstream input{ document };
+	check(json.read(input), "document parsed");
+	auto& object = json.root().as<json_type::json_object>();
+	auto& first = *json.root().first_child();
+	std::size_t bytesAfterFirstRebuild = 0;
+	// every rename drops or rekeys the dictionary; rebuilding it must not grow the arena
+	for (int cycle = 0; cycle < 2000; ++cycle)
+	{
+		check(object.find("k50") != nullptr && object.find("k50")->as<json_type::json_value::json_int>() == 50, "lookup finds the member");
+		check((object.find("k0") == &first) == (cycle % 2 == 0) && (object.find("j0") == &first) == (cycle % 2 == 1), "lookup follows a rename");
+		first.set_name(json_string{ cycle % 2 == 0 ? "j0" : "k0" });
+		if (cycle == 1)
+			bytesAfterFirstRebuild = sLiveBytes;
+	}
+	check(sLiveBytes == bytesAfterFirstRebuild, "rebuilding an object's dictionary reuses the arena memory of the one it replaced");
+	json.clear();
+	check(sLiveBytes == 0, "clearing a document frees its arena");
+}
+
+void test_json_object_edits()
+{
+	using neolib::test::check;
+	typedef neolib::fast_json_value::json_object json_object;
+	typedef neolib::fast_json_value::json_string json_string;
+	neolib::fast_json json;
+	std::istringstream input{ "{\"a\":0,\"b\":1,\"c\":2}" };
+	check(json.read(input), "document parsed");
+	auto& root = json.root();
+	auto& object = root.as<json_object>();
+	std::vector<std::string> names{ "a", "b", "c" };
+	std::vector<std::string> gone;
+	auto forget = [&](const std::string& aName)
+	{
+		gone.push_back(aName);
+		names.pop_back();
+	};
+	std::mt19937 random{ 7 };
+	// the dictionary is kept up to date by each edit rather than rebuilt; it must always agree with the members
+	for (int i = 0; i < 5000; ++i)
+	{
+		switch (std::uniform_int_distribution<int>{ 0, 2 }(random))
+		{
+		case 0:
+			{
+				std::string const name = "m" + std::to_string(std::uniform_int_distribution<int>{ 0, 40 }(random));
+				object[json_string{ name }];
+				if (std::find(names.begin(), names.end(), name) == names.end())
+					names.push_back(name);
+				gone.erase(std::remove(gone.begin(), gone.end(), name), gone.end());
+			}
+			break;
+		case 1:
+			if (!names.empty())
+			{
+				root.pop_back();
+				forget(names.back());
+			}
+			break;
+		case 2:
+			if (!names.empty())
+			{
+				std::string const name = "r" + std::to_string(i);
+				root.last_child()->set_name(json_string{ name });
+				forget(names.back());
+				names.push_back(name);
+			}
+			break;
+		}
+		auto member = root.has_children() ? root.first_child() : nullptr;
+		for (auto const& name : names)
+		{
+			check(member != nullptr && object.find(name) == member, "the dictionary finds every member after an edit");
+			member = member->is_last_sibling() ? nullptr : member->next_sibling();
+		}
+		check(member == nullptr, "every member is accounted for");
+		for (auto const& name : gone)
+			check(object.find(name) == nullptr, "the dictionary forgets removed and renamed members");
+	}
+}
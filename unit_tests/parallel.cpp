@@ -0,0 +1,194 @@
+#include <neolib/neolib.hpp>
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <random>
+#include <numeric>
+#include <algorithm>
+#include <chrono>
+#include <atomic>
+#include <stdexcept>
+#include <functional>
+#include <neolib/parallel_algorithm.hpp>
+#include "test.hpp"
+
+namespace
+{
+	template <typename Function>
+	long long time_ms(Function aFunction)
+	{
+		std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+		aFunction();
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+		return std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count();
+	}
+
+	void report(const char* aName, long long aSerial, long long aParallel, bool aCheck)
+	{
+		std::cout << "\n" << aName << "\nserial: " << aSerial << "ms\nparallel: " << aParallel << "ms\ncheck: " << (aCheck ? "ok" : "FAILED") << std::endl;
+	}
+
+	// sizes either side of the grain and chunk boundaries, including the empty and single element cases
+	const std::size_t sSizes[] = { 0, 1, 2, 3, 17, 1000, 16383, 16384, 100000 };
+
+	std::vector<int> random_values(std::size_t aCount, std::mt19937& aRandom)
+	{
+		std::vector<int> result(aCount);
+		std::uniform_int_distribution<int> distribution{ -1000, 1000 };
+		for (auto& e : result)
+			e = distribution(aRandom);
+		return result;
+	}
+}
+
+void test_parallel_algorithms()
+{
+	using neolib::test::check;
+	std::mt19937 random{ 42 };
+	auto work = [](int aValue) { return static_cast<long long>(aValue) * aValue - 3; };
+	for (auto size : sSizes)
+	{
+		auto const input = random_values(size, random);
+		std::vector<long long> expected(size);
+		std::transform(input.begin(), input.end(), expected.begin(), work);
+
+		std::vector<long long> forOutput(size);
+		neolib::parallel_for(std::size_t{ 0 }, size, [&](std::size_t i) { forOutput[i] = work(input[i]); });
+		check(forOutput == expected, "parallel_for visits every index once");
+		std::vector<std::atomic<int>> visits(size);
+		neolib::parallel_for(std::size_t{ 0 }, size, [&](std::size_t i) { ++visits[i]; }, 1);
+		check(std::all_of(visits.begin(), visits.end(), [](const std::atomic<int>& aVisits) { return aVisits == 1; }), "parallel_for with a grain of one visits every index once");
+
+		std::vector<long long> forEachOutput(input.begin(), input.end());
+		neolib::parallel_for_each(forEachOutput.begin(), forEachOutput.end(), [](long long& aValue) { aValue = aValue * aValue - 3; });
+		check(forEachOutput == expected, "parallel_for_each matches std::for_each");
+
+		std::vector<long long> transformOutput(size);
+		auto const transformEnd = neolib::parallel_transform(input.begin(), input.end(), transformOutput.begin(), work);
+		check(transformOutput == expected && transformEnd == transformOutput.end(), "parallel_transform matches std::transform");
+
+		check(neolib::parallel_reduce(input.begin(), input.end(), 7ll) == std::accumulate(input.begin(), input.end(), 7ll), "parallel_reduce matches std::accumulate");
+		check(neolib::parallel_transform_reduce(input.begin(), input.end(), 0ll, std::plus<>{}, work) == std::accumulate(expected.begin(), expected.end(), 0ll),
+			"parallel_transform_reduce matches std::transform then std::accumulate");
+
+		auto sorted = input;
+		auto expectedSorted = input;
+		std::sort(expectedSorted.begin(), expectedSorted.end());
+		neolib::parallel_sort(sorted.begin(), sorted.end());
+		check(sorted == expectedSorted, "parallel_sort matches std::sort");
+		sorted = input;
+		std::sort(expectedSorted.begin(), expectedSorted.end(), std::greater<>{});
+		neolib::parallel_sort(sorted.begin(), sorted.end(), std::greater<>{});
+		check(sorted == expectedSorted, "parallel_sort with a comparator matches std::sort");
+	}
+
+	bool called = false;
+	neolib::parallel_for(10, 10, [&](int) { called = true; });
+	neolib::parallel_for(10, 5, [&](int) { called = true; });
+	check(!called, "parallel_for over an empty or reversed range calls nothing");
+
+	// an exception from any chunk is rethrown on the calling thread once the batch has drained
+	for (auto failAt : { std::size_t{ 0 }, std::size_t{ 4999 }, std::size_t{ 9999 } })
+	{
+		std::atomic<std::size_t> visited{ 0 };
+		bool threw = false;
+		try
+		{
+			neolib::parallel_for(std::size_t{ 0 }, std::size_t{ 10000 }, [&](std::size_t i)
+			{
+				++visited;
+				if (i == failAt)
+					throw std::runtime_error("parallel_for");
+			}, 16);
+		}
+		catch (const std::runtime_error&)
+		{
+			threw = true;
+		}
+		check(threw && visited <= 10000, "an exception thrown in a batch propagates to the caller");
+	}
+	bool reduceThrew = false;
+	try
+	{
+		auto const input = random_values(10000, random);
+		neolib::parallel_transform_reduce(input.begin(), input.end(), 0, std::plus<>{}, [](int aValue) -> int
+		{
+			if (aValue == 1000)
+				throw std::out_of_range("parallel_transform_reduce");
+			return aValue;
+		}, 16);
+	}
+	catch (const std::out_of_range&)
+	{
+		reduceThrew = true;
+	}
+	check(reduceThrew, "an exception thrown in a reduction propagates to the caller");
+	std::vector<long long> afterFailure(1000);
+	neolib::parallel_for(std::size_t{ 0 }, afterFailure.size(), [&](std::size_t i) { afterFailure[i] = static_cast<long long>(i); });
+	check(afterFailure[999] == 999 && std::accumulate(afterFailure.begin(), afterFailure.end(), 0ll) == 999 * 1000 / 2, "the pool is usable after a failed batch");
+
+	// every outer index can run on a pool worker that then waits on an inner batch; the waiter works through its own
+	// batch so this completes even when every worker is blocked in an inner call
+	std::size_t const outer = neolib::thread_pool::default_thread_pool().max_threads() * 4;
+	std::vector<long long> innerSums(outer);
+	neolib::parallel_for(std::size_t{ 0 }, outer, [&](std::size_t i)
+	{
+		std::vector<int> inner(5000);
+		std::iota(inner.begin(), inner.end(), static_cast<int>(i));
+		neolib::parallel_for_each(inner.begin(), inner.end(), [](int& aValue) { aValue *= 2; }, 64);
+		auto sorted = inner;
+		std::reverse(sorted.begin(), sorted.end());
+		neolib::parallel_sort(sorted.begin(), sorted.end());
+		innerSums[i] = sorted == inner ? neolib::parallel_reduce(inner.begin(), inner.end(), 0ll, std::plus<>{}, 64) : -1;
+	}, 1);
+	for (std::size_t i = 0; i < outer; ++i)
+		check(innerSums[i] == 2 * (5000ll * static_cast<long long>(i) + 4999ll * 5000 / 2), "nested parallel calls from pool workers complete with the right result");
+}
+
+void benchmark_parallel_algorithms()
+{
+	const std::size_t ELEMENTS = 10000000;
+
+	std::vector<double> input(ELEMENTS);
+	std::mt19937 rng{ 42 };
+	std::uniform_real_distribution<double> dist{ 0.0, 1.0 };
+	for (auto& e : input)
+		e = dist(rng);
+
+	std::vector<double> serialOutput(ELEMENTS);
+	std::vector<double> parallelOutput(ELEMENTS);
+	auto work = [](double aValue) { return std::sqrt(aValue) * std::sin(aValue); };
+
+	{
+		auto serial = time_ms([&]() { std::transform(input.begin(), input.end(), serialOutput.begin(), work); });
+		auto parallel = time_ms([&]() { neolib::parallel_transform(input.begin(), input.end(), parallelOutput.begin(), work); });
+		report("transform", serial, parallel, serialOutput == parallelOutput);
+	}
+	{
+		std::vector<double> parallelForOutput(ELEMENTS);
+		auto serial = time_ms([&]() { for (std::size_t i = 0; i < ELEMENTS; ++i) serialOutput[i] = work(input[i]); });
+		auto parallel = time_ms([&]() { neolib::parallel_for(std::size_t{ 0 }, ELEMENTS, [&](std::size_t i) { parallelForOutput[i] = work(input[i]); }); });
+		report("for", serial, parallel, serialOutput == parallelForOutput);
+	}
+	{
+		auto serial = time_ms([&]() { std::for_each(serialOutput.begin(), serialOutput.end(), [](double& aValue) { aValue *= 2.0; }); });
+		auto parallel = time_ms([&]() { neolib::parallel_for_each(parallelOutput.begin(), parallelOutput.end(), [](double& aValue) { aValue *= 2.0; }); });
+		report("for_each", serial, parallel, serialOutput == parallelOutput);
+	}
+	{
+		std::vector<uint64_t> values(ELEMENTS);
+		std::iota(values.begin(), values.end(), 0);
+		uint64_t serialSum = 0;
+		uint64_t parallelSum = 0;
+		auto serial = time_ms([&]() { serialSum = std::accumulate(values.begin(), values.end(), uint64_t{ 0 }); });
+		auto parallel = time_ms([&]() { parallelSum = neolib::parallel_reduce(values.begin(), values.end(), uint64_t{ 0 }); });
+		report("reduce", serial, parallel, serialSum == parallelSum);
+	}
+	{
+		std::vector<double> serialSorted = input;
+		std::vector<double> parallelSorted = input;
+		auto serial = time_ms([&]() { std::sort(serialSorted.begin(), serialSorted.end()); });
+		auto parallel = time_ms([&]() { neolib::parallel_sort(parallelSorted.begin(), parallelSorted.end()); });
+		report("sort", serial, parallel, serialSorted == parallelSorted);
+	}
+}
@@ -0,0 +1,623 @@
+#include <neolib/neolib.hpp>
+#include <iostream>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <neolib/segmented_array.hpp>
+#include <neolib/persistent_segmented_array.hpp>
+#include <neolib/tag_array.hpp>
+#include <neolib/parallel_algorithm.hpp>
+#include "test.hpp"
+
+namespace
+{
+	template <typename Duration = std::chrono::milliseconds, typename Function>
+	long long time_taken(Function aFunction)
+	{
+		std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+		aFunction();
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+		return std::chrono::duration_cast<Duration>(end - begin).count();
+	}
+
+	template <typename Container>
+	void benchmark_container(const char* aName, std::size_t aElements, const std::vector<std::size_t>& aIndices, std::size_t aMiddleOperations)
+	{
+		Container container;
+		long long checksum = 0;
+		long long build = time_taken([&]()
+		{
+			for (std::size_t i = 0; i < aElements; ++i)
+				container.push_back(static_cast<int>(i));
+		});
+		long long lookup = time_taken([&]()
+		{
+			for (auto index : aIndices)
+				checksum += container[index];
+		});
+		long long iterate = time_taken([&]()
+		{
+			for (auto value : container)
+				checksum += value;
+		});
+		long long middle = time_taken<std::chrono::microseconds>([&]()
+		{
+			for (std::size_t i = 0; i < aMiddleOperations; ++i)
+			{
+				container.insert(container.begin() + container.size() / 2, static_cast<int>(i));
+				container.erase(container.begin() + container.size() / 3);
+			}
+		});
+		std::cout << "\n" << aName << "\nbuild: " << build << "ms\nindex lookup: " << lookup << "ms\nsequential iteration: " << iterate << "ms\nmiddle insert/erase: " << middle << "us\n(checksum " << checksum << ")" << std::endl;
+	}
+
+	template <typename Container>
+	void benchmark_bulk(const char* aName, const std::vector<int>& aSource, std::size_t aCutAndPastes)
+	{
+		long long checksum = 0;
+		Container container;
+		long long construct = time_taken([&]()
+		{
+			Container built(aSource.begin(), aSource.end());
+			built.swap(container);
+		});
+		long long insertRange = time_taken([&]()
+		{
+			container.insert(container.begin() + container.size() / 2, aSource.begin(), aSource.begin() + aSource.size() / 10);
+		});
+		long long cutAndPaste = time_taken<std::chrono::microseconds>([&]()
+		{
+			for (std::size_t i = 0; i < aCutAndPastes; ++i)
+			{
+				Container tail = container.split(container.begin() + container.size() / 3 + i);
+				container.splice(container.begin() + container.size() / 7, tail);
+			}
+		});
+		checksum += container[container.size() / 2] + container.back();
+		std::cout << "\n" << aName << "\nrange construction: " << construct << "ms\nmiddle range insert: " << insertRange << "ms\nsplit and splice: " << cutAndPaste / aCutAndPastes << "us each\n(checksum " << checksum << ")" << std::endl;
+	}
+	template <typename Container>
+	bool same_as(const Container& aContainer, const std::vector<int>& aReference)
+	{
+		if (aContainer.size() != aReference.size() || !std::equal(aContainer.begin(), aContainer.end(), aReference.begin()))
+			return false;
+		if (!std::equal(aContainer.rbegin(), aContainer.rend(), aReference.rbegin()))
+			return false;
+		for (std::size_t i = 0; i < aReference.size(); i += 1 + aReference.size() / 16)
+			if (aContainer[i] != aReference[i])
+				return false;
+		return true;
+	}
+
+	// applies the same random edits to a container and a std::vector, comparing them as it goes
+	template <typename Container>
+	void edit_against_vector(unsigned aSeed, std::size_t aOperations, std::size_t aSegmentSize)
+	{
+		using neolib::test::check;
+		std::mt19937 random{ aSeed };
+		auto pick = [&](std::size_t aMax) { return std::uniform_int_distribution<std::size_t>{ 0, aMax }(random); };
+		Container container;
+		std::vector<int> reference;
+		int next = 0;
+		for (std::size_t operation = 0; operation < aOperations; ++operation)
+		{
+			std::size_t const position = pick(reference.size());
+			switch (pick(7))
+			{
+			case 0:
+				container.push_back(next);
+				reference.push_back(next++);
+				break;
+			case 1:
+				container.insert(container.begin() + position, next);
+				reference.insert(reference.begin() + position, next++);
+				break;
+			case 2:
+				{
+					std::size_t const count = pick(aSegmentSize * 2 + 3);
+					container.insert(container.begin() + position, count, next);
+					reference.insert(reference.begin() + position, count, next++);
+				}
+				break;
+			case 3:
+				{
+					// multi-element range inserts of up to several segments, into the middle of a segment or not
+					std::vector<int> source(pick(aSegmentSize * 3 + 3));
+					for (auto& value : source)
+						value = next++;
+					container.insert(container.begin() + position, source.begin(), source.end());
+					reference.insert(reference.begin() + position, source.begin(), source.end());
+				}
+				break;
+			case 4:
+				if (!reference.empty())
+				{
+					std::size_t const erased = pick(reference.size() - 1);
+					container.erase(container.begin() + erased);
+					reference.erase(reference.begin() + erased);
+				}
+				break;
+			case 5:
+				{
+					std::size_t const last = std::min(reference.size(), position + pick(aSegmentSize * 3));
+					container.erase(container.begin() + position, container.begin() + last);
+					reference.erase(reference.begin() + position, reference.begin() + last);
+				}
+				break;
+			case 6:
+				if (!reference.empty())
+				{
+					std::size_t const changed = pick(reference.size() - 1);
+					container[changed] = next;
+					reference[changed] = next++;
+				}
+				break;
+			case 7:
+				if (pick(1) == 0)
+				{
+					container.push_front(next);
+					reference.insert(reference.begin(), next++);
+				}
+				else if (!reference.empty())
+				{
+					container.pop_front();
+					reference.erase(reference.begin());
+				}
+				break;
+			}
+			check(container.size() == reference.size(), "size matches std::vector after every edit");
+			if (operation % 16 == 0)
+				check(same_as(container, reference), "contents match std::vector");
+		}
+		check(same_as(container, reference), "contents match std::vector");
+		container.clear();
+		check(container.empty() && container.begin() == container.end(), "clear() empties the container");
+	}
+	// range and copy construction, large range inserts, split and splice, against std::vector
+	template <typename Container>
+	void cut_and_paste_against_vector(unsigned aSeed, std::size_t aSegmentSize)
+	{
+		using neolib::test::check;
+		std::mt19937 random{ aSeed };
+		auto pick = [&](std::size_t aMax) { return std::uniform_int_distribution<std::size_t>{ 0, aMax }(random); };
+		std::vector<int> reference(pick(aSegmentSize * 50));
+		std::iota(reference.begin(), reference.end(), 0);
+		Container container(reference.begin(), reference.end());
+		check(same_as(container, reference), "range construction matches std::vector");
+		Container copy{ container };
+		std::vector<int> const copyReference = reference;
+		check(same_as(copy, copyReference), "copy construction matches std::vector");
+		int next = static_cast<int>(reference.size());
+		for (std::size_t operation = 0; operation < 200; ++operation)
+		{
+			std::size_t const position = pick(reference.size());
+			switch (pick(2))
+			{
+			case 0:
+				{
+					Container tail = container.split(container.begin() + position);
+					std::vector<int> referenceTail(reference.begin() + position, reference.end());
+					reference.erase(reference.begin() + position, reference.end());
+					check(same_as(container, reference) && same_as(tail, referenceTail), "split() matches std::vector");
+					std::size_t const into = pick(reference.size());
+					container.splice(container.begin() + into, tail);
+					reference.insert(reference.begin() + into, referenceTail.begin(), referenceTail.end());
+					check(tail.empty(), "splice() empties its source");
+				}
+				break;
+			case 1:
+				{
+					std::vector<int> source(pick(aSegmentSize * 20));
+					for (auto& value : source)
+						value = next++;
+					Container other(source.begin(), source.end());
+					container.splice(container.begin() + position, other);
+					reference.insert(reference.begin() + position, source.begin(), source.end());
+				}
+				break;
+			case 2:
+				{
+					std::size_t const last = std::min(reference.size(), position + pick(aSegmentSize * 20));
+					container.erase(container.begin() + position, container.begin() + last);
+					reference.erase(reference.begin() + position, reference.begin() + last);
+				}
+				break;
+			}
+			check(same_as(container, reference), "contents match std::vector after split, splice and erase");
+			// the edited array must still take ordinary edits anywhere
+			std::size_t const edit = pick(reference.size());
+			container.insert(container.begin() + edit, next);
+			reference.insert(reference.begin() + edit, next++);
+		}
+		check(same_as(copy, copyReference), "a copy is independent of the original");
+		container = copy;
+		check(same_as(container, copyReference), "copy assignment matches std::vector");
+	}
+	// tag_array tag grouping elements; tag_array rebinds it to its node type and constructs it with the node
+	struct group_tag
+	{
+		template <typename Node>
+		struct rebind
+		{
+			typedef group_tag type;
+		};
+		group_tag(int aGroup) : iGroup{ aGroup }
+		{
+		}
+		template <typename Node>
+		group_tag(Node&, const group_tag& aOther) : iGroup{ aOther.iGroup }
+		{
+		}
+		bool operator==(const group_tag& aOther) const
+		{
+			return iGroup == aOther.iGroup;
+		}
+		bool operator!=(const group_tag& aOther) const
+		{
+			return iGroup != aOther.iGroup;
+		}
+		int iGroup;
+	};
+
+	// for_each_segment() over random sub-ranges must see exactly the elements of the range, in order, as non-empty spans
+	template <typename Container>
+	void traverse_against_vector(Container& aContainer, const std::vector<int>& aReference, std::mt19937& aRandom)
+	{
+		using neolib::test::check;
+		for (std::size_t pass = 0; pass < 50; ++pass)
+		{
+			std::size_t first = std::uniform_int_distribution<std::size_t>{ 0, aReference.size() }(aRandom);
+			std::size_t last = std::uniform_int_distribution<std::size_t>{ 0, aReference.size() }(aRandom);
+			if (first > last)
+				std::swap(first, last);
+			std::vector<int> seen;
+			bool nonEmpty = true;
+			const Container& constContainer = aContainer;
+			constContainer.for_each_segment(constContainer.begin() + first, constContainer.begin() + last, [&](neolib::span<const int> aSegment)
+			{
+				nonEmpty = nonEmpty && !aSegment.empty();
+				seen.insert(seen.end(), aSegment.begin(), aSegment.end());
+			});
+			check(nonEmpty && seen == std::vector<int>(aReference.begin() + first, aReference.begin() + last), "for_each_segment() visits exactly the range");
+		}
+		std::vector<int> seen;
+		aContainer.for_each_segment([&](neolib::span<int> aSegment) { seen.insert(seen.end(), aSegment.begin(), aSegment.end()); });
+		check(seen == aReference, "for_each_segment() visits the whole container");
+	}
+
+	// counts live allocations across every rebinding so that a test can see when all versions' nodes have been freed
+	template <typename T>
+	struct counting_allocator : std::allocator<T>
+	{
+		template <typename U>
+		struct rebind
+		{
+			typedef counting_allocator<U> other;
+		};
+		counting_allocator() = default;
+		template <typename U>
+		counting_allocator(const counting_allocator<U>&)
+		{
+		}
+		T* allocate(std::size_t aCount)
+		{
+			++live_allocations();
+			return std::allocator<T>::allocate(aCount);
+		}
+		void deallocate(T* aPointer, std::size_t aCount)
+		{
+			--live_allocations();
+			std::allocator<T>::deallocate(aPointer, aCount);
+		}
+		static long& live_allocations()
+		{
+			static long sLiveAllocations;
+			return sLiveAllocations;
+		}
+	};
+
+	// random edits applied to a persistent_segmented_array and a std::vector; snapshots taken along the way must keep
+	// matching the vector as it was when they were taken, whatever is done to the live version or to other snapshots
+	template <std::size_t SegmentSize>
+	void version_against_vector(unsigned aSeed, std::size_t aOperations)
+	{
+		using neolib::test::check;
+		typedef neolib::persistent_segmented_array<int, SegmentSize, counting_allocator<int>> container_type;
+		std::mt19937 random{ aSeed };
+		auto pick = [&](std::size_t aMax) { return std::uniform_int_distribution<std::size_t>{ 0, aMax }(random); };
+		{
+			container_type container;
+			std::vector<int> reference;
+			std::vector<std::pair<container_type, std::vector<int>>> versions;
+			int next = 0;
+			for (std::size_t operation = 0; operation < aOperations; ++operation)
+			{
+				std::size_t const position = pick(reference.size());
+				switch (pick(6))
+				{
+				case 0:
+					container.push_back(next);
+					reference.push_back(next++);
+					break;
+				case 1:
+					container.insert(position, next);
+					reference.insert(reference.begin() + position, next++);
+					break;
+				case 2:
+					{
+						std::vector<int> source(pick(SegmentSize * 3));
+						for (auto& value : source)
+							value = next++;
+						container.insert(container.begin() + position, source.begin(), source.end());
+						reference.insert(reference.begin() + position, source.begin(), source.end());
+					}
+					break;
+				case 3:
+					if (!reference.empty())
+					{
+						std::size_t const erased = pick(reference.size() - 1);
+						container.erase(erased);
+						reference.erase(reference.begin() + erased);
+					}
+					break;
+				case 4:
+					{
+						std::size_t const last = std::min(reference.size(), position + pick(SegmentSize * 3));
+						container.erase(container.begin() + position, container.begin() + last);
+						reference.erase(reference.begin() + position, reference.begin() + last);
+					}
+					break;
+				case 5:
+					if (!reference.empty())
+					{
+						std::size_t const changed = pick(reference.size() - 1);
+						container.set(changed, next);
+						reference[changed] = next++;
+					}
+					break;
+				case 6:
+					if (pick(1) == 0)
+					{
+						container.push_front(next);
+						reference.insert(reference.begin(), next++);
+					}
+					else if (!reference.empty())
+					{
+						container.pop_back();
+						reference.pop_back();
+					}
+					break;
+				}
+				check(container.size() == reference.size(), "size matches std::vector after every edit");
+				if (operation % 16 == 0)
+				{
+					check(same_as(container, reference), "contents match std::vector");
+					versions.emplace_back(container.snapshot(), reference);
+				}
+				// editing an older version must leave the live version and the other snapshots alone
+				if (operation % 64 == 32 && !versions.empty())
+				{
+					auto& version = versions[pick(versions.size() - 1)];
+					version.first.push_back(-1);
+					version.second.push_back(-1);
+					if (!version.second.empty())
+					{
+						version.first.set(0, -2);
+						version.second[0] = -2;
+					}
+				}
+			}
+			check(same_as(container, reference), "contents match std::vector");
+			for (auto const& version : versions)
+				check(same_as(version.first, version.second), "a snapshot is unaffected by later edits to any other version");
+			std::vector<int> seen;
+			container.for_each_segment([&](neolib::span<const int> aSegment) { seen.insert(seen.end(), aSegment.begin(), aSegment.end()); });
+			check(seen == reference, "for_each_segment() visits the whole container");
+			container_type copy{ container };
+			container.clear();
+			check(container.empty() && same_as(copy, reference), "clearing a version leaves its copies alone");
+			container = versions.front().first;
+			check(same_as(container, versions.front().second), "copy assignment shares the assigned version");
+		}
+		check(counting_allocator<int>::live_allocations() == 0, "destroying every version frees every node");
+	}
+}
+
+void benchmark_segmented_array()
+{
+	const std::size_t ELEMENTS = 10000000;
+	const std::size_t LOOKUPS = 1000000;
+	const std::size_t MIDDLE_OPERATIONS = 1000;
+	std::mt19937 random;
+	std::vector<std::size_t> indices(LOOKUPS);
+	for (auto& index : indices)
+		index = std::uniform_int_distribution<std::size_t>{ 0, ELEMENTS - 1 }(random);
+	benchmark_container<std::vector<int>>("std::vector", ELEMENTS, indices, MIDDLE_OPERATIONS);
+	benchmark_container<neolib::segmented_array<int, 64, std::allocator<int>, neolib::array_tree>>("segmented_array (red-black array_tree)", ELEMENTS, indices, MIDDLE_OPERATIONS);
+	benchmark_container<neolib::segmented_array<int, 64, std::allocator<int>, neolib::array_btree>>("segmented_array (B+-tree array_btree)", ELEMENTS, indices, MIDDLE_OPERATIONS);
+}
+
+void benchmark_segmented_array_bulk()
+{
+	const std::size_t ELEMENTS = 50000000;
+	const std::size_t CUT_AND_PASTES = 10;
+	std::vector<int> source(ELEMENTS);
+	for (std::size_t i = 0; i < ELEMENTS; ++i)
+		source[i] = static_cast<int>(i);
+	benchmark_bulk<neolib::segmented_array<int, 64, std::allocator<int>, neolib::array_tree>>("segmented_array (red-black array_tree)", source, CUT_AND_PASTES);
+	benchmark_bulk<neolib::segmented_array<int, 64, std::allocator<int>, neolib::array_btree>>("segmented_array (B+-tree array_btree)", source, CUT_AND_PASTES);
+}
+
+void benchmark_segment_traversal()
+{
+	const std::size_t ELEMENTS = 100000000;
+	typedef neolib::segmented_array<int, 64, std::allocator<int>, neolib::array_btree> container_type;
+	std::vector<int> source(ELEMENTS);
+	std::iota(source.begin(), source.end(), 0);
+	container_type container(source.begin(), source.end());
+	long long sum = 0;
+	std::cout << "\n" << ELEMENTS << " elements" << std::endl;
+	std::cout << "std::vector sum: " << time_taken([&]() { sum = std::accumulate(source.begin(), source.end(), 0ll); }) << "ms (" << sum << ")" << std::endl;
+	std::cout << "iterator sum: " << time_taken([&]() { sum = std::accumulate(container.begin(), container.end(), 0ll); }) << "ms (" << sum << ")" << std::endl;
+	std::cout << "for_each_segment sum: " << time_taken([&]()
+	{
+		sum = 0;
+		container.for_each_segment([&](neolib::span<const int> aSegment) { sum = std::accumulate(aSegment.begin(), aSegment.end(), sum); });
+	}) << "ms (" << sum << ")" << std::endl;
+	std::cout << "parallel_reduce_segments sum: " << time_taken([&]()
+	{
+		const container_type& constContainer = container;
+		sum = neolib::parallel_reduce_segments(constContainer, constContainer.begin(), constContainer.end(), 0ll, std::plus<>{},
+			[](long long aPartial, neolib::span<const int> aSegment) { return std::accumulate(aSegment.begin(), aSegment.end(), aPartial); });
+	}) << "ms (" << sum << ")" << std::endl;
+	std::size_t found = 0;
+	std::cout << "for_each_segment search: " << time_taken([&]()
+	{
+		found = 0;
+		container.for_each_segment([&](neolib::span<const int> aSegment) { found += std::count(aSegment.begin(), aSegment.end(), static_cast<int>(ELEMENTS - 1)); });
+	}) << "ms (" << found << ")" << std::endl;
+	std::cout << "iterator transform: " << time_taken([&]() { std::transform(container.begin(), container.end(), container.begin(), [](int aValue) { return aValue ^ 1; }); }) << "ms" << std::endl;
+	std::cout << "for_each_segment transform: " << time_taken([&]()
+	{
+		container.for_each_segment([](neolib::span<int> aSegment) { std::transform(aSegment.begin(), aSegment.end(), aSegment.begin(), [](int aValue) { return aValue ^ 1; }); });
+	}) << "ms" << std::endl;
+	std::cout << "parallel_for_each_segment transform: " << time_taken([&]()
+	{
+		neolib::parallel_for_each_segment(container, container.begin(), container.end(), [](neolib::span<int> aSegment) { std::transform(aSegment.begin(), aSegment.end(), aSegment.begin(), [](int aValue) { return aValue ^ 1; }); });
+	}) << "ms" << std::endl;
+}
+
+void benchmark_persistent_segmented_array()
+{
+	const std::size_t ELEMENTS = 10000000;
+	const std::size_t VERSIONS = 1000;
+	typedef neolib::segmented_array<int, 64, std::allocator<int>, neolib::array_btree> container_type;
+	typedef neolib::persistent_segmented_array<int> persistent_container_type;
+	std::vector<int> source(ELEMENTS);
+	std::iota(source.begin(), source.end(), 0);
+	container_type container(source.begin(), source.end());
+	persistent_container_type persistent(source.begin(), source.end());
+	std::mt19937 random;
+	std::uniform_int_distribution<std::size_t> position{ 0, ELEMENTS - 1 };
+	std::cout << "\n" << ELEMENTS << " elements, " << VERSIONS << " versions each differing by one insert and one update" << std::endl;
+	std::vector<container_type> copies;
+	std::cout << "segmented_array copies: " << time_taken([&]()
+	{
+		for (std::size_t i = 0; i < VERSIONS / 100; ++i)
+		{
+			copies.push_back(container);
+			container.insert(container.begin() + position(random), 0);
+			container[position(random)] = 1;
+		}
+	}) * 100 / VERSIONS << "ms per version (" << copies.size() << " versions)" << std::endl;
+	copies.clear();
+	std::vector<persistent_container_type> snapshots;
+	std::cout << "persistent_segmented_array snapshots: " << time_taken<std::chrono::microseconds>([&]()
+	{
+		for (std::size_t i = 0; i < VERSIONS; ++i)
+		{
+			snapshots.push_back(persistent.snapshot());
+			persistent.insert(position(random), 0);
+			persistent.set(position(random), 1);
+		}
+	}) / VERSIONS << "us per version" << std::endl;
+	std::atomic<bool> stop{ false };
+	std::atomic<std::size_t> passes{ 0 };
+	long long readerSum = 0;
+	std::thread reader([&]()
+	{
+		const persistent_container_type& snapshot = snapshots.front();
+		while (!stop)
+		{
+			readerSum = 0;
+			snapshot.for_each_segment([&](neolib::span<const int> aSegment) { readerSum = std::accumulate(aSegment.begin(), aSegment.end(), readerSum); });
+			++passes;
+		}
+	});
+	std::size_t mutations = 0;
+	std::cout << "writer mutating while a reader sums a snapshot: " << time_taken([&]()
+	{
+		for (; mutations < ELEMENTS / 100; ++mutations)
+		{
+			persistent.erase(position(random) % persistent.size());
+			persistent.insert(position(random) % persistent.size(), 2);
+		}
+		while (passes == 0)
+			std::this_thread::yield();
+		stop = true;
+		reader.join();
+	}) << "ms (" << mutations << " mutations, " << passes << " reader passes, sum " << readerSum << ")" << std::endl;
+}
+void test_segmented_array()
+{
+	for (unsigned seed = 1; seed <= 20; ++seed)
+	{
+		edit_against_vector<neolib::segmented_array<int, 64, std::allocator<int>, neolib::array_tree>>(seed, 2000, 64);
+		edit_against_vector<neolib::segmented_array<int, 64, std::allocator<int>, neolib::array_btree>>(seed, 2000, 64);
+		// small segments put most edits across segment boundaries and grow deep trees quickly
+		edit_against_vector<neolib::segmented_array<int, 4, std::allocator<int>, neolib::array_tree>>(seed, 2000, 4);
+		edit_against_vector<neolib::segmented_array<int, 4, std::allocator<int>, neolib::array_btree>>(seed, 2000, 4);
+	}
+}
+
+void test_segmented_array_bulk()
+{
+	for (unsigned seed = 1; seed <= 20; ++seed)
+	{
+		cut_and_paste_against_vector<neolib::segmented_array<int, 64, std::allocator<int>, neolib::array_tree>>(seed, 64);
+		cut_and_paste_against_vector<neolib::segmented_array<int, 64, std::allocator<int>, neolib::array_btree>>(seed, 64);
+		cut_and_paste_against_vector<neolib::segmented_array<int, 4, std::allocator<int>, neolib::array_tree>>(seed, 4);
+		cut_and_paste_against_vector<neolib::segmented_array<int, 4, std::allocator<int>, neolib::array_btree>>(seed, 4);
+	}
+}
+
+void test_segment_traversal()
+{
+	using neolib::test::check;
+	std::mt19937 random;
+	// random single inserts leave segments of every fill level
+	std::vector<int> reference;
+	neolib::segmented_array<int, 8, std::allocator<int>, neolib::array_tree> redBlack;
+	neolib::segmented_array<int, 8, std::allocator<int>, neolib::array_btree> bPlus;
+	neolib::tag_array<group_tag, int, 8, 16> tagged;
+	for (int i = 0; i < 5000; ++i)
+	{
+		std::size_t const position = std::uniform_int_distribution<std::size_t>{ 0, reference.size() }(random);
+		reference.insert(reference.begin() + position, i);
+		redBlack.insert(redBlack.begin() + position, i);
+		bPlus.insert(bPlus.begin() + position, i);
+	}
+	for (int i = 0; i < 5000; ++i)
+		tagged.push_back(group_tag{ i / 100 }, reference[i]);
+	traverse_against_vector(redBlack, reference, random);
+	traverse_against_vector(bPlus, reference, random);
+	traverse_against_vector(tagged, reference, random);
+
+	bPlus.for_each_segment(bPlus.begin() + 10, bPlus.end() - 10, [](neolib::span<int> aSegment) { for (auto& value : aSegment) value = -value; });
+	for (std::size_t i = 10; i < reference.size() - 10; ++i)
+		reference[i] = -reference[i];
+	check(std::equal(bPlus.begin(), bPlus.end(), reference.begin(), reference.end()), "for_each_segment() can modify elements in place");
+
+	long long const expected = std::accumulate(reference.begin(), reference.end(), 0ll);
+	const auto& constBPlus = bPlus;
+	long long const sum = neolib::parallel_reduce_segments(constBPlus, constBPlus.begin(), constBPlus.end(), 0ll, std::plus<>{},
+		[](long long aPartial, neolib::span<const int> aSegment) { return std::accumulate(aSegment.begin(), aSegment.end(), aPartial); }, 64);
+	check(sum == expected, "parallel_reduce_segments() sums every element once");
+	neolib::parallel_for_each_segment(bPlus, bPlus.begin(), bPlus.end(), [](neolib::span<int> aSegment) { for (auto& value : aSegment) value *= 2; }, 64);
+	std::transform(reference.begin(), reference.end(), reference.begin(), [](int aValue) { return aValue * 2; });
+	check(std::equal(bPlus.begin(), bPlus.end(), reference.begin(), reference.end()), "parallel_for_each_segment() visits every element once");
+}
+
+void test_persistent_segmented_array()
+{
+	for (unsigned seed = 1; seed <= 20; ++seed)
+	{
+		version_against_vector<64>(seed, 2000);
+		// small segments give deep trees, so path copying goes through several inner nodes
+		version_against_vector<4>(seed, 2000);
+	}
+}
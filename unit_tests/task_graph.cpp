@@ -0,0 +1,167 @@
+#include <neolib/neolib.hpp>
+#include <atomic>
+#include <future>
+#include <stdexcept>
+#include <vector>
+#include <neolib/task_graph.hpp>
+#include "test.hpp"
+
+namespace
+{
+	using neolib::test::check;
+
+	template <typename T>
+	bool fails_with_runtime_error(const neolib::task_node<T>& aNode)
+	{
+		try
+		{
+			aNode.get();
+		}
+		catch (const std::runtime_error&)
+		{
+			return true;
+		}
+		catch (...)
+		{
+		}
+		return false;
+	}
+
+	void test_dependency_order(neolib::thread_pool& aThreadPool)
+	{
+		std::atomic<int> sequence{ 0 };
+		// a diamond: d must see both b and c and they must both see a
+		auto a = neolib::spawn([&]() { return ++sequence; }, aThreadPool);
+		auto b = a.then([&](int aA) { return std::make_pair(aA, ++sequence); });
+		auto c = a.then([&](int aA) { return std::make_pair(aA, ++sequence); });
+		auto d = neolib::when_all(b, c).then([&]() { return ++sequence; });
+		d.wait();
+		check(a.get() == 1, "a ran first");
+		check(b.get().first == 1 && c.get().first == 1, "b and c received a's value");
+		check(b.get().second > 1 && c.get().second > 1 && b.get().second != c.get().second, "b and c ran after a");
+		check(d.get() == 4, "d ran after b and c");
+
+		// a long chain runs strictly in order
+		std::vector<int> order;
+		auto chain = neolib::spawn([&]() { order.push_back(0); }, aThreadPool);
+		for (int i = 1; i < 100; ++i)
+			chain = chain.then([&order, i]() { order.push_back(i); });
+		chain.wait();
+		bool inOrder = order.size() == 100;
+		for (int i = 0; inOrder && i < 100; ++i)
+			inOrder = order[i] == i;
+		check(inOrder, "a chain of continuations runs in order");
+	}
+
+	void test_failure_propagation(neolib::thread_pool& aThreadPool)
+	{
+		std::atomic<bool> successorRan{ false };
+		auto failing = neolib::spawn([]() -> int { throw std::runtime_error("failed"); }, aThreadPool);
+		auto successor = failing.then([&](int aValue) { successorRan = true; return aValue; });
+		auto grandSuccessor = successor.then([&](int aValue) { successorRan = true; return aValue; });
+		grandSuccessor.wait();
+		check(failing.failed() && successor.failed() && grandSuccessor.failed(), "a failure fails every successor");
+		check(!successorRan, "successors of a failed node don't run");
+		check(fails_with_runtime_error(grandSuccessor), "successors rethrow the original exception");
+
+		auto good = neolib::spawn([]() { return 1; }, aThreadPool);
+		auto all = neolib::when_all(good, failing);
+		all.wait();
+		check(all.failed(), "when_all fails if any predecessor fails");
+
+		auto any = neolib::when_any(failing, good);
+		any.wait();
+		check(!any.failed() && any.get() == 1, "when_any completes with the first predecessor to complete");
+
+		// a predecessor failing whilst another wins must not touch the winner's outcome
+		bool raced = true;
+		for (int i = 0; i < 200 && raced; ++i)
+		{
+			auto winner = neolib::spawn([i]() { return i; }, aThreadPool);
+			auto loser = neolib::spawn([]() -> int { throw std::runtime_error("failed"); }, aThreadPool);
+			auto race = neolib::when_any(loser, winner);
+			race.wait();
+			raced = !race.failed() && race.get() == 1;
+		}
+		check(raced, "a failing predecessor doesn't affect a when_any that another predecessor has won");
+
+		auto otherFailing = neolib::spawn([]() -> int { throw std::runtime_error("failed"); }, aThreadPool);
+		auto none = neolib::when_any(failing, otherFailing);
+		none.wait();
+		check(none.failed(), "when_any fails only once every predecessor has failed");
+	}
+
+	void test_cancellation(neolib::thread_pool& aThreadPool)
+	{
+		std::promise<void> gate;
+		std::shared_future<void> opened = gate.get_future().share();
+		std::atomic<bool> successorRan{ false };
+		auto blocked = neolib::spawn([opened]() { opened.wait(); return 1; }, aThreadPool);
+		auto successor = blocked.then([&](int aValue) { successorRan = true; return aValue; });
+		auto grandSuccessor = successor.then([&](int aValue) { successorRan = true; return aValue; });
+		successor.cancel();
+		gate.set_value();
+		grandSuccessor.wait();
+		blocked.wait();
+		check(blocked.get() == 1, "cancelling a successor doesn't affect its predecessor");
+		check(successor.cancelled() && grandSuccessor.cancelled() && !successorRan, "cancellation propagates to successors");
+		bool threw = false;
+		try
+		{
+			successor.get();
+		}
+		catch (const neolib::task_cancelled&)
+		{
+			threw = true;
+		}
+		check(threw, "get() on a cancelled node throws task_cancelled");
+
+		auto selfCancelled = neolib::spawn([]() -> int { throw neolib::task_cancelled(); }, aThreadPool);
+		auto afterSelfCancelled = selfCancelled.then([](int aValue) { return aValue; });
+		afterSelfCancelled.wait();
+		check(selfCancelled.cancelled() && afterSelfCancelled.cancelled(), "a body throwing task_cancelled cancels its node");
+	}
+
+	void test_no_cycles(neolib::thread_pool& aThreadPool)
+	{
+		std::promise<void> gate;
+		std::shared_future<void> opened = gate.get_future().share();
+		auto first = neolib::spawn([opened]() { opened.wait(); }, aThreadPool);
+		auto second = first.then([]() {});
+		// a node is linked once, when it is made, so making first depend on second is refused
+		bool refused = false;
+		try
+		{
+			first.state()->link({ second.state() });
+		}
+		catch (const neolib::detail::task_node_base::already_linked&)
+		{
+			refused = true;
+		}
+		refused = refused && [&]()
+		{
+			try
+			{
+				second.state()->link({ first.state() });
+			}
+			catch (const neolib::detail::task_node_base::already_linked&)
+			{
+				return true;
+			}
+			return false;
+		}();
+		gate.set_value();
+		second.wait();
+		check(refused, "linking an existing node (which could form a cycle) throws already_linked");
+		check(first.state()->state() == neolib::detail::task_node_base::node_state::Completed && !second.failed(), "a refused link leaves the graph intact");
+	}
+}
+
+void test_task_graph()
+{
+	neolib::thread_pool threadPool;
+	test_dependency_order(threadPool);
+	test_failure_propagation(threadPool);
+	test_cancellation(threadPool);
+	test_no_cycles(threadPool);
+}
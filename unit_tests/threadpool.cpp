@@ -1,8 +1,53 @@
 #include <neolib/neolib.hpp>
 #include <iostream>
 #include <set>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <memory>
+#include <stdexcept>
 #include <neolib/thread.hpp>
+#include <neolib/lockfree_queue.hpp>
 #include <neolib/thread_pool.hpp>
+#include "test.hpp"
+
+namespace
+{
+	std::atomic<std::size_t> sAllocations;
+
+	bool each_seen_once(const std::vector<std::vector<std::size_t>>& aTaken, std::size_t aItems)
+	{
+		std::vector<std::size_t> seen(aItems);
+		for (auto const& taken : aTaken)
+			for (auto item : taken)
+				if (item >= aItems || ++seen[item] != 1)
+					return false;
+		return std::all_of(seen.begin(), seen.end(), [](std::size_t aCount) { return aCount == 1; });
+	}
+}
+
+// count every heap allocation made by the process so the submission paths can be compared
+void* operator new(std::size_t aSize)
+{
+	++sAllocations;
+	if (void* p = std::malloc(aSize != 0 ? aSize : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* aPointer) noexcept
+{
+	std::free(aPointer);
+}
+
+void operator delete(void* aPointer, std::size_t) noexcept
+{
+	std::free(aPointer);
+}
 
 void benchmark_thread_pool()
 {
@@ -29,3 +74,241 @@ void benchmark_thread_pool()
 	std::cout << "\ncheck: " << s.size() << "\ntime: " << std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count() << "ms" << std::endl;
 }
 
+void benchmark_thread_pool_allocations()
+{
+	neolib::thread_pool threadPool;
+
+	std::vector<int> v;
+	const int ITERATIONS = 100000;
+	v.resize(ITERATIONS);
+
+	// warm up the recycled task slabs
+	for (int i = 0; i < ITERATIONS; ++i)
+		threadPool.run([i, &v]() { v[i] = i; });
+	threadPool.wait();
+
+	auto measure = [&](const char* aName, auto aSubmit)
+	{
+		std::size_t allocationsBefore = sAllocations;
+		std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+		for (int i = 0; i < ITERATIONS; ++i)
+			aSubmit(i);
+		threadPool.wait();
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+		std::cout << "\n" << aName << 
+			"\nallocations per task: " << static_cast<double>(sAllocations - allocationsBefore) / ITERATIONS <<
+			"\ntime: " << std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count() << "ms" << std::endl;
+	};
+	measure("run()", [&](int i) { threadPool.run([i, &v]() { v[i] = i; }); });
+	measure("post()", [&](int i) { threadPool.post([i, &v]() { v[i] = i; }); });
+}
+
+// submission throughput as the number of submitting threads grows, from outside the pool and from its own workers
+void benchmark_thread_pool_scaling()
+{
+	neolib::thread_pool threadPool;
+
+	const std::size_t TASKS = 1000000;
+	std::vector<int> v(TASKS);
+
+	auto measure = [&](auto aSubmit)
+	{
+		std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+		aSubmit();
+		threadPool.wait();
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+		return std::max<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count(), 1);
+	};
+	std::cout << "\n" << TASKS << " tasks, " << threadPool.max_threads() << " pool threads" << std::endl;
+	for (std::size_t submitters = 1; submitters <= threadPool.max_threads(); submitters *= 2)
+	{
+		// external threads post to the worker inboxes
+		auto external = measure([&]()
+		{
+			std::vector<std::thread> threads;
+			for (std::size_t s = 0; s < submitters; ++s)
+				threads.emplace_back([&, s]()
+				{
+					for (std::size_t i = s; i < TASKS; i += submitters)
+						threadPool.post([i, &v]() { v[i] = static_cast<int>(i); });
+				});
+			for (auto& t : threads)
+				t.join();
+		});
+		// workers fan out onto their own deques
+		auto fanOut = measure([&]()
+		{
+			for (std::size_t s = 0; s < submitters; ++s)
+				threadPool.post([&, s]()
+				{
+					for (std::size_t i = s; i < TASKS; i += submitters)
+						threadPool.post([i, &v]() { v[i] = static_cast<int>(i); });
+				});
+		});
+		std::cout << submitters << " submitter(s): " << TASKS / external << " tasks/ms posted externally, " << 
+			TASKS / fanOut << " tasks/ms fanned out" << std::endl;
+	}
+}
+
+void test_work_stealing_deque()
+{
+	using neolib::test::check;
+	{
+		neolib::work_stealing_deque<std::size_t> deque{ 2 };
+		std::size_t item = 0;
+		check(deque.empty() && !deque.pop(item) && !deque.steal(item), "a new deque is empty");
+		for (std::size_t i = 0; i < 10; ++i)
+			deque.push(i);
+		check(deque.size() == 10, "a deque grows past its initial capacity");
+		check(deque.pop(item) && item == 9 && deque.steal(item) && item == 0, "the owner pops the newest item and a thief steals the oldest");
+		std::size_t expected = 8;
+		while (deque.pop(item))
+			check(item == expected--, "the owner pops newest first");
+		check(expected == 0 && deque.empty() && !deque.steal(item), "a drained deque is empty");
+	}
+
+	// the owner pushes in doubling bursts, so the array grows whilst thieves are stealing from it, and pops half of
+	// each burst back; every item must be taken exactly once
+	const std::size_t BURSTS = 17;
+	const std::size_t THIEVES = 3;
+	neolib::work_stealing_deque<std::size_t> deque{ 2 };
+	std::atomic<bool> done{ false };
+	std::vector<std::vector<std::size_t>> taken(THIEVES + 1);
+	std::vector<std::thread> thieves;
+	for (std::size_t t = 0; t < THIEVES; ++t)
+		thieves.emplace_back([&, t]()
+		{
+			std::size_t item;
+			while (!done.load(std::memory_order_acquire))
+				if (deque.steal(item))
+					taken[t].push_back(item);
+				else
+					std::this_thread::yield();
+		});
+	std::size_t pushed = 0;
+	std::size_t item;
+	for (std::size_t burst = 0; burst < BURSTS; ++burst)
+	{
+		for (std::size_t i = 0; i < (std::size_t{ 1 } << burst); ++i)
+			deque.push(pushed++);
+		for (std::size_t i = 0; i < (std::size_t{ 1 } << burst) / 2 && deque.pop(item); ++i)
+			taken[THIEVES].push_back(item);
+	}
+	while (deque.pop(item))
+		taken[THIEVES].push_back(item);
+	done.store(true, std::memory_order_release);
+	for (auto& thief : thieves)
+		thief.join();
+	check(deque.empty() && each_seen_once(taken, pushed), "each item is popped or stolen exactly once");
+}
+
+void test_bounded_mpmc_queue()
+{
+	using neolib::test::check;
+	check(neolib::bounded_mpmc_queue<int>{ 5 }.capacity() == 8 && neolib::bounded_mpmc_queue<int>{ 1 }.capacity() == 2, 
+		"capacity is rounded up to a power of two of at least two");
+
+	neolib::bounded_mpmc_queue<std::size_t> queue{ 4 };
+	std::size_t item = 0;
+	check(queue.empty() && !queue.try_pop(item), "a new queue is empty");
+	// go round the ring several times, popping a different number of items each lap, so that full and empty are
+	// reached at every offset
+	std::size_t next = 0;
+	std::size_t expected = 0;
+	for (std::size_t lap = 0; lap < 3 * queue.capacity(); ++lap)
+	{
+		while (queue.try_push(next))
+			++next;
+		check(next - expected == queue.capacity() && !queue.empty(), "a queue takes items until it holds its capacity");
+		for (std::size_t i = 0; i <= lap % queue.capacity(); ++i)
+			check(queue.try_pop(item) && item == expected++, "items leave a queue in the order they arrived");
+	}
+	while (queue.try_pop(item))
+		check(item == expected++, "items leave a queue in the order they arrived");
+	check(expected == next && queue.empty(), "a drained queue is empty");
+
+	// a queue this small is nearly always full or empty so producers and consumers keep meeting at the boundaries
+	const std::size_t PRODUCERS = 2;
+	const std::size_t CONSUMERS = 2;
+	const std::size_t ITEMS = 100000;
+	std::atomic<std::size_t> consumed{ 0 };
+	std::vector<std::vector<std::size_t>> received(CONSUMERS);
+	std::vector<std::thread> threads;
+	for (std::size_t p = 0; p < PRODUCERS; ++p)
+		threads.emplace_back([&, p]()
+		{
+			for (std::size_t i = p; i < ITEMS; i += PRODUCERS)
+				while (!queue.try_push(i))
+					std::this_thread::yield();
+		});
+	for (std::size_t c = 0; c < CONSUMERS; ++c)
+		threads.emplace_back([&, c]()
+		{
+			std::size_t item;
+			while (consumed.load() < ITEMS)
+				if (queue.try_pop(item))
+				{
+					received[c].push_back(item);
+					++consumed;
+				}
+				else
+					std::this_thread::yield();
+		});
+	for (auto& t : threads)
+		t.join();
+	check(queue.empty() && each_seen_once(received, ITEMS), "each item pushed is popped exactly once");
+}
+
+void test_thread_pool()
+{
+	using neolib::test::check;
+	neolib::thread_pool threadPool;
+
+	auto answer = threadPool.run([]() { return 42; });
+	check(answer.first.get() == 42, "run() delivers the task's result");
+
+	auto failing = threadPool.run([]() -> int { throw std::runtime_error("task failed"); });
+	bool rethrown = false;
+	try
+	{
+		failing.first.get();
+	}
+	catch (const std::runtime_error&)
+	{
+		rethrown = true;
+	}
+	check(rethrown, "run() delivers the task's exception through its future");
+
+	// tasks that throw still count as completed so wait() returns, and their exceptions go to the pool's handler
+	std::atomic<int> completed{ 0 };
+	std::atomic<int> handled{ 0 };
+	threadPool.set_exception_handler([&handled](std::exception_ptr aException)
+	{
+		try
+		{
+			std::rethrow_exception(aException);
+		}
+		catch (const std::runtime_error&)
+		{
+			++handled;
+		}
+		throw std::logic_error("a throwing handler doesn't stop the pool");
+	});
+	const int TASKS = 1000;
+	for (int i = 0; i < TASKS; ++i)
+		threadPool.post([i, &completed]()
+		{
+			++completed;
+			if (i % 100 == 0)
+				throw std::runtime_error("posted task failed");
+		});
+	threadPool.wait();
+	check(completed == TASKS && threadPool.idle(), "wait() returns once throwing tasks have run");
+	check(handled == TASKS / 100, "the exception handler sees each posted task's exception");
+	threadPool.set_exception_handler(nullptr);
+
+	// move-only callables can be run
+	auto value = std::make_unique<int>(7);
+	auto moved = threadPool.run([value = std::move(value)]() { return *value; });
+	check(moved.first.get() == 7, "run() accepts move-only callables");
+}
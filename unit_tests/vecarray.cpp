@@ -0,0 +1,139 @@
+#include <neolib/neolib.hpp>
+#include <iostream>
+#include <random>
+#include <chrono>
+#include <vector>
+#include <stdexcept>
+#include <neolib/vecarray.hpp>
+#include "test.hpp"
+
+namespace
+{
+	// Owns a heap allocation so is neither trivially copyable nor trivially destructible.
+	template <bool Relocatable>
+	struct owned_int
+	{
+		owned_int(int aValue = 0) : value{ new int{ aValue } } {}
+		owned_int(const owned_int& aOther) : value{ new int{ *aOther.value } } {}
+		owned_int(owned_int&& aOther) : value{ aOther.value } { aOther.value = nullptr; }
+		~owned_int() { delete value; }
+		owned_int& operator=(const owned_int& aOther) { *value = *aOther.value; return *this; }
+		owned_int& operator=(owned_int&& aOther) { std::swap(value, aOther.value); return *this; }
+		int* value;
+	};
+
+	// Relocatable but copying throws once the shared budget of copies runs out.
+	struct fallible_int
+	{
+		fallible_int(int aValue = 0) : value{ aValue } {}
+		fallible_int(const fallible_int& aOther) : value{ aOther.value }
+		{
+			if (copies_left()-- == 0)
+				throw std::runtime_error("fallible_int");
+		}
+		fallible_int& operator=(const fallible_int&) = default;
+		static int& copies_left()
+		{
+			static int sCopiesLeft = -1;
+			return sCopiesLeft;
+		}
+		int value;
+	};
+}
+
+namespace neolib
+{
+	template <>
+	struct is_trivially_relocatable<owned_int<true>> : std::true_type {};
+	template <>
+	struct is_trivially_relocatable<fallible_int> : std::true_type {};
+}
+
+namespace
+{
+	template <typename Function>
+	long long time_taken(Function aFunction)
+	{
+		std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+		aFunction();
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+		return std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count();
+	}
+
+	template <typename T>
+	void benchmark_churn(const char* aName, std::size_t aIterations)
+	{
+		typedef neolib::vecarray<T, 64, 64, neolib::nocheck> segment_type;
+		std::mt19937 random;
+		segment_type segment(48, T{ 1 });
+		long long churn = time_taken([&]()
+		{
+			for (std::size_t i = 0; i < aIterations; ++i)
+			{
+				segment.insert(segment.begin() + random() % (segment.size() + 1), T{ static_cast<int>(i) });
+				segment.erase(segment.begin() + random() % segment.size());
+			}
+		});
+		std::cout << aName << ": " << churn << "ms (" << segment.size() << " elements)" << std::endl;
+	}
+}
+
+void benchmark_vecarray()
+{
+	const std::size_t ITERATIONS = 10000000;
+	std::cout << "\n" << ITERATIONS << " random insert/erase pairs on a 48 element vecarray<T, 64>" << std::endl;
+	benchmark_churn<owned_int<false>>("owned_int, element-wise moves", ITERATIONS);
+	benchmark_churn<owned_int<true>>("owned_int, is_trivially_relocatable", ITERATIONS);
+	benchmark_churn<int>("int", ITERATIONS);
+}
+
+void test_vecarray()
+{
+	using neolib::test::check;
+	typedef neolib::vecarray<fallible_int, 64, 64> segment_type;
+	auto values = [](const segment_type& aSegment)
+	{
+		std::vector<int> result;
+		for (auto const& element : aSegment)
+			result.push_back(element.value);
+		return result;
+	};
+	std::vector<int> expected;
+	segment_type segment;
+	for (int i = 0; i < 16; ++i)
+	{
+		segment.push_back(fallible_int{ i });
+		expected.push_back(i);
+	}
+	fallible_int const source[8] = { 100, 101, 102, 103, 104, 105, 106, 107 };
+	for (int budget = 0; budget < 8; ++budget)
+	{
+		// the fill overload copies its value once before opening the gap
+		fallible_int::copies_left() = budget + 1;
+		bool threw = false;
+		try
+		{
+			segment.insert(segment.begin() + 4, 8, fallible_int{ -1 });
+		}
+		catch (const std::runtime_error&)
+		{
+			threw = true;
+		}
+		check(threw && values(segment) == expected, "a throwing fill insert leaves the vecarray as it was");
+		fallible_int::copies_left() = budget;
+		threw = false;
+		try
+		{
+			segment.insert(segment.begin() + 4, std::begin(source), std::end(source));
+		}
+		catch (const std::runtime_error&)
+		{
+			threw = true;
+		}
+		check(threw && values(segment) == expected, "a throwing range insert leaves the vecarray as it was");
+	}
+	fallible_int::copies_left() = -1;
+	segment.insert(segment.begin() + 4, 2, fallible_int{ -1 });
+	expected.insert(expected.begin() + 4, 2, -1);
+	check(values(segment) == expected, "fill insert still works after a failure");
+}
@@ -0,0 +1,174 @@
+#include <neolib/neolib.hpp>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <neolib/crc.hpp>
+#include <neolib/thread_pool.hpp>
+#include <neolib/zip.hpp>
+#include "test.hpp"
+
+namespace
+{
+	struct test_entry
+	{
+		std::string path;
+		std::string data;
+		bool corrupt;
+	};
+
+	template <typename T>
+	void put(std::vector<uint8_t>& aArchive, T aValue)
+	{
+		uint8_t bytes[sizeof(T)];
+		std::memcpy(bytes, &aValue, sizeof(T));
+		aArchive.insert(aArchive.end(), bytes, bytes + sizeof(T));
+	}
+
+	// Builds an archive of stored entries; a corrupt entry has a CRC that doesn't match its data. With aZip64 the
+	// central directory is found through a ZIP64 record (carrying some extensible data) and its locator.
+	neolib::zip::buffer_type make_archive(const std::vector<test_entry>& aEntries, std::size_t aPrepended = 0, bool aZip64 = false)
+	{
+		std::vector<uint8_t> archive(aPrepended, 0xAA);
+		std::vector<uint32_t> offsets;
+		for (auto const& entry : aEntries)
+		{
+			// offsets are as the archiver wrote them, before anything was prepended
+			offsets.push_back(static_cast<uint32_t>(archive.size() - aPrepended));
+			uint32_t const crc = neolib::crc32(reinterpret_cast<const uint8_t*>(entry.data.data()), entry.data.size()) ^ (entry.corrupt ? 1u : 0u);
+			put<uint32_t>(archive, 0x04034b50);
+			put<uint16_t>(archive, 20);
+			put<uint16_t>(archive, 0);
+			put<uint16_t>(archive, 0);
+			put<uint16_t>(archive, 0);
+			put<uint16_t>(archive, 0);
+			put<uint32_t>(archive, crc);
+			put<uint32_t>(archive, static_cast<uint32_t>(entry.data.size()));
+			put<uint32_t>(archive, static_cast<uint32_t>(entry.data.size()));
+			put<uint16_t>(archive, static_cast<uint16_t>(entry.path.size()));
+			put<uint16_t>(archive, 0);
+			archive.insert(archive.end(), entry.path.begin(), entry.path.end());
+			archive.insert(archive.end(), entry.data.begin(), entry.data.end());
+		}
+		std::size_t const dirOffset = archive.size() - aPrepended;
+		for (std::size_t i = 0; i < aEntries.size(); ++i)
+		{
+			auto const& entry = aEntries[i];
+			uint32_t const crc = neolib::crc32(reinterpret_cast<const uint8_t*>(entry.data.data()), entry.data.size()) ^ (entry.corrupt ? 1u : 0u);
+			put<uint32_t>(archive, 0x02014b50);
+			put<uint16_t>(archive, 20);
+			put<uint16_t>(archive, 20);
+			put<uint16_t>(archive, 0);
+			put<uint16_t>(archive, 0);
+			put<uint16_t>(archive, 0);
+			put<uint16_t>(archive, 0);
+			put<uint32_t>(archive, crc);
+			put<uint32_t>(archive, static_cast<uint32_t>(entry.data.size()));
+			put<uint32_t>(archive, static_cast<uint32_t>(entry.data.size()));
+			put<uint16_t>(archive, static_cast<uint16_t>(entry.path.size()));
+			put<uint16_t>(archive, 0);
+			put<uint16_t>(archive, 0);
+			put<uint16_t>(archive, 0);
+			put<uint16_t>(archive, 0);
+			put<uint32_t>(archive, 0);
+			put<uint32_t>(archive, offsets[i]);
+			archive.insert(archive.end(), entry.path.begin(), entry.path.end());
+		}
+		std::size_t const dirSize = archive.size() - aPrepended - dirOffset;
+		if (aZip64)
+		{
+			std::size_t const recordOffset = archive.size() - aPrepended;
+			std::size_t const extensibleData = 8;
+			put<uint32_t>(archive, 0x06064b50);
+			put<uint64_t>(archive, 44 + extensibleData);
+			put<uint16_t>(archive, 45);
+			put<uint16_t>(archive, 45);
+			put<uint32_t>(archive, 0);
+			put<uint32_t>(archive, 0);
+			put<uint64_t>(archive, aEntries.size());
+			put<uint64_t>(archive, aEntries.size());
+			put<uint64_t>(archive, dirSize);
+			put<uint64_t>(archive, dirOffset);
+			archive.insert(archive.end(), extensibleData, 0);
+			put<uint32_t>(archive, 0x07064b50);
+			put<uint32_t>(archive, 0);
+			put<uint64_t>(archive, recordOffset);
+			put<uint32_t>(archive, 1);
+		}
+		put<uint32_t>(archive, 0x06054b50);
+		put<uint16_t>(archive, 0);
+		put<uint16_t>(archive, 0);
+		put<uint16_t>(archive, aZip64 ? 0xFFFF : static_cast<uint16_t>(aEntries.size()));
+		put<uint16_t>(archive, aZip64 ? 0xFFFF : static_cast<uint16_t>(aEntries.size()));
+		put<uint32_t>(archive, aZip64 ? 0xFFFFFFFF : static_cast<uint32_t>(dirSize));
+		put<uint32_t>(archive, aZip64 ? 0xFFFFFFFF : static_cast<uint32_t>(dirOffset));
+		put<uint16_t>(archive, 0);
+		return archive;
+	}
+
+	std::string file_contents(const boost::filesystem::path& aPath)
+	{
+		std::ifstream in{ aPath.string(), std::ios::binary };
+		return std::string{ std::istreambuf_iterator<char>{ in }, std::istreambuf_iterator<char>{} };
+	}
+}
+
+void test_zip()
+{
+	using neolib::test::check;
+	neolib::thread_pool threadPool;
+	boost::filesystem::path const root = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+	boost::filesystem::path const target = root / "target";
+	boost::filesystem::create_directories(target);
+
+	std::vector<test_entry> const good = { { "a.txt", "alpha", false }, { "dir/", "", false }, { "dir/b.txt", "bravo", false } };
+	for (std::size_t prepended : { 0, 100 })
+		for (bool zip64 : { false, true })
+		{
+			neolib::zip archive{ make_archive(good, prepended, zip64) };
+			check(archive.ok() && archive.file_count() == 3, "a good archive parses, with or without prepended data and ZIP64 records");
+			check(archive.extract_to_string(archive.index_of("dir/b.txt")) == "bravo", "an entry of a good archive extracts");
+		}
+	{
+		neolib::zip archive{ make_archive(good, 100, true) };
+		check(archive.extract_all(threadPool, target.string()), "extract_all() of a good archive succeeds");
+		check(file_contents(target / "a.txt") == "alpha" && file_contents(target / "dir" / "b.txt") == "bravo", "extract_all() writes every file");
+	}
+
+	{
+		neolib::zip empty{ make_archive({}) };
+		check(empty.ok() && empty.file_count() == 0, "an empty archive, its end record at the start of the data, parses");
+		neolib::zip archive{ make_archive({ { "win\\", "", false }, { "win\\d.txt", "delta", false } }) };
+		check(archive.extract(0, target.string()) && boost::filesystem::is_directory(target / "win"), "extract() of a directory entry ending in a backslash creates the directory");
+		check(archive.extract(1, target.string()) && file_contents(target / "win" / "d.txt") == "delta", "entries within it then extract");
+	}
+
+	{
+		neolib::zip archive{ make_archive({ { "bad.txt", "corrupt", true }, { "good.txt", "fine", false } }) };
+		neolib::zip::buffer_type buffer;
+		check(archive.ok() && !archive.extract_to(0, buffer), "a corrupt entry fails to extract");
+		check(archive.ok() && archive.extract_to(1, buffer) && std::string(buffer.begin(), buffer.end()) == "fine", "a failed entry doesn't fail later extractions");
+		check(!archive.extract_all(threadPool, target.string()), "extract_all() fails if an entry is corrupt");
+		check(file_contents(target / "good.txt") == "fine", "extract_all() still extracts the good entries");
+	}
+
+	{
+		std::vector<test_entry> const malicious = {
+			{ "../escaped.txt", "x", false },
+			{ "dir/../../escaped2.txt", "x", false },
+			{ (root / "absolute.txt").string(), "x", false },
+			{ "\\escaped3.txt", "x", false },
+			{ "./dir/./c.txt", "charlie", false } };
+		neolib::zip archive{ make_archive(malicious) };
+		check(archive.ok(), "an archive with malicious paths parses");
+		for (std::size_t i = 0; i < 4; ++i)
+			check(!archive.extract(i, target.string()), "an entry escaping the target directory is refused");
+		check(!archive.extract_all(threadPool, target.string()), "extract_all() fails if an entry escapes the target directory");
+		check(!boost::filesystem::exists(root / "escaped.txt") && !boost::filesystem::exists(root / "escaped2.txt") &&
+			!boost::filesystem::exists(root / "absolute.txt") && !boost::filesystem::exists(root / "escaped3.txt"), "nothing is written outside the target directory");
+		check(file_contents(target / "dir" / "c.txt") == "charlie", "an entry with harmless dot components is extracted");
+	}
+	boost::filesystem::remove_all(root);
+}